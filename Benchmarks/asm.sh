@@ -0,0 +1,57 @@
+#!/bin/bash
+#
+# Filename   : asm.sh
+# Author     : Philip Androwick
+# Description: Times the kernels in Benchmarks/kernels compiled to x86-64
+#              with registers allocated by linear scan, against the
+#              stack code generator (--stack-code) and the virtual
+#              machine (--run).  Run from the repository root after make;
+#              needs as and ld.  Usage: Benchmarks/asm.sh [runs]
+#
+
+RUNS=${1:-3}
+
+# Kernel and its input
+KERNELS=("fib 30" "sieve 1000000 10" "sort 500000" "matmul 200")
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Best time of RUNS runs of a command given the input, in ms; the
+# output of the last run is left in $output
+best_of () {
+  local input=$1
+  shift
+  best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    start=$(date +%s%N)
+    output=$(echo "$input" | "$@") || exit 1
+    elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+}
+
+echo "best of $RUNS runs"
+printf "%-8s %10s %10s %10s\n" "" "vm" "stack" "regalloc"
+for kernel in "${KERNELS[@]}"; do
+  set -- $kernel
+  name=$1
+  shift
+  input="$*"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name.cm"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name-stack.cm"
+  ./CMinus --emit=asm --link "$WORK/$name.cm" > /dev/null || exit 1
+  ./CMinus --emit=asm --link --stack-code "$WORK/$name-stack.cm" > /dev/null || exit 1
+
+  best_of "$input" ./CMinus --run "Benchmarks/kernels/$name.cm"
+  vm=$best
+  expected=$output
+  best_of "$input" "$WORK/$name-stack"
+  stack=$best
+  [ "$output" == "$expected" ] || { echo "$name: stack code output differs"; exit 1; }
+  best_of "$input" "$WORK/$name"
+  [ "$output" == "$expected" ] || { echo "$name: register allocated output differs"; exit 1; }
+  printf "%-8s %7d ms %7d ms %7d ms  (%s)\n" "$name" "$vm" "$stack" "$best" "$(echo $output)"
+done
@@ -0,0 +1,59 @@
+#!/bin/bash
+#
+# Filename   : c.sh
+# Author     : Philip Androwick
+# Description: Translates the kernels in Benchmarks/kernels to C
+#              (--emit=c), compiles them with $CC (gcc by default) at
+#              -O3 and times them against the register allocated native
+#              code (--emit=asm --link).  Run from the repository root
+#              after make.  Usage: Benchmarks/c.sh [runs]
+#
+
+RUNS=${1:-3}
+CC=${CC:-gcc}
+
+# Kernel and its input
+KERNELS=("fib 30" "sieve 1000000 10" "sort 500000" "matmul 200")
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Best time of RUNS runs of a command given the input, in ms; the
+# output of the last run is left in $output
+best_of () {
+  local input=$1 run
+  shift
+  best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    start=$(date +%s%N)
+    output=$(echo "$input" | "$@") || exit 1
+    elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+}
+
+echo "best of $RUNS runs"
+printf "%-8s %10s %10s %10s\n" "" "$CC build" "$CC -O3" "regalloc"
+for kernel in "${KERNELS[@]}"; do
+  set -- $kernel
+  name=$1
+  shift
+  input="$*"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name.cm"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name-c.cm"
+  ./CMinus --emit=asm --link "$WORK/$name.cm" > /dev/null || exit 1
+  ./CMinus --emit=c "$WORK/$name-c.cm" > /dev/null || exit 1
+
+  start=$(date +%s%N)
+  $CC -std=c99 -O3 -I Codegen -o "$WORK/$name-c" "$WORK/$name-c.c" || exit 1
+  build=$(( ($(date +%s%N) - start) / 1000000 ))
+
+  best_of "$input" "$WORK/$name"
+  native=$best
+  expected=$output
+  best_of "$input" "$WORK/$name-c"
+  [ "$output" == "$expected" ] || { echo "$name: C output differs"; exit 1; }
+  printf "%-8s %7d ms %7d ms %7d ms  (%s)\n" "$name" "$build" "$best" "$native" "$(echo $output)"
+done
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+#
+# Filename   : generate.py
+# Author     : Philip Androwick
+# Description: Writes a large, valid C- program to stdout for timing the
+#              compiler.  Usage: generate.py [functions]
+#
+
+import sys
+
+def main ():
+  count = int (sys.argv[1]) if len (sys.argv) > 1 else 2000
+
+  print ("int table[100];")
+  print ("int total;")
+  print ()
+  for n in range (count):
+    print ("/* Function %d */" % n)
+    print ("int f%s (int x)" % name (n))
+    print ("{")
+    print ("  int i;")
+    print ("  int sum;")
+    print ("  i = 0;")
+    print ("  sum = x * %d;" % (n % 97 + 1))
+    print ("  while (i < 10)")
+    print ("  {")
+    print ("    if (table[i] > sum)")
+    print ("      sum = sum + table[i] / 2 - (i * 3 + x);")
+    print ("    else")
+    print ("      sum = sum - 1;")
+    print ("    i = i + 1;")
+    print ("  }")
+    if n > 0:
+      print ("  total = total + f%s (sum);" % name (n - 1))
+    print ("  return sum;")
+    print ("}")
+    print ()
+  print ("void main (void)")
+  print ("{")
+  print ("  input (total);")
+  print ("  output (f%s (total));" % name (count - 1))
+  print ("}")
+
+# C- identifiers are letters only
+def name (n):
+  letters = ""
+  while True:
+    letters = chr (ord ('a') + n % 26) + letters
+    n //= 26
+    if n == 0:
+      return letters
+
+main ()
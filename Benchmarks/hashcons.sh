@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Filename   : hashcons.sh
+# Author     : Philip Androwick
+# Description: Compares compiles without and with hash-consing on the
+#              given C- files, or on a generated program when none are
+#              given: the AST's arena bytes, those plus the bytes of the
+#              hash-consing tables, the peak memory of the process and
+#              the wall time.  Run from the repository root after make.
+#              Usage: Benchmarks/hashcons.sh [file.cm ...]
+#
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+FILES=("$@")
+if [ ${#FILES[@]} -eq 0 ]; then
+  python3 Benchmarks/generate.py 2000 > "$WORK/generated.cm"
+  FILES=("$WORK/generated.cm")
+fi
+
+# Prints arena bytes, arena and table bytes, peak KB and milliseconds
+measure ()
+{
+  local start=$(date +%s%N)
+  ./CMinus "$@" --stats "$WORK/input.cm" 2> "$WORK/stats" > /dev/null || return 1
+  local elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+  awk -v ms="$elapsed" '
+    /^AST:/ { arena = $4 }
+    /hash-consing shared/ { tables = $(NF - 1) }
+    /^Peak memory:/ { peak = $3 }
+    END { print arena, arena + tables, peak, ms }' "$WORK/stats"
+}
+
+for file in "${FILES[@]}"; do
+  cp "$file" "$WORK/input.cm"
+  if ! plain=($(measure)) || ! shared=($(measure --hash-cons)); then
+    echo "$(basename "$file"): does not compile"
+    continue
+  fi
+  echo "$(basename "$file"):"
+  echo "  AST bytes          ${plain[0]} -> ${shared[0]}"
+  echo "  with tables        ${plain[1]} -> ${shared[1]}"
+  echo "  peak memory (KB)   ${plain[2]} -> ${shared[2]}"
+  echo "  time (ms)          ${plain[3]} -> ${shared[3]}"
+done
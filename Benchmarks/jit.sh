@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# Filename   : jit.sh
+# Author     : Philip Androwick
+# Description: Times compiling and running the kernels in
+#              Benchmarks/kernels in the compiler's process (--jit)
+#              against building an executable ahead of time (--emit=asm
+#              --link) and running it.  Run from the repository root
+#              after make; needs as and ld.  Usage: Benchmarks/jit.sh [runs]
+#
+
+RUNS=${1:-3}
+
+# Kernel and its input
+KERNELS=("fib 30" "sieve 1000000 10" "sort 500000" "matmul 200")
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Best time of RUNS runs of a command given the input, in ms; the
+# output of the last run is left in $output
+best_of () {
+  local input=$1 run
+  shift
+  best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    start=$(date +%s%N)
+    output=$(echo "$input" | "$@") || exit 1
+    elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+}
+
+echo "best of $RUNS runs"
+printf "%-8s %10s %10s %10s %10s\n" "" "jit" "aot build" "aot run" "aot total"
+for kernel in "${KERNELS[@]}"; do
+  set -- $kernel
+  name=$1
+  shift
+  input="$*"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name.cm"
+
+  best_of "" ./CMinus --emit=asm --link "$WORK/$name.cm"
+  build=$best
+  best_of "$input" "$WORK/$name"
+  run=$best
+  expected=$output
+  best_of "$input" ./CMinus --jit "Benchmarks/kernels/$name.cm"
+  [ "$output" == "$expected" ] || { echo "$name: jit output differs"; exit 1; }
+  printf "%-8s %7d ms %7d ms %7d ms %7d ms  (%s)\n" "$name" "$best" "$build" "$run" "$((build + run))" \
+         "$(echo $output)"
+done
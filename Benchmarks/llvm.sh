@@ -0,0 +1,79 @@
+#!/bin/bash
+#
+# Filename   : llvm.sh
+# Author     : Philip Androwick
+# Description: Translates the kernels in Benchmarks/kernels to LLVM IR
+#              (--emit=llvm), optimizes it with opt at -O0 (no mem2reg,
+#              variables stay in memory) and -O2, compiles it with llc,
+#              links it with as and ld, and times the results against
+#              the register allocated native code (--emit=asm --link).
+#              Every output is checked against --run.  Run from the
+#              repository root after make.  Usage: Benchmarks/llvm.sh [runs]
+#
+
+RUNS=${1:-3}
+
+for tool in opt llc as ld; do
+  command -v $tool > /dev/null || { echo "$tool not found; skipping"; exit 0; }
+done
+
+# Kernel and its input
+KERNELS=("fib 30" "sieve 1000000 10" "sort 500000" "matmul 200")
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Best time of RUNS runs of a command given the input, in ms; the
+# output of the last run is left in $output
+best_of () {
+  local input=$1 run
+  shift
+  best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    start=$(date +%s%N)
+    output=$(echo "$input" | "$@") || exit 1
+    elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+}
+
+# Optimizes, compiles and links $WORK/$1.ll at opt level $2 into
+# $WORK/$1$2
+build () {
+  opt "$2" "$WORK/$1.ll" -o "$WORK/$1$2.bc" || exit 1
+  llc -O2 "$WORK/$1$2.bc" -o "$WORK/$1$2.s" || exit 1
+  as "$WORK/$1$2.s" -o "$WORK/$1$2.o" || exit 1
+  ld "$WORK/$1$2.o" -o "$WORK/$1$2" || exit 1
+}
+
+echo "best of $RUNS runs"
+printf "%-8s %10s %10s %10s %10s\n" "" "build" "opt -O0" "opt -O2" "regalloc"
+for kernel in "${KERNELS[@]}"; do
+  set -- $kernel
+  name=$1
+  shift
+  input="$*"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name.cm"
+  cp "Benchmarks/kernels/$name.cm" "$WORK/$name-ll.cm"
+  ./CMinus --emit=asm --link "$WORK/$name.cm" > /dev/null || exit 1
+  ./CMinus --emit=llvm "$WORK/$name-ll.cm" > /dev/null || exit 1
+
+  start=$(date +%s%N)
+  build "$name-ll" -O2
+  compile=$(( ($(date +%s%N) - start) / 1000000 ))
+  build "$name-ll" -O0
+
+  expected=$(echo "$input" | ./CMinus --run "$WORK/$name.cm") || exit 1
+  best_of "$input" "$WORK/$name"
+  native=$best
+  [ "$output" == "$expected" ] || { echo "$name: native output differs"; exit 1; }
+  best_of "$input" "$WORK/$name-ll-O0"
+  unoptimized=$best
+  [ "$output" == "$expected" ] || { echo "$name: opt -O0 output differs"; exit 1; }
+  best_of "$input" "$WORK/$name-ll-O2"
+  [ "$output" == "$expected" ] || { echo "$name: opt -O2 output differs"; exit 1; }
+  printf "%-8s %7d ms %7d ms %7d ms %7d ms  (%s)\n" "$name" "$compile" "$unoptimized" "$best" "$native" \
+    "$(echo $output)"
+done
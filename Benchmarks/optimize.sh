@@ -0,0 +1,64 @@
+#!/bin/bash
+#
+# Filename   : optimize.sh
+# Author     : Philip Androwick
+# Description: Times the kernels in Benchmarks/kernels without and with
+#              the optimization passes (-O1), on the virtual machine
+#              (--run) and as stack code (--jit --stack-code), which
+#              follows the tree most closely, and prints what the passes
+#              did.  Built with CMINUS_COUNT_INSTRUCTIONS defined, the
+#              virtual machine counts the instructions it runs, and the
+#              counts are printed too.  Run from the repository root after
+#              make.
+#              Usage: Benchmarks/optimize.sh [runs]
+#
+
+RUNS=${1:-3}
+
+# Kernel and its input
+KERNELS=("fib 30" "sieve 1000000 10" "sort 500000" "matmul 200" "blur 10")
+
+# Best time of RUNS runs of a command given the input, in ms; the
+# output of the last run is left in $output
+best_of () {
+  local input=$1 run
+  shift
+  best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    start=$(date +%s%N)
+    output=$(echo "$input" | "$@") || exit 1
+    elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+}
+
+echo "best of $RUNS runs"
+printf "%-8s %10s %10s %10s %10s\n" "" "run -O0" "run -O1" "stack -O0" "stack -O1"
+for kernel in "${KERNELS[@]}"; do
+  set -- $kernel
+  name=$1
+  shift
+  input="$*"
+  file="Benchmarks/kernels/$name.cm"
+
+  best_of "$input" ./CMinus --run "$file"
+  run=$best
+  expected=$output
+  best_of "$input" ./CMinus -O1 --run "$file"
+  optimized=$best
+  [ "$output" == "$expected" ] || { echo "$name: -O1 output differs"; exit 1; }
+  best_of "$input" ./CMinus --jit --stack-code "$file"
+  stack=$best
+  best_of "$input" ./CMinus -O1 --jit --stack-code "$file"
+  [ "$output" == "$expected" ] || { echo "$name: -O1 stack code output differs"; exit 1; }
+  printf "%-8s %7d ms %7d ms %7d ms %7d ms  (%s)\n" "$name" "$run" "$optimized" "$stack" "$best" \
+         "$(echo $output)"
+  echo "$input" | ./CMinus -O1 --stats --run "$file" 2>&1 > /dev/null | grep "^  [a-z]*: "
+  counts=$(for level in -O0 -O1; do
+             echo "$input" | ./CMinus $level --stats --run "$file" 2>&1 > /dev/null \
+               | sed -n 's/^Bytecode: ran \([0-9]*\) instructions$/\1/p'
+           done)
+  [ -z "$counts" ] || echo "  instructions: $(echo $counts | sed 's/ / at -O0, /') at -O1"
+done
@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Filename   : pipeline.sh
+# Author     : Philip Androwick
+# Description: Times a serial compile against a pipelined one, and ones
+#              with parallel lexing, parsing and printing, on a generated program.  Run from the repository root after
+#              make.  Usage: Benchmarks/pipeline.sh [functions] [runs]
+#
+
+FUNCTIONS=${1:-5000}
+RUNS=${2:-5}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+python3 Benchmarks/generate.py "$FUNCTIONS" > "$WORK/bench.cm"
+echo "$(wc -c < "$WORK/bench.cm") bytes, $FUNCTIONS functions, best of $RUNS runs"
+
+best ()
+{
+  local best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    local start=$(date +%s%N)
+    ./CMinus "$@" "$WORK/bench.cm" > /dev/null || exit 1
+    local elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+  echo "$best"
+}
+
+echo "serial       $(best) ms"
+echo "pipelined    $(best --pipeline) ms"
+echo "parallel lex $(best --parallel-lex) ms"
+echo "parallel lex and parse $(best --parallel-lex --parallel-parse) ms"
+echo "parallel print $(best --parallel-print) ms"
+echo "parallel lex, parse and print $(best --parallel-lex --parallel-parse --parallel-print) ms"
+./CMinus --pipeline --stats "$WORK/bench.cm" 2>&1 > /dev/null | sed 's/^/  /'
@@ -0,0 +1,30 @@
+#!/bin/bash
+#
+# Filename   : vm.sh
+# Author     : Philip Androwick
+# Description: Times the kernels in Benchmarks/kernels on the virtual
+#              machine (--run).  Run from the repository root after
+#              make.  Usage: Benchmarks/vm.sh [runs]
+#
+
+RUNS=${1:-3}
+
+# Kernel and its input
+KERNELS=("fib 30" "sieve 1000000 10" "sort 500000" "matmul 200")
+
+echo "best of $RUNS runs"
+for kernel in "${KERNELS[@]}"; do
+  set -- $kernel
+  name=$1
+  shift
+  best=""
+  for ((run = 0; run < RUNS; ++run)); do
+    start=$(date +%s%N)
+    output=$(echo "$@" | ./CMinus --run "Benchmarks/kernels/$name.cm") || exit 1
+    elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+  printf "%-8s %6d ms  (%s)\n" "$name" "$best" "$(echo $output)"
+done
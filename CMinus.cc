@@ -4,24 +4,127 @@
  Description: Lexical Analyzer, Parser, and Semantic Analyzer for the c- language.
 */
 
+#include <cerrno>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <cstdio>
 #include <cstdlib>
-#include "Lexer/Lexer.h"
-#include "Parser/Parser.h"
-#include "SemanticAnalyzer/SymbolTable.h"
-#include "SemanticAnalyzer/SymbolTableVisitor.h"
-#include "SemanticAnalyzer/SemanticAnalysisVisitor.h"
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Compiler/AstWriter.h"
+#include "Compiler/CompilerContext.h"
+#include "Compiler/FunctionQuery.h"
+#include "Compiler/ModuleDriver.h"
+#include "Compiler/Passes.h"
+#include "Compiler/Pipeline.h"
+#include "Compiler/SourceBuffer.h"
+#include "Compiler/Streaming.h"
+#include "Server/CompileServer.h"
+#include "Server/Protocol.h"
+#include "Codegen/CodeGenerator.h"
+#include "Codegen/Jit.h"
+#include "VM/VirtualMachine.h"
 #include <stdio.h>
-#include <deque>
 
 //**
 
 extern FILE* stdin;
 
-FILE*
-getInput (int argc, char* argv[]);
+// Options given on the command line
+struct CommandLine
+{
+  // Source file; empty when reading stdin
+  std::string inputFile;
+
+  // Separate compilation of several modules
+  bool        modules = false;
+  std::vector<std::string> moduleFiles;
+
+  // Lex, parse and analyze on three threads at once
+  bool        pipeline = false;
+
+  // Share identical expression subtrees
+  bool        hashCons = false;
+
+  // Hold only one declaration's tree at a time
+  bool        stream = false;
+
+  // Lex or parse a large source on --jobs threads
+  bool        parallelLex = false;
+  bool        parallelParse = false;
+
+  // Print the AST on --jobs threads
+  bool        parallelPrint = false;
+
+  // Last pass to run; the output file is only written by "print"
+  std::string stopAfter;
+
+  // Write the IR to a .ir file, assembly to a .s file or C to a .c
+  //   file instead of the .ast file
+  EmitKind    emit = EmitKind::AST;
+
+  // Assembly or machine code from the stack code generator rather than
+  //   the allocator
+  bool        stackCode = false;
+
+  // Assemble and link the .s file into an executable
+  bool        link = false;
+
+  // Optimization level (-O0 or -O1)
+  unsigned    optimize = 0;
+
+  // Largest function body, in nodes, that -O1 inlines
+  size_t      inlineBudget = DEFAULT_INLINE_BUDGET;
+
+  // Copies of a loop's body that -O1 unrolls a counted loop to
+  unsigned    unrollFactor = DEFAULT_UNROLL_FACTOR;
+
+  // Check only this function; no .ast file is written
+  std::string checkFunction;
+
+  // Run the program on the virtual machine instead of writing a file
+  bool        run = false;
+
+  // Run the program as machine code in this process instead
+  bool        jit = false;
+
+  // Report statistics: of the compile server with --client, otherwise
+  //   of this compilation (on stderr)
+  bool        stats = false;
+
+  // Compile server
+  bool        serve = false;
+  bool        client = false;
+  std::string socketPath = DEFAULT_SOCKET_PATH;
+  unsigned    jobs = std::thread::hardware_concurrency ();
+};
+
+bool
+parseCommandLine (int argc, char* argv[], CommandLine& options);
+
+bool
+getInput (const CommandLine& options, SourceBuffer& source);
+
+int
+runProgram (const CommandLine& options, CompilerContext& context, const SourceBuffer& source);
+
+int
+jitProgram (const CommandLine& options, CompilerContext& context, const SourceBuffer& source);
+
+bool
+linkProgram (const std::string& assemblyFile, const std::string& executable);
+
+std::string
+getOutputName (const CommandLine& options, const char* extension = ".ast");
+
+void
+printOptimizations (const CompileResult& result);
 
 //**
 
@@ -31,51 +134,239 @@ main (int argc, char* argv[])
   ++argv;
   --argc;
 
-  // Run Lexical analyzer
+  CommandLine options;
+  if (!parseCommandLine (argc, argv, options))
+  {
+    printf ("Usage: CMinus [--pipeline | --stream | [--parallel-lex] [--parallel-parse] [--parallel-print] [--jobs=N] [--hash-cons] [--stop-after=PASS] [--emit=ast|ir]] [-O1 [--inline-budget=N] [--unroll-factor=N]] [--stats] [file.cm]\n"
+            "       CMinus --emit=asm [--stack-code] [--link] [-O1 [--inline-budget=N] [--unroll-factor=N]] [--stats] [file.cm]\n"
+            "       CMinus --emit=c [-O1 [--inline-budget=N] [--unroll-factor=N]] [--stats] [file.cm]\n"
+            "       CMinus --emit=llvm [-O1 [--inline-budget=N] [--unroll-factor=N]] [--stats] [file.cm]\n"
+            "       CMinus --check-function=NAME [--stats] [file.cm]\n"
+            "       CMinus --run [-O1 [--inline-budget=N] [--unroll-factor=N]] [--stats] file.cm\n"
+            "       CMinus --jit [--stack-code] [-O1 [--inline-budget=N] [--unroll-factor=N]] [--stats] file.cm\n"
+            "       CMinus --modules [--jobs=N] module.cm ... main.cm\n"
+            "       CMinus --serve [--socket=PATH] [--jobs=N]\n"
+            "       CMinus --client [--socket=PATH] (file.cm | --stats)\n");
+    return EXIT_FAILURE;
+  }
+
+  if (options.modules)
+    return buildModules (options.moduleFiles, options.jobs) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  if (options.serve)
+  {
+    CompileServer server (options.socketPath, options.jobs);
+    return server.run () ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (options.client && options.stats)
+  {
+    std::string report;
+    if (!fetchServerStats (options.socketPath, report))
+    {
+      printf ("\nERROR: No compile server on \"%s\"\n\n", options.socketPath.c_str ());
+      return EXIT_FAILURE;
+    }
+    printf ("%s", report.c_str ());
+    return EXIT_SUCCESS;
+  }
+
   // IF USING STDIN: finish program by using the $ sign
-  Lexer lex (getInput (argc, argv));
-  std::deque<Token> tokens;
-  Token token;
-  do
-  {
-    token = lex.getToken ();
-    tokens.push_back(token);
-  } while (token.type != END_OF_FILE);
-  
-  // Run Parser
-  Parser par(tokens);
-  ProgramNode* astTree = par.program();
-  
-  // Create Symbol Table and Check for
-  // Undeclared/Multiply declared variables
-  // (Phase 1 of Sementic Analysis)
-  SymbolTable table(astTree);
-  SymbolTableVisitor visitor(&table);
-  astTree->accept (&visitor);
-  table.exitScope();
-
-  // Run Phase 2 of Semantic Analysis
-  SemanticAnalysisVisitor semanticVisitor(&table);
-  astTree->accept (&semanticVisitor);
+  SourceBuffer source;
+  if (!getInput (options, source))
+  {
+    printf ("\nERROR: Could not read \"%s\"\n\n", options.inputFile.empty () ? "stdin" : options.inputFile.c_str ());
+    return EXIT_FAILURE;
+  }
+
+  CompilerContext context;
+  if (!options.checkFunction.empty ())
+  {
+    FunctionQueryStats stats;
+    CompileResult result = context.checkFunction (source.data (), source.size (), options.checkFunction,
+                                                  CompileOptions (), &stats);
+    if (options.stats)
+      stats.print (stderr);
+    for (const Diagnostic& diagnostic : result.diagnostics)
+      printf ("%s", diagnostic.message.c_str ());
+    if (!result.success)
+      return EXIT_FAILURE;
+    printf ("\nValid!\n\n");
+    return EXIT_SUCCESS;
+  }
+
+  if (options.run)
+    return runProgram (options, context, source);
+  if (options.jit)
+    return jitProgram (options, context, source);
+
+  std::string fileName = getOutputName (options);
+  if (options.stream)
+  {
+    FILE* astFile = fopen (fileName.c_str (), "w");
+    if (astFile == nullptr)
+    {
+      printf ("\nERROR: Could not write \"%s\"\n\n", fileName.c_str ());
+      return EXIT_FAILURE;
+    }
+    StreamStats stats;
+    CompileResult result = context.compileStreaming (source.data (), source.size (), astFile,
+                                                     CompileOptions (), &stats);
+    fclose (astFile);
+    if (options.stats)
+      stats.print (stderr);
+    if (!result.success)
+    {
+      remove (fileName.c_str ());
+      for (const Diagnostic& diagnostic : result.diagnostics)
+        printf ("%s", diagnostic.message.c_str ());
+      return EXIT_FAILURE;
+    }
+
+    printf("\nValid!\n");
+    printf("Writing AST to \"%s\"\n\n", fileName.c_str());
+    return EXIT_SUCCESS;
+  }
+
+  // Lex, parse and run both phases of Semantic Analysis, either here
+  // or in a compile server
+  CompileResult result;
+  if (options.client)
+  {
+    if (!compileRemote (options.socketPath, std::string (source.data (), source.size ()), result))
+    {
+      printf ("\nERROR: No compile server on \"%s\"\n\n", options.socketPath.c_str ());
+      return EXIT_FAILURE;
+    }
+  }
+  else if (options.pipeline)
+  {
+    PipelineStats stats;
+    result = context.compilePipelined (source.data (), source.size (), CompileOptions (), &stats);
+    if (options.stats)
+      stats.print (stderr);
+  }
+  else
+  {
+    CompileOptions compileOptions;
+    if (options.parallelLex)
+      compileOptions.lexJobs = options.jobs;
+    if (options.parallelParse)
+      compileOptions.parseJobs = options.jobs;
+    if (options.parallelPrint)
+      compileOptions.printJobs = options.jobs;
+    compileOptions.hashCons = options.hashCons;
+    compileOptions.stopAfter = options.stopAfter;
+    compileOptions.emit = options.emit;
+    compileOptions.stackCode = options.stackCode;
+    compileOptions.optimize = options.optimize;
+    compileOptions.inlineBudget = options.inlineBudget;
+    compileOptions.unrollFactor = options.unrollFactor;
+    result = context.compile (source.data (), source.size (), compileOptions);
+    if (options.stats)
+    {
+      AstArena& arena = context.getArena ();
+      fprintf (stderr, "AST: %zu nodes, %zu bytes\n", arena.nodeCount (), arena.bytesUsed ());
+      if (options.hashCons)
+        fprintf (stderr, "  hash-consing shared %zu expression nodes, saving %zu bytes; its tables took %zu bytes\n",
+                 result.sharedNodes, result.sharedBytes, result.factoryBytes);
+      for (const std::pair<std::string, double>& pass : result.passTimes)
+        fprintf (stderr, "  %-10s %.3f ms\n", pass.first.c_str (), pass.second * 1000);
+      printOptimizations (result);
+      // Everything the compile held at once, the parser's tables included
+      struct rusage usage;
+      getrusage (RUSAGE_SELF, &usage);
+      fprintf (stderr, "Peak memory: %ld KB\n", usage.ru_maxrss);
+    }
+  }
+
+  if (!result.success)
+  {
+    for (const Diagnostic& diagnostic : result.diagnostics)
+      printf ("%s", diagnostic.message.c_str ());
+    return EXIT_FAILURE;
+  }
+
+  // Passes before "print" leave no AST text
+  if (!options.stopAfter.empty () && options.stopAfter != "print")
+  {
+    printf("\nValid!\n\n");
+    return EXIT_SUCCESS;
+  }
+
+  if (options.emit == EmitKind::IR)
+  {
+    fileName = getOutputName (options, ".ir");
+    std::ofstream irFile (fileName);
+    irFile << result.code;
+    irFile.close ();
+    printf ("\nValid!\n");
+    printf ("Writing IR to \"%s\"\n\n", fileName.c_str ());
+    return EXIT_SUCCESS;
+  }
+
+  if (options.emit == EmitKind::ASM)
+  {
+    fileName = getOutputName (options, ".s");
+    std::ofstream assemblyFile (fileName);
+    assemblyFile << result.code;
+    assemblyFile.close ();
+    printf ("\nValid!\n");
+    printf ("Writing assembly to \"%s\"\n\n", fileName.c_str ());
+    if (options.link)
+    {
+      std::string executable = getOutputName (options, "");
+      if (!linkProgram (fileName, executable))
+      {
+        printf ("\nERROR: Could not assemble and link \"%s\"\n\n", executable.c_str ());
+        return EXIT_FAILURE;
+      }
+      printf ("Linking \"%s\"\n\n", executable.c_str ());
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (options.emit == EmitKind::C)
+  {
+    fileName = getOutputName (options, ".c");
+    std::ofstream sourceFile (fileName);
+    sourceFile << result.code;
+    sourceFile.close ();
+    printf ("\nValid!\n");
+    printf ("Writing C to \"%s\"\n\n", fileName.c_str ());
+    return EXIT_SUCCESS;
+  }
+
+  if (options.emit == EmitKind::LLVM)
+  {
+    fileName = getOutputName (options, ".ll");
+    std::ofstream sourceFile (fileName);
+    sourceFile << result.code;
+    sourceFile.close ();
+    printf ("\nValid!\n");
+    printf ("Writing LLVM IR to \"%s\"\n\n", fileName.c_str ());
+    return EXIT_SUCCESS;
+  }
 
   // Print results in .ast file  
-  std::ofstream myfile;
-  std::string fileName;
-  if (argc > 0)
+  if (!result.astChunks.empty ())
   {
-    std::string fullFileName = argv[0];
-    size_t lastindex = fullFileName.find_last_of("."); 
-    fileName = fullFileName.substr(0, lastindex); 
-    fileName += ".ast";
-    myfile.open (fileName.c_str());
+    int fd = open (fileName.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool written = fd >= 0 && writeChunks (fd, result.astChunks);
+    if (fd >= 0)
+      written = close (fd) == 0 && written;
+    if (!written)
+    {
+      printf ("\nERROR: Could not write \"%s\"\n\n", fileName.c_str ());
+      return EXIT_FAILURE;
+    }
   }
   else
   {
-    fileName = "Default.ast";
-    myfile.open (fileName);
+    std::ofstream myfile (fileName);
+    myfile << result.ast;
+    myfile.close();
   }
-  myfile << par.getAST(astTree);
-  myfile.close();
 
   printf("\nValid!\n");
   printf("Writing AST to \"%s\"\n\n", fileName.c_str());
@@ -83,15 +374,262 @@ main (int argc, char* argv[])
   return EXIT_SUCCESS;
 }
 
-FILE*
-getInput (int argc, char* argv[])
+bool
+parseCommandLine (int argc, char* argv[], CommandLine& options)
+{
+  for (int n = 0; n < argc; ++n)
+  {
+    std::string arg = argv[n];
+    if (arg == "--serve")
+      options.serve = true;
+    else if (arg == "--client")
+      options.client = true;
+    else if (arg == "--modules")
+      options.modules = true;
+    else if (arg == "--pipeline")
+      options.pipeline = true;
+    else if (arg == "--hash-cons")
+      options.hashCons = true;
+    else if (arg == "--stream")
+      options.stream = true;
+    else if (arg == "--parallel-lex")
+      options.parallelLex = true;
+    else if (arg == "--parallel-parse")
+      options.parallelParse = true;
+    else if (arg == "--parallel-print")
+      options.parallelPrint = true;
+    else if (arg == "--stats")
+      options.stats = true;
+    else if (arg == "--run")
+      options.run = true;
+    else if (arg == "--jit")
+      options.jit = true;
+    else if (arg.compare (0, 9, "--socket=") == 0)
+      options.socketPath = arg.substr (9);
+    else if (arg.compare (0, 13, "--stop-after=") == 0)
+      options.stopAfter = arg.substr (13);
+    else if (arg.compare (0, 17, "--check-function=") == 0 && arg.size () > 17)
+      options.checkFunction = arg.substr (17);
+    else if (arg == "--emit=ast")
+      options.emit = EmitKind::AST;
+    else if (arg == "--emit=ir")
+      options.emit = EmitKind::IR;
+    else if (arg == "--emit=asm")
+      options.emit = EmitKind::ASM;
+    else if (arg == "--emit=c")
+      options.emit = EmitKind::C;
+    else if (arg == "--emit=llvm")
+      options.emit = EmitKind::LLVM;
+    else if (arg == "--stack-code")
+      options.stackCode = true;
+    else if (arg == "--link")
+      options.link = true;
+    else if (arg == "-O0" || arg == "-O1")
+      options.optimize = (unsigned) (arg[2] - '0');
+    else if (arg.compare (0, 16, "--inline-budget=") == 0)
+      options.inlineBudget = (size_t) atoi (arg.c_str () + 16);
+    else if (arg.compare (0, 16, "--unroll-factor=") == 0)
+      options.unrollFactor = (unsigned) atoi (arg.c_str () + 16);
+    else if (arg.compare (0, 7, "--jobs=") == 0)
+      options.jobs = (unsigned) atoi (arg.c_str () + 7);
+    else if (arg.compare (0, 2, "--") == 0)
+      return false;
+    else
+      options.moduleFiles.push_back (arg);
+  }
+
+  if (options.modules)
+    return !options.moduleFiles.empty () && !options.serve && !options.client;
+  if (options.moduleFiles.size () > 1)
+    return false;
+  if (!options.moduleFiles.empty ())
+    options.inputFile = options.moduleFiles[0];
+
+  // Only one way of running the stages at a time, and only locally
+  int modes = options.pipeline + options.stream + !options.checkFunction.empty () + options.run + options.jit
+    + (options.parallelLex || options.parallelParse || options.parallelPrint || options.hashCons
+       || !options.stopAfter.empty () || options.emit != EmitKind::AST);
+  if (modes > 1 || (modes == 1 && options.client))
+    return false;
+  if ((options.stackCode && options.emit != EmitKind::ASM && !options.jit)
+      || (options.link && options.emit != EmitKind::ASM))
+    return false;
+  // Optimization changes the tree of a plain compile in place
+  if (options.optimize > 0
+      && (options.pipeline || options.stream || !options.checkFunction.empty () || options.hashCons || options.client))
+    return false;
+  return !(options.serve && options.client);
+}
+
+bool
+getInput (const CommandLine& options, SourceBuffer& source)
 {
-  if (argc > 0) 
+  if (!options.inputFile.empty ()) 
   {
-    return fopen (argv[0], "r");
+    return source.open (options.inputFile);
   }
   else
   {
-    return stdin;
+    return source.read (stdin, true);
+  }
+}
+
+// Compiles the source to bytecode and runs it, with the program's input
+// and output on stdin and stdout.  Returns the exit status.
+int
+runProgram (const CommandLine& options, CompilerContext& context, const SourceBuffer& source)
+{
+  auto now = [] () { return std::chrono::steady_clock::now (); };
+  auto milliseconds = [] (std::chrono::steady_clock::duration time) {
+    return std::chrono::duration<double, std::milli> (time).count ();
+  };
+
+  auto start = now ();
+  CompileOptions compileOptions;
+  compileOptions.emit = EmitKind::IR;
+  compileOptions.stopAfter = "ssa";
+  compileOptions.optimize = options.optimize;
+  compileOptions.inlineBudget = options.inlineBudget;
+  compileOptions.unrollFactor = options.unrollFactor;
+  CompileResult result = context.compile (source.data (), source.size (), compileOptions);
+  if (!result.success)
+  {
+    for (const Diagnostic& diagnostic : result.diagnostics)
+      printf ("%s", diagnostic.message.c_str ());
+    return EXIT_FAILURE;
+  }
+
+  BcProgram program;
+  try
+  {
+    compileBytecode (*result.ir, program);
+    auto compiled = now ();
+    VirtualMachine machine;
+    machine.run (program, stdin, stdout);
+    fflush (stdout);
+    if (options.stats)
+    {
+      printOptimizations (result);
+      fprintf (stderr, "Bytecode: %zu functions, %zu words; compiled in %.3f ms, ran in %.3f ms\n",
+               program.functions.size (), program.code.size (), milliseconds (compiled - start),
+               milliseconds (now () - compiled));
+      // Counted only in a build with CMINUS_COUNT_INSTRUCTIONS defined
+      if (machine.getExecutedCount () != 0)
+        fprintf (stderr, "Bytecode: ran %llu instructions\n", (unsigned long long) machine.getExecutedCount ());
+    }
+  }
+  catch (const CompileError& error)
+  {
+    fflush (stdout);
+    printf ("%s", error.diagnostic.message.c_str ());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// Compiles the source to machine code and runs it in this process, with
+// the program's input and output on stdin and stdout.  Returns the exit
+// status.
+int
+jitProgram (const CommandLine& options, CompilerContext& context, const SourceBuffer& source)
+{
+  auto now = [] () { return std::chrono::steady_clock::now (); };
+  auto milliseconds = [] (std::chrono::steady_clock::duration time) {
+    return std::chrono::duration<double, std::milli> (time).count ();
+  };
+
+  // The stack code generator works from the checked tree, the other
+  // from the IR in SSA form
+  auto start = now ();
+  CompileOptions compileOptions;
+  compileOptions.emit = options.stackCode ? EmitKind::AST : EmitKind::IR;
+  compileOptions.optimize = options.optimize;
+  compileOptions.inlineBudget = options.inlineBudget;
+  compileOptions.unrollFactor = options.unrollFactor;
+  compileOptions.stopAfter = options.stackCode ? getLastTreePass (compileOptions) : "ssa";
+  CompileResult result = context.compile (source.data (), source.size (), compileOptions);
+  if (!result.success)
+  {
+    for (const Diagnostic& diagnostic : result.diagnostics)
+      printf ("%s", diagnostic.message.c_str ());
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    auto checked = now ();
+    X86Encoder encoder;
+    if (options.stackCode)
+      generateStackCode (result.program, encoder);
+    else
+      generateCode (*result.ir, encoder);
+    JitProgram program;
+    program.load (encoder);
+    auto loaded = now ();
+    program.run (stdin, stdout);
+    fflush (stdout);
+    if (options.stats)
+    {
+      printOptimizations (result);
+      fprintf (stderr, "Machine code: %zu functions, %zu bytes; front end %.3f ms, code generated and loaded "
+               "in %.3f ms (%.1f us per function), ran in %.3f ms\n",
+               encoder.getFunctionCount (), program.getTextBytes (), milliseconds (checked - start),
+               milliseconds (loaded - checked),
+               milliseconds (loaded - checked) * 1000 / encoder.getFunctionCount (),
+               milliseconds (now () - loaded));
+    }
+  }
+  catch (const CompileError& error)
+  {
+    fflush (stdout);
+    printf ("%s", error.diagnostic.message.c_str ());
+    return EXIT_FAILURE;
   }
+  return EXIT_SUCCESS;
+}
+
+// Runs the command, found on the PATH, and waits for it.  Returns
+// whether it exited with status 0.
+static bool
+runCommand (std::vector<const char*> argv)
+{
+  argv.push_back (nullptr);
+  pid_t pid;
+  if (posix_spawnp (&pid, argv[0], nullptr, nullptr, (char* const*) argv.data (), environ) != 0)
+    return false;
+  int status;
+  while (waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      return false;
+  return WIFEXITED (status) && WEXITSTATUS (status) == 0;
+}
+
+// Assembles the program and its runtime with as and links them with ld;
+// the runtime needs no C library
+bool
+linkProgram (const std::string& assemblyFile, const std::string& executable)
+{
+  std::string objectFile = executable + ".o";
+  bool linked = runCommand ({ "as", "-o", objectFile.c_str (), assemblyFile.c_str () })
+    && runCommand ({ "ld", "-o", executable.c_str (), objectFile.c_str () });
+  remove (objectFile.c_str ());
+  return linked;
+}
+
+std::string
+getOutputName (const CommandLine& options, const char* extension)
+{
+  if (options.inputFile.empty ())
+    return std::string ("Default") + extension;
+
+  size_t lastindex = options.inputFile.find_last_of("."); 
+  return options.inputFile.substr(0, lastindex) + extension; 
+}
+
+// Reports what the optimization passes did, on stderr
+void
+printOptimizations (const CompileResult& result)
+{
+  for (const std::pair<std::string, std::string>& pass : result.optimizations)
+    fprintf (stderr, "  %s: %s\n", pass.first.c_str (), pass.second.c_str ());
 }
\ No newline at end of file
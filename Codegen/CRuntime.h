@@ -0,0 +1,78 @@
+/*
+  Filename   : CRuntime.h
+  Author     : Philip Androwick
+  Description: The runtime C programs written by --emit=c (CSource.h)
+               include.  It is C, not C++: arithmetic wraps as it does
+               in the other backends without relying on signed overflow,
+               and errors are reported on standard output, as the
+               compiler reports them, with exit status 1.
+*/
+
+#ifndef CMINUS_C_RUNTIME_H
+#define CMINUS_C_RUNTIME_H
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The int congruent to value modulo UINT_MAX + 1 */
+static inline int
+cminus_wrap (unsigned value)
+{
+  if (value <= INT_MAX)
+    return (int) value;
+  return (int) (value - (unsigned) INT_MIN) + INT_MIN;
+}
+
+static inline void
+cminus_error (const char* error, const char* function)
+{
+  printf ("\nERROR: %s in \"%s\"\n\n", error, function);
+  exit (1);
+}
+
+static inline int
+cminus_add (int a, int b)
+{
+  return cminus_wrap ((unsigned) a + (unsigned) b);
+}
+
+static inline int
+cminus_sub (int a, int b)
+{
+  return cminus_wrap ((unsigned) a - (unsigned) b);
+}
+
+static inline int
+cminus_mul (int a, int b)
+{
+  return cminus_wrap ((unsigned) a * (unsigned) b);
+}
+
+/* INT_MIN / -1 overflows; it wraps to INT_MIN */
+static inline int
+cminus_div (int a, int b, const char* function)
+{
+  if (b == 0)
+    cminus_error ("Division by zero", function);
+  if (b == -1)
+    return cminus_wrap (0u - (unsigned) a);
+  return a / b;
+}
+
+static inline int
+cminus_input (const char* function)
+{
+  int value;
+  if (scanf ("%d", &value) != 1)
+    cminus_error ("No integer left to read", function);
+  return value;
+}
+
+static inline void
+cminus_output (int value)
+{
+  printf ("%d\n", value);
+}
+
+#endif
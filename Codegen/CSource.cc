@@ -0,0 +1,531 @@
+/*
+  Filename   : CSource.cc
+  Author     : Philip Androwick
+  Description: Writes the checked tree as C.  Statements are written as
+               the tree is walked; expressions leave their text on a
+               stack, where the expression or statement using them takes
+               it.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <climits>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "CSource.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // An expression written as C
+  struct Expression
+  {
+    std::string text;
+    // Whether it reads no variable, so that no write can change it
+    bool fixed = true;
+    // Whether it may assign a variable, and whether it may read or
+    //   write
+    bool writes = false;
+    bool io = false;
+    // Whether it needs parentheses as the operand of a comparison
+    bool loose = false;
+    // A subscript's array and index, for an assignment to it to take
+    //   its index first
+    std::string array;
+    std::vector<Expression> index;
+
+    static Expression
+    of (const std::string& text)
+    {
+      Expression expression;
+      expression.text = text;
+      return expression;
+    }
+
+    // Takes on what its operands read and do
+    void
+    include (const Expression& operand)
+    {
+      fixed = fixed && operand.fixed;
+      writes = writes || operand.writes;
+      io = io || operand.io;
+    }
+  };
+
+  std::string
+  name (const std::string& identifier)
+  {
+    return "cm_" + identifier;
+  }
+
+  class CSourceWriter : public AstWalker
+  {
+  public:
+    CSourceWriter ()
+      : AstWalker ({ ChildSlot::THEN, ChildSlot::ELSE, ChildSlot::BODY }),
+        m_function (nullptr), m_indent (0), m_temporaries (0), m_temporariesAt (0)
+    { }
+
+    std::string
+    getText ()
+    {
+      return std::move (m_text);
+    }
+
+    // Declarations
+
+    virtual bool
+    enter (ProgramNode* node)
+    {
+      m_text = "/* Written by CMinus --emit=c */\n\n#include \"CRuntime.h\"\n";
+      bool hasMain = false;
+      std::string prototypes;
+      for (DeclarationNode* declaration : node->declarations)
+      {
+        m_declared.insert (declaration);
+        FunctionDeclarationNode* function = dynamic_cast<FunctionDeclarationNode*> (declaration);
+        if (function != nullptr)
+        {
+          prototypes += signature (function, " ") + ";\n";
+          hasMain = hasMain || function->identifier == "main";
+        }
+      }
+      if (!hasMain)
+        raiseError (DiagnosticPhase::CODEGEN, 0, 0, "\nERROR: \"main\" function was never declared\n\n");
+      m_text += "\n" + prototypes;
+      return true;
+    }
+
+    virtual void
+    leave (ProgramNode* node)
+    {
+      m_text += "\nint\nmain (void)\n{\n  cm_main ();\n  return 0;\n}\n";
+    }
+
+    virtual bool
+    enter (VariableDeclarationNode* node)
+    {
+      if (m_function == nullptr)
+        m_text += "\nint " + name (node->identifier) + ";\n";
+      else
+        line ("int " + name (node->identifier) + " = 0;");
+      return true;
+    }
+
+    virtual bool
+    enter (ArrayDeclarationNode* node)
+    {
+      std::string declaration = "int " + name (node->identifier) + "[" + std::to_string (node->size) + "]";
+      if (m_function == nullptr)
+        m_text += "\n" + declaration + ";\n";
+      else
+        line (declaration + " = { 0 };");
+      return true;
+    }
+
+    virtual bool
+    enter (FunctionDeclarationNode* node)
+    {
+      m_function = node;
+      m_temporaries = 0;
+      m_text += "\n" + signature (node, "\n") + "\n";
+      return true;
+    }
+
+    virtual void
+    leave (FunctionDeclarationNode* node)
+    {
+      // Declared once the function has said how many it needs
+      if (m_temporaries > 0)
+      {
+        std::string temporaries = "  int cminus_t0";
+        for (unsigned n = 1; n < m_temporaries; ++n)
+          temporaries += ", cminus_t" + std::to_string (n);
+        m_text.insert (m_temporariesAt, temporaries + ";\n");
+      }
+      m_function = nullptr;
+    }
+
+    // Parameters are written with the signature
+    virtual bool
+    enter (ParameterNode* node)
+    {
+      return false;
+    }
+
+    // Statements
+
+    virtual bool
+    enter (CompoundStatementNode* node)
+    {
+      line ("{");
+      if (node == m_function->functionBody)
+        m_temporariesAt = m_text.size ();
+      ++m_indent;
+      return true;
+    }
+
+    virtual void
+    leave (CompoundStatementNode* node)
+    {
+      // The checker sees that an int function returns; C may not
+      if (node == m_function->functionBody && m_function->valueType == ValueType::INT
+          && (node->statements.empty ()
+              || dynamic_cast<ReturnStatementNode*> (node->statements.back ()) == nullptr))
+        line ("return 0;");
+      --m_indent;
+      line ("}");
+    }
+
+    // The condition has been written; a statement other than a block is
+    // indented under its if, else or while
+    virtual void
+    enterChild (Node* parent, ChildSlot slot)
+    {
+      StatementNode* child;
+      if (slot == ChildSlot::BODY)
+      {
+        WhileStatementNode* loop = static_cast<WhileStatementNode*> (parent);
+        line ("while (" + pop ().text + ")");
+        child = loop->body;
+      }
+      else if (slot == ChildSlot::THEN)
+      {
+        IfStatementNode* branch = static_cast<IfStatementNode*> (parent);
+        line ("if (" + pop ().text + ")");
+        child = branch->thenStatement;
+      }
+      else
+      {
+        line ("else");
+        child = static_cast<IfStatementNode*> (parent)->elseStatement;
+      }
+      if (dynamic_cast<CompoundStatementNode*> (child) == nullptr)
+        ++m_indent;
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot)
+    {
+      StatementNode* child = slot == ChildSlot::BODY ? static_cast<WhileStatementNode*> (parent)->body
+        : slot == ChildSlot::THEN ? static_cast<IfStatementNode*> (parent)->thenStatement
+        : static_cast<IfStatementNode*> (parent)->elseStatement;
+      if (dynamic_cast<CompoundStatementNode*> (child) == nullptr)
+        --m_indent;
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      line (node->expression != nullptr ? "return " + pop ().text + ";" : "return;");
+    }
+
+    virtual void
+    leave (ExpressionStatementNode* node)
+    {
+      if (node->expression == nullptr)
+      {
+        line (";");
+        return;
+      }
+      Expression expression = pop ();
+      if (expression.writes || expression.io)
+        line (expression.text + ";");
+      else
+        line ("(void) " + parenthesize (expression) + ";");
+    }
+
+    virtual bool
+    enter (ForStatementNode* node)
+    {
+      throw std::logic_error ("C source: the parser makes no for statements");
+    }
+
+    // Expressions
+
+    virtual bool
+    enter (IntegerLiteralExpressionNode* node)
+    {
+      // Folding makes negative literals; C has no literal for INT_MIN
+      if (node->value == INT_MIN)
+        m_values.push_back (Expression::of ("(-2147483647 - 1)"));
+      else
+        m_values.push_back (Expression::of (std::to_string (node->value)));
+      return true;
+    }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      check (node->usingDecNode);
+      Expression expression = Expression::of (name (node->identifier));
+      // An array's address never changes
+      ParameterNode* parameter = dynamic_cast<ParameterNode*> (node->usingDecNode);
+      expression.fixed = parameter != nullptr ? parameter->isArray
+        : dynamic_cast<ArrayDeclarationNode*> (node->usingDecNode) != nullptr;
+      m_values.push_back (expression);
+      return true;
+    }
+
+    virtual void
+    leave (SubscriptExpressionNode* node)
+    {
+      check (node->usingDecNode);
+      Expression index = pop ();
+      Expression expression = Expression::of (name (node->identifier) + "[" + index.text + "]");
+      expression.include (index);
+      expression.fixed = false;
+      expression.array = name (node->identifier);
+      expression.index.push_back (index);
+      m_values.push_back (expression);
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      Expression value = pop ();
+      m_values.push_back (assign (pop (), value));
+    }
+
+    virtual void
+    leave (CallExpressionNode* node)
+    {
+      std::vector<Expression> arguments (m_values.end () - node->arguments.size (), m_values.end ());
+      m_values.resize (m_values.size () - node->arguments.size ());
+
+      // input and output are the only functions without a declaration
+      // node of their own
+      if (dynamic_cast<FunctionDeclarationNode*> (node->usingDecNode) == nullptr)
+      {
+        Expression call;
+        call.io = true;
+        if (node->identifier == "input")
+        {
+          call.text = "cminus_input (\"" + m_function->identifier + "\")";
+          m_values.push_back (assign (arguments[0], call));
+        }
+        else
+        {
+          call.include (arguments[0]);
+          call.text = "cminus_output (" + arguments[0].text + ")";
+          m_values.push_back (call);
+        }
+        return;
+      }
+
+      check (node->usingDecNode);
+      Expression call;
+      call.fixed = false;
+      call.writes = call.io = true;
+      std::string prefix = sequence (arguments);
+      call.text = name (node->identifier) + " (";
+      for (size_t n = 0; n < arguments.size (); ++n)
+      {
+        call.include (arguments[n]);
+        call.text += (n > 0 ? ", " : "") + arguments[n].text;
+      }
+      call.text += ")";
+      m_values.push_back (withPrefix (prefix, call));
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node)
+    {
+      bool plus = node->addOperator == AdditiveOperatorType::PLUS;
+      arithmetic (plus ? "cminus_add (" : "cminus_sub (", "");
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node)
+    {
+      if (node->multOperator == MultiplicativeOperatorType::TIMES)
+        arithmetic ("cminus_mul (", "");
+      else
+        arithmetic ("cminus_div (", ", \"" + m_function->identifier + "\"");
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node)
+    {
+      static const char* const operators[] = { " < ", " <= ", " > ", " >= ", " == ", " != " };
+      std::vector<Expression> operands = popOperands ();
+      std::string prefix = sequence (operands);
+      Expression comparison;
+      comparison.text = parenthesize (operands[0]) + operators[(int) node->relationalOperator]
+        + parenthesize (operands[1]);
+      comparison.include (operands[0]);
+      comparison.include (operands[1]);
+      comparison.loose = true;
+      m_values.push_back (withPrefix (prefix, comparison));
+    }
+
+    virtual bool
+    enter (UnaryExpressionNode* node)
+    {
+      throw std::logic_error ("C source: the parser makes no unary expressions");
+    }
+
+  private:
+    // Function's declaration, with its return type and name separated
+    // by between
+    static std::string
+    signature (FunctionDeclarationNode* function, const char* between)
+    {
+      std::string text = (function->valueType == ValueType::INT ? "int" : "void") + std::string (between)
+        + name (function->identifier) + " (";
+      for (size_t n = 0; n < function->parameters.size (); ++n)
+      {
+        ParameterNode* parameter = function->parameters[n];
+        text += (n > 0 ? ", int " : "int ") + name (parameter->identifier) + (parameter->isArray ? "[]" : "");
+      }
+      return text + (function->parameters.empty () ? "void)" : ")");
+    }
+
+    void
+    line (const std::string& text)
+    {
+      m_text.append (2 * m_indent, ' ');
+      m_text += text;
+      m_text += '\n';
+    }
+
+    Expression
+    pop ()
+    {
+      Expression expression = std::move (m_values.back ());
+      m_values.pop_back ();
+      return expression;
+    }
+
+    // The left operand, then the right
+    std::vector<Expression>
+    popOperands ()
+    {
+      std::vector<Expression> operands (2);
+      operands[1] = pop ();
+      operands[0] = pop ();
+      return operands;
+    }
+
+    // Calls the runtime function opening with the operands, then suffix
+    void
+    arithmetic (const std::string& opening, const std::string& suffix)
+    {
+      std::vector<Expression> operands = popOperands ();
+      std::string prefix = sequence (operands);
+      Expression result;
+      result.text = opening + operands[0].text + ", " + operands[1].text + suffix + ")";
+      result.include (operands[0]);
+      result.include (operands[1]);
+      m_values.push_back (withPrefix (prefix, result));
+    }
+
+    // target = value, a subscript's index taken before the value
+    Expression
+    assign (const Expression& target, const Expression& value)
+    {
+      std::string prefix;
+      std::string lvalue = target.text;
+      Expression assignment;
+      if (!target.array.empty ())
+      {
+        std::vector<Expression> operands = { target.index[0], value };
+        prefix = sequence (operands);
+        lvalue = target.array + "[" + operands[0].text + "]";
+        assignment.include (operands[0]);
+      }
+      assignment.text = lvalue + " = " + value.text;
+      assignment.include (value);
+      assignment.fixed = false;
+      assignment.writes = true;
+      assignment.loose = true;
+      return withPrefix (prefix, assignment);
+    }
+
+    // Assigns to temporaries the operands C could evaluate out of order
+    // with a later one, so that they are evaluated in order.  Returns
+    // the assignments, each followed by a comma.
+    std::string
+    sequence (std::vector<Expression>& operands)
+    {
+      std::vector<std::string> assignments;
+      bool laterReads = false;
+      bool laterWrites = false;
+      bool laterEffects = false;
+      for (size_t n = operands.size (); n > 0; --n)
+      {
+        Expression& operand = operands[n - 1];
+        bool effects = operand.writes || operand.io;
+        if ((!operand.fixed && laterWrites) || (operand.writes && laterReads) || (effects && laterEffects))
+        {
+          std::string temporary = "cminus_t" + std::to_string (m_temporaries++);
+          assignments.push_back (temporary + " = " + operand.text + ", ");
+          operand.text = temporary;
+        }
+        laterReads = laterReads || !operand.fixed;
+        laterWrites = laterWrites || operand.writes;
+        laterEffects = laterEffects || effects;
+      }
+      std::string prefix;
+      for (size_t n = assignments.size (); n > 0; --n)
+        prefix += assignments[n - 1];
+      return prefix;
+    }
+
+    static Expression
+    withPrefix (const std::string& prefix, Expression expression)
+    {
+      if (!prefix.empty ())
+      {
+        expression.text = "(" + prefix + expression.text + ")";
+        expression.loose = false;
+      }
+      return expression;
+    }
+
+    static std::string
+    parenthesize (const Expression& operand)
+    {
+      return operand.loose ? "(" + operand.text + ")" : operand.text;
+    }
+
+    // Declarations made in another module have no definition here
+    void
+    check (DeclarationNode* declaration) const
+    {
+      if (declaration->nestLevel == 0 && m_declared.count (declaration) == 0)
+        raiseError (DiagnosticPhase::CODEGEN, 0, 0,
+                    "\nERROR: \"%s\" is imported; only whole programs can be compiled\n\n",
+                    declaration->identifier.c_str ());
+    }
+
+    std::string              m_text;
+    FunctionDeclarationNode* m_function;
+    unsigned                 m_indent;
+    std::vector<Expression>  m_values;
+    std::unordered_set<DeclarationNode*> m_declared;
+
+    // Temporaries the function being written needs, and where in the
+    // text to declare them
+    unsigned m_temporaries;
+    size_t   m_temporariesAt;
+  };
+}
+
+/***********************************************************************/
+
+std::string
+generateCSource (ProgramNode* program)
+{
+  CSourceWriter writer;
+  writer.walk (program);
+  return writer.getText ();
+}
@@ -0,0 +1,39 @@
+/*
+  Filename   : CSource.h
+  Author     : Philip Androwick
+  Description: Translation of the checked tree to C, for an optimizing C
+               compiler to finish.  The C keeps the shape of the source:
+               one function for each function, one block for each
+               compound statement.  Names get a cm_ prefix, so that they
+               clash neither with C's nor with the runtime's cminus_ ones
+               (CRuntime.h), which do the arithmetic and input/output.
+*/
+
+/***********************************************************************/
+
+#ifndef C_SOURCE_H
+#define C_SOURCE_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// Text of a C99 program that behaves as program does, including
+//   "CRuntime.h".  Operands are evaluated left to right, as in the
+//   other backends: where C leaves the order open and it matters, the
+//   earlier ones go through temporaries first.  Raises a CompileError
+//   if program refers to an imported symbol.
+std::string
+generateCSource (ProgramNode* program);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,940 @@
+/*
+  Filename   : CodeGenerator.cc
+  Author     : Philip Androwick
+  Description: Compiles SSA IR to x86-64, one function at a time.  Below
+               the saved frame pointer a frame holds the local arrays,
+               the callee-saved registers the function uses and its
+               spill slots.  Constants and array addresses are made where
+               they are used, phis become parallel moves at the ends of
+               their predecessors, and a jump back to a loop's test is
+               replaced by the test.  Multiplying by a power of 2 shifts,
+               and dividing by a constant shifts or multiplies by its
+               reciprocal instead of using idiv.  rax, rdx and r11 are
+               scratch.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "CodeGenerator.h"
+#include "FrameLayout.h"
+#include "LinearScan.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+namespace
+{
+  X86Cond
+  conditionOf (IrOpcode op)
+  {
+    switch (op)
+    {
+    case IrOpcode::LT: return X86Cond::L;
+    case IrOpcode::LE: return X86Cond::LE;
+    case IrOpcode::GT: return X86Cond::G;
+    case IrOpcode::GE: return X86Cond::GE;
+    case IrOpcode::EQ: return X86Cond::E;
+    default:           return X86Cond::NE;
+    }
+  }
+
+  // The condition with its operands swapped
+  X86Cond
+  mirror (X86Cond cond)
+  {
+    switch (cond)
+    {
+    case X86Cond::L:  return X86Cond::G;
+    case X86Cond::LE: return X86Cond::GE;
+    case X86Cond::G:  return X86Cond::L;
+    case X86Cond::GE: return X86Cond::LE;
+    default:          return cond;
+    }
+  }
+
+  bool
+  sameLocation (const X86Operand& a, const X86Operand& b)
+  {
+    if (a.kind != b.kind)
+      return false;
+    if (a.kind == X86Operand::REG)
+      return a.reg == b.reg;
+    if (a.kind == X86Operand::IMM)
+      return a.imm == b.imm;
+    return a.mem.base == b.mem.base && a.mem.index == b.mem.index && a.mem.disp == b.mem.disp
+      && a.mem.global == b.mem.global;
+  }
+
+  // One move of a parallel move; with address, dst gets the address of
+  // src.mem
+  struct Move
+  {
+    int        size;
+    X86Operand dst;
+    X86Operand src;
+    bool       address;
+  };
+
+  // The k with value == 2^k, or -1 if value is not a power of 2
+  int
+  log2Exact (uint32_t value)
+  {
+    if (value == 0 || (value & (value - 1)) != 0)
+      return -1;
+    int k = 0;
+    while (value >>= 1)
+      ++k;
+    return k;
+  }
+
+  // What dividing by a constant takes instead of idiv: the high half of
+  // multiplier * dividend, plus or minus the dividend where their signs
+  // differ, shifted right by shift and rounded toward 0
+  struct DivisionMagic
+  {
+    int32_t multiplier;
+    int     shift;
+  };
+
+  // For a divisor whose magnitude is at least 2 and not a power of 2
+  // (Hacker's Delight, section 10-1)
+  DivisionMagic
+  divisionMagic (int32_t divisor)
+  {
+    const uint32_t twoTo31 = 0x80000000u;
+    uint32_t magnitude = divisor < 0 ? 0u - (uint32_t) divisor : (uint32_t) divisor;
+    uint32_t t = twoTo31 + ((uint32_t) divisor >> 31);
+    uint32_t anc = t - 1 - t % magnitude;
+    uint32_t q1 = twoTo31 / anc;
+    uint32_t r1 = twoTo31 - q1 * anc;
+    uint32_t q2 = twoTo31 / magnitude;
+    uint32_t r2 = twoTo31 - q2 * magnitude;
+    uint32_t delta;
+    int p = 31;
+    do
+    {
+      ++p;
+      q1 *= 2;
+      r1 *= 2;
+      if (r1 >= anc)
+      {
+        ++q1;
+        r1 -= anc;
+      }
+      q2 *= 2;
+      r2 *= 2;
+      if (r2 >= magnitude)
+      {
+        ++q2;
+        r2 -= magnitude;
+      }
+      delta = magnitude - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    uint32_t multiplier = q2 + 1;
+    return { (int32_t) (divisor < 0 ? 0u - multiplier : multiplier), p - 32 };
+  }
+
+  class FunctionGenerator
+  {
+  public:
+    FunctionGenerator (const IrModule& module, uint32_t index, X86Assembler& out)
+      : m_function (module.functions[index]), m_index (index), m_out (out),
+        m_arrayBytes (0), m_nextBlock (0), m_divisionLabel (UINT32_MAX)
+    { }
+
+    void
+    generate ();
+
+  private:
+    void
+    layOutFrame ();
+
+    void
+    generateInstruction (uint32_t block, const IrInstruction& instruction);
+
+    void
+    generateArithmetic (const IrInstruction& instruction);
+
+    void
+    generateDivision (const IrInstruction& instruction);
+
+    void
+    generateCall (const IrInstruction& instruction);
+
+    // Branches from the end of the block being written, which may be a
+    // jump to the block the branch ends
+    void
+    generateBranch (const IrInstruction& instruction);
+
+    void
+    generatePhiMoves (uint32_t block);
+
+    void
+    generateReturn (const IrInstruction& instruction);
+
+    // Sets the flags to compare a with b; returns the condition for op
+    X86Cond
+    compare (IrOpcode op, uint32_t a, uint32_t b);
+
+    // Whether block only tests a condition, so that a jump to it can be
+    // replaced by its branch
+    bool
+    isTest (uint32_t block) const;
+
+    void
+    parallelMove (std::vector<Move>& moves);
+
+    void
+    emitMove (const Move& move);
+
+    // Value access
+
+    const X86Location&
+    location (uint32_t value) const
+    {
+      return m_allocation.locations[value];
+    }
+
+    int
+    size (uint32_t value) const
+    {
+      return m_function.types[value] == IrType::ADDRESS ? 8 : 4;
+    }
+
+    bool
+    isIn (uint32_t value, X86Reg reg) const
+    {
+      return location (value).kind == X86Location::REGISTER && location (value).reg == reg;
+    }
+
+    X86Mem
+    spillSlot (uint32_t slot) const
+    {
+      return X86Mem::at (X86Reg::RBP, -(m_arrayBytes + 8 * (int32_t) m_allocation.calleeSaved.size ()
+                                         + 8 * (int32_t) (slot + 1)));
+    }
+
+    X86Mem
+    savedRegisterSlot (size_t n) const
+    {
+      return X86Mem::at (X86Reg::RBP, -(m_arrayBytes + 8 * (int32_t) (n + 1)));
+    }
+
+    // The value as an operand; it must not be an address
+    X86Operand
+    operand (uint32_t value) const;
+
+    // The value as the source of a move
+    Move
+    moveFrom (uint32_t value, const X86Operand& dst) const;
+
+    void
+    load (X86Reg dst, uint32_t value);
+
+    // The register holding value, loading it into scratch if needed
+    X86Reg
+    inRegister (uint32_t value, X86Reg scratch);
+
+    // The register to compute value in, and storing it from there
+    X86Reg
+    resultRegister (uint32_t value) const
+    {
+      return location (value).kind == X86Location::REGISTER ? location (value).reg : X86Reg::RAX;
+    }
+
+    void
+    storeResult (uint32_t value, X86Reg reg);
+
+    // Element index of the array at address, using r11 and rax
+    X86Mem
+    element (uint32_t address, uint32_t index);
+
+    uint32_t
+    divisionLabel ()
+    {
+      if (m_divisionLabel == UINT32_MAX)
+        m_divisionLabel = m_out.newLabel ();
+      return m_divisionLabel;
+    }
+
+    const IrFunction& m_function;
+    uint32_t          m_index;
+    X86Assembler&     m_out;
+    X86Allocation     m_allocation;
+
+    // Frame pointer offset of each local array, and their bytes
+    std::vector<int32_t> m_arrayOffsets;
+    int32_t              m_arrayBytes;
+
+    std::vector<uint32_t> m_blockLabels;
+    uint32_t              m_nextBlock;
+    uint32_t              m_divisionLabel;
+  };
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generate ()
+  {
+    if (!m_function.ssa)
+      throw std::logic_error ("code generation needs SSA form");
+    allocateRegisters (m_function, m_allocation);
+    layOutFrame ();
+
+    m_out.beginFunction (m_index);
+    m_out.push (X86Reg::RBP);
+    m_out.mov (8, X86Reg::RBP, X86Reg::RSP);
+    int32_t frameBytes = m_arrayBytes + 8 * (int32_t) (m_allocation.calleeSaved.size () + m_allocation.spillSlots);
+    m_out.adjustStack (-((frameBytes + 15) & ~15));
+    for (size_t n = 0; n < m_allocation.calleeSaved.size (); ++n)
+      m_out.mov (8, savedRegisterSlot (n), m_allocation.calleeSaved[n]);
+    zeroFrame (m_out, m_arrayBytes);
+
+    // Parameters go from where the caller put them to where they are kept
+    std::vector<Move> moves;
+    const IrBlock& entry = m_function.blocks[0];
+    for (uint32_t n = entry.first; n < entry.first + entry.count; ++n)
+    {
+      const IrInstruction& instruction = m_function.instructions[n];
+      if (instruction.op != IrOpcode::PARAM)
+        continue;
+      X86Operand src = instruction.a < X86_ARGUMENT_REGISTER_COUNT
+        ? X86Operand (X86_ARGUMENT_REGISTERS[instruction.a])
+        : X86Operand (X86Mem::at (X86Reg::RBP, 16 + 8 * (int32_t) (instruction.a - X86_ARGUMENT_REGISTER_COUNT)));
+      moves.push_back ({ size (instruction.dest), operand (instruction.dest), src, false });
+    }
+    parallelMove (moves);
+
+    m_blockLabels.clear ();
+    for (size_t block = 0; block < m_function.blocks.size (); ++block)
+      m_blockLabels.push_back (m_out.newLabel ());
+    for (uint32_t block = 0; block < m_function.blocks.size (); ++block)
+    {
+      m_out.bind (m_blockLabels[block]);
+      m_nextBlock = block + 1;
+      const IrBlock& b = m_function.blocks[block];
+      for (uint32_t n = b.first; n < b.first + b.count; ++n)
+        generateInstruction (block, m_function.instructions[n]);
+    }
+
+    if (m_divisionLabel != UINT32_MAX)
+    {
+      m_out.bind (m_divisionLabel);
+      m_out.loadFunctionName (X86Reg::RDI);
+      m_out.callRuntime (X86Runtime::DIVISION_BY_ZERO);
+    }
+    m_out.endFunction ();
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::layOutFrame ()
+  {
+    m_arrayOffsets.clear ();
+    m_arrayBytes = 0;
+    for (uint32_t size : m_function.arrays)
+    {
+      m_arrayBytes += arrayFrameBytes (size);
+      m_arrayOffsets.push_back (-m_arrayBytes);
+    }
+  }
+
+  /*********************************************************************/
+
+  X86Operand
+  FunctionGenerator::operand (uint32_t value) const
+  {
+    const X86Location& l = location (value);
+    switch (l.kind)
+    {
+    case X86Location::REGISTER:
+      return l.reg;
+    case X86Location::STACK:
+      return spillSlot (l.index);
+    case X86Location::CONSTANT:
+      return X86Operand::immediate ((int32_t) l.index);
+    default:
+      throw std::logic_error ("code generation: an address or comparison used as an operand");
+    }
+  }
+
+  /*********************************************************************/
+
+  Move
+  FunctionGenerator::moveFrom (uint32_t value, const X86Operand& dst) const
+  {
+    const X86Location& l = location (value);
+    if (l.kind == X86Location::FRAME_ADDRESS)
+      return { 8, dst, X86Mem::at (X86Reg::RBP, m_arrayOffsets[l.index]), true };
+    if (l.kind == X86Location::GLOBAL_ADDRESS)
+      return { 8, dst, X86Mem::ofGlobal (l.index), true };
+    return { size (value), dst, operand (value), false };
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::load (X86Reg dst, uint32_t value)
+  {
+    if (!isIn (value, dst))
+      emitMove (moveFrom (value, dst));
+  }
+
+  /*********************************************************************/
+
+  X86Reg
+  FunctionGenerator::inRegister (uint32_t value, X86Reg scratch)
+  {
+    if (location (value).kind == X86Location::REGISTER)
+      return location (value).reg;
+    load (scratch, value);
+    return scratch;
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::storeResult (uint32_t value, X86Reg reg)
+  {
+    const X86Location& l = location (value);
+    if (l.kind == X86Location::STACK)
+      m_out.mov (size (value), spillSlot (l.index), reg);
+    else if (l.reg != reg)
+      m_out.mov (size (value), l.reg, reg);
+  }
+
+  /*********************************************************************/
+
+  X86Mem
+  FunctionGenerator::element (uint32_t address, uint32_t index)
+  {
+    const X86Location& base = location (address);
+    const X86Location& offset = location (index);
+    X86Mem mem;
+    if (base.kind == X86Location::GLOBAL_ADDRESS && offset.kind == X86Location::CONSTANT)
+      return X86Mem::ofGlobal (base.index, 4 * (int32_t) offset.index);
+    if (base.kind == X86Location::FRAME_ADDRESS)
+      mem = X86Mem::at (X86Reg::RBP, m_arrayOffsets[base.index]);
+    else
+      mem = X86Mem::at (inRegister (address, X86Reg::R11));
+
+    if (offset.kind == X86Location::CONSTANT)
+      mem.disp += 4 * (int32_t) offset.index;
+    else
+    {
+      mem.index = inRegister (index, X86Reg::RAX);
+      mem.scale = 4;
+    }
+    return mem;
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generateInstruction (uint32_t block, const IrInstruction& instruction)
+  {
+    const IrInstruction& i = instruction;
+    switch (i.op)
+    {
+    case IrOpcode::CONST: case IrOpcode::PARAM: case IrOpcode::COPY: case IrOpcode::PHI:
+    case IrOpcode::FRAME_ADDR: case IrOpcode::GLOBAL_ADDR:
+      break;
+
+    case IrOpcode::ADD: case IrOpcode::SUB: case IrOpcode::MUL:
+      generateArithmetic (i);
+      break;
+
+    case IrOpcode::DIV:
+      generateDivision (i);
+      break;
+
+    case IrOpcode::LT: case IrOpcode::LE: case IrOpcode::GT:
+    case IrOpcode::GE: case IrOpcode::EQ: case IrOpcode::NE:
+    {
+      if (location (i.dest).kind == X86Location::FLAGS)
+        break;
+      X86Cond cond = compare (i.op, i.a, i.b);
+      X86Reg target = resultRegister (i.dest);
+      m_out.setcc (cond, target);
+      storeResult (i.dest, target);
+      break;
+    }
+
+    case IrOpcode::LOAD:
+    {
+      X86Mem mem = element (i.a, i.b);
+      X86Reg target = resultRegister (i.dest);
+      m_out.mov (4, target, mem);
+      storeResult (i.dest, target);
+      break;
+    }
+
+    case IrOpcode::STORE:
+    {
+      X86Mem mem = element (i.a, i.b);
+      X86Operand value = location (i.c).kind == X86Location::STACK ? X86Operand (X86Reg::RDX) : operand (i.c);
+      if (location (i.c).kind == X86Location::STACK)
+        load (X86Reg::RDX, i.c);
+      m_out.mov (4, mem, value);
+      break;
+    }
+
+    case IrOpcode::LOAD_GLOBAL:
+    {
+      X86Reg target = resultRegister (i.dest);
+      m_out.mov (4, target, X86Mem::ofGlobal (i.a));
+      storeResult (i.dest, target);
+      break;
+    }
+
+    case IrOpcode::STORE_GLOBAL:
+    {
+      X86Operand value = location (i.b).kind == X86Location::STACK ? X86Operand (X86Reg::RAX) : operand (i.b);
+      if (location (i.b).kind == X86Location::STACK)
+        load (X86Reg::RAX, i.b);
+      m_out.mov (4, X86Mem::ofGlobal (i.a), value);
+      break;
+    }
+
+    case IrOpcode::CALL:
+      generateCall (i);
+      break;
+
+    case IrOpcode::INPUT:
+      m_out.loadFunctionName (X86Reg::RDI);
+      m_out.callRuntime (X86Runtime::INPUT);
+      storeResult (i.dest, X86Reg::RAX);
+      break;
+
+    case IrOpcode::OUTPUT:
+      load (X86Reg::RDI, i.a);
+      m_out.callRuntime (X86Runtime::OUTPUT);
+      break;
+
+    case IrOpcode::JUMP:
+      generatePhiMoves (block);
+      if (i.a == m_nextBlock)
+        break;
+      if (isTest (i.a))
+      {
+        const IrBlock& test = m_function.blocks[i.a];
+        generateBranch (m_function.instructions[test.first + test.count - 1]);
+      }
+      else
+        m_out.jmp (m_blockLabels[i.a]);
+      break;
+
+    case IrOpcode::BRANCH:
+      generateBranch (i);
+      break;
+
+    case IrOpcode::RET:
+      generateReturn (i);
+      break;
+    }
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generateArithmetic (const IrInstruction& instruction)
+  {
+    IrOpcode op = instruction.op;
+    uint32_t dest = instruction.dest;
+    uint32_t a = instruction.a;
+    uint32_t b = instruction.b;
+    X86Reg target = resultRegister (dest);
+
+    // a goes in the target and b is added to it; the target may hold
+    // either operand already
+    if (op != IrOpcode::SUB
+        && ((isIn (b, target) && !isIn (a, target))
+            || (location (a).kind == X86Location::CONSTANT && location (b).kind != X86Location::CONSTANT)))
+      std::swap (a, b);
+    if (isIn (b, target) && !isIn (a, target))
+      target = X86Reg::RAX;
+
+    int shift = op == IrOpcode::MUL && location (b).kind == X86Location::CONSTANT
+      ? log2Exact ((uint32_t) location (b).index) : -1;
+    if (shift > 0 && location (a).kind != X86Location::CONSTANT)
+    {
+      load (target, a);
+      m_out.shift (X86Shift::SHL, target, (uint8_t) shift);
+    }
+    else if (op == IrOpcode::MUL && location (b).kind == X86Location::CONSTANT
+             && location (a).kind != X86Location::CONSTANT)
+      m_out.imul (target, operand (a), (int32_t) location (b).index);
+    else
+    {
+      load (target, a);
+      if (op == IrOpcode::MUL)
+        m_out.imul (target, operand (b));
+      else
+        m_out.alu (op == IrOpcode::ADD ? X86Alu::ADD : X86Alu::SUB, target, operand (b));
+    }
+    storeResult (dest, target);
+  }
+
+  /*********************************************************************/
+
+  // Division truncates like C's; dividing by -1 negates, so that the
+  // quotient of INT_MIN wraps instead of trapping.  Dividing by any other
+  // constant shifts or multiplies instead.
+  void
+  FunctionGenerator::generateDivision (const IrInstruction& instruction)
+  {
+    const IrInstruction& i = instruction;
+    if (location (i.b).kind == X86Location::CONSTANT)
+    {
+      int32_t divisor = (int32_t) location (i.b).index;
+      if (divisor == 0)
+      {
+        m_out.jmp (divisionLabel ());
+        return;
+      }
+      uint32_t magnitude = divisor < 0 ? 0u - (uint32_t) divisor : (uint32_t) divisor;
+      int shift = log2Exact (magnitude);
+      if (shift >= 0)
+      {
+        load (X86Reg::RAX, i.a);
+        // Adding 2^shift - 1 to a negative dividend makes the shift round
+        // toward 0
+        if (shift > 0)
+        {
+          m_out.cdq ();
+          m_out.shift (X86Shift::SHR, X86Reg::RDX, (uint8_t) (32 - shift));
+          m_out.alu (X86Alu::ADD, X86Reg::RAX, X86Reg::RDX);
+          m_out.shift (X86Shift::SAR, X86Reg::RAX, (uint8_t) shift);
+        }
+        if (divisor < 0)
+          m_out.neg (X86Reg::RAX);
+      }
+      else
+      {
+        // The product's high half lands in edx, so the dividend stays
+        // where it is or goes in r11
+        DivisionMagic magic = divisionMagic (divisor);
+        X86Operand dividend = location (i.a).kind == X86Location::STACK
+          ? operand (i.a) : X86Operand (inRegister (i.a, X86Reg::R11));
+        m_out.mov (4, X86Reg::RAX, X86Operand::immediate (magic.multiplier));
+        m_out.imulWide (dividend);
+        if (divisor > 0 && magic.multiplier < 0)
+          m_out.alu (X86Alu::ADD, X86Reg::RDX, dividend);
+        else if (divisor < 0 && magic.multiplier > 0)
+          m_out.alu (X86Alu::SUB, X86Reg::RDX, dividend);
+        if (magic.shift > 0)
+          m_out.shift (X86Shift::SAR, X86Reg::RDX, (uint8_t) magic.shift);
+        // A negative quotient is 1 short of rounding toward 0
+        m_out.mov (4, X86Reg::RAX, X86Reg::RDX);
+        m_out.shift (X86Shift::SHR, X86Reg::RAX, 31);
+        m_out.alu (X86Alu::ADD, X86Reg::RAX, X86Reg::RDX);
+      }
+    }
+    else
+    {
+      X86Operand divisor = operand (i.b);
+      uint32_t negate = m_out.newLabel ();
+      uint32_t done = m_out.newLabel ();
+      m_out.alu (X86Alu::CMP, divisor, X86Operand::immediate (0));
+      m_out.jcc (X86Cond::E, divisionLabel ());
+      m_out.alu (X86Alu::CMP, divisor, X86Operand::immediate (-1));
+      m_out.jcc (X86Cond::E, negate);
+      load (X86Reg::RAX, i.a);
+      m_out.cdq ();
+      m_out.idiv (divisor);
+      m_out.jmp (done);
+      m_out.bind (negate);
+      load (X86Reg::RAX, i.a);
+      m_out.neg (X86Reg::RAX);
+      m_out.bind (done);
+    }
+    storeResult (i.dest, X86Reg::RAX);
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generateCall (const IrInstruction& instruction)
+  {
+    uint32_t count = instruction.b;
+    const uint32_t* arguments = m_function.operands.data () + instruction.a;
+
+    // Arguments past the sixth are pushed last first, keeping the stack
+    // aligned to 16 bytes at the call
+    uint32_t pushed = count > X86_ARGUMENT_REGISTER_COUNT ? count - X86_ARGUMENT_REGISTER_COUNT : 0;
+    int32_t padding = pushed % 2 == 1 ? 8 : 0;
+    m_out.adjustStack (-padding);
+    for (uint32_t n = count; n-- > X86_ARGUMENT_REGISTER_COUNT;)
+      m_out.push (inRegister (arguments[n], X86Reg::RAX));
+
+    std::vector<Move> moves;
+    for (uint32_t n = 0; n < count && n < X86_ARGUMENT_REGISTER_COUNT; ++n)
+      moves.push_back (moveFrom (arguments[n], X86_ARGUMENT_REGISTERS[n]));
+    parallelMove (moves);
+
+    m_out.call (instruction.c);
+    m_out.adjustStack (8 * (int32_t) pushed + padding);
+    if (instruction.dest != IR_NO_VALUE)
+      storeResult (instruction.dest, X86Reg::RAX);
+  }
+
+  /*********************************************************************/
+
+  X86Cond
+  FunctionGenerator::compare (IrOpcode op, uint32_t a, uint32_t b)
+  {
+    X86Cond cond = conditionOf (op);
+    if (location (a).kind == X86Location::CONSTANT && location (b).kind != X86Location::CONSTANT)
+    {
+      std::swap (a, b);
+      cond = mirror (cond);
+    }
+    X86Operand left = operand (a);
+    X86Operand right = operand (b);
+    if (left.kind == X86Operand::IMM || (left.kind == X86Operand::MEM && right.kind == X86Operand::MEM))
+    {
+      load (X86Reg::RAX, a);
+      left = X86Reg::RAX;
+    }
+    m_out.alu (X86Alu::CMP, left, right);
+    return cond;
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generateBranch (const IrInstruction& instruction)
+  {
+    uint32_t thenBlock = instruction.b;
+    uint32_t elseBlock = instruction.c;
+    for (uint32_t successor : { thenBlock, elseBlock })
+    {
+      const IrBlock& s = m_function.blocks[successor];
+      if (m_function.instructions[s.first].op == IrOpcode::PHI)
+        throw std::logic_error ("code generation: a branch to a block with phis");
+    }
+
+    const X86Location& condition = location (instruction.a);
+    X86Cond cond = X86Cond::NE;
+    if (condition.kind == X86Location::FLAGS)
+    {
+      const IrInstruction& comparison = m_function.instructions[condition.index];
+      cond = compare (comparison.op, comparison.a, comparison.b);
+    }
+    else if (condition.kind == X86Location::CONSTANT)
+    {
+      uint32_t target = condition.index != 0 ? thenBlock : elseBlock;
+      if (target != m_nextBlock)
+        m_out.jmp (m_blockLabels[target]);
+      return;
+    }
+    else if (condition.kind == X86Location::REGISTER)
+      m_out.test (condition.reg, condition.reg);
+    else
+      m_out.alu (X86Alu::CMP, operand (instruction.a), X86Operand::immediate (0));
+
+    if (thenBlock == m_nextBlock)
+      m_out.jcc (negate (cond), m_blockLabels[elseBlock]);
+    else
+    {
+      m_out.jcc (cond, m_blockLabels[thenBlock]);
+      if (elseBlock != m_nextBlock)
+        m_out.jmp (m_blockLabels[elseBlock]);
+    }
+  }
+
+  /*********************************************************************/
+
+  bool
+  FunctionGenerator::isTest (uint32_t block) const
+  {
+    const IrBlock& b = m_function.blocks[block];
+    const std::vector<IrInstruction>& instructions = m_function.instructions;
+    if (instructions[b.first + b.count - 1].op != IrOpcode::BRANCH)
+      return false;
+    for (uint32_t n = b.first; n < b.first + b.count - 1; ++n)
+    {
+      const IrInstruction& instruction = instructions[n];
+      switch (instruction.op)
+      {
+      case IrOpcode::PHI: case IrOpcode::COPY: case IrOpcode::CONST:
+      case IrOpcode::FRAME_ADDR: case IrOpcode::GLOBAL_ADDR:
+        break;
+      default:
+        if (instruction.dest == IR_NO_VALUE || location (instruction.dest).kind != X86Location::FLAGS)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generatePhiMoves (uint32_t block)
+  {
+    const IrBlock& b = m_function.blocks[block];
+    const IrBlock& s = m_function.blocks[b.successors[0]];
+    size_t slot = 0;
+    while (s.predecessors[slot] != block)
+      ++slot;
+
+    std::vector<Move> moves;
+    for (uint32_t n = s.first; n < s.first + s.count && m_function.instructions[n].op == IrOpcode::PHI; ++n)
+    {
+      const IrInstruction& phi = m_function.instructions[n];
+      moves.push_back (moveFrom (m_function.operands[phi.a + slot], operand (phi.dest)));
+    }
+    parallelMove (moves);
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::generateReturn (const IrInstruction& instruction)
+  {
+    if (instruction.a != IR_NO_VALUE)
+      load (X86Reg::RAX, instruction.a);
+    for (size_t n = 0; n < m_allocation.calleeSaved.size (); ++n)
+      m_out.mov (8, m_allocation.calleeSaved[n], savedRegisterSlot (n));
+    m_out.mov (8, X86Reg::RSP, X86Reg::RBP);
+    m_out.pop (X86Reg::RBP);
+    m_out.ret ();
+  }
+
+  /*********************************************************************/
+
+  // Moves are made in an order that reads each destination before it
+  // is written; a cycle is broken by moving one value to rax
+  void
+  FunctionGenerator::parallelMove (std::vector<Move>& moves)
+  {
+    auto reads = [] (const Move& move, const X86Operand& place) {
+      return !move.address && sameLocation (move.src, place);
+    };
+
+    for (size_t n = 0; n < moves.size ();)
+    {
+      if (reads (moves[n], moves[n].dst))
+      {
+        moves[n] = moves.back ();
+        moves.pop_back ();
+      }
+      else
+        ++n;
+    }
+
+    while (!moves.empty ())
+    {
+      size_t ready = moves.size ();
+      for (size_t n = 0; n < moves.size () && ready == moves.size (); ++n)
+      {
+        bool blocked = false;
+        for (size_t k = 0; k < moves.size () && !blocked; ++k)
+          blocked = k != n && reads (moves[k], moves[n].dst);
+        if (!blocked)
+          ready = n;
+      }
+
+      if (ready == moves.size ())
+      {
+        X86Operand saved = moves[0].dst;
+        m_out.mov (8, X86Reg::RAX, saved);
+        for (Move& move : moves)
+          if (reads (move, saved))
+            move.src = X86Reg::RAX;
+        continue;
+      }
+
+      emitMove (moves[ready]);
+      moves.erase (moves.begin () + ready);
+    }
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionGenerator::emitMove (const Move& move)
+  {
+    if (move.address)
+    {
+      if (move.dst.kind == X86Operand::REG)
+        m_out.lea (move.dst.reg, move.src.mem);
+      else
+      {
+        m_out.lea (X86Reg::R11, move.src.mem);
+        m_out.mov (8, move.dst, X86Reg::R11);
+      }
+    }
+    else if (move.dst.kind == X86Operand::MEM && move.src.kind == X86Operand::MEM)
+    {
+      m_out.mov (move.size, X86Reg::R11, move.src);
+      m_out.mov (move.size, move.dst, X86Reg::R11);
+    }
+    else
+      m_out.mov (move.size, move.dst, move.src);
+  }
+}
+
+/***********************************************************************/
+
+void
+zeroFrame (X86Assembler& assembler, int32_t bytes)
+{
+  if (bytes <= 64)
+  {
+    for (int32_t offset = 8; offset <= bytes; offset += 8)
+      assembler.mov (8, X86Mem::at (X86Reg::RBP, -offset), X86Operand::immediate (0));
+    return;
+  }
+
+  // r11 counts the words down to 1
+  uint32_t loop = assembler.newLabel ();
+  assembler.mov (4, X86Reg::R11, X86Operand::immediate (bytes / 8));
+  assembler.bind (loop);
+  X86Mem word = X86Mem::indexed (X86Reg::RBP, X86Reg::R11, -bytes - 8);
+  word.scale = 8;
+  assembler.mov (8, word, X86Operand::immediate (0));
+  assembler.alu (X86Alu::SUB, X86Reg::R11, X86Operand::immediate (1));
+  assembler.jcc (X86Cond::NE, loop);
+}
+
+/***********************************************************************/
+
+void
+generateCode (const IrModule& module, X86Assembler& assembler)
+{
+  bool hasMain = false;
+  for (const IrGlobal& global : module.globals)
+  {
+    if (global.external)
+      raiseError (DiagnosticPhase::CODEGEN, 0, 0,
+                  "\nERROR: \"%s\" is imported; only whole programs can be compiled\n\n", global.name.c_str ());
+    assembler.addGlobal (global.name, global.size);
+  }
+  for (const IrFunction& function : module.functions)
+  {
+    if (function.external)
+      raiseError (DiagnosticPhase::CODEGEN, 0, 0,
+                  "\nERROR: \"%s\" is imported; only whole programs can be compiled\n\n", function.name.c_str ());
+    hasMain = hasMain || function.name == "main";
+    assembler.addFunction (function.name);
+  }
+  if (!hasMain)
+    raiseError (DiagnosticPhase::CODEGEN, 0, 0, "\nERROR: \"main\" function was never declared\n\n");
+
+  for (uint32_t n = 0; n < module.functions.size (); ++n)
+  {
+    FunctionGenerator generator (module, n, assembler);
+    generator.generate ();
+  }
+}
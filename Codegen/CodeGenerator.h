@@ -0,0 +1,47 @@
+/*
+  Filename   : CodeGenerator.h
+  Author     : Philip Androwick
+  Description: x86-64 code generation.  generateCode compiles the SSA IR
+               with its values in registers chosen by linear scan
+               (LinearScan.h); generateStackCode compiles the checked
+               tree directly, keeping every variable in the frame and
+               every temporary on the stack, as a baseline to measure
+               register allocation against.  Both follow the System V
+               ABI for the registers a call keeps.
+*/
+
+/***********************************************************************/
+
+#ifndef CODE_GENERATOR_H
+#define CODE_GENERATOR_H
+
+/***********************************************************************/
+// Local includes
+
+#include "X86.h"
+#include "../IR/IR.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// Writes module, whose functions must be in SSA form, through assembler.
+//   The first six arguments of a call are passed in registers, as the
+//   System V ABI does.  Raises a CompileError if module has no "main"
+//   or refers to an imported symbol.
+void
+generateCode (const IrModule& module, X86Assembler& assembler);
+
+// Writes the checked program through assembler, laying out its frames
+//   (FrameLayout.h).  Raises a CompileError as generateCode does.
+//   (StackCodeGenerator.cc)
+void
+generateStackCode (ProgramNode* program, X86Assembler& assembler);
+
+// Clears the bytes [rbp - bytes, rbp) of the frame, a multiple of 8,
+//   using r11
+void
+zeroFrame (X86Assembler& assembler, int32_t bytes);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,94 @@
+/*
+  Filename   : FrameLayout.cc
+  Author     : Philip Androwick
+  Description: Assigns the frame pointer offsets of a function's
+               parameters and locals.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "FrameLayout.h"
+
+/***********************************************************************/
+
+namespace
+{
+  class FrameLayout : public AstWalker
+  {
+  public:
+    virtual bool
+    enter (ParameterNode* node)
+    {
+      m_parameters.push_back (node);
+      return true;
+    }
+
+    virtual bool
+    enter (VariableDeclarationNode* node)
+    {
+      m_scalars.push_back (node);
+      return true;
+    }
+
+    virtual bool
+    enter (ArrayDeclarationNode* node)
+    {
+      m_arrays.push_back (node);
+      return true;
+    }
+
+    int32_t
+    assign ()
+    {
+      int32_t offset = 0;
+      for (ArrayDeclarationNode* array : m_arrays)
+      {
+        offset -= arrayFrameBytes (array->size);
+        array->framePointerOffset = offset;
+      }
+      for (VariableDeclarationNode* scalar : m_scalars)
+      {
+        offset -= 8;
+        scalar->framePointerOffset = offset;
+      }
+      int32_t count = (int32_t) m_parameters.size ();
+      for (int32_t n = 0; n < count; ++n)
+        m_parameters[n]->framePointerOffset = 16 + 8 * (count - 1 - n);
+      return (-offset + 15) & ~15;
+    }
+
+  private:
+    std::vector<ParameterNode*>           m_parameters;
+    std::vector<VariableDeclarationNode*> m_scalars;
+    std::vector<ArrayDeclarationNode*>    m_arrays;
+  };
+}
+
+/***********************************************************************/
+
+int32_t
+layoutFrame (FunctionDeclarationNode* function)
+{
+  FrameLayout layout;
+  layout.walk (function);
+  return layout.assign ();
+}
+
+/***********************************************************************/
+
+void
+layoutFrames (ProgramNode* program)
+{
+  for (DeclarationNode* declaration : program->declarations)
+  {
+    FunctionDeclarationNode* function = dynamic_cast<FunctionDeclarationNode*> (declaration);
+    if (function != nullptr && function->functionBody != nullptr)
+      layoutFrame (function);
+  }
+}
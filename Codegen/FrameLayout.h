@@ -0,0 +1,53 @@
+/*
+  Filename   : FrameLayout.h
+  Author     : Philip Androwick
+  Description: Layout of a function's stack frame for the x86-64 code
+               generators.  Below the saved frame pointer come the local
+               arrays, in the order they are declared, then whatever else
+               a generator keeps in the frame.  The stack code generator
+               keeps every scalar local there, and has the caller push
+               the arguments in order, so that the last one is nearest
+               the frame pointer, above the return address.
+*/
+
+/***********************************************************************/
+
+#ifndef FRAME_LAYOUT_H
+#define FRAME_LAYOUT_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// Bytes a local array of size ints takes in a frame, a multiple of 8
+inline int32_t
+arrayFrameBytes (size_t size)
+{
+  return (int32_t) ((size * 4 + 7) & ~(size_t) 7);
+}
+
+// Sets framePointerOffset of function's parameters and locals: an
+//   array's is where its first element is, a scalar local's where it is
+//   kept in a slot of 8 bytes after the arrays, and parameter n of
+//   count's 16 + 8 * (count - 1 - n), where the caller pushed it.
+//   Returns the bytes of the frame below the saved frame pointer, a
+//   multiple of 16.
+int32_t
+layoutFrame (FunctionDeclarationNode* function);
+
+// Lays out the frame of every function of program
+void
+layoutFrames (ProgramNode* program);
+
+/***********************************************************************/
+
+#endif
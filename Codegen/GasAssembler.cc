@@ -0,0 +1,362 @@
+/*
+  Filename   : GasAssembler.cc
+  Author     : Philip Androwick
+  Description: Writes x86-64 assembly text for GNU as.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <stdexcept>
+
+/***********************************************************************/
+// Local includes
+
+#include "GasAssembler.h"
+#include "Runtime.h"
+
+/***********************************************************************/
+
+namespace
+{
+  const char* const NAMES_64[] = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+  };
+  const char* const NAMES_32[] = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+    "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+  };
+  const char* const NAMES_8[] = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+    "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+  };
+
+  std::string
+  reg (int size, X86Reg reg)
+  {
+    const char* const* names = size == 8 ? NAMES_64 : size == 4 ? NAMES_32 : NAMES_8;
+    return std::string ("%") + names[(int) reg];
+  }
+
+  const char*
+  condition (X86Cond cond)
+  {
+    switch (cond)
+    {
+    case X86Cond::E:  return "e";
+    case X86Cond::NE: return "ne";
+    case X86Cond::L:  return "l";
+    case X86Cond::GE: return "ge";
+    case X86Cond::LE: return "le";
+    case X86Cond::G:  return "g";
+    }
+    throw std::logic_error ("GasAssembler: unknown condition");
+  }
+
+  std::string
+  label (uint32_t label)
+  {
+    return ".L" + std::to_string (label);
+  }
+}
+
+/***********************************************************************/
+
+GasAssembler::GasAssembler ()
+  : m_function (0), m_labels (0)
+{
+  m_code = "\t.text\n";
+}
+
+/***********************************************************************/
+
+std::string
+GasAssembler::finish ()
+{
+  std::string text = std::move (m_code);
+  text += "\n\t.section .rodata\n";
+  for (size_t n = 0; n < m_functions.size (); ++n)
+    text += ".Lname" + std::to_string (n) + ":\n\t.asciz \"" + m_functions[n] + "\"\n";
+  text += "\n\t.bss\n\t.p2align 4\n";
+  for (size_t n = 0; n < m_globals.size (); ++n)
+    text += "cm_" + m_globals[n] + ":\n\t.zero " + std::to_string (m_globalWords[n] * 4) + "\n";
+  return text;
+}
+
+/***********************************************************************/
+
+uint32_t
+GasAssembler::addGlobal (const std::string& name, uint32_t words)
+{
+  m_globals.push_back (name);
+  m_globalWords.push_back (words);
+  return (uint32_t) m_globals.size () - 1;
+}
+
+/***********************************************************************/
+
+uint32_t
+GasAssembler::addFunction (const std::string& name)
+{
+  m_functions.push_back (name);
+  return (uint32_t) m_functions.size () - 1;
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::beginFunction (uint32_t function)
+{
+  m_function = function;
+  m_code += "\n\t.p2align 4\ncm_" + m_functions[function] + ":\n";
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::endFunction ()
+{
+}
+
+/***********************************************************************/
+
+uint32_t
+GasAssembler::newLabel ()
+{
+  return m_labels++;
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::bind (uint32_t label)
+{
+  m_code += ::label (label) + ":\n";
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::line (const char* mnemonic, const std::string& operands)
+{
+  m_code += '\t';
+  m_code += mnemonic;
+  if (!operands.empty ())
+  {
+    m_code += '\t';
+    m_code += operands;
+  }
+  m_code += '\n';
+}
+
+/***********************************************************************/
+
+std::string
+GasAssembler::memory (const X86Mem& mem) const
+{
+  std::string text;
+  if (mem.global != X86Mem::NO_GLOBAL)
+  {
+    text = "cm_" + m_globals[mem.global];
+    if (mem.disp != 0)
+      text += (mem.disp > 0 ? "+" : "") + std::to_string (mem.disp);
+    return text + "(%rip)";
+  }
+  if (mem.disp != 0)
+    text = std::to_string (mem.disp);
+  text += "(" + reg (8, mem.base);
+  if (mem.index != X86Reg::NONE)
+    text += "," + reg (8, mem.index) + "," + std::to_string (mem.scale);
+  return text + ")";
+}
+
+/***********************************************************************/
+
+std::string
+GasAssembler::operand (int size, const X86Operand& operand) const
+{
+  switch (operand.kind)
+  {
+  case X86Operand::REG:
+    return reg (size, operand.reg);
+  case X86Operand::IMM:
+    return "$" + std::to_string (operand.imm);
+  default:
+    return memory (operand.mem);
+  }
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::mov (int size, const X86Operand& dst, const X86Operand& src)
+{
+  line (size == 8 ? "movq" : "movl", operand (size, src) + ", " + operand (size, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::lea (X86Reg dst, const X86Mem& src)
+{
+  line ("leaq", memory (src) + ", " + reg (8, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::alu (X86Alu op, const X86Operand& dst, const X86Operand& src)
+{
+  static const char* const mnemonics[] = { "addl", "", "", "", "", "subl", "xorl", "cmpl" };
+  line (mnemonics[(int) op], operand (4, src) + ", " + operand (4, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::adjustStack (int32_t bytes)
+{
+  if (bytes > 0)
+    line ("addq", "$" + std::to_string (bytes) + ", %rsp");
+  else if (bytes < 0)
+    line ("subq", "$" + std::to_string (-bytes) + ", %rsp");
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::imul (X86Reg dst, const X86Operand& src)
+{
+  line ("imull", operand (4, src) + ", " + reg (4, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::imul (X86Reg dst, const X86Operand& src, int32_t k)
+{
+  line ("imull", "$" + std::to_string (k) + ", " + operand (4, src) + ", " + reg (4, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::imulWide (const X86Operand& src)
+{
+  line ("imull", operand (4, src));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::cdq ()
+{
+  line ("cltd");
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::idiv (const X86Operand& divisor)
+{
+  line ("idivl", operand (4, divisor));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::neg (X86Reg reg)
+{
+  line ("negl", ::reg (4, reg));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::shift (X86Shift op, X86Reg reg, uint8_t count)
+{
+  const char* mnemonic = op == X86Shift::SHL ? "shll" : op == X86Shift::SHR ? "shrl" : "sarl";
+  line (mnemonic, "$" + std::to_string (count) + ", " + ::reg (4, reg));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::test (X86Reg a, X86Reg b)
+{
+  line ("testl", reg (4, b) + ", " + reg (4, a));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::setcc (X86Cond cond, X86Reg dst)
+{
+  line ((std::string ("set") + condition (cond)).c_str (), reg (1, dst));
+  line ("movzbl", reg (1, dst) + ", " + reg (4, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::jmp (uint32_t label)
+{
+  line ("jmp", ::label (label));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::jcc (X86Cond cond, uint32_t label)
+{
+  line ((std::string ("j") + condition (cond)).c_str (), ::label (label));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::call (uint32_t function)
+{
+  line ("call", "cm_" + m_functions[function]);
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::callRuntime (X86Runtime function)
+{
+  line ("call", getRuntimeSymbol (function));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::loadFunctionName (X86Reg dst)
+{
+  line ("leaq", ".Lname" + std::to_string (m_function) + "(%rip), " + reg (8, dst));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::push (X86Reg reg)
+{
+  line ("pushq", ::reg (8, reg));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::pop (X86Reg reg)
+{
+  line ("popq", ::reg (8, reg));
+}
+
+/***********************************************************************/
+
+void
+GasAssembler::ret ()
+{
+  line ("ret");
+}
@@ -0,0 +1,139 @@
+/*
+  Filename   : GasAssembler.h
+  Author     : Philip Androwick
+  Description: An X86Assembler that writes GNU as (AT&T syntax) text.
+               Functions become the symbols cm_NAME and globals cm_NAME
+               in .bss, so C- names never clash with the runtime's.
+*/
+
+/***********************************************************************/
+
+#ifndef GAS_ASSEMBLER_H
+#define GAS_ASSEMBLER_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "X86.h"
+
+/***********************************************************************/
+
+class GasAssembler : public X86Assembler
+{
+public:
+  GasAssembler ();
+
+  // The program's text: its code, the names of its functions and its
+  //   globals.  The runtime is not included.
+  std::string
+  finish ();
+
+  uint32_t
+  addGlobal (const std::string& name, uint32_t words) override;
+
+  uint32_t
+  addFunction (const std::string& name) override;
+
+  void
+  beginFunction (uint32_t function) override;
+
+  void
+  endFunction () override;
+
+  uint32_t
+  newLabel () override;
+
+  void
+  bind (uint32_t label) override;
+
+  void
+  mov (int size, const X86Operand& dst, const X86Operand& src) override;
+
+  void
+  lea (X86Reg dst, const X86Mem& src) override;
+
+  void
+  alu (X86Alu op, const X86Operand& dst, const X86Operand& src) override;
+
+  void
+  adjustStack (int32_t bytes) override;
+
+  void
+  imul (X86Reg dst, const X86Operand& src) override;
+
+  void
+  imul (X86Reg dst, const X86Operand& src, int32_t k) override;
+
+  void
+  imulWide (const X86Operand& src) override;
+
+  void
+  cdq () override;
+
+  void
+  idiv (const X86Operand& divisor) override;
+
+  void
+  neg (X86Reg reg) override;
+
+  void
+  shift (X86Shift op, X86Reg reg, uint8_t count) override;
+
+  void
+  test (X86Reg a, X86Reg b) override;
+
+  void
+  setcc (X86Cond cond, X86Reg dst) override;
+
+  void
+  jmp (uint32_t label) override;
+
+  void
+  jcc (X86Cond cond, uint32_t label) override;
+
+  void
+  call (uint32_t function) override;
+
+  void
+  callRuntime (X86Runtime function) override;
+
+  void
+  loadFunctionName (X86Reg dst) override;
+
+  void
+  push (X86Reg reg) override;
+
+  void
+  pop (X86Reg reg) override;
+
+  void
+  ret () override;
+
+private:
+  // Appends "\tmnemonic operands\n"
+  void
+  line (const char* mnemonic, const std::string& operands = "");
+
+  std::string
+  operand (int size, const X86Operand& operand) const;
+
+  std::string
+  memory (const X86Mem& mem) const;
+
+  std::string m_code;
+  std::vector<std::string> m_globals;
+  std::vector<uint32_t>    m_globalWords;
+  std::vector<std::string> m_functions;
+  uint32_t m_function;
+  uint32_t m_labels;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,200 @@
+/*
+  Filename   : Jit.cc
+  Author     : Philip Androwick
+  Description: Loads and runs machine code.  The runtime's errors, and
+               memory faults caught by a signal handler on its own stack,
+               jump back to run, which raises them; generated code has
+               no unwind information, so no exception may pass through
+               it.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/***********************************************************************/
+// Local includes
+
+#include "Jit.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // The program running on this thread
+  struct RunState
+  {
+    FILE*       in;
+    FILE*       out;
+    sigjmp_buf  failure;
+    const char* error;
+    const char* function;
+  };
+
+  thread_local RunState* t_running = nullptr;
+
+  [[noreturn]] void
+  fail (const char* error, const char* function)
+  {
+    t_running->error = error;
+    t_running->function = function;
+    siglongjmp (t_running->failure, 1);
+  }
+
+  int
+  input (const char* function)
+  {
+    int value;
+    if (fscanf (t_running->in, "%d", &value) != 1)
+      fail ("No integer left to read", function);
+    return value;
+  }
+
+  void
+  output (int value)
+  {
+    fprintf (t_running->out, "%d\n", value);
+  }
+
+  void
+  divisionByZero (const char* function)
+  {
+    fail ("Division by zero", function);
+  }
+
+  // In the order of X86Runtime
+  const void* const RUNTIME[X86_RUNTIME_COUNT] = {
+    (const void*) &input, (const void*) &output, (const void*) &divisionByZero
+  };
+
+  void
+  memoryFault (int signal)
+  {
+    // A fault outside a program is not ours to handle; returning with
+    // the default action faults again
+    if (t_running == nullptr)
+    {
+      std::signal (signal, SIG_DFL);
+      return;
+    }
+    fail ("Memory fault (recursion too deep or an index out of bounds)", nullptr);
+  }
+
+  size_t
+  pageBytes ()
+  {
+    static const size_t bytes = (size_t) sysconf (_SC_PAGESIZE);
+    return bytes;
+  }
+}
+
+/***********************************************************************/
+
+JitProgram::JitProgram ()
+  : m_image (nullptr), m_imageBytes (0), m_textBytes (0), m_globals (nullptr), m_globalBytes (0),
+    m_main (0)
+{
+}
+
+/***********************************************************************/
+
+JitProgram::~JitProgram ()
+{
+  unload ();
+}
+
+/***********************************************************************/
+
+void
+JitProgram::unload ()
+{
+  if (m_image != nullptr)
+    munmap (m_image, m_imageBytes);
+  m_image = nullptr;
+  m_imageBytes = 0;
+}
+
+/***********************************************************************/
+
+void
+JitProgram::load (X86Encoder& encoder)
+{
+  uint32_t main = encoder.findFunction ("main");
+  if (main == UINT32_MAX)
+    throw std::logic_error ("JitProgram: the program has no main");
+
+  unload ();
+  std::vector<uint8_t> text = encoder.finish (RUNTIME, pageBytes ());
+  size_t textPages = (text.size () + pageBytes () - 1) / pageBytes () * pageBytes ();
+  size_t globalPages = (encoder.getGlobalBytes () + pageBytes () - 1) / pageBytes () * pageBytes ();
+
+  void* image = mmap (nullptr, textPages + globalPages, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (image == MAP_FAILED)
+    throw std::runtime_error ("JitProgram: could not map memory for the code");
+  m_image = (uint8_t*) image;
+  m_imageBytes = textPages + globalPages;
+  std::memcpy (m_image, text.data (), text.size ());
+  if (mprotect (m_image, textPages, PROT_READ | PROT_EXEC) != 0)
+  {
+    unload ();
+    throw std::runtime_error ("JitProgram: could not make the code executable");
+  }
+  m_textBytes = text.size ();
+  m_globals = m_image + textPages;
+  m_globalBytes = encoder.getGlobalBytes ();
+  m_main = encoder.getFunctionOffset (main);
+}
+
+/***********************************************************************/
+
+void
+JitProgram::run (FILE* in, FILE* out)
+{
+  if (m_image == nullptr)
+    throw std::logic_error ("JitProgram: no program is loaded");
+  std::memset (m_globals, 0, m_globalBytes);
+
+  // Faults are handled on a stack of their own, as the program's may be
+  // the one that overflowed
+  std::vector<char> signalStack (1 << 16);
+  stack_t alternate = { };
+  alternate.ss_sp = signalStack.data ();
+  alternate.ss_size = signalStack.size ();
+  stack_t previousStack;
+  sigaltstack (&alternate, &previousStack);
+  struct sigaction action = { };
+  action.sa_handler = memoryFault;
+  action.sa_flags = SA_ONSTACK | SA_NODEFER;
+  struct sigaction previousSegv, previousBus;
+  sigaction (SIGSEGV, &action, &previousSegv);
+  sigaction (SIGBUS, &action, &previousBus);
+
+  RunState state;
+  state.in = in;
+  state.out = out;
+  state.error = nullptr;
+  state.function = nullptr;
+  RunState* outer = t_running;
+  t_running = &state;
+  if (sigsetjmp (state.failure, 1) == 0)
+    ((int (*) ()) (m_image + m_main)) ();
+  t_running = outer;
+
+  sigaction (SIGSEGV, &previousSegv, nullptr);
+  sigaction (SIGBUS, &previousBus, nullptr);
+  sigaltstack (&previousStack, nullptr);
+
+  if (state.error != nullptr && state.function != nullptr)
+    raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: %s in \"%s\"\n\n", state.error, state.function);
+  if (state.error != nullptr)
+    raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: %s\n\n", state.error);
+}
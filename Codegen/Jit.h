@@ -0,0 +1,73 @@
+/*
+  Filename   : Jit.h
+  Author     : Philip Androwick
+  Description: Runs a program compiled to machine code (X86Encoder.h) in
+               the compiler's own process.  The text is loaded into pages
+               that are made executable only once they are no longer
+               writable, and the globals into writable pages after it.
+               input and output are C++ functions of the host, called
+               through stubs in the text.
+*/
+
+/***********************************************************************/
+
+#ifndef JIT_H
+#define JIT_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+
+/***********************************************************************/
+// Local includes
+
+#include "X86Encoder.h"
+
+/***********************************************************************/
+
+class JitProgram
+{
+public:
+  JitProgram ();
+
+  ~JitProgram ();
+
+  JitProgram (const JitProgram&) = delete;
+  JitProgram& operator= (const JitProgram&) = delete;
+
+  // Loads the program written through encoder, which must have a
+  //   "main", replacing any loaded before
+  void
+  load (X86Encoder& encoder);
+
+  // Runs main, reading input from in and writing output to out.
+  //   Integer arithmetic wraps.  Dividing by zero, running out of input
+  //   and faulting on memory, from recursing too deeply or indexing
+  //   outside an array, are raised as a CompileError with
+  //   DiagnosticPhase::RUNTIME.
+  void
+  run (FILE* in, FILE* out);
+
+  // Bytes of code and data loaded
+  size_t
+  getTextBytes () const
+  {
+    return m_textBytes;
+  }
+
+private:
+  void
+  unload ();
+
+  uint8_t* m_image;
+  size_t   m_imageBytes;
+  size_t   m_textBytes;
+  uint8_t* m_globals;
+  size_t   m_globalBytes;
+  uint32_t m_main;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,502 @@
+/*
+  Filename   : LinearScan.cc
+  Author     : Philip Androwick
+  Description: Linear-scan register allocation.  Instructions are
+               numbered in block order, two apart, and liveness is solved
+               over the blocks with bit sets.  Phi operands are live out
+               of their predecessors and phis are defined where their
+               blocks start.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+
+/***********************************************************************/
+// Local includes
+
+#include "LinearScan.h"
+
+/***********************************************************************/
+
+namespace
+{
+  const uint32_t NONE = UINT32_MAX;
+
+  bool
+  isComparison (IrOpcode op)
+  {
+    return op >= IrOpcode::LT && op <= IrOpcode::NE;
+  }
+
+  class Allocator
+  {
+  public:
+    Allocator (const IrFunction& function, X86Allocation& allocation)
+      : m_function (function), m_allocation (allocation)
+    { }
+
+    void
+    run ()
+    {
+      findRoots ();
+      classifyValues ();
+      numberInstructions ();
+      solveLiveness ();
+      buildIntervals ();
+      scan ();
+
+      for (uint32_t value = 0; value < m_roots.size (); ++value)
+        if (m_roots[value] != value)
+          m_allocation.locations[value] = m_allocation.locations[m_roots[value]];
+    }
+
+  private:
+    // Each value's root: itself, or the source of the copy it is
+    void
+    findRoots ()
+    {
+      const std::vector<IrInstruction>& instructions = m_function.instructions;
+      size_t valueCount = m_function.types.size ();
+      m_definition.assign (valueCount, NONE);
+      for (const IrBlock& block : m_function.blocks)
+        for (uint32_t n = block.first; n < block.first + block.count; ++n)
+          if (instructions[n].dest != IR_NO_VALUE)
+            m_definition[instructions[n].dest] = n;
+
+      m_roots.assign (valueCount, NONE);
+      for (uint32_t value = 0; value < valueCount; ++value)
+      {
+        uint32_t root = value;
+        while (m_definition[root] != NONE && instructions[m_definition[root]].op == IrOpcode::COPY)
+          root = instructions[m_definition[root]].a;
+        m_roots[value] = root;
+      }
+    }
+
+    // Calls f on the root of each value instruction reads, including
+    // call and phi operands; copies read nothing, being their sources
+    template<typename F>
+    void
+    forEachUse (const IrInstruction& instruction, F f) const
+    {
+      if (instruction.op == IrOpcode::COPY)
+        return;
+      if (instruction.op == IrOpcode::CALL || instruction.op == IrOpcode::PHI)
+      {
+        for (uint32_t n = 0; n < instruction.b; ++n)
+          f (m_roots[m_function.operands[instruction.a + n]]);
+        return;
+      }
+      forEachOperand (instruction, [&] (const uint32_t& operand) { f (m_roots[operand]); });
+    }
+
+    // Values made where they are used, and comparisons compiled into
+    // their branches, need no interval
+    void
+    classifyValues ()
+    {
+      const std::vector<IrInstruction>& instructions = m_function.instructions;
+      size_t valueCount = m_function.types.size ();
+      m_allocation.locations.assign (valueCount, X86Location ());
+
+      std::vector<uint32_t> uses (valueCount, 0);
+      for (const IrBlock& block : m_function.blocks)
+        for (uint32_t n = block.first; n < block.first + block.count; ++n)
+          forEachUse (instructions[n], [&] (uint32_t value) { ++uses[value]; });
+
+      m_needsInterval.assign (valueCount, false);
+      for (const IrBlock& block : m_function.blocks)
+      {
+        for (uint32_t n = block.first; n < block.first + block.count; ++n)
+        {
+          const IrInstruction& instruction = instructions[n];
+          if (instruction.dest == IR_NO_VALUE || instruction.op == IrOpcode::COPY)
+            continue;
+          X86Location& location = m_allocation.locations[instruction.dest];
+          switch (instruction.op)
+          {
+          case IrOpcode::CONST:
+            location.kind = X86Location::CONSTANT;
+            location.index = instruction.a;
+            break;
+          case IrOpcode::FRAME_ADDR:
+            location.kind = X86Location::FRAME_ADDRESS;
+            location.index = instruction.a;
+            break;
+          case IrOpcode::GLOBAL_ADDR:
+            location.kind = X86Location::GLOBAL_ADDRESS;
+            location.index = instruction.a;
+            break;
+          default:
+            m_needsInterval[instruction.dest] = true;
+            break;
+          }
+        }
+
+        const IrInstruction& last = instructions[block.first + block.count - 1];
+        if (last.op != IrOpcode::BRANCH)
+          continue;
+        uint32_t condition = m_roots[last.a];
+        uint32_t definition = m_definition[condition];
+        if (definition != NONE && definition >= block.first && isComparison (instructions[definition].op)
+            && uses[condition] == 1)
+        {
+          m_allocation.locations[condition].kind = X86Location::FLAGS;
+          m_allocation.locations[condition].index = definition;
+          m_needsInterval[condition] = false;
+        }
+      }
+    }
+
+    void
+    numberInstructions ()
+    {
+      const std::vector<IrBlock>& blocks = m_function.blocks;
+      m_position.assign (m_function.instructions.size (), 0);
+      m_blockStart.assign (blocks.size (), 0);
+      m_blockEnd.assign (blocks.size (), 0);
+      m_calls.clear ();
+      uint32_t position = 0;
+      for (uint32_t b = 0; b < blocks.size (); ++b)
+      {
+        m_blockStart[b] = position;
+        for (uint32_t n = blocks[b].first; n < blocks[b].first + blocks[b].count; ++n)
+        {
+          IrOpcode op = m_function.instructions[n].op;
+          if (op == IrOpcode::CALL || op == IrOpcode::INPUT || op == IrOpcode::OUTPUT)
+            m_calls.push_back (position);
+          m_position[n] = position;
+          position += 2;
+        }
+        m_blockEnd[b] = position - 1;
+      }
+    }
+
+    void
+    solveLiveness ()
+    {
+      const std::vector<IrInstruction>& instructions = m_function.instructions;
+      const std::vector<IrBlock>& blocks = m_function.blocks;
+      m_words = (m_function.types.size () + 63) / 64;
+      size_t blockCount = blocks.size ();
+      std::vector<uint64_t> gen (blockCount * m_words, 0);
+      std::vector<uint64_t> kill (blockCount * m_words, 0);
+      std::vector<uint64_t> phiUses (blockCount * m_words, 0);
+      m_liveIn.assign (blockCount * m_words, 0);
+      m_liveOut.assign (blockCount * m_words, 0);
+
+      for (uint32_t b = 0; b < blockCount; ++b)
+      {
+        uint64_t* blockGen = &gen[b * m_words];
+        uint64_t* blockKill = &kill[b * m_words];
+        for (uint32_t n = blocks[b].first; n < blocks[b].first + blocks[b].count; ++n)
+        {
+          const IrInstruction& instruction = instructions[n];
+          if (instruction.op == IrOpcode::PHI)
+          {
+            set (blockKill, instruction.dest);
+            for (uint32_t k = 0; k < instruction.b; ++k)
+            {
+              uint32_t operand = m_roots[m_function.operands[instruction.a + k]];
+              if (m_needsInterval[operand])
+                set (&phiUses[blocks[b].predecessors[k] * m_words], operand);
+            }
+            continue;
+          }
+          forEachUse (instruction, [&] (uint32_t value) {
+            if (m_needsInterval[value] && !test (blockKill, value))
+              set (blockGen, value);
+          });
+          if (instruction.dest != IR_NO_VALUE && m_needsInterval[instruction.dest])
+            set (blockKill, instruction.dest);
+        }
+      }
+
+      bool changed = true;
+      while (changed)
+      {
+        changed = false;
+        for (uint32_t b = (uint32_t) blockCount; b-- > 0;)
+        {
+          uint64_t* out = &m_liveOut[b * m_words];
+          uint64_t* in = &m_liveIn[b * m_words];
+          for (size_t w = 0; w < m_words; ++w)
+          {
+            uint64_t live = phiUses[b * m_words + w];
+            for (uint32_t successor : blocks[b].successors)
+              live |= m_liveIn[successor * m_words + w];
+            uint64_t liveIn = gen[b * m_words + w] | (live & ~kill[b * m_words + w]);
+            if (live != out[w] || liveIn != in[w])
+            {
+              out[w] = live;
+              in[w] = liveIn;
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+
+    void
+    buildIntervals ()
+    {
+      const std::vector<IrInstruction>& instructions = m_function.instructions;
+      const std::vector<IrBlock>& blocks = m_function.blocks;
+      size_t valueCount = m_function.types.size ();
+      m_start.assign (valueCount, NONE);
+      m_end.assign (valueCount, 0);
+      auto extend = [&] (uint32_t value, uint32_t position) {
+        m_start[value] = std::min (m_start[value], position);
+        m_end[value] = std::max (m_end[value], position);
+      };
+
+      for (uint32_t b = 0; b < blocks.size (); ++b)
+      {
+        forEachSet (&m_liveIn[b * m_words], [&] (uint32_t value) { extend (value, m_blockStart[b]); });
+        forEachSet (&m_liveOut[b * m_words], [&] (uint32_t value) { extend (value, m_blockEnd[b]); });
+
+        uint32_t last = blocks[b].first + blocks[b].count - 1;
+        for (uint32_t n = blocks[b].first; n <= last; ++n)
+        {
+          const IrInstruction& instruction = instructions[n];
+          if (instruction.op == IrOpcode::PHI)
+          {
+            // The phis of a block are all written by the same parallel
+            // move, so even one that is never read must not share a
+            // register with the others
+            extend (instruction.dest, m_blockStart[b]);
+            extend (instruction.dest, m_position[n] + 1);
+            continue;
+          }
+          // A comparison compiled into the branch reads its operands there
+          uint32_t position = m_position[n];
+          if (instruction.dest != IR_NO_VALUE
+              && m_allocation.locations[instruction.dest].kind == X86Location::FLAGS)
+            position = m_position[last];
+          forEachUse (instruction, [&] (uint32_t value) {
+            if (m_needsInterval[value])
+              extend (value, position);
+          });
+          if (instruction.dest != IR_NO_VALUE && m_needsInterval[instruction.dest])
+            extend (instruction.dest, m_position[n]);
+        }
+      }
+    }
+
+    // Registers each value would best be given: its argument register
+    // for a parameter or an argument that dies in the call, its phi's
+    // register for a phi operand, and its operands' for a phi
+    void
+    findHints ()
+    {
+      const std::vector<IrInstruction>& instructions = m_function.instructions;
+      size_t valueCount = m_function.types.size ();
+      m_argumentHint.assign (valueCount, X86Reg::NONE);
+      m_phiOf.assign (valueCount, NONE);
+      for (const IrBlock& block : m_function.blocks)
+      {
+        for (uint32_t n = block.first; n < block.first + block.count; ++n)
+        {
+          const IrInstruction& instruction = instructions[n];
+          if (instruction.op == IrOpcode::PARAM && instruction.a < X86_ARGUMENT_REGISTER_COUNT)
+            m_argumentHint[instruction.dest] = X86_ARGUMENT_REGISTERS[instruction.a];
+          else if (instruction.op == IrOpcode::OUTPUT)
+            hintArgument (m_roots[instruction.a], 0, m_position[n]);
+          else if (instruction.op == IrOpcode::CALL)
+          {
+            for (uint32_t k = 0; k < instruction.b && k < X86_ARGUMENT_REGISTER_COUNT; ++k)
+              hintArgument (m_roots[m_function.operands[instruction.a + k]], k, m_position[n]);
+          }
+          else if (instruction.op == IrOpcode::PHI)
+          {
+            for (uint32_t k = 0; k < instruction.b; ++k)
+            {
+              uint32_t operand = m_roots[m_function.operands[instruction.a + k]];
+              if (m_needsInterval[operand] && m_phiOf[operand] == NONE)
+                m_phiOf[operand] = instruction.dest;
+            }
+          }
+        }
+      }
+    }
+
+    void
+    hintArgument (uint32_t value, uint32_t argument, uint32_t position)
+    {
+      if (m_needsInterval[value] && m_end[value] == position && m_argumentHint[value] == X86Reg::NONE)
+        m_argumentHint[value] = X86_ARGUMENT_REGISTERS[argument];
+    }
+
+    bool
+    crossesCall (uint32_t value) const
+    {
+      auto call = std::upper_bound (m_calls.begin (), m_calls.end (), m_start[value]);
+      return call != m_calls.end () && *call < m_end[value];
+    }
+
+    void
+    scan ()
+    {
+      findHints ();
+      std::vector<uint32_t> intervals;
+      for (uint32_t value = 0; value < m_needsInterval.size (); ++value)
+        if (m_needsInterval[value])
+          intervals.push_back (value);
+      std::sort (intervals.begin (), intervals.end (), [&] (uint32_t a, uint32_t b) {
+        return m_start[a] != m_start[b] ? m_start[a] < m_start[b] : a < b;
+      });
+
+      std::vector<X86Location>& locations = m_allocation.locations;
+      bool free[16] = { };
+      for (X86Reg reg : X86_ALLOCATABLE_REGISTERS)
+        free[(int) reg] = true;
+      bool used[16] = { };
+      std::vector<uint32_t> active;
+
+      for (uint32_t value : intervals)
+      {
+        // An interval that ends where this one starts is read by the
+        // instruction that defines this one, before it writes
+        for (size_t n = 0; n < active.size ();)
+        {
+          if (m_end[active[n]] <= m_start[value])
+          {
+            free[(int) locations[active[n]].reg] = true;
+            active[n] = active.back ();
+            active.pop_back ();
+          }
+          else
+            ++n;
+        }
+
+        bool calleeSavedOnly = crossesCall (value);
+        auto allowed = [&] (X86Reg reg) {
+          return reg != X86Reg::NONE && (!calleeSavedOnly || isCalleeSaved (reg));
+        };
+        auto available = [&] (X86Reg reg) {
+          return allowed (reg) && free[(int) reg];
+        };
+
+        X86Reg chosen = X86Reg::NONE;
+        if (available (m_argumentHint[value]))
+          chosen = m_argumentHint[value];
+        else if (m_phiOf[value] != NONE && locations[m_phiOf[value]].kind == X86Location::REGISTER
+                 && available (locations[m_phiOf[value]].reg))
+          chosen = locations[m_phiOf[value]].reg;
+        else if (m_function.instructions[m_definition[value]].op == IrOpcode::PHI)
+        {
+          const IrInstruction& phi = m_function.instructions[m_definition[value]];
+          for (uint32_t k = 0; k < phi.b && chosen == X86Reg::NONE; ++k)
+          {
+            const X86Location& operand = locations[m_roots[m_function.operands[phi.a + k]]];
+            if (operand.kind == X86Location::REGISTER && m_needsInterval[m_roots[m_function.operands[phi.a + k]]]
+                && available (operand.reg))
+              chosen = operand.reg;
+          }
+        }
+        for (X86Reg reg : X86_ALLOCATABLE_REGISTERS)
+          if (chosen == X86Reg::NONE && available (reg))
+            chosen = reg;
+
+        if (chosen == X86Reg::NONE)
+        {
+          // Spill whichever of this interval and the active ones it could
+          // take a register from ends last
+          size_t victim = active.size ();
+          for (size_t n = 0; n < active.size (); ++n)
+            if (allowed (locations[active[n]].reg)
+                && (victim == active.size () || m_end[active[n]] > m_end[active[victim]]))
+              victim = n;
+          if (victim == active.size () || m_end[active[victim]] <= m_end[value])
+          {
+            spill (value);
+            continue;
+          }
+          chosen = locations[active[victim]].reg;
+          spill (active[victim]);
+          active[victim] = active.back ();
+          active.pop_back ();
+        }
+
+        locations[value].kind = X86Location::REGISTER;
+        locations[value].reg = chosen;
+        free[(int) chosen] = false;
+        used[(int) chosen] = true;
+        active.push_back (value);
+      }
+
+      for (X86Reg reg : X86_ALLOCATABLE_REGISTERS)
+        if (used[(int) reg] && isCalleeSaved (reg))
+          m_allocation.calleeSaved.push_back (reg);
+    }
+
+    void
+    spill (uint32_t value)
+    {
+      X86Location& location = m_allocation.locations[value];
+      location.kind = X86Location::STACK;
+      location.reg = X86Reg::NONE;
+      location.index = m_allocation.spillSlots++;
+    }
+
+    static void
+    set (uint64_t* bits, uint32_t n)
+    {
+      bits[n / 64] |= (uint64_t) 1 << (n % 64);
+    }
+
+    static bool
+    test (const uint64_t* bits, uint32_t n)
+    {
+      return (bits[n / 64] >> (n % 64)) & 1;
+    }
+
+    template<typename F>
+    void
+    forEachSet (const uint64_t* bits, F f) const
+    {
+      for (size_t w = 0; w < m_words; ++w)
+        for (uint64_t word = bits[w]; word != 0; word &= word - 1)
+          f ((uint32_t) (w * 64 + __builtin_ctzll (word)));
+    }
+
+    const IrFunction& m_function;
+    X86Allocation&    m_allocation;
+
+    std::vector<uint32_t> m_definition;
+    std::vector<uint32_t> m_roots;
+    std::vector<bool>     m_needsInterval;
+
+    // Position of each instruction, and of the first instruction and
+    // the end of each block; positions of the calls, in order
+    std::vector<uint32_t> m_position;
+    std::vector<uint32_t> m_blockStart;
+    std::vector<uint32_t> m_blockEnd;
+    std::vector<uint32_t> m_calls;
+
+    // Bit sets of live values, m_words words per block
+    size_t                m_words = 0;
+    std::vector<uint64_t> m_liveIn;
+    std::vector<uint64_t> m_liveOut;
+
+    // Each value's interval
+    std::vector<uint32_t> m_start;
+    std::vector<uint32_t> m_end;
+
+    std::vector<X86Reg>   m_argumentHint;
+    std::vector<uint32_t> m_phiOf;
+  };
+}
+
+/***********************************************************************/
+
+void
+allocateRegisters (const IrFunction& function, X86Allocation& allocation)
+{
+  allocation.spillSlots = 0;
+  allocation.calleeSaved.clear ();
+  Allocator allocator (function, allocation);
+  allocator.run ();
+}
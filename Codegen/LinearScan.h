@@ -0,0 +1,81 @@
+/*
+  Filename   : LinearScan.h
+  Author     : Philip Androwick
+  Description: Linear-scan register allocation of an SSA function for
+               the x86-64 code generator.  Each value's live range is
+               taken as one interval, from the first to the last point of
+               the block layout where it is live, and the intervals are
+               given registers in order of their starts.  When none is
+               free, the interval that ends last is spilled to a stack
+               slot of its own.
+*/
+
+/***********************************************************************/
+
+#ifndef LINEAR_SCAN_H
+#define LINEAR_SCAN_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "X86.h"
+#include "../IR/IR.h"
+
+/***********************************************************************/
+
+// Where a value is kept
+struct X86Location
+{
+  enum Kind : uint8_t
+  {
+    // In the register reg; in spill slot index
+    REGISTER, STACK,
+    // Not kept anywhere: the constant index (an int32_t), the address of
+    //   frame array index or of global index, each made where it is used
+    CONSTANT, FRAME_ADDRESS, GLOBAL_ADDRESS,
+    // A comparison only the branch ending its block uses, which is
+    //   compiled into the branch; index is the comparison's instruction
+    FLAGS
+  };
+
+  Kind     kind = STACK;
+  X86Reg   reg = X86Reg::NONE;
+  uint32_t index = 0;
+};
+
+struct X86Allocation
+{
+  // Location of each value; copies share their source's
+  std::vector<X86Location> locations;
+
+  uint32_t spillSlots = 0;
+
+  // Callee-saved registers the function uses, which it must save
+  std::vector<X86Reg> calleeSaved;
+};
+
+/***********************************************************************/
+
+// Registers the allocator hands out, caller-saved ones first.  rax,
+//   rdx and r11 are left for the code generator's scratch use.
+const X86Reg X86_ALLOCATABLE_REGISTERS[] = {
+  X86Reg::RCX, X86Reg::RSI, X86Reg::RDI, X86Reg::R8, X86Reg::R9, X86Reg::R10,
+  X86Reg::RBX, X86Reg::R12, X86Reg::R13, X86Reg::R14, X86Reg::R15
+};
+
+// Allocates the values of function, which must be in SSA form.  A value
+//   live across a call gets a callee-saved register or a stack slot.  An
+//   instruction's result may share a register with an operand that
+//   dies there, so the code for it must read its operands first.
+void
+allocateRegisters (const IrFunction& function, X86Allocation& allocation);
+
+/***********************************************************************/
+
+#endif
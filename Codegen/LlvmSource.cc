@@ -0,0 +1,710 @@
+/*
+  Filename   : LlvmSource.cc
+  Author     : Philip Androwick
+  Description: Writes the checked tree as LLVM IR, the way a C compiler
+               does without optimizing: variables are loaded and stored
+               at each use.  Expressions leave their values on a stack,
+               and if and while statements open their blocks from the
+               hooks around their bodies, as in lowering (IR/Lowering.h).
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "LlvmSource.h"
+#include "Runtime.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // Where a variable is: the pointer to a scalar or to the first
+  //   element of an array parameter, or to the whole of any other array
+  struct Variable
+  {
+    std::string pointer;
+    // Elements of an array other than a parameter; 0 otherwise
+    size_t size = 0;
+    bool   isArray = false;
+  };
+
+  std::string
+  arrayType (size_t size)
+  {
+    return "[" + std::to_string (size) + " x i32]";
+  }
+
+  // String constant text of LLVM, escaping what is not printable
+  std::string
+  escape (const std::string& text)
+  {
+    std::string escaped;
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\' || c < ' ' || c > '~')
+      {
+        char hex[4];
+        snprintf (hex, sizeof (hex), "\\%02X", (unsigned char) c);
+        escaped += hex;
+      }
+      else
+        escaped += c;
+    }
+    return escaped;
+  }
+
+  class LlvmWriter : public AstWalker
+  {
+  public:
+    LlvmWriter ()
+      : AstWalker ({ ChildSlot::THEN, ChildSlot::BODY }),
+        m_function (nullptr), m_temporaries (0), m_labels (0), m_terminated (false)
+    { }
+
+    std::string
+    getText ()
+    {
+      return std::move (m_text);
+    }
+
+    // Declarations
+
+    virtual bool
+    enter (ProgramNode* node)
+    {
+      m_text = "; Written by CMinus --emit=llvm\n\n"
+        "target triple = \"x86_64-pc-linux-gnu\"\n\n"
+        "declare i32 @" + std::string (getRuntimeSymbol (X86Runtime::INPUT)) + "(i8*)\n"
+        "declare void @" + getRuntimeSymbol (X86Runtime::OUTPUT) + "(i32)\n"
+        "declare void @" + getRuntimeSymbol (X86Runtime::DIVISION_BY_ZERO) + "(i8*) noreturn\n"
+        "declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)\n";
+
+      bool hasMain = false;
+      for (DeclarationNode* declaration : node->declarations)
+      {
+        if (dynamic_cast<FunctionDeclarationNode*> (declaration) == nullptr)
+          continue;
+        std::string name = declaration->identifier;
+        hasMain = hasMain || name == "main";
+        m_names[declaration] = "@.name." + std::to_string (m_names.size ());
+        m_text += m_names[declaration] + " = private unnamed_addr constant "
+          + "[" + std::to_string (name.size () + 1) + " x i8] c\"" + escape (name) + "\\00\"\n";
+      }
+      if (!hasMain)
+        raiseError (DiagnosticPhase::CODEGEN, 0, 0, "\nERROR: \"main\" function was never declared\n\n");
+      return true;
+    }
+
+    virtual void
+    leave (ProgramNode* node)
+    {
+      // Clearing local arrays, and loops that opt recognizes as copies
+      // or clears, can become calls to these, and no C library is
+      // linked; "no-builtins" keeps opt from making their own loops
+      // into calls to themselves
+      m_text += "\n; What llc may call\n"
+        "define i8* @memset(i8* %dest, i32 %value, i64 %count) #0 {\n"
+        "entry:\n"
+        "  %byte = trunc i32 %value to i8\n"
+        "  br label %test\n"
+        "test:\n"
+        "  %n = phi i64 [ 0, %entry ], [ %next, %loop ]\n"
+        "  %done = icmp eq i64 %n, %count\n"
+        "  br i1 %done, label %exit, label %loop\n"
+        "loop:\n"
+        "  %to = getelementptr i8, i8* %dest, i64 %n\n"
+        "  store i8 %byte, i8* %to\n"
+        "  %next = add i64 %n, 1\n"
+        "  br label %test\n"
+        "exit:\n"
+        "  ret i8* %dest\n"
+        "}\n"
+        "\n"
+        "define i8* @memcpy(i8* %dest, i8* %source, i64 %count) #0 {\n"
+        "entry:\n"
+        "  br label %test\n"
+        "test:\n"
+        "  %n = phi i64 [ 0, %entry ], [ %next, %loop ]\n"
+        "  %done = icmp eq i64 %n, %count\n"
+        "  br i1 %done, label %exit, label %loop\n"
+        "loop:\n"
+        "  %from = getelementptr i8, i8* %source, i64 %n\n"
+        "  %byte = load i8, i8* %from\n"
+        "  %to = getelementptr i8, i8* %dest, i64 %n\n"
+        "  store i8 %byte, i8* %to\n"
+        "  %next = add i64 %n, 1\n"
+        "  br label %test\n"
+        "exit:\n"
+        "  ret i8* %dest\n"
+        "}\n"
+        "\n"
+        "; Copies from the last byte first when the destination is above\n"
+        "; the source\n"
+        "define i8* @memmove(i8* %dest, i8* %source, i64 %count) #0 {\n"
+        "entry:\n"
+        "  %above = icmp ugt i8* %dest, %source\n"
+        "  br i1 %above, label %test, label %forward\n"
+        "forward:\n"
+        "  %copy = call i8* @memcpy(i8* %dest, i8* %source, i64 %count)\n"
+        "  ret i8* %dest\n"
+        "test:\n"
+        "  %n = phi i64 [ %count, %entry ], [ %last, %loop ]\n"
+        "  %done = icmp eq i64 %n, 0\n"
+        "  br i1 %done, label %exit, label %loop\n"
+        "loop:\n"
+        "  %last = sub i64 %n, 1\n"
+        "  %from = getelementptr i8, i8* %source, i64 %last\n"
+        "  %byte = load i8, i8* %from\n"
+        "  %to = getelementptr i8, i8* %dest, i64 %last\n"
+        "  store i8 %byte, i8* %to\n"
+        "  br label %test\n"
+        "exit:\n"
+        "  ret i8* %dest\n"
+        "}\n"
+        "\n"
+        "attributes #0 = { \"no-builtins\" }\n";
+
+      // The runtime, as the native backend links it
+      m_text += "\n; Runtime\n";
+      std::string runtime = getRuntimeAssembly ();
+      size_t start = 0;
+      while (start < runtime.size ())
+      {
+        size_t end = runtime.find ('\n', start);
+        if (end == std::string::npos)
+          end = runtime.size ();
+        m_text += "module asm \"" + escape (runtime.substr (start, end - start)) + "\"\n";
+        start = end + 1;
+      }
+    }
+
+    virtual bool
+    enter (VariableDeclarationNode* node)
+    {
+      Variable variable;
+      if (m_function == nullptr)
+      {
+        variable.pointer = "@cm_" + node->identifier;
+        m_text += "\n" + variable.pointer + " = global i32 0\n";
+      }
+      else
+      {
+        // Locals start out as 0 each time their block is entered
+        variable.pointer = allocate (node->identifier, "i32");
+        emit ("store i32 0, i32* " + variable.pointer);
+      }
+      m_variables[node] = variable;
+      return true;
+    }
+
+    virtual bool
+    enter (ArrayDeclarationNode* node)
+    {
+      Variable variable;
+      variable.size = node->size;
+      variable.isArray = true;
+      std::string type = arrayType (node->size);
+      if (m_function == nullptr)
+      {
+        variable.pointer = "@cm_" + node->identifier;
+        m_text += "\n" + variable.pointer + " = global " + type + " zeroinitializer\n";
+      }
+      else
+      {
+        // The arrays are cleared on each call
+        variable.pointer = allocate (node->identifier, type);
+        std::string bytes = temporary ();
+        m_entry += "  " + bytes + " = bitcast " + type + "* " + variable.pointer + " to i8*\n"
+          + "  call void @llvm.memset.p0i8.i64(i8* " + bytes + ", i8 0, i64 "
+          + std::to_string (node->size * 4) + ", i1 false)\n";
+      }
+      m_variables[node] = variable;
+      return true;
+    }
+
+    virtual bool
+    enter (FunctionDeclarationNode* node)
+    {
+      m_function = node;
+      m_body.clear ();
+      m_entry.clear ();
+      m_temporaries = 0;
+      m_labels = 0;
+      m_terminated = false;
+      m_divisionByZero = false;
+      m_allocas.clear ();
+      m_allocaNames.clear ();
+
+      std::string returnType = node->valueType == ValueType::INT ? "i32" : "void";
+      m_text += "\ndefine " + returnType + " @cm_" + node->identifier + "(";
+      for (size_t n = 0; n < node->parameters.size (); ++n)
+      {
+        ParameterNode* parameter = node->parameters[n];
+        Variable variable;
+        variable.isArray = parameter->isArray;
+        std::string argument = "%" + parameter->identifier;
+        m_text += (n > 0 ? ", " : "") + std::string (parameter->isArray ? "i32* " : "i32 ") + argument;
+        if (parameter->isArray)
+          variable.pointer = argument;
+        else
+        {
+          variable.pointer = allocate (parameter->identifier, "i32");
+          m_entry += "  store i32 " + argument + ", i32* " + variable.pointer + "\n";
+        }
+        m_variables[parameter] = variable;
+      }
+      m_text += ") {\n";
+      return true;
+    }
+
+    virtual void
+    leave (FunctionDeclarationNode* node)
+    {
+      // Falling off the end returns 0
+      if (!m_terminated)
+        terminate (node->valueType == ValueType::INT ? "ret i32 0" : "ret void");
+      if (m_divisionByZero)
+      {
+        label ("div.zero");
+        emit ("call void @" + std::string (getRuntimeSymbol (X86Runtime::DIVISION_BY_ZERO)) + "(i8* "
+              + name () + ")");
+        terminate ("unreachable");
+      }
+      m_text += m_allocas + m_entry + m_body + "}\n";
+      m_function = nullptr;
+    }
+
+    // Parameters are declared with their function
+    virtual bool
+    enter (ParameterNode* node)
+    {
+      return false;
+    }
+
+    // Statements
+
+    virtual bool
+    enter (WhileStatementNode* node)
+    {
+      std::string number = std::to_string (m_labels++);
+      m_joins.push_back ("while.end." + number);
+      m_joins.push_back ("while.cond." + number);
+      branch ("while.cond." + number);
+      label ("while.cond." + number);
+      return true;
+    }
+
+    // The condition has been evaluated
+    virtual void
+    enterChild (Node* parent, ChildSlot slot)
+    {
+      std::string condition = temporary ();
+      emit (condition + " = icmp ne i32 " + pop () + ", 0");
+      if (slot == ChildSlot::THEN)
+      {
+        std::string number = std::to_string (m_labels++);
+        m_joins.push_back ("if.end." + number);
+        m_joins.push_back ("if.else." + number);
+        terminate ("br i1 " + condition + ", label %if.then." + number + ", label %if.else." + number);
+        label ("if.then." + number);
+      }
+      else
+      {
+        // Above the loop's condition label is its end
+        std::string end = m_joins[m_joins.size () - 2];
+        std::string body = "while.body." + end.substr (end.rfind ('.') + 1);
+        terminate ("br i1 " + condition + ", label %" + body + ", label %" + end);
+        label (body);
+      }
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot)
+    {
+      std::string next = m_joins.back ();
+      m_joins.pop_back ();
+      if (slot == ChildSlot::THEN)
+      {
+        // Past the else part
+        branch (m_joins.back ());
+        label (next);
+      }
+      else
+      {
+        // Back to the condition
+        branch (next);
+        label (m_joins.back ());
+        m_joins.pop_back ();
+      }
+    }
+
+    virtual void
+    leave (IfStatementNode* node)
+    {
+      branch (m_joins.back ());
+      label (m_joins.back ());
+      m_joins.pop_back ();
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        terminate ("ret i32 " + pop ());
+      else
+        terminate ("ret void");
+    }
+
+    virtual void
+    leave (ExpressionStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        pop ();
+    }
+
+    virtual bool
+    enter (ForStatementNode* node)
+    {
+      throw std::logic_error ("LLVM source: the parser makes no for statements");
+    }
+
+    // Expressions
+
+    virtual bool
+    enter (IntegerLiteralExpressionNode* node)
+    {
+      m_values.push_back (std::to_string (node->value));
+      return true;
+    }
+
+    virtual bool
+    enter (AssignmentExpressionNode* node)
+    {
+      m_targets.push_back (node->variable);
+      return true;
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      std::string value = pop ();
+      emit ("store i32 " + value + ", i32* " + pop ());
+      m_targets.pop_back ();
+      m_values.push_back (value);
+    }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      const Variable& variable = find (node->usingDecNode);
+      // An assignment stores to its target instead
+      if (!m_targets.empty () && m_targets.back () == node)
+        m_values.push_back (variable.pointer);
+      else if (variable.isArray)
+        m_values.push_back (firstElement (variable));
+      else
+      {
+        std::string value = temporary ();
+        emit (value + " = load i32, i32* " + variable.pointer);
+        m_values.push_back (value);
+      }
+      return true;
+    }
+
+    virtual void
+    leave (SubscriptExpressionNode* node)
+    {
+      const Variable& variable = find (node->usingDecNode);
+      std::string index = pop ();
+      std::string element = temporary ();
+      if (variable.size == 0)
+        emit (element + " = getelementptr inbounds i32, i32* " + variable.pointer + ", i32 " + index);
+      else
+      {
+        std::string type = arrayType (variable.size);
+        emit (element + " = getelementptr inbounds " + type + ", " + type + "* " + variable.pointer
+              + ", i32 0, i32 " + index);
+      }
+      // An assignment's target leaves the element's address for it
+      if (!m_targets.empty () && m_targets.back () == node)
+        m_values.push_back (element);
+      else
+      {
+        std::string value = temporary ();
+        emit (value + " = load i32, i32* " + element);
+        m_values.push_back (value);
+      }
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node)
+    {
+      // input reads into its argument, like an assignment
+      if (isBuiltin (node) && node->identifier == "input")
+        m_targets.push_back (static_cast<VariableExpressionNode*> (node->arguments[0]));
+      return true;
+    }
+
+    virtual void
+    leave (CallExpressionNode* node)
+    {
+      if (isBuiltin (node))
+      {
+        if (node->identifier == "input")
+        {
+          std::string value = temporary ();
+          emit (value + " = call i32 @" + getRuntimeSymbol (X86Runtime::INPUT) + "(i8* " + name () + ")");
+          emit ("store i32 " + value + ", i32* " + pop ());
+          m_targets.pop_back ();
+        }
+        else
+          emit ("call void @" + std::string (getRuntimeSymbol (X86Runtime::OUTPUT)) + "(i32 " + pop () + ")");
+        m_values.push_back ("");
+        return;
+      }
+
+      FunctionDeclarationNode* callee = static_cast<FunctionDeclarationNode*> (node->usingDecNode);
+      if (m_names.count (callee) == 0)
+        imported (callee);
+      size_t count = node->arguments.size ();
+      std::string arguments;
+      for (size_t n = 0; n < count; ++n)
+        arguments += (n > 0 ? ", " : "") + std::string (callee->parameters[n]->isArray ? "i32* " : "i32 ")
+          + m_values[m_values.size () - count + n];
+      m_values.resize (m_values.size () - count);
+
+      std::string call = "call " + std::string (callee->valueType == ValueType::INT ? "i32" : "void")
+        + " @cm_" + callee->identifier + "(" + arguments + ")";
+      if (callee->valueType == ValueType::INT)
+      {
+        std::string value = temporary ();
+        emit (value + " = " + call);
+        m_values.push_back (value);
+      }
+      else
+      {
+        emit (call);
+        m_values.push_back ("");
+      }
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node)
+    {
+      binary (node->addOperator == AdditiveOperatorType::PLUS ? "add" : "sub");
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node)
+    {
+      if (node->multOperator == MultiplicativeOperatorType::TIMES)
+      {
+        binary ("mul");
+        return;
+      }
+
+      std::string right = pop ();
+      std::string left = pop ();
+      std::string zero = temporary ();
+      std::string number = std::to_string (m_labels++);
+      emit (zero + " = icmp eq i32 " + right + ", 0");
+      terminate ("br i1 " + zero + ", label %div.zero, label %div." + number);
+      label ("div." + number);
+      m_divisionByZero = true;
+
+      // Dividing by -1 negates, so that INT_MIN wraps
+      std::string minusOne = temporary ();
+      std::string divisor = temporary ();
+      std::string quotient = temporary ();
+      std::string negated = temporary ();
+      std::string value = temporary ();
+      emit (minusOne + " = icmp eq i32 " + right + ", -1");
+      emit (divisor + " = select i1 " + minusOne + ", i32 1, i32 " + right);
+      emit (quotient + " = sdiv i32 " + left + ", " + divisor);
+      emit (negated + " = sub i32 0, " + left);
+      emit (value + " = select i1 " + minusOne + ", i32 " + negated + ", i32 " + quotient);
+      m_values.push_back (value);
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node)
+    {
+      static const char* const conditions[] = { "slt", "sle", "sgt", "sge", "eq", "ne" };
+      std::string right = pop ();
+      std::string left = pop ();
+      std::string flag = temporary ();
+      std::string value = temporary ();
+      emit (flag + " = icmp " + conditions[(int) node->relationalOperator] + " i32 " + left + ", " + right);
+      emit (value + " = zext i1 " + flag + " to i32");
+      m_values.push_back (value);
+    }
+
+    virtual bool
+    enter (UnaryExpressionNode* node)
+    {
+      throw std::logic_error ("LLVM source: the parser makes no unary expressions");
+    }
+
+  private:
+    // Names of values have a dot, which C- names do not, so that they
+    // never clash with a parameter's
+
+    std::string
+    temporary ()
+    {
+      return "%t." + std::to_string (m_temporaries++);
+    }
+
+    // An alloca in the entry block, named after the variable
+    std::string
+    allocate (const std::string& variable, const std::string& type)
+    {
+      unsigned uses = ++m_allocaNames[variable];
+      std::string pointer = "%" + variable + ".addr" + (uses > 1 ? "." + std::to_string (uses) : "");
+      m_allocas += "  " + pointer + " = alloca " + type + "\n";
+      return pointer;
+    }
+
+    // The address of the function's name, for the runtime's errors
+    std::string
+    name () const
+    {
+      const std::string& identifier = m_function->identifier;
+      std::string type = "[" + std::to_string (identifier.size () + 1) + " x i8]";
+      return "getelementptr inbounds (" + type + ", " + type + "* " + m_names.at (m_function) + ", i32 0, i32 0)";
+    }
+
+    void
+    emit (const std::string& instruction)
+    {
+      // Code after a return or a jump starts a block no jump reaches
+      if (m_terminated)
+        label ("dead." + std::to_string (m_labels++));
+      m_body += "  " + instruction + "\n";
+    }
+
+    void
+    terminate (const std::string& instruction)
+    {
+      emit (instruction);
+      m_terminated = true;
+    }
+
+    // Jumps to target unless the block has ended already
+    void
+    branch (const std::string& target)
+    {
+      if (!m_terminated)
+        terminate ("br label %" + target);
+    }
+
+    void
+    label (const std::string& name)
+    {
+      m_body += name + ":\n";
+      m_terminated = false;
+    }
+
+    std::string
+    pop ()
+    {
+      std::string value = std::move (m_values.back ());
+      m_values.pop_back ();
+      return value;
+    }
+
+    void
+    binary (const char* opcode)
+    {
+      std::string right = pop ();
+      std::string left = pop ();
+      std::string value = temporary ();
+      emit (value + " = " + opcode + " i32 " + left + ", " + right);
+      m_values.push_back (value);
+    }
+
+    // Pointer to the first element of an array
+    std::string
+    firstElement (const Variable& variable)
+    {
+      if (variable.size == 0)
+        return variable.pointer;
+      std::string type = arrayType (variable.size);
+      std::string element = temporary ();
+      emit (element + " = getelementptr inbounds " + type + ", " + type + "* " + variable.pointer
+            + ", i32 0, i32 0");
+      return element;
+    }
+
+    // input and output are the only functions without a declaration
+    // node of their own
+    static bool
+    isBuiltin (CallExpressionNode* node)
+    {
+      return dynamic_cast<FunctionDeclarationNode*> (node->usingDecNode) == nullptr;
+    }
+
+    const Variable&
+    find (DeclarationNode* declaration)
+    {
+      auto entry = m_variables.find (declaration);
+      if (entry == m_variables.end ())
+        imported (declaration);
+      return entry->second;
+    }
+
+    // Declarations made in another module have no definition here
+    [[noreturn]] static void
+    imported (DeclarationNode* declaration)
+    {
+      raiseError (DiagnosticPhase::CODEGEN, 0, 0,
+                  "\nERROR: \"%s\" is imported; only whole programs can be compiled\n\n",
+                  declaration->identifier.c_str ());
+    }
+
+    std::string m_text;
+
+    // Functions' name constants
+    std::unordered_map<DeclarationNode*, std::string> m_names;
+    std::unordered_map<DeclarationNode*, Variable>    m_variables;
+
+    // The function being written: its allocas, the rest of its entry
+    // block and its other instructions
+    FunctionDeclarationNode* m_function;
+    std::string m_allocas;
+    std::string m_entry;
+    std::string m_body;
+    std::unordered_map<std::string, unsigned> m_allocaNames;
+    unsigned    m_temporaries;
+    unsigned    m_labels;
+    bool        m_terminated;
+    bool        m_divisionByZero;
+
+    std::vector<std::string> m_values;
+    // Targets of the assignments and input calls being evaluated,
+    // innermost last
+    std::vector<VariableExpressionNode*> m_targets;
+    // For each if, its end label and its else label on top; for each
+    // while, its end label and its condition label on top
+    std::vector<std::string> m_joins;
+  };
+}
+
+/***********************************************************************/
+
+std::string
+generateLlvmSource (ProgramNode* program)
+{
+  LlvmWriter writer;
+  writer.walk (program);
+  return writer.getText ();
+}
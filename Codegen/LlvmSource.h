@@ -0,0 +1,40 @@
+/*
+  Filename   : LlvmSource.h
+  Author     : Philip Androwick
+  Description: Translation of the checked tree to LLVM's textual IR, for
+               LLVM's optimizer (opt) and code generator (llc) to finish.
+               Every scalar variable is an alloca in the entry block, as
+               mem2reg wants, and every array an alloca or a global.
+               Pointers are typed, which LLVM 14 reads by default and
+               later versions read as opaque.
+*/
+
+/***********************************************************************/
+
+#ifndef LLVM_SOURCE_H
+#define LLVM_SOURCE_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// Text of an LLVM module for x86-64 Linux that behaves as program does.
+//   Functions are named @cm_NAME; input, output and the division by zero
+//   error are declared, and defined by the native runtime (Runtime.h),
+//   which the module carries as module-level assembly, so that llc's
+//   output only needs as and ld.  Raises a CompileError if program
+//   refers to an imported symbol.
+std::string
+generateLlvmSource (ProgramNode* program);
+
+/***********************************************************************/
+
+#endif
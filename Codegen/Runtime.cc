@@ -0,0 +1,242 @@
+/*
+  Filename   : Runtime.cc
+  Author     : Philip Androwick
+  Description: The runtime of native programs, as assembly text.
+*/
+
+/***********************************************************************/
+// Local includes
+
+#include "Runtime.h"
+
+/***********************************************************************/
+
+const char*
+getRuntimeSymbol (X86Runtime function)
+{
+  switch (function)
+  {
+  case X86Runtime::INPUT:
+    return "cminus_input";
+  case X86Runtime::OUTPUT:
+    return "cminus_output";
+  default:
+    return "cminus_division_by_zero";
+  }
+}
+
+/***********************************************************************/
+
+const char*
+getRuntimeAssembly ()
+{
+  return R"(
+# Runtime
+
+	.text
+	.globl	_start
+_start:
+	xorl	%ebp, %ebp
+	call	cm_main
+	call	cminus_flush
+	movl	$60, %eax
+	xorl	%edi, %edi
+	syscall
+
+# int cminus_input (const char* function): reads an integer as scanf's
+# "%d" does
+	.p2align 4
+cminus_input:
+	movq	%rdi, %r8
+	xorl	%r9d, %r9d
+	xorl	%r10d, %r10d
+.Lskip:
+	call	.Lgetc
+	cmpl	$32, %eax
+	je	.Lskip
+	leal	-9(%rax), %ecx
+	cmpl	$4, %ecx
+	jbe	.Lskip
+	cmpl	$45, %eax
+	jne	.Lplus
+	movl	$1, %r10d
+	call	.Lgetc
+	jmp	.Lfirst
+.Lplus:
+	cmpl	$43, %eax
+	jne	.Lfirst
+	call	.Lgetc
+.Lfirst:
+	leal	-48(%rax), %ecx
+	cmpl	$9, %ecx
+	ja	.Lnone
+.Ldigit:
+	imull	$10, %r9d, %r9d
+	addl	%ecx, %r9d
+	call	.Lgetc
+	leal	-48(%rax), %ecx
+	cmpl	$9, %ecx
+	jbe	.Ldigit
+	# The character after the number is left for the next read
+	testl	%eax, %eax
+	js	.Lread
+	decq	.Linpos(%rip)
+.Lread:
+	movl	%r9d, %eax
+	testl	%r10d, %r10d
+	jz	1f
+	negl	%eax
+1:	ret
+.Lnone:
+	leaq	.Lnoinput(%rip), %rdi
+	movq	%r8, %rsi
+	jmp	cminus_error
+
+# The next character of standard input in eax, or -1 at its end; keeps
+# r8 to r10
+.Lgetc:
+	movq	.Linpos(%rip), %rcx
+	cmpq	.Linend(%rip), %rcx
+	jb	.Lhave
+	xorl	%eax, %eax
+	xorl	%edi, %edi
+	leaq	.Linbuf(%rip), %rsi
+	movl	$65536, %edx
+	syscall
+	testq	%rax, %rax
+	jle	.Leof
+	leaq	.Linbuf(%rip), %rcx
+	leaq	(%rcx,%rax), %rax
+	movq	%rax, .Linend(%rip)
+.Lhave:
+	movzbl	(%rcx), %eax
+	incq	%rcx
+	movq	%rcx, .Linpos(%rip)
+	ret
+.Leof:
+	movl	$-1, %eax
+	ret
+
+# void cminus_output (int value): writes value and a newline
+	.p2align 4
+cminus_output:
+	movq	.Loutlen(%rip), %r8
+	cmpq	$65520, %r8
+	jbe	1f
+	pushq	%rdi
+	call	cminus_flush
+	popq	%rdi
+	xorl	%r8d, %r8d
+1:	leaq	.Loutbuf(%rip), %r9
+	addq	%r8, %r9
+	movl	%edi, %eax
+	testl	%edi, %edi
+	jns	2f
+	movb	$45, (%r9)
+	incq	%r9
+	negl	%eax
+	# The digits go below the stack pointer last first, then are copied
+2:	leaq	-1(%rsp), %rsi
+	movl	$10, %ecx
+3:	xorl	%edx, %edx
+	divl	%ecx
+	addl	$48, %edx
+	movb	%dl, (%rsi)
+	decq	%rsi
+	testl	%eax, %eax
+	jnz	3b
+4:	incq	%rsi
+	cmpq	%rsp, %rsi
+	je	5f
+	movb	(%rsi), %dl
+	movb	%dl, (%r9)
+	incq	%r9
+	jmp	4b
+5:	movb	$10, (%r9)
+	incq	%r9
+	leaq	.Loutbuf(%rip), %rax
+	subq	%rax, %r9
+	movq	%r9, .Loutlen(%rip)
+	ret
+
+# Writes the buffered output
+cminus_flush:
+	leaq	.Loutbuf(%rip), %rsi
+	movq	.Loutlen(%rip), %rdx
+1:	testq	%rdx, %rdx
+	jz	2f
+	movl	$1, %eax
+	movl	$1, %edi
+	syscall
+	testq	%rax, %rax
+	jle	2f
+	addq	%rax, %rsi
+	subq	%rax, %rdx
+	jmp	1b
+2:	movq	$0, .Loutlen(%rip)
+	ret
+
+# void cminus_division_by_zero (const char* function)
+	.p2align 4
+cminus_division_by_zero:
+	movq	%rdi, %rsi
+	leaq	.Ldivision(%rip), %rdi
+
+# Reports the message rdi in the function rsi and exits
+cminus_error:
+	pushq	%rsi
+	pushq	%rdi
+	call	cminus_flush
+	leaq	.Lerror(%rip), %rdi
+	call	.Lputs
+	popq	%rdi
+	call	.Lputs
+	leaq	.Lin(%rip), %rdi
+	call	.Lputs
+	popq	%rdi
+	call	.Lputs
+	leaq	.Lend(%rip), %rdi
+	call	.Lputs
+	movl	$60, %eax
+	movl	$1, %edi
+	syscall
+
+# Writes the string rdi
+.Lputs:
+	movq	%rdi, %rsi
+	xorl	%edx, %edx
+1:	cmpb	$0, (%rsi,%rdx)
+	je	2f
+	incq	%rdx
+	jmp	1b
+2:	movl	$1, %eax
+	movl	$1, %edi
+	syscall
+	ret
+
+	.section .rodata
+.Lnoinput:
+	.asciz	"No integer left to read"
+.Ldivision:
+	.asciz	"Division by zero"
+.Lerror:
+	.asciz	"\nERROR: "
+.Lin:
+	.asciz	" in \""
+.Lend:
+	.asciz	"\"\n\n"
+
+	.bss
+	.p2align 4
+.Linbuf:
+	.zero	65536
+.Loutbuf:
+	.zero	65536
+.Linpos:
+	.zero	8
+.Linend:
+	.zero	8
+.Loutlen:
+	.zero	8
+)";
+}
@@ -0,0 +1,35 @@
+/*
+  Filename   : Runtime.h
+  Author     : Philip Androwick
+  Description: The runtime native programs are linked with.  It makes
+               no use of the C library: _start calls main and exits, and
+               input and output are buffered over the read and write
+               system calls.  Its functions keep the registers the
+               System V ABI says a callee keeps.
+*/
+
+/***********************************************************************/
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+/***********************************************************************/
+// Local includes
+
+#include "X86.h"
+
+/***********************************************************************/
+
+// Symbol of a runtime function in the assembly text
+const char*
+getRuntimeSymbol (X86Runtime function);
+
+// Assembly text of the runtime, to be assembled with a program written
+//   by GasAssembler.  Errors are reported on standard output, as the
+//   compiler reports them, and exit with status 1.
+const char*
+getRuntimeAssembly ();
+
+/***********************************************************************/
+
+#endif
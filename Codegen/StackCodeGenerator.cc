@@ -0,0 +1,461 @@
+/*
+  Filename   : StackCodeGenerator.cc
+  Author     : Philip Androwick
+  Description: Compiles the checked tree to x86-64 the simple way: every
+               parameter and local lives at its framePointerOffset, and
+               every expression pushes its value on the stack, where the
+               expression using it pops it.  Arguments are pushed in
+               order and popped by the caller.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "CodeGenerator.h"
+#include "FrameLayout.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+namespace
+{
+  class StackCodeGenerator : public AstWalker
+  {
+  public:
+    explicit StackCodeGenerator (X86Assembler& out)
+      : AstWalker ({ ChildSlot::THEN, ChildSlot::BODY }),
+        m_out (out), m_inFunction (false), m_divisionLabel (UINT32_MAX)
+    { }
+
+    // Declarations
+
+    virtual bool
+    enter (ProgramNode* node)
+    {
+      bool hasMain = false;
+      for (DeclarationNode* declaration : node->declarations)
+      {
+        if (dynamic_cast<FunctionDeclarationNode*> (declaration) != nullptr)
+        {
+          m_functions[declaration] = m_out.addFunction (declaration->identifier);
+          hasMain = hasMain || declaration->identifier == "main";
+        }
+        else
+        {
+          ArrayDeclarationNode* array = dynamic_cast<ArrayDeclarationNode*> (declaration);
+          m_globals[declaration] = m_out.addGlobal (declaration->identifier,
+                                                    array != nullptr ? (uint32_t) array->size : 1);
+        }
+      }
+      if (!hasMain)
+        raiseError (DiagnosticPhase::CODEGEN, 0, 0, "\nERROR: \"main\" function was never declared\n\n");
+      return true;
+    }
+
+    virtual bool
+    enter (VariableDeclarationNode* node)
+    {
+      // Locals start out as 0 each time their block is entered
+      if (m_inFunction)
+        m_out.mov (4, local (node), X86Operand::immediate (0));
+      return true;
+    }
+
+    virtual bool
+    enter (FunctionDeclarationNode* node)
+    {
+      int32_t frameBytes = layoutFrame (node);
+      m_inFunction = true;
+      m_divisionLabel = UINT32_MAX;
+      m_out.beginFunction (m_functions[node]);
+      m_out.push (X86Reg::RBP);
+      m_out.mov (8, X86Reg::RBP, X86Reg::RSP);
+      m_out.adjustStack (-frameBytes);
+
+      // The arrays are cleared on each call
+      int32_t arrayBytes = 0;
+      for (ArrayDeclarationNode* declaration : findArrays (node))
+        arrayBytes += arrayFrameBytes (declaration->size);
+      zeroFrame (m_out, arrayBytes);
+      return true;
+    }
+
+    virtual void
+    leave (FunctionDeclarationNode* node)
+    {
+      // Falling off the end returns 0
+      m_out.mov (4, X86Reg::RAX, X86Operand::immediate (0));
+      epilogue ();
+      if (m_divisionLabel != UINT32_MAX)
+      {
+        m_out.bind (m_divisionLabel);
+        m_out.loadFunctionName (X86Reg::RDI);
+        m_out.callRuntime (X86Runtime::DIVISION_BY_ZERO);
+      }
+      m_out.endFunction ();
+      m_inFunction = false;
+    }
+
+    // Statements
+
+    virtual bool
+    enter (IfStatementNode* node)
+    {
+      m_labels.push_back (m_out.newLabel ());
+      m_labels.push_back (m_out.newLabel ());
+      return true;
+    }
+
+    virtual bool
+    enter (WhileStatementNode* node)
+    {
+      m_labels.push_back (m_out.newLabel ());
+      m_labels.push_back (m_out.newLabel ());
+      m_out.bind (m_labels[m_labels.size () - 2]);
+      return true;
+    }
+
+    // The condition has been pushed; the label on top is the else part
+    // of an if or the exit of a while
+    virtual void
+    enterChild (Node* parent, ChildSlot slot)
+    {
+      m_out.pop (X86Reg::RAX);
+      m_out.test (X86Reg::RAX, X86Reg::RAX);
+      m_out.jcc (X86Cond::E, m_labels.back ());
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot)
+    {
+      uint32_t end = m_labels.back ();
+      m_labels.pop_back ();
+      // Past the else part of an if, or back to the condition of a while
+      m_out.jmp (m_labels.back ());
+      if (slot == ChildSlot::BODY)
+        m_labels.pop_back ();
+      m_out.bind (end);
+    }
+
+    virtual void
+    leave (IfStatementNode* node)
+    {
+      m_out.bind (m_labels.back ());
+      m_labels.pop_back ();
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        m_out.pop (X86Reg::RAX);
+      epilogue ();
+    }
+
+    virtual void
+    leave (ExpressionStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        m_out.adjustStack (8);
+    }
+
+    virtual bool
+    enter (ForStatementNode* node)
+    {
+      throw std::logic_error ("stack code generation: the parser makes no for statements");
+    }
+
+    // Expressions
+
+    virtual bool
+    enter (IntegerLiteralExpressionNode* node)
+    {
+      m_out.mov (4, X86Reg::RAX, X86Operand::immediate (node->value));
+      m_out.push (X86Reg::RAX);
+      return true;
+    }
+
+    virtual bool
+    enter (AssignmentExpressionNode* node)
+    {
+      m_targets.push_back (node->variable);
+      return true;
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      m_out.pop (X86Reg::RAX);
+      store (node->variable);
+      m_targets.pop_back ();
+      m_out.push (X86Reg::RAX);
+    }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      // An assignment stores to its target instead
+      if (!m_targets.empty () && m_targets.back () == node)
+        return true;
+
+      DeclarationNode* declaration = node->usingDecNode;
+      if (isArray (declaration))
+        arrayAddress (X86Reg::RAX, declaration);
+      else if (isLocal (declaration))
+        m_out.mov (4, X86Reg::RAX, local (declaration));
+      else
+        m_out.mov (4, X86Reg::RAX, X86Mem::ofGlobal (global (declaration)));
+      m_out.push (X86Reg::RAX);
+      return true;
+    }
+
+    virtual void
+    leave (SubscriptExpressionNode* node)
+    {
+      m_out.pop (X86Reg::RAX);
+      arrayAddress (X86Reg::R11, node->usingDecNode);
+      // An assignment's target leaves the element's address for it
+      if (!m_targets.empty () && m_targets.back () == node)
+        m_out.lea (X86Reg::RAX, X86Mem::indexed (X86Reg::R11, X86Reg::RAX));
+      else
+        m_out.mov (4, X86Reg::RAX, X86Mem::indexed (X86Reg::R11, X86Reg::RAX));
+      m_out.push (X86Reg::RAX);
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node)
+    {
+      // input reads into its argument, like an assignment
+      if (isInput (node))
+        m_targets.push_back (static_cast<VariableExpressionNode*> (node->arguments[0]));
+      return true;
+    }
+
+    virtual void
+    leave (CallExpressionNode* node)
+    {
+      if (isInput (node))
+      {
+        m_out.loadFunctionName (X86Reg::RDI);
+        m_out.callRuntime (X86Runtime::INPUT);
+        store (m_targets.back ());
+        m_targets.pop_back ();
+      }
+      else if (isBuiltin (node))
+      {
+        m_out.pop (X86Reg::RDI);
+        m_out.callRuntime (X86Runtime::OUTPUT);
+      }
+      else
+      {
+        m_out.call (find (m_functions, node->usingDecNode));
+        m_out.adjustStack (8 * (int32_t) node->arguments.size ());
+      }
+      // Every call leaves a value, used or not
+      m_out.push (X86Reg::RAX);
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node)
+    {
+      popOperands ();
+      X86Alu op = node->addOperator == AdditiveOperatorType::PLUS ? X86Alu::ADD : X86Alu::SUB;
+      m_out.alu (op, X86Reg::RAX, X86Reg::RCX);
+      m_out.push (X86Reg::RAX);
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node)
+    {
+      popOperands ();
+      if (node->multOperator == MultiplicativeOperatorType::TIMES)
+        m_out.imul (X86Reg::RAX, X86Reg::RCX);
+      else
+      {
+        // Dividing by -1 negates, so that INT_MIN wraps
+        if (m_divisionLabel == UINT32_MAX)
+          m_divisionLabel = m_out.newLabel ();
+        uint32_t negate = m_out.newLabel ();
+        uint32_t done = m_out.newLabel ();
+        m_out.test (X86Reg::RCX, X86Reg::RCX);
+        m_out.jcc (X86Cond::E, m_divisionLabel);
+        m_out.alu (X86Alu::CMP, X86Reg::RCX, X86Operand::immediate (-1));
+        m_out.jcc (X86Cond::E, negate);
+        m_out.cdq ();
+        m_out.idiv (X86Reg::RCX);
+        m_out.jmp (done);
+        m_out.bind (negate);
+        m_out.neg (X86Reg::RAX);
+        m_out.bind (done);
+      }
+      m_out.push (X86Reg::RAX);
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node)
+    {
+      static const X86Cond conditions[] = {
+        X86Cond::L, X86Cond::LE, X86Cond::G, X86Cond::GE, X86Cond::E, X86Cond::NE
+      };
+      popOperands ();
+      m_out.alu (X86Alu::CMP, X86Reg::RAX, X86Reg::RCX);
+      m_out.setcc (conditions[(int) node->relationalOperator], X86Reg::RAX);
+      m_out.push (X86Reg::RAX);
+    }
+
+    virtual bool
+    enter (UnaryExpressionNode* node)
+    {
+      throw std::logic_error ("stack code generation: the parser makes no unary expressions");
+    }
+
+  private:
+    // The left operand in rax, the right one in rcx
+    void
+    popOperands ()
+    {
+      m_out.pop (X86Reg::RCX);
+      m_out.pop (X86Reg::RAX);
+    }
+
+    void
+    epilogue ()
+    {
+      m_out.mov (8, X86Reg::RSP, X86Reg::RBP);
+      m_out.pop (X86Reg::RBP);
+      m_out.ret ();
+    }
+
+    // Stores eax to target; a subscript has left its element's address
+    // on the stack
+    void
+    store (VariableExpressionNode* target)
+    {
+      DeclarationNode* declaration = target->usingDecNode;
+      if (dynamic_cast<SubscriptExpressionNode*> (target) != nullptr)
+      {
+        m_out.pop (X86Reg::R11);
+        m_out.mov (4, X86Mem::at (X86Reg::R11), X86Reg::RAX);
+      }
+      else if (isLocal (declaration))
+        m_out.mov (4, local (declaration), X86Reg::RAX);
+      else
+        m_out.mov (4, X86Mem::ofGlobal (global (declaration)), X86Reg::RAX);
+    }
+
+    // dst = address of the first element of the array declared by
+    // declaration
+    void
+    arrayAddress (X86Reg dst, DeclarationNode* declaration)
+    {
+      if (dynamic_cast<ParameterNode*> (declaration) != nullptr)
+        m_out.mov (8, dst, local (declaration));
+      else if (isLocal (declaration))
+        m_out.lea (dst, local (declaration));
+      else
+        m_out.lea (dst, X86Mem::ofGlobal (global (declaration)));
+    }
+
+    // input and output are the only functions without a declaration
+    // node of their own
+    static bool
+    isBuiltin (CallExpressionNode* node)
+    {
+      return dynamic_cast<FunctionDeclarationNode*> (node->usingDecNode) == nullptr;
+    }
+
+    static bool
+    isInput (CallExpressionNode* node)
+    {
+      return isBuiltin (node) && node->identifier == "input";
+    }
+
+    static bool
+    isArray (DeclarationNode* declaration)
+    {
+      ParameterNode* parameter = dynamic_cast<ParameterNode*> (declaration);
+      return parameter != nullptr ? parameter->isArray : dynamic_cast<ArrayDeclarationNode*> (declaration) != nullptr;
+    }
+
+    static bool
+    isLocal (DeclarationNode* declaration)
+    {
+      return declaration->nestLevel > 0;
+    }
+
+    X86Mem
+    local (DeclarationNode* declaration) const
+    {
+      ParameterNode* parameter = dynamic_cast<ParameterNode*> (declaration);
+      int32_t offset = parameter != nullptr ? parameter->framePointerOffset
+        : static_cast<VariableDeclarationNode*> (declaration)->framePointerOffset;
+      return X86Mem::at (X86Reg::RBP, offset);
+    }
+
+    uint32_t
+    global (DeclarationNode* declaration) const
+    {
+      return find (m_globals, declaration);
+    }
+
+    // Functions and globals declared in another module have no code here
+    static uint32_t
+    find (const std::unordered_map<DeclarationNode*, uint32_t>& indexes, DeclarationNode* declaration)
+    {
+      auto entry = indexes.find (declaration);
+      if (entry == indexes.end ())
+        raiseError (DiagnosticPhase::CODEGEN, 0, 0,
+                    "\nERROR: \"%s\" is imported; only whole programs can be compiled\n\n",
+                    declaration->identifier.c_str ());
+      return entry->second;
+    }
+
+    static std::vector<ArrayDeclarationNode*>
+    findArrays (FunctionDeclarationNode* function)
+    {
+      struct Finder : AstWalker
+      {
+        virtual bool
+        enter (ArrayDeclarationNode* node)
+        {
+          arrays.push_back (node);
+          return true;
+        }
+
+        std::vector<ArrayDeclarationNode*> arrays;
+      } finder;
+      finder.walk (function->functionBody);
+      return finder.arrays;
+    }
+
+    X86Assembler& m_out;
+    bool          m_inFunction;
+    uint32_t      m_divisionLabel;
+
+    std::unordered_map<DeclarationNode*, uint32_t> m_functions;
+    std::unordered_map<DeclarationNode*, uint32_t> m_globals;
+
+    // Targets of the assignments and input calls being compiled,
+    // innermost last
+    std::vector<VariableExpressionNode*> m_targets;
+    // For each if, its end label and its else label on top; for each
+    // while, its condition label and its exit label on top
+    std::vector<uint32_t> m_labels;
+  };
+}
+
+/***********************************************************************/
+
+void
+generateStackCode (ProgramNode* program, X86Assembler& assembler)
+{
+  StackCodeGenerator generator (assembler);
+  generator.walk (program);
+}
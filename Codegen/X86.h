@@ -0,0 +1,266 @@
+/*
+  Filename   : X86.h
+  Author     : Philip Androwick
+  Description: Registers, operands and the instructions the x86-64 code
+               generators use.  Code is written through an X86Assembler,
+               so the same generator can produce assembly text
+               (GasAssembler.h) or machine code.  Ints are 32 bits, and
+               addresses and registers spilled to the stack 64.
+*/
+
+/***********************************************************************/
+
+#ifndef X86_H
+#define X86_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************************/
+
+// In the order of their encodings
+enum class X86Reg : uint8_t
+{
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15,
+  NONE
+};
+
+// Condition codes, numbered as in their encodings; a condition and its
+//   negation differ in the low bit
+enum class X86Cond : uint8_t
+{
+  E = 4, NE = 5, L = 12, GE = 13, LE = 14, G = 15
+};
+
+inline X86Cond
+negate (X86Cond cond)
+{
+  return (X86Cond) ((uint8_t) cond ^ 1);
+}
+
+// Two-operand arithmetic, numbered as in their encodings
+enum class X86Alu : uint8_t
+{
+  ADD = 0, SUB = 5, XOR = 6, CMP = 7
+};
+
+// Shifts by a constant count, numbered as in their encodings
+enum class X86Shift : uint8_t
+{
+  SHL = 4, SHR = 5, SAR = 7
+};
+
+// Functions of the runtime (Runtime.h); each takes and returns its
+//   values as a C function would
+enum class X86Runtime : uint8_t
+{
+  // int input (const char* function)
+  INPUT,
+  // void output (int value)
+  OUTPUT,
+  // void divisionByZero (const char* function), which does not return
+  DIVISION_BY_ZERO
+};
+const unsigned X86_RUNTIME_COUNT = 3;
+
+// Registers for the arguments of calls, in order; the rest go on the
+//   stack, the first one deepest
+const X86Reg X86_ARGUMENT_REGISTERS[] = {
+  X86Reg::RDI, X86Reg::RSI, X86Reg::RDX, X86Reg::RCX, X86Reg::R8, X86Reg::R9
+};
+const unsigned X86_ARGUMENT_REGISTER_COUNT = 6;
+
+inline bool
+isCalleeSaved (X86Reg reg)
+{
+  return reg == X86Reg::RBX || reg == X86Reg::RBP || reg >= X86Reg::R12;
+}
+
+/***********************************************************************/
+
+// base + index * scale + disp, or global + disp addressed relative to
+//   the instruction pointer when global is not NO_GLOBAL
+struct X86Mem
+{
+  static const uint32_t NO_GLOBAL = UINT32_MAX;
+
+  X86Reg   base = X86Reg::NONE;
+  X86Reg   index = X86Reg::NONE;
+  uint8_t  scale = 1;
+  int32_t  disp = 0;
+  uint32_t global = NO_GLOBAL;
+
+  static X86Mem
+  at (X86Reg base, int32_t disp = 0)
+  {
+    X86Mem mem;
+    mem.base = base;
+    mem.disp = disp;
+    return mem;
+  }
+
+  static X86Mem
+  indexed (X86Reg base, X86Reg index, int32_t disp = 0)
+  {
+    X86Mem mem = at (base, disp);
+    mem.index = index;
+    mem.scale = 4;
+    return mem;
+  }
+
+  static X86Mem
+  ofGlobal (uint32_t global, int32_t disp = 0)
+  {
+    X86Mem mem;
+    mem.global = global;
+    mem.disp = disp;
+    return mem;
+  }
+};
+
+struct X86Operand
+{
+  enum Kind : uint8_t
+  {
+    REG, IMM, MEM
+  };
+
+  X86Operand (X86Reg pReg)
+    : kind (REG), reg (pReg), imm (0)
+  { }
+
+  X86Operand (const X86Mem& pMem)
+    : kind (MEM), reg (X86Reg::NONE), imm (0), mem (pMem)
+  { }
+
+  static X86Operand
+  immediate (int32_t value)
+  {
+    X86Operand operand (X86Reg::NONE);
+    operand.kind = IMM;
+    operand.imm = value;
+    return operand;
+  }
+
+  Kind    kind;
+  X86Reg  reg;
+  int32_t imm;
+  X86Mem  mem;
+};
+
+/***********************************************************************/
+
+// Receives the code of a program: its globals, then its functions one at
+//   a time.  Functions and globals are referred to by the indexes they
+//   were added with, labels by the numbers newLabel gave them.  Operand
+//   sizes are 4 or 8 bytes; instructions without one work on 32 bits.
+class X86Assembler
+{
+public:
+  virtual ~X86Assembler ()
+  { }
+
+  // Declarations, before any code
+
+  virtual uint32_t
+  addGlobal (const std::string& name, uint32_t words) = 0;
+
+  virtual uint32_t
+  addFunction (const std::string& name) = 0;
+
+  // Code
+
+  virtual void
+  beginFunction (uint32_t function) = 0;
+
+  virtual void
+  endFunction () = 0;
+
+  virtual uint32_t
+  newLabel () = 0;
+
+  virtual void
+  bind (uint32_t label) = 0;
+
+  // dst = src; at most one of them in memory
+  virtual void
+  mov (int size, const X86Operand& dst, const X86Operand& src) = 0;
+
+  virtual void
+  lea (X86Reg dst, const X86Mem& src) = 0;
+
+  // dst = dst op src, or just the flags for CMP; at most one of them in
+  //   memory
+  virtual void
+  alu (X86Alu op, const X86Operand& dst, const X86Operand& src) = 0;
+
+  // rsp = rsp + bytes
+  virtual void
+  adjustStack (int32_t bytes) = 0;
+
+  // dst = dst * src; dst = src * k
+  virtual void
+  imul (X86Reg dst, const X86Operand& src) = 0;
+
+  virtual void
+  imul (X86Reg dst, const X86Operand& src, int32_t k) = 0;
+
+  // edx:eax = eax * src, signed
+  virtual void
+  imulWide (const X86Operand& src) = 0;
+
+  // Sign extends eax into edx; divides edx:eax by divisor
+  virtual void
+  cdq () = 0;
+
+  virtual void
+  idiv (const X86Operand& divisor) = 0;
+
+  virtual void
+  neg (X86Reg reg) = 0;
+
+  // reg = reg shifted by count bits, 1 to 31
+  virtual void
+  shift (X86Shift op, X86Reg reg, uint8_t count) = 0;
+
+  virtual void
+  test (X86Reg a, X86Reg b) = 0;
+
+  // dst = 1 if cond holds, otherwise 0
+  virtual void
+  setcc (X86Cond cond, X86Reg dst) = 0;
+
+  virtual void
+  jmp (uint32_t label) = 0;
+
+  virtual void
+  jcc (X86Cond cond, uint32_t label) = 0;
+
+  virtual void
+  call (uint32_t function) = 0;
+
+  virtual void
+  callRuntime (X86Runtime function) = 0;
+
+  // dst = the address of the name of the function being written, for
+  //   the runtime's error messages
+  virtual void
+  loadFunctionName (X86Reg dst) = 0;
+
+  virtual void
+  push (X86Reg reg) = 0;
+
+  virtual void
+  pop (X86Reg reg) = 0;
+
+  virtual void
+  ret () = 0;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,577 @@
+/*
+  Filename   : X86Encoder.cc
+  Author     : Philip Androwick
+  Description: Encodes x86-64 instructions.  Ints are worked on with the
+               32-bit forms, which clear the upper half of a register;
+               addresses with the 64-bit ones, behind a REX.W prefix.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstring>
+#include <stdexcept>
+
+/***********************************************************************/
+// Local includes
+
+#include "X86Encoder.h"
+
+/***********************************************************************/
+
+namespace
+{
+  const uint8_t REX = 0x40;
+  const uint8_t REX_W = 0x48;
+
+  // Encoding of reg within its group of eight
+  uint8_t
+  low (X86Reg reg)
+  {
+    return (uint8_t) reg & 7;
+  }
+
+  // Whether reg is one of r8 to r15, which take a REX bit
+  bool
+  high (X86Reg reg)
+  {
+    return reg != X86Reg::NONE && (uint8_t) reg >= 8;
+  }
+
+  bool
+  fitsByte (int32_t value)
+  {
+    return value >= -128 && value <= 127;
+  }
+}
+
+/***********************************************************************/
+
+X86Encoder::X86Encoder ()
+  : m_globalBytes (0), m_function (0)
+{
+}
+
+/***********************************************************************/
+
+std::vector<uint8_t>
+X86Encoder::finish (const void* const runtime[X86_RUNTIME_COUNT], size_t pageBytes)
+{
+  // Code compiled from the tree pushes its temporaries, so the stack is
+  // aligned for the runtime's C functions on the way in:
+  //   push rbp; mov rbp, rsp; and rsp, -16; call [slot]; leave; ret
+  uint32_t stubs[X86_RUNTIME_COUNT];
+  for (unsigned n = 0; n < X86_RUNTIME_COUNT; ++n)
+  {
+    align (m_code, 16);
+    stubs[n] = (uint32_t) m_code.size ();
+    static const uint8_t entry[] = { 0x55, REX_W, 0x89, 0xE5, REX_W, 0x83, 0xE4, 0xF0, 0xFF, 0x15 };
+    m_code.insert (m_code.end (), entry, entry + sizeof (entry));
+    fixup (Target::RUNTIME_SLOT, n);
+    byte (0xC9);
+    byte (0xC3);
+  }
+
+  align (m_code, 8);
+  uint32_t slots = (uint32_t) m_code.size ();
+  m_code.resize (slots + X86_RUNTIME_COUNT * sizeof (void*));
+  std::memcpy (&m_code[slots], runtime, X86_RUNTIME_COUNT * sizeof (void*));
+
+  std::vector<uint32_t> names;
+  for (const std::string& name : m_functions)
+  {
+    names.push_back ((uint32_t) m_code.size ());
+    m_code.insert (m_code.end (), name.begin (), name.end ());
+    byte (0);
+  }
+  uint32_t globals = (uint32_t) ((m_code.size () + pageBytes - 1) / pageBytes * pageBytes);
+
+  for (const Fixup& fixup : m_fixups)
+  {
+    uint32_t target = 0;
+    switch (fixup.target)
+    {
+    case Target::LABEL:
+      target = m_labels[fixup.index];
+      if (target == UINT32_MAX)
+        throw std::logic_error ("X86Encoder: jump to a label that was never bound");
+      break;
+    case Target::FUNCTION:
+      target = m_functionOffsets[fixup.index];
+      if (target == UINT32_MAX)
+        throw std::logic_error ("X86Encoder: call to a function that was never written");
+      break;
+    case Target::GLOBAL:
+      target = globals + m_globalOffsets[fixup.index];
+      break;
+    case Target::NAME:
+      target = names[fixup.index];
+      break;
+    case Target::RUNTIME:
+      target = stubs[fixup.index];
+      break;
+    case Target::RUNTIME_SLOT:
+      target = slots + fixup.index * (uint32_t) sizeof (void*);
+      break;
+    }
+    int32_t displacement = (int32_t) (target - fixup.next) + fixup.addend;
+    std::memcpy (&m_code[fixup.at], &displacement, sizeof (displacement));
+  }
+  m_fixups.clear ();
+  return std::move (m_code);
+}
+
+/***********************************************************************/
+
+uint32_t
+X86Encoder::findFunction (const std::string& name) const
+{
+  for (size_t n = 0; n < m_functions.size (); ++n)
+    if (m_functions[n] == name)
+      return (uint32_t) n;
+  return UINT32_MAX;
+}
+
+/***********************************************************************/
+
+uint32_t
+X86Encoder::addGlobal (const std::string& name, uint32_t words)
+{
+  m_globalOffsets.push_back ((uint32_t) m_globalBytes);
+  m_globalBytes += words * 4;
+  return (uint32_t) m_globalOffsets.size () - 1;
+}
+
+/***********************************************************************/
+
+uint32_t
+X86Encoder::addFunction (const std::string& name)
+{
+  m_functions.push_back (name);
+  m_functionOffsets.push_back (UINT32_MAX);
+  return (uint32_t) m_functions.size () - 1;
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::beginFunction (uint32_t function)
+{
+  m_function = function;
+  align (m_code, 16);
+  m_functionOffsets[function] = (uint32_t) m_code.size ();
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::endFunction ()
+{
+}
+
+/***********************************************************************/
+
+uint32_t
+X86Encoder::newLabel ()
+{
+  m_labels.push_back (UINT32_MAX);
+  return (uint32_t) m_labels.size () - 1;
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::bind (uint32_t label)
+{
+  m_labels[label] = (uint32_t) m_code.size ();
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::dword (int32_t value)
+{
+  uint32_t bits = (uint32_t) value;
+  for (int n = 0; n < 4; ++n)
+    byte ((uint8_t) (bits >> (8 * n)));
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::fixup (Target target, uint32_t index, int32_t addend, uint32_t trailing)
+{
+  uint32_t at = (uint32_t) m_code.size ();
+  m_fixups.push_back ({ at, at + 4 + trailing, target, index, addend });
+  dword (0);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::rex (bool wide, X86Reg reg, const X86Operand& rm, bool byteRegisters)
+{
+  uint8_t bits = (wide ? 8 : 0) | (high (reg) ? 4 : 0);
+  if (rm.kind == X86Operand::REG)
+    bits |= high (rm.reg) ? 1 : 0;
+  else if (rm.kind == X86Operand::MEM)
+    bits |= (high (rm.mem.index) ? 2 : 0) | (high (rm.mem.base) ? 1 : 0);
+  if (bits != 0 || byteRegisters)
+    byte (REX | bits);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::modrm (uint8_t reg, const X86Operand& rm, uint32_t trailing)
+{
+  if (rm.kind == X86Operand::REG)
+  {
+    byte (0xC0 | reg << 3 | low (rm.reg));
+    return;
+  }
+
+  const X86Mem& mem = rm.mem;
+  if (mem.global != X86Mem::NO_GLOBAL)
+  {
+    byte (0x05 | reg << 3);
+    fixup (Target::GLOBAL, mem.global, mem.disp, trailing);
+    return;
+  }
+
+  // rbp and r13 as a base always take a displacement, and rsp and r12
+  // a SIB byte
+  uint8_t mod = mem.disp == 0 && low (mem.base) != 5 ? 0x00 : fitsByte (mem.disp) ? 0x40 : 0x80;
+  if (mem.index == X86Reg::NONE && low (mem.base) != 4)
+    byte (mod | reg << 3 | low (mem.base));
+  else
+  {
+    uint8_t scale = mem.scale == 8 ? 3 : mem.scale == 4 ? 2 : mem.scale == 2 ? 1 : 0;
+    uint8_t index = mem.index == X86Reg::NONE ? 4 : low (mem.index);
+    byte (mod | reg << 3 | 4);
+    byte (scale << 6 | index << 3 | low (mem.base));
+  }
+  if (mod == 0x40)
+    byte ((uint8_t) mem.disp);
+  else if (mod == 0x80)
+    dword (mem.disp);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::align (std::vector<uint8_t>& code, size_t alignment)
+{
+  while (code.size () % alignment != 0)
+    code.push_back (0xCC);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::mov (int size, const X86Operand& dst, const X86Operand& src)
+{
+  bool wide = size == 8;
+  if (src.kind == X86Operand::IMM)
+  {
+    if (dst.kind == X86Operand::REG && !wide)
+    {
+      rex (false, X86Reg::NONE, dst);
+      byte (0xB8 | low (dst.reg));
+      dword (src.imm);
+    }
+    else
+    {
+      rex (wide, X86Reg::NONE, dst);
+      byte (0xC7);
+      modrm (0, dst, 4);
+      dword (src.imm);
+    }
+  }
+  else if (src.kind == X86Operand::REG)
+  {
+    rex (wide, src.reg, dst);
+    byte (0x89);
+    modrm (low (src.reg), dst);
+  }
+  else
+  {
+    rex (wide, dst.reg, src);
+    byte (0x8B);
+    modrm (low (dst.reg), src);
+  }
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::lea (X86Reg dst, const X86Mem& src)
+{
+  rex (true, dst, src);
+  byte (0x8D);
+  modrm (low (dst), src);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::alu (X86Alu op, const X86Operand& dst, const X86Operand& src)
+{
+  uint8_t code = (uint8_t) op;
+  if (src.kind == X86Operand::IMM)
+  {
+    rex (false, X86Reg::NONE, dst);
+    if (fitsByte (src.imm))
+    {
+      byte (0x83);
+      modrm (code, dst, 1);
+      byte ((uint8_t) src.imm);
+    }
+    else
+    {
+      byte (0x81);
+      modrm (code, dst, 4);
+      dword (src.imm);
+    }
+  }
+  else if (src.kind == X86Operand::REG)
+  {
+    rex (false, src.reg, dst);
+    byte (code << 3 | 0x01);
+    modrm (low (src.reg), dst);
+  }
+  else
+  {
+    rex (false, dst.reg, src);
+    byte (code << 3 | 0x03);
+    modrm (low (dst.reg), src);
+  }
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::adjustStack (int32_t bytes)
+{
+  if (bytes == 0)
+    return;
+  byte (REX_W);
+  if (fitsByte (bytes))
+  {
+    byte (0x83);
+    byte (0xC4);
+    byte ((uint8_t) bytes);
+  }
+  else
+  {
+    byte (0x81);
+    byte (0xC4);
+    dword (bytes);
+  }
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::imul (X86Reg dst, const X86Operand& src)
+{
+  // An immediate only comes in the three-operand form
+  if (src.kind == X86Operand::IMM)
+  {
+    imul (dst, dst, src.imm);
+    return;
+  }
+  rex (false, dst, src);
+  byte (0x0F);
+  byte (0xAF);
+  modrm (low (dst), src);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::imul (X86Reg dst, const X86Operand& src, int32_t k)
+{
+  rex (false, dst, src);
+  if (fitsByte (k))
+  {
+    byte (0x6B);
+    modrm (low (dst), src, 1);
+    byte ((uint8_t) k);
+  }
+  else
+  {
+    byte (0x69);
+    modrm (low (dst), src, 4);
+    dword (k);
+  }
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::imulWide (const X86Operand& src)
+{
+  rex (false, X86Reg::NONE, src);
+  byte (0xF7);
+  modrm (5, src);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::cdq ()
+{
+  byte (0x99);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::idiv (const X86Operand& divisor)
+{
+  rex (false, X86Reg::NONE, divisor);
+  byte (0xF7);
+  modrm (7, divisor);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::neg (X86Reg reg)
+{
+  rex (false, X86Reg::NONE, reg);
+  byte (0xF7);
+  modrm (3, reg);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::shift (X86Shift op, X86Reg reg, uint8_t count)
+{
+  rex (false, X86Reg::NONE, reg);
+  byte (0xC1);
+  modrm ((uint8_t) op, reg, 1);
+  byte (count);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::test (X86Reg a, X86Reg b)
+{
+  rex (false, b, a);
+  byte (0x85);
+  modrm (low (b), a);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::setcc (X86Cond cond, X86Reg dst)
+{
+  // Without a REX prefix, the bytes of rsp to rdi are ah to bh
+  bool byteRegisters = dst >= X86Reg::RSP && dst <= X86Reg::RDI;
+  rex (false, X86Reg::NONE, dst, byteRegisters);
+  byte (0x0F);
+  byte (0x90 | (uint8_t) cond);
+  modrm (0, dst);
+  // movzx
+  rex (false, dst, dst, byteRegisters);
+  byte (0x0F);
+  byte (0xB6);
+  modrm (low (dst), dst);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::jmp (uint32_t label)
+{
+  // Backward jumps are short when they can be
+  uint32_t target = m_labels[label];
+  if (target != UINT32_MAX && fitsByte ((int32_t) (target - (m_code.size () + 2))))
+  {
+    byte (0xEB);
+    byte ((uint8_t) (target - (m_code.size () + 1)));
+    return;
+  }
+  byte (0xE9);
+  fixup (Target::LABEL, label);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::jcc (X86Cond cond, uint32_t label)
+{
+  uint32_t target = m_labels[label];
+  if (target != UINT32_MAX && fitsByte ((int32_t) (target - (m_code.size () + 2))))
+  {
+    byte (0x70 | (uint8_t) cond);
+    byte ((uint8_t) (target - (m_code.size () + 1)));
+    return;
+  }
+  byte (0x0F);
+  byte (0x80 | (uint8_t) cond);
+  fixup (Target::LABEL, label);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::call (uint32_t function)
+{
+  byte (0xE8);
+  fixup (Target::FUNCTION, function);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::callRuntime (X86Runtime function)
+{
+  byte (0xE8);
+  fixup (Target::RUNTIME, (uint32_t) function);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::loadFunctionName (X86Reg dst)
+{
+  // lea dst, [rip + name]
+  byte (REX_W | (high (dst) ? 4 : 0));
+  byte (0x8D);
+  byte (0x05 | low (dst) << 3);
+  fixup (Target::NAME, m_function);
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::push (X86Reg reg)
+{
+  if (high (reg))
+    byte (REX | 1);
+  byte (0x50 | low (reg));
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::pop (X86Reg reg)
+{
+  if (high (reg))
+    byte (REX | 1);
+  byte (0x58 | low (reg));
+}
+
+/***********************************************************************/
+
+void
+X86Encoder::ret ()
+{
+  byte (0xC3);
+}
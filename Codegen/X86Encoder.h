@@ -0,0 +1,209 @@
+/*
+  Filename   : X86Encoder.h
+  Author     : Philip Androwick
+  Description: An X86Assembler that encodes machine code, for running a
+               program in the compiler's own process (Jit.h).  Jumps,
+               calls and the addresses of globals are relative to the
+               instruction pointer, so the text can be loaded anywhere
+               as long as the globals follow it where finish says.
+*/
+
+/***********************************************************************/
+
+#ifndef X86_ENCODER_H
+#define X86_ENCODER_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "X86.h"
+
+/***********************************************************************/
+
+class X86Encoder : public X86Assembler
+{
+public:
+  X86Encoder ();
+
+  // Resolves the jumps, calls and addresses of the program and returns
+  //   its text: the code, a stub for each runtime function that aligns
+  //   the stack and calls it through runtime (its addresses, in the
+  //   order of X86Runtime), and the names of the functions.  The
+  //   globals, getGlobalBytes () bytes of zeroes, must be loaded at the
+  //   first multiple of pageBytes past the end of the text.
+  std::vector<uint8_t>
+  finish (const void* const runtime[X86_RUNTIME_COUNT], size_t pageBytes);
+
+  size_t
+  getGlobalBytes () const
+  {
+    return m_globalBytes;
+  }
+
+  // Offset of the function in the text
+  uint32_t
+  getFunctionOffset (uint32_t function) const
+  {
+    return m_functionOffsets[function];
+  }
+
+  // Index of the function called name, or UINT32_MAX if there is none
+  uint32_t
+  findFunction (const std::string& name) const;
+
+  size_t
+  getFunctionCount () const
+  {
+    return m_functions.size ();
+  }
+
+  uint32_t
+  addGlobal (const std::string& name, uint32_t words) override;
+
+  uint32_t
+  addFunction (const std::string& name) override;
+
+  void
+  beginFunction (uint32_t function) override;
+
+  void
+  endFunction () override;
+
+  uint32_t
+  newLabel () override;
+
+  void
+  bind (uint32_t label) override;
+
+  void
+  mov (int size, const X86Operand& dst, const X86Operand& src) override;
+
+  void
+  lea (X86Reg dst, const X86Mem& src) override;
+
+  void
+  alu (X86Alu op, const X86Operand& dst, const X86Operand& src) override;
+
+  void
+  adjustStack (int32_t bytes) override;
+
+  void
+  imul (X86Reg dst, const X86Operand& src) override;
+
+  void
+  imul (X86Reg dst, const X86Operand& src, int32_t k) override;
+
+  void
+  imulWide (const X86Operand& src) override;
+
+  void
+  cdq () override;
+
+  void
+  idiv (const X86Operand& divisor) override;
+
+  void
+  neg (X86Reg reg) override;
+
+  void
+  shift (X86Shift op, X86Reg reg, uint8_t count) override;
+
+  void
+  test (X86Reg a, X86Reg b) override;
+
+  void
+  setcc (X86Cond cond, X86Reg dst) override;
+
+  void
+  jmp (uint32_t label) override;
+
+  void
+  jcc (X86Cond cond, uint32_t label) override;
+
+  void
+  call (uint32_t function) override;
+
+  void
+  callRuntime (X86Runtime function) override;
+
+  void
+  loadFunctionName (X86Reg dst) override;
+
+  void
+  push (X86Reg reg) override;
+
+  void
+  pop (X86Reg reg) override;
+
+  void
+  ret () override;
+
+private:
+  // What a 32-bit field left by an instruction is relative to
+  enum class Target : uint8_t
+  {
+    LABEL, FUNCTION, GLOBAL, NAME, RUNTIME, RUNTIME_SLOT
+  };
+
+  // The field at offset at is target index + addend minus next, the
+  //   offset of the end of its instruction
+  struct Fixup
+  {
+    uint32_t at;
+    uint32_t next;
+    Target   target;
+    uint32_t index;
+    int32_t  addend;
+  };
+
+  void
+  byte (uint8_t value)
+  {
+    m_code.push_back (value);
+  }
+
+  void
+  dword (int32_t value);
+
+  // Leaves a field to be resolved by finish; trailing bytes of the
+  //   instruction come after it
+  void
+  fixup (Target target, uint32_t index, int32_t addend = 0, uint32_t trailing = 0);
+
+  // The REX prefix, if one is needed, for an instruction with reg in
+  //   its ModRM reg field and rm as its other operand.  byteRegisters
+  //   asks for one when rm names spl, bpl, sil or dil.
+  void
+  rex (bool wide, X86Reg reg, const X86Operand& rm, bool byteRegisters = false);
+
+  // The ModRM byte, and the SIB byte and displacement rm needs; trailing
+  //   bytes of immediate follow them
+  void
+  modrm (uint8_t reg, const X86Operand& rm, uint32_t trailing = 0);
+
+  // Pads the code with int3 to a multiple of alignment
+  void
+  align (std::vector<uint8_t>& code, size_t alignment);
+
+  std::vector<uint8_t> m_code;
+
+  std::vector<std::string> m_functions;
+  std::vector<uint32_t>    m_functionOffsets;
+  std::vector<uint32_t>    m_globalOffsets;
+  size_t                   m_globalBytes;
+
+  // Offsets of the labels, UINT32_MAX until they are bound
+  std::vector<uint32_t> m_labels;
+  std::vector<Fixup>    m_fixups;
+  uint32_t              m_function;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,88 @@
+/*
+  Filename   : AstWriter.cc
+  Author     : Philip Androwick
+  Description: Parallel rendering and gathered writing of .ast text.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+
+/***********************************************************************/
+// Local includes
+
+#include "AstWriter.h"
+#include "Parallel.h"
+#include "../Parser/Parser.h"
+
+/***********************************************************************/
+
+void
+renderAst (ProgramNode* tree, unsigned jobs, std::vector<std::string>& chunks)
+{
+  std::vector<DeclarationNode*>& declarations = tree->declarations;
+
+  // A few batches per thread evens out the load; the first chunk is the
+  //   program's own line
+  size_t batches = std::min (declarations.size (), (size_t) std::max (jobs, 1u) * 4);
+  chunks.assign (batches + 1, std::string ());
+
+  EvaluationVisitor visitor;
+  visitor.walk (tree);
+  chunks[0] = visitor.output + "\n";
+
+  parallelFor (batches, jobs, [&] (size_t index, unsigned worker) {
+    size_t begin = declarations.size () * index / batches;
+    size_t end = declarations.size () * (index + 1) / batches;
+    std::string& chunk = chunks[index + 1];
+    for (size_t n = begin; n < end; ++n)
+      chunk += Parser::getAST (declarations[n]);
+  });
+}
+
+/***********************************************************************/
+
+bool
+writeChunks (int fd, const std::vector<std::string>& chunks)
+{
+#ifdef IOV_MAX
+  const size_t maxVectors = IOV_MAX;
+#else
+  const size_t maxVectors = 1024;
+#endif
+
+  std::vector<struct iovec> vectors;
+  for (const std::string& chunk : chunks)
+    if (!chunk.empty ())
+      vectors.push_back ({ (void*) chunk.data (), chunk.size () });
+
+  // writev may write less than asked; carry on from where it stopped
+  size_t first = 0;
+  while (first < vectors.size ())
+  {
+    int count = (int) std::min (vectors.size () - first, maxVectors);
+    ssize_t written = writev (fd, &vectors[first], count);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    while (first < vectors.size () && (size_t) written >= vectors[first].iov_len)
+    {
+      written -= vectors[first].iov_len;
+      ++first;
+    }
+    if (written > 0)
+    {
+      vectors[first].iov_base = (char*) vectors[first].iov_base + written;
+      vectors[first].iov_len -= written;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,42 @@
+/*
+  Filename   : AstWriter.h
+  Author     : Philip Androwick
+  Description: Prints the .ast text of a large program on several
+               threads.  Top-level declarations print independently, so
+               they are split into batches, each batch is rendered into
+               its own buffer, and the buffers are written out in order
+               with writev.  The text is the same as Parser::getAST's.
+*/
+
+/***********************************************************************/
+
+#ifndef AST_WRITER_H
+#define AST_WRITER_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// Replaces chunks with the .ast text of tree, split between buffers
+//   rendered by up to jobs threads.  Joined in order, the chunks are
+//   Parser::getAST (tree).
+void
+renderAst (ProgramNode* tree, unsigned jobs, std::vector<std::string>& chunks);
+
+// Writes chunks, in order, to the file descriptor fd with as few writev
+//   calls as IOV_MAX allows.  Returns false on a write error.
+bool
+writeChunks (int fd, const std::vector<std::string>& chunks);
+
+/***********************************************************************/
+
+#endif
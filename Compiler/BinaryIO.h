@@ -0,0 +1,77 @@
+/*
+  Filename   : BinaryIO.h
+  Author     : Philip Androwick
+  Description: Helpers for the compact binary formats (server messages and
+               module interfaces): 32-bit words and length-prefixed strings
+               appended to, and read back from, a byte string.
+*/
+
+/***********************************************************************/
+
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/***********************************************************************/
+
+inline void
+putWord (std::string& out, uint32_t word)
+{
+  out.append ((const char*) &word, sizeof (word));
+}
+
+inline void
+putLong (std::string& out, uint64_t word)
+{
+  out.append ((const char*) &word, sizeof (word));
+}
+
+inline void
+putString (std::string& out, const std::string& text)
+{
+  putWord (out, text.size ());
+  out += text;
+}
+
+// The get functions advance offset and return false past the end of in
+
+inline bool
+getWord (const std::string& in, size_t& offset, uint32_t& word)
+{
+  if (in.size () - offset < sizeof (word))
+    return false;
+  memcpy (&word, in.data () + offset, sizeof (word));
+  offset += sizeof (word);
+  return true;
+}
+
+inline bool
+getLong (const std::string& in, size_t& offset, uint64_t& word)
+{
+  if (in.size () - offset < sizeof (word))
+    return false;
+  memcpy (&word, in.data () + offset, sizeof (word));
+  offset += sizeof (word);
+  return true;
+}
+
+inline bool
+getString (const std::string& in, size_t& offset, std::string& text)
+{
+  uint32_t length;
+  if (!getWord (in, offset, length) || in.size () - offset < length)
+    return false;
+  text.assign (in, offset, length);
+  offset += length;
+  return true;
+}
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,219 @@
+/*
+  Filename   : CompilerContext.cc
+  Author     : Philip Androwick
+  Description: Runs the lexer, parser and both semantic analysis phases on
+               an in-memory source buffer.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+
+/***********************************************************************/
+// Local includes
+
+#include "CompilerContext.h"
+#include "FunctionQuery.h"
+#include "Passes.h"
+#include "../IR/IR.h"
+#include "../Lexer/ParallelLexer.h"
+#include "../Optimizer/AstRewriter.h"
+#include "../Parser/Parser.h"
+#include "../Parser/ParallelParser.h"
+#include "../SemanticAnalyzer/ReferenceVisitor.h"
+
+/***********************************************************************/
+
+CompilerContext::CompilerContext ()
+  : m_lexer (nullptr, nullptr), m_table (nullptr)
+{
+}
+
+CompilerContext::~CompilerContext ()
+{
+}
+
+/***********************************************************************/
+
+CompileResult
+CompilerContext::compile (const char* source, size_t length,
+                          const CompileOptions& options)
+{
+  reset ();
+
+  CompileResult result;
+  try
+  {
+    if (options.optimize > 0 && options.hashCons)
+      raiseError (DiagnosticPhase::INPUT, 0, 0, "\nERROR: A hash-consed tree cannot be optimized\n\n");
+
+    // Run Lexical analyzer
+    if (options.lexJobs > 1)
+      lexParallel (source, source + length, options.lexJobs, m_tokens);
+    else
+    {
+      m_lexer.reset (source, source + length);
+      Token token;
+      do
+      {
+        token = m_lexer.getToken ();
+        m_tokens.push_back (token);
+      } while (token.type != END_OF_FILE);
+    }
+
+    // Run Parser, falling back to a serial parse when a parallel one
+    // is not possible
+    ProgramNode* astTree = nullptr;
+    if (options.parseJobs > 1 && !options.hashCons)
+      astTree = parseParallel (m_tokens, options.parseJobs, m_arena, m_workerArenas);
+    if (astTree == nullptr)
+    {
+      Parser par (m_tokens, &m_arena);
+      NodeFactory factory (&m_arena);
+      if (options.hashCons)
+        par.setNodeFactory (&factory);
+      astTree = par.program ();
+      result.sharedNodes = factory.getShared ();
+      result.sharedBytes = factory.getBytesSaved ();
+      if (options.hashCons)
+        result.factoryBytes = factory.getTableBytes ();
+    }
+    if (options.parseOnly || options.stopAfter == "parse")
+    {
+      result.program = astTree;
+      result.success = true;
+      return result;
+    }
+
+    NameSupply names;
+    PassContext passContext;
+    passContext.program = astTree;
+    passContext.table = &m_table;
+    passContext.arena = &m_arena;
+    passContext.options = &options;
+    passContext.result = &result;
+    passContext.names = &names;
+    if (options.emit == EmitKind::IR || options.emit == EmitKind::ASM)
+    {
+      if (m_ir == nullptr)
+        m_ir.reset (new IrModule ());
+      passContext.ir = m_ir.get ();
+    }
+
+    m_table.reset (astTree);
+    ImportMap imported;
+    declareImports (options, imported, &passContext.imports);
+
+    // Resolve, check and print the tree
+    PassManager passes (passContext);
+    addStandardPasses (passes);
+    bool known = passes.run (options.stopAfter);
+    if (!known)
+      raiseError (DiagnosticPhase::INPUT, 0, 0, "\nERROR: Unknown pass \"%s\"\n\n",
+                  options.stopAfter.c_str ());
+
+    // Finding the imports used needs the tree resolved, which a pass
+    //   that changed it or stopping early may have left it not
+    if (!imported.empty ())
+    {
+      passes.require ("resolve");
+      findUsedImports (astTree, imported, result);
+    }
+    for (const PassTiming& timing : passes.getTimings ())
+      result.passTimes.emplace_back (timing.name, timing.seconds);
+
+    result.program = astTree;
+    result.success = true;
+  }
+  catch (const CompileError& error)
+  {
+    result.diagnostics.push_back (error.diagnostic);
+  }
+
+  return result;
+}
+
+/***********************************************************************/
+
+CompileResult
+CompilerContext::compile (const std::string& source, const CompileOptions& options)
+{
+  return compile (source.data (), source.size (), options);
+}
+
+/***********************************************************************/
+
+void
+CompilerContext::declareImports (const CompileOptions& options, ImportMap& imported,
+                                 std::vector<DeclarationNode*>* declarations)
+{
+  for (size_t i = 0; i < options.imports.size (); ++i)
+    for (size_t e = 0; e < options.imports[i]->exports.size (); ++e)
+    {
+      DeclarationNode* declaration = options.imports[i]->exports[e].declare (m_arena);
+      m_table.insert (declaration);
+      imported[declaration] = std::make_pair (i, e);
+      if (declarations != nullptr)
+        declarations->push_back (declaration);
+    }
+}
+
+/***********************************************************************/
+
+void
+CompilerContext::findUsedImports (ProgramNode* program, const ImportMap& imported,
+                                  CompileResult& result)
+{
+  ReferenceVisitor references;
+  references.walk (program);
+  for (DeclarationNode* declaration : references.references)
+  {
+    auto entry = imported.find (declaration);
+    if (entry != imported.end ())
+      result.usedImports.push_back (entry->second);
+  }
+  std::sort (result.usedImports.begin (), result.usedImports.end ());
+}
+
+/***********************************************************************/
+
+void
+CompilerContext::reset ()
+{
+  m_arena.reset ();
+  for (std::unique_ptr<AstArena>& arena : m_workerArenas)
+    arena->reset ();
+  m_tokens.clear ();
+  if (m_ir != nullptr)
+    m_ir->clear ();
+}
+
+/***********************************************************************/
+
+bool
+readSource (FILE* file, std::string& source, bool stopAtDollar)
+{
+  source.clear ();
+  if (file == nullptr)
+    return false;
+
+  char buffer[64 * 1024];
+  size_t count;
+  if (stopAtDollar)
+  {
+    int c;
+    while ((c = fgetc (file)) != EOF)
+    {
+      source += (char) c;
+      if (c == '$')
+        break;
+    }
+  }
+  else
+  {
+    while ((count = fread (buffer, 1, sizeof (buffer), file)) > 0)
+      source.append (buffer, count);
+  }
+  return !ferror (file);
+}
@@ -0,0 +1,272 @@
+/*
+  Filename   : CompilerContext.h
+  Author     : Philip Androwick
+  Description: Embeddable interface to the compiler (libcminus).  A
+               CompilerContext compiles C- source held in memory and
+               returns the AST text and any diagnostics instead of writing
+               files or exiting.  A context can be reused for any number of
+               compilations; its arena, token buffer and symbol table keep
+               their storage between them.
+*/
+
+/***********************************************************************/
+
+#ifndef COMPILER_CONTEXT_H
+#define COMPILER_CONTEXT_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "Diagnostic.h"
+#include "ModuleInterface.h"
+#include "../Lexer/Lexer.h"
+#include "../Parser/AstArena.h"
+#include "../SemanticAnalyzer/SymbolTable.h"
+
+/***********************************************************************/
+
+// What a compilation produces besides diagnostics
+enum class EmitKind
+{
+  // The .ast text
+  AST,
+  // The program lowered to SSA form (see IR/IR.h), and its text
+  IR,
+  // x86-64 assembly text (see Codegen/CodeGenerator.h)
+  ASM,
+  // C source text (see Codegen/CSource.h)
+  C,
+  // LLVM IR text (see Codegen/LlvmSource.h)
+  LLVM
+};
+
+/***********************************************************************/
+
+// Largest function body, in nodes, that optimizing inlines by default
+const size_t DEFAULT_INLINE_BUDGET = 100;
+
+// Copies of a loop's body that optimizing unrolls a counted loop to by
+//   default, when it cannot unroll it fully
+const unsigned DEFAULT_UNROLL_FACTOR = 4;
+
+/***********************************************************************/
+
+struct CompileOptions
+{
+  // Interfaces of other modules, declared in the global scope before
+  //   the source is analyzed
+  std::vector<const ModuleInterface*> imports;
+
+  // Whether the source must declare "main"; only the last module of a
+  //   program does
+  bool requireMain = true;
+
+  // Stop after parsing; the result holds the unchecked tree
+  bool parseOnly = false;
+
+  // Threads used to lex large sources (see ParallelLexer.h); the
+  //   pipelined compile always lexes on one thread
+  unsigned lexJobs = 1;
+
+  // Threads used to parse large programs (see ParallelParser.h)
+  unsigned parseJobs = 1;
+
+  // Share identical expression subtrees (see NodeFactory.h); the parse
+  //   is then serial
+  bool hashCons = false;
+
+  // Threads used to print the AST text (see AstWriter.h); with more
+  //   than one the text is left in CompileResult::astChunks
+  unsigned printJobs = 1;
+
+  // Name of the pass to stop after ("parse", "resolve", "check",
+  //   "inline", "fold", "unroll", "licm", "strength", "cse", "dce",
+  //   "lower", "ssa" or "print"); empty runs every pass (see Passes.h)
+  std::string stopAfter;
+
+  EmitKind emit = EmitKind::AST;
+
+  // With EmitKind::ASM, compile the tree with the stack code generator
+  //   instead of allocating registers for the IR
+  bool stackCode = false;
+
+  // Optimization level: 0 compiles the checked tree as it is, 1 runs
+  //   the optimization passes over it first.  The tree is changed in
+  //   place, so it must not be hash-consed.
+  unsigned optimize = 0;
+
+  // Largest function body, in nodes, whose calls optimizing inlines
+  //   (see Optimizer/Inliner.h); 0 inlines none
+  size_t inlineBudget = DEFAULT_INLINE_BUDGET;
+
+  // Copies of the body a counted loop that is not fully unrolled gets
+  //   (see Optimizer/LoopUnroller.h); 0 or 1 unrolls none partially
+  unsigned unrollFactor = DEFAULT_UNROLL_FACTOR;
+};
+
+/***********************************************************************/
+
+struct IrModule;
+
+struct CompileResult
+{
+  bool success = false;
+
+  // Contents of the .ast file; empty when compilation failed
+  std::string ast;
+
+  // The same text in pieces, to be written in order, instead of ast
+  //   when CompileOptions::printJobs is more than one
+  std::vector<std::string> astChunks;
+
+  std::vector<Diagnostic> diagnostics;
+
+  // Checked tree, owned by the context and valid until its next
+  //   compilation; nullptr when compilation failed
+  ProgramNode* program = nullptr;
+
+  // With EmitKind::IR, the IR, owned by the context like the tree, and
+  //   its text in place of the AST text; with EmitKind::ASM, the
+  //   assembly text of the program and its runtime, and with
+  //   EmitKind::C and EmitKind::LLVM, the C and LLVM text
+  const IrModule* ir = nullptr;
+  std::string     code;
+
+  // Imported symbols the source refers to, as (import, export) indexes
+  //   into CompileOptions::imports and its exports
+  std::vector<std::pair<size_t, size_t>> usedImports;
+
+  // Expression nodes shared by hash-consing, the bytes that saved, and
+  //   the bytes the hash-consing tables took
+  size_t sharedNodes = 0;
+  size_t sharedBytes = 0;
+  size_t factoryBytes = 0;
+
+  // Seconds spent in each pass that ran, in order
+  std::vector<std::pair<std::string, double>> passTimes;
+
+  // What each optimization pass that ran did, in order, as (pass,
+  //   report) pairs
+  std::vector<std::pair<std::string, std::string>> optimizations;
+};
+
+/***********************************************************************/
+
+struct FunctionIndex;
+struct FunctionQueryStats;
+struct PipelineStats;
+struct StreamStats;
+
+/***********************************************************************/
+
+class CompilerContext
+{
+public:
+  CompilerContext ();
+
+  ~CompilerContext ();
+
+  CompilerContext (const CompilerContext&) = delete;
+  CompilerContext& operator= (const CompilerContext&) = delete;
+
+  // Compiles the characters in [source, source + length)
+  CompileResult
+  compile (const char* source, size_t length,
+           const CompileOptions& options = CompileOptions ());
+
+  CompileResult
+  compile (const std::string& source,
+           const CompileOptions& options = CompileOptions ());
+
+  // Same result as compile, but lexing, parsing and analysis run at the
+  //   same time on three threads connected by lock-free queues; each
+  //   declaration is checked as soon as it has been parsed.  Fills in
+  //   stats when it is not nullptr.  (Pipeline.cc)
+  CompileResult
+  compilePipelined (const char* source, size_t length,
+                    const CompileOptions& options = CompileOptions (),
+                    PipelineStats* stats = nullptr);
+
+  // Compiles one top-level declaration at a time, writing the .ast text
+  //   to astFile as it goes and freeing each tree once it is written.
+  //   Memory use follows the largest declaration, not the program.  The
+  //   result holds no tree or AST text, and usedImports is not filled
+  //   in; astFile holds partial output if compilation fails.
+  //   (Streaming.cc)
+  CompileResult
+  compileStreaming (const char* source, size_t length, FILE* astFile,
+                    const CompileOptions& options = CompileOptions (),
+                    StreamStats* stats = nullptr);
+
+  // Resolves and checks only the function called name, against the
+  //   headers of the declarations before it; no other body is parsed.
+  //   Errors elsewhere in the source, other than syntax errors in the
+  //   headers, are not reported, and neither is a missing "main".  The
+  //   source is indexed on the first query about it, and each result is
+  //   memoized until the function or a declaration before it changes.
+  //   The result holds no tree or AST text.  Fills in stats when it is
+  //   not nullptr.  (FunctionQuery.cc)
+  CompileResult
+  checkFunction (const char* source, size_t length, const std::string& name,
+                 const CompileOptions& options = CompileOptions (),
+                 FunctionQueryStats* stats = nullptr);
+
+  // Frees the tree of the last compilation, keeping the storage warm
+  void
+  reset ();
+
+  AstArena&
+  getArena ()
+  {
+    return m_arena;
+  }
+
+private:
+  // Declarations made for imported symbols, and their (import, export)
+  //   indexes
+  using ImportMap = std::unordered_map<DeclarationNode*, std::pair<size_t, size_t>>;
+
+  // Also lists the declarations, in order, in declarations when it is
+  //   not nullptr
+  void
+  declareImports (const CompileOptions& options, ImportMap& imported,
+                  std::vector<DeclarationNode*>* declarations = nullptr);
+
+  void
+  findUsedImports (ProgramNode* program, const ImportMap& imported, CompileResult& result);
+
+  AstArena           m_arena;
+  // Nodes made by the threads of a parallel parse
+  std::vector<std::unique_ptr<AstArena>> m_workerArenas;
+  // Tree of the declaration being compiled by compileStreaming
+  AstArena           m_scratchArena;
+  Lexer              m_lexer;
+  std::vector<Token> m_tokens;
+  SymbolTable        m_table;
+  // Index of the source checkFunction was last asked about
+  std::unique_ptr<FunctionIndex> m_functionIndex;
+  // IR of the last compilation that emitted it
+  std::unique_ptr<IrModule> m_ir;
+};
+
+/***********************************************************************/
+
+// Reads all of file into source.  When stopAtDollar is set, reading
+//   also ends after a '$', which is how interactive input is finished.
+// Returns false if the file could not be read.
+bool
+readSource (FILE* file, std::string& source, bool stopAtDollar = false);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,91 @@
+/*
+  Filename   : Diagnostic.h
+  Author     : Philip Androwick
+  Description: Diagnostics reported by every phase of the compiler.  Errors
+               are raised as a CompileError so that a caller (the CMinus
+               executable or an embedding application) decides whether to
+               print them and exit, or to keep compiling.
+*/
+
+/***********************************************************************/
+
+#ifndef DIAGNOSTIC_H
+#define DIAGNOSTIC_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdarg>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+/***********************************************************************/
+
+// RUNTIME errors come from running a program (VM/VirtualMachine.h),
+//   CODEGEN ones from compiling it to machine code (Codegen/)
+enum class DiagnosticPhase
+{
+  INPUT, LEXER, PARSER, SEMANTIC, RUNTIME, CODEGEN
+};
+
+/***********************************************************************/
+
+struct Diagnostic
+{
+  Diagnostic (DiagnosticPhase pPhase = DiagnosticPhase::INPUT,
+              int pLine = 0,
+              int pColumn = 0,
+              std::string pMessage = "")
+    : phase (pPhase), lineNum (pLine), columnNum (pColumn), message (pMessage)
+  {  }
+
+  DiagnosticPhase phase;
+  // 0 when the diagnostic has no source position
+  int             lineNum;
+  int             columnNum;
+  // Text exactly as the command line compiler prints it
+  std::string     message;
+};
+
+/***********************************************************************/
+
+struct CompileError : std::exception
+{
+  CompileError (Diagnostic pDiagnostic)
+    : diagnostic (pDiagnostic)
+  {  }
+
+  virtual const char*
+  what () const noexcept
+  {
+    return diagnostic.message.c_str ();
+  }
+
+  Diagnostic diagnostic;
+};
+
+/***********************************************************************/
+
+// Formats a printf-style message and throws it as a CompileError
+[[noreturn]] inline void
+raiseError (DiagnosticPhase phase, int line, int column, const char* format, ...)
+{
+  va_list args;
+  va_start (args, format);
+  va_list argsCopy;
+  va_copy (argsCopy, args);
+  int length = vsnprintf (nullptr, 0, format, args);
+  va_end (args);
+
+  std::string message (length > 0 ? length : 0, '\0');
+  if (length > 0)
+    vsnprintf (&message[0], length + 1, format, argsCopy);
+  va_end (argsCopy);
+
+  throw CompileError (Diagnostic (phase, line, column, message));
+}
+
+/***********************************************************************/
+
+#endif
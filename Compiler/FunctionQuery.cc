@@ -0,0 +1,215 @@
+/*
+  Filename   : FunctionQuery.cc
+  Author     : Philip Androwick
+  Description: Checks one function of a source without parsing or
+               analyzing the bodies of the others.  Global names are
+               resolved against the headers of the declarations before
+               the function, which are found lazily instead of being put
+               in the symbol table, so a query costs time in proportion to
+               the function rather than the program.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstring>
+
+/***********************************************************************/
+// Local includes
+
+#include "FunctionQuery.h"
+#include "../Parser/Parser.h"
+#include "../Parser/ParallelParser.h"
+#include "../SemanticAnalyzer/SymbolTableVisitor.h"
+#include "../SemanticAnalyzer/SemanticAnalysisVisitor.h"
+
+/***********************************************************************/
+
+// Hash of the kinds, positions and text of count tokens
+static uint64_t
+hashTokens (const Token* tokens, size_t count, uint64_t hash)
+{
+  for (size_t n = 0; n < count; ++n)
+  {
+    int fields[3] = { tokens[n].type, tokens[n].lineNum, tokens[n].columnNum };
+    hash = hashBytes ((const char*) fields, sizeof (fields), hash);
+    hash = hashBytes (tokens[n].lexeme.data (), tokens[n].lexeme.size (), hash);
+  }
+  return hash;
+}
+
+/***********************************************************************/
+
+// Lexes the source into index, cuts it into declarations and parses
+//   their headers.  Raises the error a full compile would if the source
+//   cannot be cut, or one of the headers has a syntax error.
+static void
+buildIndex (FunctionIndex& index, Lexer& lexer, const char* source, size_t length)
+{
+  lexer.reset (source, source + length);
+  Token token;
+  do
+  {
+    token = lexer.getToken ();
+    index.tokens.push_back (token);
+  } while (token.type != END_OF_FILE);
+
+  if (!findDeclarationEnds (index.tokens, index.ends))
+  {
+    // A lexical error or unbalanced braces; let the serial parser
+    // report it
+    Parser par (index.tokens, &index.arena);
+    par.program ();
+    raiseError (DiagnosticPhase::PARSER, 0, 0, "\nERROR: Could not split the program into declarations\n\n");
+  }
+
+  index.prefixHashes.push_back (hashBytes (nullptr, 0));
+  for (size_t d = 0; d < index.ends.size (); ++d)
+  {
+    size_t begin = d == 0 ? 0 : index.ends[d - 1];
+    Parser par (index.tokens.data () + begin, index.ends[d] - begin, &index.arena);
+    DeclarationNode* header = par.nextHeader ();
+    index.headers.push_back (header);
+    index.prefixHashes.push_back (hashTokens (index.tokens.data () + begin, par.getTokensConsumed (),
+                                              index.prefixHashes.back ()));
+
+    index.firstDeclarations.emplace (header->identifier, d);
+    if (header->dataType == DataType::FUNCTION)
+    {
+      index.firstFunctions.emplace (header->identifier, d);
+      if (header->identifier == "main" && index.firstMain > d)
+        index.firstMain = d;
+    }
+  }
+}
+
+/***********************************************************************/
+
+CompileResult
+CompilerContext::checkFunction (const char* source, size_t length, const std::string& name,
+                                const CompileOptions& options, FunctionQueryStats* stats)
+{
+  reset ();
+  if (!m_functionIndex)
+    m_functionIndex.reset (new FunctionIndex ());
+  FunctionIndex& index = *m_functionIndex;
+  FunctionQueryStats queryStats;
+
+  CompileResult result;
+  try
+  {
+    // Comparing is much faster than hashing, so the source is kept
+    if (!index.valid || index.source.size () != length
+        || memcmp (index.source.data (), source, length) != 0)
+    {
+      index.valid = true;
+      index.source.assign (source, length);
+      index.tokens.clear ();
+      index.failed = false;
+      index.ends.clear ();
+      index.headers.clear ();
+      index.prefixHashes.clear ();
+      index.firstDeclarations.clear ();
+      index.firstFunctions.clear ();
+      index.firstMain = (size_t) -1;
+      index.arena.reset ();
+      queryStats.indexed = true;
+      try
+      {
+        buildIndex (index, m_lexer, source, length);
+      }
+      catch (const CompileError& error)
+      {
+        index.failed = true;
+        index.error = error.diagnostic;
+      }
+    }
+    queryStats.declarations = index.headers.size ();
+    queryStats.sourceTokens = index.tokens.size ();
+    if (index.failed)
+      throw CompileError (index.error);
+
+    auto function = index.firstFunctions.find (name);
+    if (function == index.firstFunctions.end ())
+      raiseError (DiagnosticPhase::INPUT, 0, 0, "\nERROR: No function named \"%s\"\n\n", name.c_str ());
+    size_t d = function->second;
+    size_t begin = d == 0 ? 0 : index.ends[d - 1];
+    size_t count = index.ends[d] - begin;
+    queryStats.functionTokens = count;
+
+    // The result depends on the function, the headers before it and
+    // the imports
+    uint64_t inputs = hashTokens (index.tokens.data () + begin, count, index.prefixHashes[d]);
+    for (const ModuleInterface* import : options.imports)
+    {
+      inputs = hashBytes ((const char*) &import->sourceHash, sizeof (import->sourceHash), inputs);
+      inputs = hashBytes ((const char*) &import->interfaceHash, sizeof (import->interfaceHash), inputs);
+    }
+    auto memoized = index.memo.find (name);
+    if (memoized != index.memo.end () && memoized->second.first == inputs)
+    {
+      queryStats.memoized = true;
+      if (stats != nullptr)
+        *stats = queryStats;
+      return memoized->second.second;
+    }
+
+    // Errors in the function are memoized along with successes
+    try
+    {
+      m_scratchArena.reset ();
+      Parser par (index.tokens.data () + begin, count, &m_scratchArena);
+      DeclarationNode* declaration = par.nextDeclaration ();
+
+      // Only the declarations before the function are visible from it
+      m_table.reset (nullptr);
+      ImportMap imported;
+      declareImports (options, imported);
+      m_table.setOuterLookup ([&index, d] (const std::string& identifier) -> DeclarationNode* {
+        auto first = index.firstDeclarations.find (identifier);
+        if (first == index.firstDeclarations.end () || first->second >= d)
+          return nullptr;
+        return index.headers[first->second];
+      });
+
+      // A global of the same name makes the function a redeclaration
+      size_t first = index.firstDeclarations.at (name);
+      if (first < d)
+        m_table.insert (index.headers[first]);
+
+      SymbolTableVisitor visitor (&m_table);
+      visitor.walk (declaration);
+      SemanticAnalysisVisitor semanticVisitor (&m_table);
+      semanticVisitor.requireMain = false;
+      semanticVisitor.foundMain = index.firstMain < d;
+      semanticVisitor.walk (declaration);
+      result.success = true;
+    }
+    catch (const CompileError& error)
+    {
+      result.diagnostics.push_back (error.diagnostic);
+    }
+    index.memo[name] = std::make_pair (inputs, result);
+  }
+  catch (const CompileError& error)
+  {
+    // The source could not be indexed, or has no such function
+    result.diagnostics.push_back (error.diagnostic);
+  }
+
+  m_scratchArena.reset ();
+  if (stats != nullptr)
+    *stats = queryStats;
+  return result;
+}
+
+/***********************************************************************/
+
+void
+FunctionQueryStats::print (FILE* file) const
+{
+  fprintf (file, "Checked %zu of %zu tokens in %zu declarations\n", functionTokens,
+           sourceTokens, declarations);
+  fprintf (file, "  index   : %s\n", indexed ? "built" : "reused");
+  fprintf (file, "  result  : %s\n", memoized ? "memoized" : "computed");
+}
@@ -0,0 +1,93 @@
+/*
+  Filename   : FunctionQuery.h
+  Author     : Philip Androwick
+  Description: Demand-driven checking of a single function
+               (CompilerContext::checkFunction).  A source is indexed once:
+               it is lexed, cut into top-level declarations by counting
+               braces, and only the header of each declaration is parsed.
+               A query then parses, resolves and checks the body of the one
+               function asked about.  Its result is memoized until the
+               function's tokens or the declarations before it change.
+*/
+
+/***********************************************************************/
+
+#ifndef FUNCTION_QUERY_H
+#define FUNCTION_QUERY_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "CompilerContext.h"
+
+/***********************************************************************/
+
+struct FunctionQueryStats
+{
+  // Whether the source had to be indexed, or was indexed by an earlier
+  //   query
+  bool indexed = false;
+
+  // Whether the result was memoized by an earlier query
+  bool memoized = false;
+
+  size_t declarations = 0;
+  size_t sourceTokens = 0;
+  size_t functionTokens = 0;
+
+  // Writes a readable report to file
+  void
+  print (FILE* file) const;
+};
+
+/***********************************************************************/
+
+// The last source a context was asked about, and the results of its
+//   queries
+struct FunctionIndex
+{
+  bool               valid = false;
+  std::string        source;
+  std::vector<Token> tokens;
+
+  // Lexing or cutting the source, or parsing a header, failed with error;
+  //   every query reports it
+  bool       failed = false;
+  Diagnostic error;
+
+  // For each top-level declaration: the index just past it in tokens,
+  //   its header (functions have a nullptr body), and a hash of the
+  //   headers before it
+  std::vector<size_t>           ends;
+  std::vector<DeclarationNode*> headers;
+  std::vector<uint64_t>         prefixHashes;
+
+  // First declaration of each name, and first function of each name
+  std::unordered_map<std::string, size_t> firstDeclarations;
+  std::unordered_map<std::string, size_t> firstFunctions;
+
+  // First function named "main"; (size_t) -1 when there is none
+  size_t firstMain = (size_t) -1;
+
+  // Holds the headers
+  AstArena arena;
+
+  // Results by function name, with the hash of the inputs they were
+  //   found from.  Kept when the source changes, since a function whose
+  //   inputs did not change keeps its result.
+  std::unordered_map<std::string, std::pair<uint64_t, CompileResult>> memo;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,232 @@
+/*
+  Filename   : ModuleDriver.cc
+  Author     : Philip Androwick
+  Description: Builds modules in two parallel rounds.  The first finds the
+               interface of every module, from its .cmi file when the
+               source has not changed or by parsing it otherwise.  The
+               second compiles each module that is out of date against the
+               interfaces of the modules before it.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <unistd.h>
+
+/***********************************************************************/
+// Local includes
+
+#include "ModuleDriver.h"
+#include "CompilerContext.h"
+#include "ModuleInterface.h"
+#include "Parallel.h"
+
+/***********************************************************************/
+
+struct ModuleState
+{
+  std::string     sourceFile;
+  std::string     baseName;
+  std::string     source;
+  ModuleInterface interface;
+  bool            sourceChanged = false;
+  bool            rebuilt = false;
+  bool            failed = false;
+  std::vector<Diagnostic> diagnostics;
+};
+
+/***********************************************************************/
+
+// Round one: read the source and find the module's interface
+static void
+loadInterface (ModuleState& module, CompilerContext& context)
+{
+  FILE* file = fopen (module.sourceFile.c_str (), "r");
+  bool readOk = readSource (file, module.source);
+  if (file != nullptr)
+    fclose (file);
+  if (!readOk)
+  {
+    module.failed = true;
+    module.diagnostics.push_back (Diagnostic (DiagnosticPhase::INPUT, 0, 0,
+      "\nERROR: Could not read \"" + module.sourceFile + "\"\n\n"));
+    return;
+  }
+
+  uint64_t sourceHash = hashBytes (module.source.data (), module.source.size ());
+  if (module.interface.read (module.baseName + ".cmi")
+      && module.interface.sourceHash == sourceHash
+      && access ((module.baseName + ".ast").c_str (), F_OK) == 0)
+    return;
+
+  // New or edited; its exports come from the declarations' headers
+  CompileOptions options;
+  options.parseOnly = true;
+  CompileResult result = context.compile (module.source, options);
+  if (!result.success)
+  {
+    module.failed = true;
+    module.diagnostics = result.diagnostics;
+    return;
+  }
+
+  module.interface = ModuleInterface ();
+  module.interface.module = module.baseName;
+  module.interface.sourceHash = sourceHash;
+  module.interface.extract (result.program);
+  module.sourceChanged = true;
+}
+
+/***********************************************************************/
+
+// Whether anything the module was compiled against has changed
+static bool
+isOutOfDate (const std::vector<ModuleState>& modules, size_t index)
+{
+  const ModuleState& module = modules[index];
+  if (module.sourceChanged)
+    return true;
+
+  // The symbols it used must have kept their signatures
+  for (const ModuleDependency& dependency : module.interface.dependencies)
+  {
+    size_t from = 0;
+    while (from < index && modules[from].interface.module != dependency.module)
+      ++from;
+    if (from == index || modules[from].interface.hashSymbols (dependency.symbols) != dependency.symbolsHash)
+      return true;
+  }
+
+  // A new clash between global names has to be reported
+  std::map<std::string, size_t> owners;
+  for (size_t from = 0; from <= index; ++from)
+    for (const ExportedSymbol& symbol : modules[from].interface.exports)
+      if (!owners.emplace (symbol.identifier, from).second)
+        return true;
+  return false;
+}
+
+/***********************************************************************/
+
+// Round two: compile the module against the interfaces before it
+static void
+compileModule (std::vector<ModuleState>& modules, size_t index, CompilerContext& context)
+{
+  ModuleState& module = modules[index];
+  if (!isOutOfDate (modules, index))
+    return;
+
+  CompileOptions options;
+  for (size_t from = 0; from < index; ++from)
+    options.imports.push_back (&modules[from].interface);
+  options.requireMain = index + 1 == modules.size ();
+
+  module.rebuilt = true;
+  std::string astFile = module.baseName + ".ast";
+  std::string interfaceFile = module.baseName + ".cmi";
+  CompileResult result = context.compile (module.source, options);
+  if (!result.success)
+  {
+    // Leave nothing behind that would make the module look up to date
+    module.failed = true;
+    module.diagnostics = result.diagnostics;
+    unlink (astFile.c_str ());
+    unlink (interfaceFile.c_str ());
+    return;
+  }
+
+  // Record what was used from each module, for the next build
+  module.interface.dependencies.clear ();
+  for (const std::pair<size_t, size_t>& used : result.usedImports)
+  {
+    const ModuleInterface& from = *options.imports[used.first];
+    if (module.interface.dependencies.empty ()
+        || module.interface.dependencies.back ().module != from.module)
+    {
+      module.interface.dependencies.push_back (ModuleDependency ());
+      module.interface.dependencies.back ().module = from.module;
+    }
+    module.interface.dependencies.back ().symbols.push_back (from.exports[used.second].identifier);
+  }
+  for (ModuleDependency& dependency : module.interface.dependencies)
+  {
+    size_t from = 0;
+    while (modules[from].interface.module != dependency.module)
+      ++from;
+    dependency.symbolsHash = modules[from].interface.hashSymbols (dependency.symbols);
+  }
+
+  std::ofstream astOutput (astFile);
+  astOutput << result.ast;
+  astOutput.close ();
+  if (!astOutput || !module.interface.write (interfaceFile))
+  {
+    module.failed = true;
+    module.diagnostics.push_back (Diagnostic (DiagnosticPhase::INPUT, 0, 0,
+      "\nERROR: Could not write \"" + astFile + "\" or \"" + interfaceFile + "\"\n\n"));
+  }
+}
+
+/***********************************************************************/
+
+bool
+buildModules (const std::vector<std::string>& sourceFiles, unsigned jobs)
+{
+  std::vector<ModuleState> modules (sourceFiles.size ());
+  for (size_t n = 0; n < modules.size (); ++n)
+  {
+    modules[n].sourceFile = sourceFiles[n];
+    size_t lastindex = sourceFiles[n].find_last_of (".");
+    modules[n].baseName = sourceFiles[n].substr (0, lastindex);
+  }
+
+  std::vector<std::unique_ptr<CompilerContext>> contexts;
+  for (unsigned n = 0; n < (jobs > 0 ? jobs : 1); ++n)
+    contexts.emplace_back (new CompilerContext ());
+
+  parallelFor (modules.size (), jobs, [&] (size_t index, unsigned worker) {
+    loadInterface (modules[index], *contexts[worker]);
+  });
+
+  bool interfacesOk = true;
+  for (const ModuleState& module : modules)
+    interfacesOk = interfacesOk && !module.failed;
+
+  if (interfacesOk)
+    parallelFor (modules.size (), jobs, [&] (size_t index, unsigned worker) {
+      compileModule (modules, index, *contexts[worker]);
+    });
+
+  size_t rebuilt = 0;
+  bool ok = true;
+  for (const ModuleState& module : modules)
+  {
+    if (module.failed)
+    {
+      ok = false;
+      printf ("\nIn module \"%s\":\n", module.sourceFile.c_str ());
+      for (const Diagnostic& diagnostic : module.diagnostics)
+        printf ("%s", diagnostic.message.c_str ());
+    }
+    else if (module.rebuilt)
+    {
+      ++rebuilt;
+      printf ("Compiled \"%s\"\n", module.sourceFile.c_str ());
+    }
+    else if (interfacesOk)
+    {
+      printf ("Up to date \"%s\"\n", module.sourceFile.c_str ());
+    }
+  }
+
+  if (ok)
+  {
+    printf ("\nValid!\n");
+    printf ("Rebuilt %zu of %zu modules\n\n", rebuilt, modules.size ());
+  }
+  return ok;
+}
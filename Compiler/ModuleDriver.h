@@ -0,0 +1,32 @@
+/*
+  Filename   : ModuleDriver.h
+  Author     : Philip Androwick
+  Description: Separate compilation of a program split across several
+               source files (CMinus --modules).  Each module may use the
+               global declarations of the modules listed before it, and the
+               last module holds "main".
+*/
+
+/***********************************************************************/
+
+#ifndef MODULE_DRIVER_H
+#define MODULE_DRIVER_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+
+// Brings the .ast and .cmi files of every module up to date, using up
+//   to jobs threads.  A module is only recompiled when its source
+//   changed or when a symbol it uses from another module changed.
+// Prints progress and errors; returns true if every module compiled.
+bool
+buildModules (const std::vector<std::string>& sourceFiles, unsigned jobs);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,253 @@
+/*
+  Filename   : ModuleInterface.cc
+  Author     : Philip Androwick
+  Description: Extraction, hashing and the .cmi file format of module
+               interface summaries.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+
+/***********************************************************************/
+// Local includes
+
+#include "ModuleInterface.h"
+#include "BinaryIO.h"
+
+/***********************************************************************/
+
+// Identifies .cmi files; bump the last character when the format changes
+static const char INTERFACE_MAGIC[] = "CMI1";
+
+/***********************************************************************/
+
+uint64_t
+hashBytes (const char* data, size_t length, uint64_t hash)
+{
+  for (size_t n = 0; n < length; ++n)
+  {
+    hash ^= (unsigned char) data[n];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/***********************************************************************/
+
+// The signature of a symbol; positions are left out so that moving a
+//   declaration does not change the interface
+static void
+putSignature (std::string& out, const ExportedSymbol& symbol)
+{
+  putWord (out, (uint32_t) symbol.dataType);
+  putWord (out, (uint32_t) symbol.valueType);
+  putString (out, symbol.identifier);
+  putWord (out, symbol.arraySize);
+  putWord (out, symbol.parameters.size ());
+  for (const ExportedParameter& parameter : symbol.parameters)
+  {
+    putWord (out, (uint32_t) parameter.type);
+    putWord (out, parameter.isArray);
+  }
+}
+
+static bool
+getSignature (const std::string& in, size_t& offset, ExportedSymbol& symbol)
+{
+  uint32_t dataType, valueType, count;
+  if (!getWord (in, offset, dataType) || !getWord (in, offset, valueType)
+      || !getString (in, offset, symbol.identifier) || !getWord (in, offset, symbol.arraySize)
+      || !getWord (in, offset, count))
+    return false;
+
+  symbol.dataType = (DataType) dataType;
+  symbol.valueType = (ValueType) valueType;
+  symbol.parameters.clear ();
+  for (uint32_t n = 0; n < count; ++n)
+  {
+    uint32_t type, isArray;
+    if (!getWord (in, offset, type) || !getWord (in, offset, isArray))
+      return false;
+    symbol.parameters.push_back ({ (ValueType) type, isArray != 0 });
+  }
+  return true;
+}
+
+/***********************************************************************/
+
+DeclarationNode*
+ExportedSymbol::declare (AstArena& arena) const
+{
+  if (dataType == DataType::FUNCTION)
+  {
+    vector<ParameterNode*> params;
+    for (size_t n = 0; n < parameters.size (); ++n)
+      params.push_back (arena.make<ParameterNode> (parameters[n].type, "p" + std::to_string (n),
+                                                   parameters[n].isArray, row, col));
+    return arena.make<FunctionDeclarationNode> (valueType, identifier, params, nullptr, row, col);
+  }
+  if (dataType == DataType::ARRAY)
+    return arena.make<ArrayDeclarationNode> (valueType, identifier, arraySize, row, col);
+  return arena.make<VariableDeclarationNode> (valueType, identifier, DataType::VARIABLE, row, col);
+}
+
+/***********************************************************************/
+
+ExportedSymbol
+ExportedSymbol::describe (DeclarationNode* declaration)
+{
+  ExportedSymbol symbol;
+  symbol.dataType = declaration->dataType;
+  symbol.valueType = declaration->valueType;
+  symbol.identifier = declaration->identifier;
+  symbol.row = declaration->row;
+  symbol.col = declaration->col;
+
+  if (FunctionDeclarationNode* function = dynamic_cast<FunctionDeclarationNode*> (declaration))
+  {
+    for (ParameterNode* parameter : function->parameters)
+      symbol.parameters.push_back ({ parameter->valueType, parameter->isArray });
+  }
+  else if (ArrayDeclarationNode* array = dynamic_cast<ArrayDeclarationNode*> (declaration))
+  {
+    symbol.arraySize = (uint32_t) array->size;
+  }
+  return symbol;
+}
+
+/***********************************************************************/
+
+void
+ModuleInterface::extract (ProgramNode* program)
+{
+  exports.clear ();
+  std::string signatures;
+  for (DeclarationNode* declaration : program->declarations)
+  {
+    ExportedSymbol symbol = ExportedSymbol::describe (declaration);
+    putSignature (signatures, symbol);
+    exports.push_back (symbol);
+  }
+  interfaceHash = hashBytes (signatures.data (), signatures.size ());
+}
+
+/***********************************************************************/
+
+uint64_t
+ModuleInterface::hashSymbols (const std::vector<std::string>& names) const
+{
+  std::string signatures;
+  for (const std::string& name : names)
+  {
+    const ExportedSymbol* symbol = find (name);
+    if (symbol != nullptr)
+      putSignature (signatures, *symbol);
+    else
+      putString (signatures, "?" + name);
+  }
+  return hashBytes (signatures.data (), signatures.size ());
+}
+
+const ExportedSymbol*
+ModuleInterface::find (const std::string& identifier) const
+{
+  for (const ExportedSymbol& symbol : exports)
+    if (symbol.identifier == identifier)
+      return &symbol;
+  return nullptr;
+}
+
+/***********************************************************************/
+// A .cmi file is the magic, the source and interface hashes, the module
+//   name, the exports with their positions, and the dependencies
+
+bool
+ModuleInterface::write (const std::string& path) const
+{
+  std::string out (INTERFACE_MAGIC, 4);
+  putLong (out, sourceHash);
+  putLong (out, interfaceHash);
+  putString (out, module);
+
+  putWord (out, exports.size ());
+  for (const ExportedSymbol& symbol : exports)
+  {
+    putSignature (out, symbol);
+    putWord (out, symbol.row);
+    putWord (out, symbol.col);
+  }
+
+  putWord (out, dependencies.size ());
+  for (const ModuleDependency& dependency : dependencies)
+  {
+    putString (out, dependency.module);
+    putWord (out, dependency.symbols.size ());
+    for (const std::string& name : dependency.symbols)
+      putString (out, name);
+    putLong (out, dependency.symbolsHash);
+  }
+
+  FILE* file = fopen (path.c_str (), "wb");
+  if (file == nullptr)
+    return false;
+  bool ok = fwrite (out.data (), 1, out.size (), file) == out.size ();
+  return fclose (file) == 0 && ok;
+}
+
+bool
+ModuleInterface::read (const std::string& path)
+{
+  FILE* file = fopen (path.c_str (), "rb");
+  if (file == nullptr)
+    return false;
+  std::string in;
+  char buffer[4096];
+  size_t count;
+  while ((count = fread (buffer, 1, sizeof (buffer), file)) > 0)
+    in.append (buffer, count);
+  fclose (file);
+
+  if (in.compare (0, 4, INTERFACE_MAGIC) != 0)
+    return false;
+  size_t offset = 4;
+  uint32_t exportCount, dependencyCount;
+  if (!getLong (in, offset, sourceHash) || !getLong (in, offset, interfaceHash)
+      || !getString (in, offset, module) || !getWord (in, offset, exportCount))
+    return false;
+
+  exports.assign (exportCount < in.size () ? exportCount : 0, ExportedSymbol ());
+  if (exports.size () != exportCount)
+    return false;
+  for (ExportedSymbol& symbol : exports)
+  {
+    uint32_t row, col;
+    if (!getSignature (in, offset, symbol) || !getWord (in, offset, row) || !getWord (in, offset, col))
+      return false;
+    symbol.row = (int) row;
+    symbol.col = (int) col;
+  }
+
+  if (!getWord (in, offset, dependencyCount))
+    return false;
+  dependencies.clear ();
+  for (uint32_t n = 0; n < dependencyCount; ++n)
+  {
+    ModuleDependency dependency;
+    uint32_t symbolCount;
+    if (!getString (in, offset, dependency.module) || !getWord (in, offset, symbolCount))
+      return false;
+    for (uint32_t s = 0; s < symbolCount; ++s)
+    {
+      std::string name;
+      if (!getString (in, offset, name))
+        return false;
+      dependency.symbols.push_back (name);
+    }
+    if (!getLong (in, offset, dependency.symbolsHash))
+      return false;
+    dependencies.push_back (dependency);
+  }
+  return offset == in.size ();
+}
@@ -0,0 +1,104 @@
+/*
+  Filename   : ModuleInterface.h
+  Author     : Philip Androwick
+  Description: Interface summary of a C- module: the signatures of its
+               global functions and the types of its global variables.
+               Summaries are stored next to the source in a compact binary
+               .cmi file, and importing modules declare them in their
+               global scope instead of parsing the exporting source.
+*/
+
+/***********************************************************************/
+
+#ifndef MODULE_INTERFACE_H
+#define MODULE_INTERFACE_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/CMinusAst.h"
+#include "../Parser/AstArena.h"
+
+/***********************************************************************/
+
+struct ExportedParameter
+{
+  ValueType type;
+  bool      isArray;
+};
+
+struct ExportedSymbol
+{
+  // FUNCTION, VARIABLE or ARRAY
+  DataType    dataType;
+  ValueType   valueType;
+  std::string identifier;
+  uint32_t    arraySize = 0;
+  std::vector<ExportedParameter> parameters;
+  int         row = 0;
+  int         col = 0;
+
+  // Builds the declaration an importing module puts in its global scope.
+  //   Functions get their parameters but no body.
+  DeclarationNode*
+  declare (AstArena& arena) const;
+
+  // The signature of a global declaration
+  static ExportedSymbol
+  describe (DeclarationNode* declaration);
+};
+
+// Symbols one module used from another, and a hash of their signatures
+//   at the time it was compiled
+struct ModuleDependency
+{
+  std::string              module;
+  std::vector<std::string> symbols;
+  uint64_t                 symbolsHash = 0;
+};
+
+struct ModuleInterface
+{
+  std::string                   module;
+  uint64_t                      sourceHash = 0;
+  uint64_t                      interfaceHash = 0;
+  std::vector<ExportedSymbol>   exports;
+  std::vector<ModuleDependency> dependencies;
+
+  // Fills in exports and interfaceHash from the global declarations
+  void
+  extract (ProgramNode* program);
+
+  // Hash of the signatures of the named exports; a name that is not
+  //   exported changes the hash
+  uint64_t
+  hashSymbols (const std::vector<std::string>& names) const;
+
+  const ExportedSymbol*
+  find (const std::string& identifier) const;
+
+  // Return false if the file could not be written, or could not be read
+  //   as an interface summary
+  bool
+  write (const std::string& path) const;
+
+  bool
+  read (const std::string& path);
+};
+
+/***********************************************************************/
+
+// 64-bit FNV-1a hash, used for sources and interfaces
+uint64_t
+hashBytes (const char* data, size_t length, uint64_t hash = 14695981039346656037ull);
+
+/***********************************************************************/
+
+#endif
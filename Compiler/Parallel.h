@@ -0,0 +1,54 @@
+/*
+  Filename   : Parallel.h
+  Author     : Philip Androwick
+  Description: Runs independent pieces of work on several threads.
+*/
+
+/***********************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/***********************************************************************/
+// System includes
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/***********************************************************************/
+
+// Calls body (index, worker) for every index in [0, count) using up to
+//   jobs threads.  worker identifies the calling thread, in [0, jobs),
+//   so that per-thread state can be kept in an array.
+inline void
+parallelFor (size_t count, unsigned jobs,
+             const std::function<void (size_t index, unsigned worker)>& body)
+{
+  if (jobs == 0)
+    jobs = 1;
+  if (jobs > count)
+    jobs = (unsigned) count;
+
+  if (jobs <= 1)
+  {
+    for (size_t index = 0; index < count; ++index)
+      body (index, 0);
+    return;
+  }
+
+  std::atomic<size_t> next (0);
+  std::vector<std::thread> threads;
+  for (unsigned worker = 0; worker < jobs; ++worker)
+    threads.emplace_back ([&, worker] {
+      for (size_t index = next++; index < count; index = next++)
+        body (index, worker);
+    });
+  for (std::thread& thread : threads)
+    thread.join ();
+}
+
+/***********************************************************************/
+
+#endif
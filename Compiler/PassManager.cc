@@ -0,0 +1,111 @@
+/*
+  Filename   : PassManager.cc
+  Author     : Philip Androwick
+  Description: Scheduling of passes and caching of analyses.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <chrono>
+
+/***********************************************************************/
+// Local includes
+
+#include "PassManager.h"
+
+/***********************************************************************/
+
+void
+PassManager::add (std::unique_ptr<Pass> pass)
+{
+  std::string name = pass->getName ();
+  if (m_passes.count (name) != 0)
+    throw std::logic_error ("pass \"" + name + "\" added twice");
+
+  // Non-analysis dependencies must already be in the pipeline
+  for (const std::string& dependency : pass->getDependencies ())
+  {
+    auto entry = m_passes.find (dependency);
+    if (entry == m_passes.end ())
+      throw std::logic_error ("pass \"" + name + "\" depends on unknown pass \"" + dependency + "\"");
+  }
+
+  if (!pass->isAnalysis ())
+    m_pipeline.push_back (pass.get ());
+  m_passes[name] = std::move (pass);
+}
+
+/***********************************************************************/
+
+std::vector<std::string>
+PassManager::getPipeline () const
+{
+  std::vector<std::string> names;
+  for (Pass* pass : m_pipeline)
+    names.push_back (pass->getName ());
+  return names;
+}
+
+/***********************************************************************/
+
+bool
+PassManager::run (const std::string& stopAfter)
+{
+  if (!stopAfter.empty () && !hasPass (stopAfter))
+    return false;
+
+  // Stopping after an analysis runs just it and what it needs
+  if (!stopAfter.empty () && m_passes.at (stopAfter)->isAnalysis ())
+  {
+    require (stopAfter);
+    return true;
+  }
+
+  for (Pass* pass : m_pipeline)
+  {
+    for (const std::string& dependency : pass->getDependencies ())
+    {
+      if (m_passes.at (dependency)->isAnalysis ())
+        require (dependency);
+      else if (m_finished.count (dependency) == 0)
+        throw std::logic_error (std::string ("pass \"") + pass->getName ()
+                                + "\" runs before \"" + dependency + "\"");
+    }
+
+    runPass (*pass);
+    m_finished.insert (pass->getName ());
+    if (stopAfter == pass->getName ())
+      break;
+  }
+  return true;
+}
+
+/***********************************************************************/
+
+void
+PassManager::require (const std::string& name)
+{
+  if (m_valid.count (name) != 0)
+    return;
+
+  Pass& analysis = *m_passes.at (name);
+  for (const std::string& dependency : analysis.getDependencies ())
+    require (dependency);
+  runPass (analysis);
+  m_valid.insert (name);
+}
+
+/***********************************************************************/
+
+void
+PassManager::runPass (Pass& pass)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  bool changed = pass.run (*this);
+  double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  m_timings.push_back ({ pass.getName (), seconds });
+
+  if (changed)
+    invalidate ();
+}
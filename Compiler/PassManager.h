@@ -0,0 +1,189 @@
+/*
+  Filename   : PassManager.h
+  Author     : Philip Androwick
+  Description: Runs the passes of a compilation over a parsed tree.  Each
+               pass names the passes it depends on.  Analyses are run when
+               something first needs them and their results are kept
+               until a transform changes the tree; the other passes run in
+               the order they were added, optionally stopping after a
+               named one.
+*/
+
+/***********************************************************************/
+
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+/***********************************************************************/
+// System includes
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+#include "../SemanticAnalyzer/SymbolTable.h"
+
+/***********************************************************************/
+
+struct CompileOptions;
+struct CompileResult;
+struct IrModule;
+class NameSupply;
+class PassManager;
+
+// What the passes of one compilation share
+struct PassContext
+{
+  ProgramNode*          program = nullptr;
+  SymbolTable*          table = nullptr;
+  AstArena*             arena = nullptr;
+  const CompileOptions* options = nullptr;
+  CompileResult*        result = nullptr;
+
+  // Where the tree is lowered to, when the compilation emits IR
+  IrModule*             ir = nullptr;
+
+  // Where the optimization passes get the names of the declarations
+  //   they make, so that no two passes make the same one
+  NameSupply*           names = nullptr;
+
+  // Declarations of imported symbols, put in the global scope ahead of
+  //   the tree's own
+  std::vector<DeclarationNode*> imports;
+};
+
+/***********************************************************************/
+
+class Pass
+{
+public:
+  virtual ~Pass ()
+  { }
+
+  virtual const char*
+  getName () const = 0;
+
+  // Passes that must have run first.  An analysis is run if needed; any
+  //   other pass must come earlier in the pipeline.
+  virtual std::vector<std::string>
+  getDependencies () const
+  {
+    return { };
+  }
+
+  // Analyses only compute facts about the tree, and are cached
+  virtual bool
+  isAnalysis () const
+  {
+    return false;
+  }
+
+  // Returns true if the pass changed the tree.  Errors are raised as
+  //   CompileError.
+  virtual bool
+  run (PassManager& manager) = 0;
+};
+
+/***********************************************************************/
+
+// Time spent in one run of a pass
+struct PassTiming
+{
+  std::string name;
+  double      seconds;
+};
+
+/***********************************************************************/
+
+class PassManager
+{
+public:
+  explicit PassManager (PassContext& context)
+    : m_context (context)
+  { }
+
+  // Registers pass.  Analyses run on demand; other passes join the end
+  //   of the pipeline.
+  void
+  add (std::unique_ptr<Pass> pass);
+
+  bool
+  hasPass (const std::string& name) const
+  {
+    return m_passes.count (name) != 0;
+  }
+
+  // Names of the pipeline's passes, in order
+  std::vector<std::string>
+  getPipeline () const;
+
+  // Runs the pipeline, through stopAfter if it is not empty; stopping
+  //   after an analysis runs only it and its dependencies.  Returns
+  //   false, running nothing, if there is no such pass.
+  bool
+  run (const std::string& stopAfter = "");
+
+  // Makes sure the analysis name is up to date and returns it
+  template<typename T>
+  T&
+  getAnalysis (const std::string& name)
+  {
+    require (name);
+    return dynamic_cast<T&> (*m_passes.at (name));
+  }
+
+  void
+  require (const std::string& name);
+
+  // Forgets every cached analysis; the tree has changed
+  void
+  invalidate ()
+  {
+    m_valid.clear ();
+  }
+
+  bool
+  isValid (const std::string& name) const
+  {
+    return m_valid.count (name) != 0;
+  }
+
+  PassContext&
+  getContext ()
+  {
+    return m_context;
+  }
+
+  const std::vector<PassTiming>&
+  getTimings () const
+  {
+    return m_timings;
+  }
+
+private:
+  void
+  runPass (Pass& pass);
+
+  PassContext& m_context;
+  std::unordered_map<std::string, std::unique_ptr<Pass>> m_passes;
+  std::vector<Pass*> m_pipeline;
+
+  // Analyses whose results are current, and pipeline passes that ran
+  std::unordered_set<std::string> m_valid;
+  std::unordered_set<std::string> m_finished;
+
+  std::vector<PassTiming> m_timings;
+};
+
+/***********************************************************************/
+
+#endif
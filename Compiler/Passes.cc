@@ -0,0 +1,280 @@
+/*
+  Filename   : Passes.cc
+  Author     : Philip Androwick
+  Description: The standard passes.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstdlib>
+#include <stdexcept>
+
+/***********************************************************************/
+// Local includes
+
+#include "Passes.h"
+#include "AstWriter.h"
+#include "CompilerContext.h"
+#include "../IR/IR.h"
+#include "../IR/Lowering.h"
+#include "../IR/SSA.h"
+#include "../Optimizer/CommonSubexpressions.h"
+#include "../Optimizer/ConstantFolding.h"
+#include "../Optimizer/DeadCode.h"
+#include "../Optimizer/Inliner.h"
+#include "../Optimizer/LoopInvariants.h"
+#include "../Optimizer/LoopUnroller.h"
+#include "../Optimizer/StrengthReduction.h"
+#include "../Codegen/CodeGenerator.h"
+#include "../Codegen/CSource.h"
+#include "../Codegen/GasAssembler.h"
+#include "../Codegen/LlvmSource.h"
+#include "../Codegen/Runtime.h"
+#include "../Parser/Parser.h"
+#include "../SemanticAnalyzer/SymbolTableVisitor.h"
+#include "../SemanticAnalyzer/SemanticAnalysisVisitor.h"
+
+/***********************************************************************/
+
+bool
+ResolvePass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+
+  // Imported declarations go in the global scope ahead of the tree's
+  context.table->reset (context.program);
+  for (DeclarationNode* declaration : context.imports)
+    context.table->insert (declaration);
+
+  // Create Symbol Table and Check for
+  // Undeclared/Multiply declared variables
+  SymbolTableVisitor visitor (context.table);
+  visitor.walk (context.program);
+  context.table->exitScope ();
+  return false;
+}
+
+/***********************************************************************/
+
+bool
+CheckPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  SemanticAnalysisVisitor semanticVisitor (context.table);
+  semanticVisitor.requireMain = context.options->requireMain;
+  semanticVisitor.walk (context.program);
+  return false;
+}
+
+/***********************************************************************/
+
+bool
+InlinePass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  InlineStats stats = inlineCalls (context.program, *context.arena, *context.names, context.options->inlineBudget);
+  std::string inlined;
+  size_t calls = 0;
+  for (const std::pair<const std::string, size_t>& function : stats.calls)
+  {
+    inlined += (inlined.empty () ? " (" : ", ") + function.first + " " + std::to_string (function.second);
+    calls += function.second;
+  }
+  if (!inlined.empty ())
+    inlined += ")";
+  context.result->optimizations.emplace_back (getName (),
+    "inlined " + std::to_string (calls) + " calls" + inlined + ", adding " + std::to_string (stats.addedNodes)
+    + " nodes");
+  return calls > 0;
+}
+
+/***********************************************************************/
+
+bool
+FoldPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  FoldStats stats = foldConstants (context.program, *context.arena);
+  context.result->optimizations.emplace_back (getName (),
+    "folded " + std::to_string (stats.folded) + " operators, propagated " + std::to_string (stats.propagated)
+    + " constants, removed " + std::to_string (stats.removedNodes) + " nodes"
+    + (stats.zeroDivisions > 0 ? "; left " + std::to_string (stats.zeroDivisions) + " divisions by 0" : ""));
+  return stats.folded + stats.propagated > 0;
+}
+
+/***********************************************************************/
+
+bool
+UnrollPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  UnrollStats stats = unrollLoops (context.program, *context.arena, *context.names, context.options->unrollFactor);
+  std::string report = "fully unrolled " + std::to_string (stats.full) + " loops, unrolled "
+    + std::to_string (stats.partial) + " by " + std::to_string (context.options->unrollFactor) + ", "
+    + (stats.addedNodes < 0 ? "removing " : "adding ") + std::to_string (std::abs (stats.addedNodes)) + " nodes";
+  if (stats.full > 0)
+  {
+    FoldStats folded = foldConstants (context.program, *context.arena);
+    report += ", then folded " + std::to_string (folded.folded) + " operators and propagated "
+      + std::to_string (folded.propagated) + " constants";
+  }
+  context.result->optimizations.emplace_back (getName (), report);
+  return stats.full + stats.partial > 0;
+}
+
+/***********************************************************************/
+
+bool
+LoopInvariantPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  LoopInvariantStats stats = hoistLoopInvariants (context.program, *context.arena, *context.names);
+  context.result->optimizations.emplace_back (getName (),
+    "hoisted " + std::to_string (stats.hoisted) + " expressions out of " + std::to_string (stats.loops) + " loops");
+  return stats.hoisted > 0;
+}
+
+/***********************************************************************/
+
+bool
+StrengthPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  StrengthStats stats = reduceStrength (context.program, *context.arena, *context.names);
+  context.result->optimizations.emplace_back (getName (),
+    "reduced " + std::to_string (stats.products) + " products to " + std::to_string (stats.locals)
+    + " additive locals in " + std::to_string (stats.loops) + " loops");
+  return stats.products > 0;
+}
+
+/***********************************************************************/
+
+bool
+CommonSubexpressionPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  CommonSubexpressionStats stats = eliminateCommonSubexpressions (context.program, *context.arena, *context.names);
+  context.result->optimizations.emplace_back (getName (),
+    "eliminated " + std::to_string (stats.evaluations) + " evaluations: " + std::to_string (stats.repeats)
+    + " repeated expressions became reads, through " + std::to_string (stats.temporaries) + " new locals");
+  return stats.repeats > 0;
+}
+
+/***********************************************************************/
+
+bool
+DeadCodePass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  // Only the last module of a program has main, and only its own code
+  // is known not to be used elsewhere
+  DeadCodeStats stats = eliminateDeadCode (context.program, *context.arena, *context.names,
+                                            context.options->requireMain);
+  context.result->optimizations.emplace_back (getName (),
+    "removed " + std::to_string (stats.statements) + " statements, " + std::to_string (stats.locals)
+    + " locals and " + std::to_string (stats.assignments) + " assignments to them, "
+    + std::to_string (stats.globals) + " unreached functions and globals; " + std::to_string (stats.removedNodes)
+    + " nodes");
+  return stats.removedNodes > 0;
+}
+
+/***********************************************************************/
+
+namespace
+{
+  // The IR passes take a checked tree, so a malformed result is a bug in
+  // them, not in the source
+  void
+  verifyAfter (const char* pass, const IrModule& module)
+  {
+    std::string error;
+    if (!verifyIr (module, error))
+      throw std::logic_error (std::string ("IR verification failed after ") + pass + ": " + error);
+  }
+}
+
+/***********************************************************************/
+
+bool
+LowerPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  lowerProgram (context.program, *context.ir);
+  verifyAfter (getName (), *context.ir);
+  context.result->ir = context.ir;
+  return false;
+}
+
+/***********************************************************************/
+
+bool
+SsaPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  buildSsa (*context.ir);
+  verifyAfter (getName (), *context.ir);
+  return false;
+}
+
+/***********************************************************************/
+
+bool
+PrintPass::run (PassManager& manager)
+{
+  PassContext& context = manager.getContext ();
+  if (context.options->emit == EmitKind::IR)
+    context.result->code = printIr (*context.ir);
+  else if (context.options->emit == EmitKind::ASM)
+  {
+    GasAssembler assembler;
+    if (context.options->stackCode)
+      generateStackCode (context.program, assembler);
+    else
+      generateCode (*context.ir, assembler);
+    context.result->code = assembler.finish () + getRuntimeAssembly ();
+  }
+  else if (context.options->emit == EmitKind::C)
+    context.result->code = generateCSource (context.program);
+  else if (context.options->emit == EmitKind::LLVM)
+    context.result->code = generateLlvmSource (context.program);
+  else if (context.options->printJobs > 1)
+    renderAst (context.program, context.options->printJobs, context.result->astChunks);
+  else
+    context.result->ast = Parser::getAST (context.program);
+  return false;
+}
+
+/***********************************************************************/
+
+void
+addStandardPasses (PassManager& manager)
+{
+  manager.add (std::unique_ptr<Pass> (new ResolvePass ()));
+  manager.add (std::unique_ptr<Pass> (new CheckPass ()));
+  const CompileOptions& options = *manager.getContext ().options;
+  if (options.optimize > 0)
+  {
+    manager.add (std::unique_ptr<Pass> (new InlinePass ()));
+    manager.add (std::unique_ptr<Pass> (new FoldPass ()));
+    manager.add (std::unique_ptr<Pass> (new UnrollPass ()));
+    manager.add (std::unique_ptr<Pass> (new LoopInvariantPass ()));
+    manager.add (std::unique_ptr<Pass> (new StrengthPass ()));
+    manager.add (std::unique_ptr<Pass> (new CommonSubexpressionPass ()));
+    manager.add (std::unique_ptr<Pass> (new DeadCodePass ()));
+  }
+  if (options.emit == EmitKind::IR || (options.emit == EmitKind::ASM && !options.stackCode))
+  {
+    manager.add (std::unique_ptr<Pass> (new LowerPass ()));
+    manager.add (std::unique_ptr<Pass> (new SsaPass ()));
+  }
+  manager.add (std::unique_ptr<Pass> (new PrintPass ()));
+}
+
+/***********************************************************************/
+
+const char*
+getLastTreePass (const CompileOptions& options)
+{
+  return options.optimize > 0 ? "dce" : "check";
+}
@@ -0,0 +1,316 @@
+/*
+  Filename   : Passes.h
+  Author     : Philip Androwick
+  Description: The passes a compilation runs after parsing.  "resolve"
+               is an analysis; "check" and "print" make up the pipeline,
+               with "lower" and "ssa" between them when the compilation
+               emits IR or assembly from it.  Optimizing adds "inline",
+               "fold", "unroll", "licm", "strength", "cse" and "dce"
+               after "check".
+*/
+
+/***********************************************************************/
+
+#ifndef PASSES_H
+#define PASSES_H
+
+/***********************************************************************/
+// System includes
+
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "PassManager.h"
+
+/***********************************************************************/
+
+// Builds the symbol table over the tree and links every use of a name
+//   to its declaration (phase 1 of semantic analysis)
+class ResolvePass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "resolve";
+  }
+
+  bool
+  isAnalysis () const override
+  {
+    return true;
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+/***********************************************************************/
+
+// Type checks the resolved tree (phase 2 of semantic analysis)
+class CheckPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "check";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "resolve" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Inlines calls to small functions in the checked tree (see
+//   Optimizer/Inliner.h)
+class InlinePass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "inline";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Folds and propagates constants in the checked tree (see
+//   Optimizer/ConstantFolding.h)
+class FoldPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "fold";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Unrolls counted while loops in the checked tree (see
+//   Optimizer/LoopUnroller.h), and folds again after unrolling any
+//   loop fully, since the copies' counters may then be constants
+class UnrollPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "unroll";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Hoists loop-invariant expressions out of while loops in the checked
+//   tree (see Optimizer/LoopInvariants.h)
+class LoopInvariantPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "licm";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Reduces products of induction variables in the checked tree to
+//   additions (see Optimizer/StrengthReduction.h)
+class StrengthPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "strength";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Replaces repeated expressions in the checked tree with reads of the
+//   values computed first (see Optimizer/CommonSubexpressions.h)
+class CommonSubexpressionPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "cse";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Removes dead code from the checked tree (see Optimizer/DeadCode.h)
+class DeadCodePass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "dce";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Lowers the checked tree to IR (see IR/Lowering.h)
+class LowerPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "lower";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Puts the lowered IR in SSA form (see IR/SSA.h)
+class SsaPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "ssa";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "lower" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Writes the text of the .ast file, of the IR, of the assembly or of the
+//   C into the result
+class PrintPass : public Pass
+{
+public:
+  const char*
+  getName () const override
+  {
+    return "print";
+  }
+
+  std::vector<std::string>
+  getDependencies () const override
+  {
+    return { "check" };
+  }
+
+  bool
+  run (PassManager& manager) override;
+};
+
+/***********************************************************************/
+
+// Adds the standard passes for what the compilation emits to manager
+void
+addStandardPasses (PassManager& manager);
+
+// The last of the standard passes that change or check the tree, for
+//   compilations that take the tree when it is done
+const char*
+getLastTreePass (const CompileOptions& options);
+
+/***********************************************************************/
+
+#endif
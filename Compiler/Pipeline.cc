@@ -0,0 +1,257 @@
+/*
+  Filename   : Pipeline.cc
+  Author     : Philip Androwick
+  Description: Pipelined compilation.  The lexer thread feeds token batches
+               to the parser thread, which hands each top-level declaration
+               to the analysis thread (the caller's) as soon as it is
+               parsed.  Errors are reported exactly as a serial compile
+               would report them.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <chrono>
+#include <thread>
+
+/***********************************************************************/
+// Local includes
+
+#include "CompilerContext.h"
+#include "Pipeline.h"
+#include "../Parser/Parser.h"
+#include "../SemanticAnalyzer/SymbolTableVisitor.h"
+#include "../SemanticAnalyzer/SemanticAnalysisVisitor.h"
+
+/***********************************************************************/
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double
+  secondsSince (Clock::time_point start)
+  {
+    return std::chrono::duration<double> (Clock::now () - start).count ();
+  }
+
+  // Token feed for the parser thread, backed by the lexer's queue
+  class RingFeed : public TokenFeed
+  {
+  public:
+    explicit RingFeed (SpscRing<std::vector<Token>>& ring)
+      : m_ring (ring)
+    { }
+
+    virtual bool
+    next (std::vector<Token>& batch)
+    {
+      return m_ring.pop (batch);
+    }
+
+  private:
+    SpscRing<std::vector<Token>>& m_ring;
+  };
+}
+
+/***********************************************************************/
+
+CompileResult
+CompilerContext::compilePipelined (const char* source, size_t length,
+                                   const CompileOptions& options,
+                                   PipelineStats* stats)
+{
+  // Nothing to overlap with parsing
+  if (options.parseOnly)
+    return compile (source, length, options);
+
+  reset ();
+  Clock::time_point start = Clock::now ();
+
+  // Imported declarations go in the global scope first.  They are made
+  //   before the parser thread starts using the arena.
+  m_table.reset (nullptr);
+  ImportMap imported;
+  bool resolveFailed = false;
+  Diagnostic resolveError;
+  try
+  {
+    declareImports (options, imported);
+  }
+  catch (const CompileError& error)
+  {
+    resolveFailed = true;
+    resolveError = error.diagnostic;
+  }
+
+  SpscRing<std::vector<Token>> tokenRing (PIPELINE_TOKEN_QUEUE);
+  SpscRing<DeclarationNode*> declarationRing (PIPELINE_DECLARATION_QUEUE);
+  size_t tokenCount = 0;
+  double lexSeconds = 0.0;
+  double parseSeconds = 0.0;
+
+  // Lexer thread
+  std::thread lexerThread ([&] ()
+  {
+    Clock::time_point lexStart = Clock::now ();
+    Lexer lexer (source, source + length);
+    std::vector<Token> batch;
+    batch.reserve (PIPELINE_TOKEN_BATCH);
+    Token token;
+    do
+    {
+      token = lexer.getToken ();
+      batch.push_back (token);
+      ++tokenCount;
+      if (batch.size () == PIPELINE_TOKEN_BATCH || token.type == END_OF_FILE)
+      {
+        // The parser gave up on an error
+        if (!tokenRing.push (std::move (batch)))
+          break;
+        batch = std::vector<Token> ();
+        batch.reserve (PIPELINE_TOKEN_BATCH);
+      }
+    } while (token.type != END_OF_FILE);
+    tokenRing.close ();
+    lexSeconds = secondsSince (lexStart);
+  });
+
+  // Parser thread.  Only this thread allocates from the arena until it
+  //   has been joined.
+  bool parseFailed = false;
+  Diagnostic parseError;
+  std::thread parserThread ([&] ()
+  {
+    Clock::time_point parseStart = Clock::now ();
+    RingFeed feed (tokenRing);
+    Parser par (&feed, &m_arena);
+    try
+    {
+      while (DeclarationNode* declaration = par.nextDeclaration ())
+        declarationRing.push (std::move (declaration));
+    }
+    catch (const CompileError& error)
+    {
+      parseFailed = true;
+      parseError = error.diagnostic;
+      tokenRing.abandon ();
+    }
+    declarationRing.close ();
+    parseSeconds = secondsSince (parseStart);
+  });
+
+  // Analysis, on this thread.  A serial compile resolves every name
+  //   before checking anything, so a resolution error takes priority
+  //   over a check error in an earlier declaration: keep resolving after
+  //   a check fails.
+  Clock::time_point analyzeStart = Clock::now ();
+  bool checkFailed = false;
+  Diagnostic checkError;
+
+  SymbolTableVisitor visitor (&m_table);
+  SemanticAnalysisVisitor semanticVisitor (&m_table);
+  semanticVisitor.requireMain = options.requireMain;
+  std::vector<DeclarationNode*> declarations;
+  std::string ast = "ProgramNode:\n\n";
+
+  DeclarationNode* declaration;
+  while (declarationRing.pop (declaration))
+  {
+    declarations.push_back (declaration);
+    if (resolveFailed)
+      continue;
+    try
+    {
+      visitor.walk (declaration);
+    }
+    catch (const CompileError& error)
+    {
+      resolveFailed = true;
+      resolveError = error.diagnostic;
+      continue;
+    }
+
+    if (checkFailed)
+      continue;
+    try
+    {
+      semanticVisitor.walk (declaration);
+      ast += Parser::getAST (declaration);
+    }
+    catch (const CompileError& error)
+    {
+      checkFailed = true;
+      checkError = error.diagnostic;
+    }
+  }
+
+  if (!resolveFailed && !checkFailed)
+  {
+    try
+    {
+      semanticVisitor.finishProgram ();
+    }
+    catch (const CompileError& error)
+    {
+      checkFailed = true;
+      checkError = error.diagnostic;
+    }
+  }
+  double analyzeSeconds = secondsSince (analyzeStart);
+
+  parserThread.join ();
+  lexerThread.join ();
+
+  CompileResult result;
+  if (parseFailed)
+    result.diagnostics.push_back (parseError);
+  else if (resolveFailed)
+    result.diagnostics.push_back (resolveError);
+  else if (checkFailed)
+    result.diagnostics.push_back (checkError);
+  else
+  {
+    m_table.exitScope ();
+    ProgramNode* astTree = m_arena.make<ProgramNode> (declarations);
+    findUsedImports (astTree, imported, result);
+    result.ast = ast;
+    result.program = astTree;
+    result.success = true;
+  }
+
+  if (stats != nullptr)
+  {
+    stats->wallSeconds = secondsSince (start);
+    stats->lexSeconds = lexSeconds;
+    stats->parseSeconds = parseSeconds;
+    stats->analyzeSeconds = analyzeSeconds;
+    stats->tokens = tokenCount;
+    stats->declarations = declarations.size ();
+    stats->tokenQueue = tokenRing.getStats ();
+    stats->declarationQueue = declarationRing.getStats ();
+  }
+
+  return result;
+}
+
+/***********************************************************************/
+
+void
+PipelineStats::print (FILE* file) const
+{
+  fprintf (file, "Pipeline: %zu tokens, %zu declarations in %.3f ms\n",
+           tokens, declarations, wallSeconds * 1000.0);
+  fprintf (file, "  lexer    %10.3f ms\n", lexSeconds * 1000.0);
+  fprintf (file, "  parser   %10.3f ms\n", parseSeconds * 1000.0);
+  fprintf (file, "  analysis %10.3f ms\n", analyzeSeconds * 1000.0);
+
+  const char* names[] = { "token batches", "declarations" };
+  const QueueStats* queues[] = { &tokenQueue, &declarationQueue };
+  for (size_t n = 0; n < 2; ++n)
+    fprintf (file, "  %-14s queue: %llu pushed, occupancy %.1f average, %zu max of %zu;"
+             " %llu full waits, %llu empty waits\n",
+             names[n], (unsigned long long) queues[n]->pushes,
+             queues[n]->averageOccupancy (), queues[n]->maxOccupancy,
+             queues[n]->capacity, (unsigned long long) queues[n]->fullWaits,
+             (unsigned long long) queues[n]->emptyWaits);
+}
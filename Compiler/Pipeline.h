@@ -0,0 +1,59 @@
+/*
+  Filename   : Pipeline.h
+  Author     : Philip Androwick
+  Description: Statistics of a pipelined compilation
+               (CompilerContext::compilePipelined).  The lexer, parser and
+               analyzer each run on their own thread; tokens flow from the
+               lexer in batches and declarations flow from the parser one
+               at a time.
+*/
+
+/***********************************************************************/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+
+/***********************************************************************/
+// Local includes
+
+#include "SpscRing.h"
+
+/***********************************************************************/
+
+// Tokens handed from the lexer to the parser at a time
+const size_t PIPELINE_TOKEN_BATCH = 1024;
+
+// Capacity of the queue of token batches, and of parsed declarations
+const size_t PIPELINE_TOKEN_QUEUE = 64;
+const size_t PIPELINE_DECLARATION_QUEUE = 256;
+
+/***********************************************************************/
+
+struct PipelineStats
+{
+  // Wall-clock time of the whole compilation, and the time each stage's
+  //   thread ran (including its waits on the queues)
+  double wallSeconds = 0.0;
+  double lexSeconds = 0.0;
+  double parseSeconds = 0.0;
+  double analyzeSeconds = 0.0;
+
+  size_t tokens = 0;
+  size_t declarations = 0;
+
+  QueueStats tokenQueue;
+  QueueStats declarationQueue;
+
+  // Writes a readable report to file
+  void
+  print (FILE* file) const;
+};
+
+/***********************************************************************/
+
+#endif
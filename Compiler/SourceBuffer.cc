@@ -0,0 +1,75 @@
+/*
+  Filename   : SourceBuffer.cc
+  Author     : Philip Androwick
+  Description: Mapping and reading of source files.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/***********************************************************************/
+// Local includes
+
+#include "SourceBuffer.h"
+#include "CompilerContext.h"
+
+/***********************************************************************/
+
+bool
+SourceBuffer::open (const std::string& path)
+{
+  close ();
+  int fd = ::open (path.c_str (), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat (fd, &info) == 0 && S_ISREG (info.st_mode) && info.st_size > 0)
+  {
+    void* mapped = mmap (nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED)
+    {
+      // The lexer reads front to back
+      madvise (mapped, info.st_size, MADV_SEQUENTIAL);
+      m_mapped = (const char*) mapped;
+      m_mappedSize = info.st_size;
+      ::close (fd);
+      return true;
+    }
+  }
+
+  // Empty files and pipes cannot be mapped
+  FILE* file = fdopen (fd, "r");
+  bool ok = read (file, false);
+  if (file != nullptr)
+    fclose (file);
+  else
+    ::close (fd);
+  return ok;
+}
+
+/***********************************************************************/
+
+bool
+SourceBuffer::read (FILE* file, bool stopAtDollar)
+{
+  close ();
+  return readSource (file, m_text, stopAtDollar);
+}
+
+/***********************************************************************/
+
+void
+SourceBuffer::close ()
+{
+  if (m_mapped != nullptr)
+    munmap ((void*) m_mapped, m_mappedSize);
+  m_mapped = nullptr;
+  m_mappedSize = 0;
+  m_text.clear ();
+}
@@ -0,0 +1,68 @@
+/*
+  Filename   : SourceBuffer.h
+  Author     : Philip Androwick
+  Description: Source text of a compilation.  Regular files are mapped into
+               memory, so pages are read in as the lexer reaches them rather
+               than copied up front; other input is read into a string.
+*/
+
+/***********************************************************************/
+
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+#include <string>
+
+/***********************************************************************/
+
+class SourceBuffer
+{
+public:
+  SourceBuffer ()
+    : m_mapped (nullptr), m_mappedSize (0)
+  { }
+
+  ~SourceBuffer ()
+  {
+    close ();
+  }
+
+  SourceBuffer (const SourceBuffer&) = delete;
+  SourceBuffer& operator= (const SourceBuffer&) = delete;
+
+  // Maps the named file.  Returns false if it could not be read.
+  bool
+  open (const std::string& path);
+
+  // Reads all of file; see readSource for stopAtDollar
+  bool
+  read (FILE* file, bool stopAtDollar);
+
+  void
+  close ();
+
+  const char*
+  data () const
+  {
+    return m_mapped != nullptr ? m_mapped : m_text.data ();
+  }
+
+  size_t
+  size () const
+  {
+    return m_mapped != nullptr ? m_mappedSize : m_text.size ();
+  }
+
+private:
+  const char* m_mapped;
+  size_t      m_mappedSize;
+  std::string m_text;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,154 @@
+/*
+  Filename   : SpscRing.h
+  Author     : Philip Androwick
+  Description: Lock-free ring buffer connecting one producer thread to one
+               consumer thread, used between the stages of the pipelined
+               compiler.  Both ends wait by yielding instead of blocking on
+               a lock.
+*/
+
+/***********************************************************************/
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+/***********************************************************************/
+// System includes
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+
+// How full a ring was over its life, sampled at every push
+struct QueueStats
+{
+  uint64_t pushes = 0;
+  uint64_t occupancyTotal = 0;
+  size_t   maxOccupancy = 0;
+  size_t   capacity = 0;
+  // Times the producer found the ring full, or the consumer found it empty
+  uint64_t fullWaits = 0;
+  uint64_t emptyWaits = 0;
+
+  double
+  averageOccupancy () const
+  {
+    return pushes > 0 ? (double) occupancyTotal / pushes : 0.0;
+  }
+};
+
+/***********************************************************************/
+
+template<typename T>
+class SpscRing
+{
+public:
+  // capacity is rounded up to a power of two
+  explicit SpscRing (size_t capacity)
+    : m_head (0), m_tail (0), m_closed (false), m_abandoned (false)
+  {
+    size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    m_slots.resize (size);
+    m_mask = size - 1;
+    m_stats.capacity = size;
+  }
+
+  // Producer: adds item, waiting while the ring is full.  Returns false,
+  //   dropping item, once the consumer has abandoned the ring.
+  bool
+  push (T&& item)
+  {
+    size_t tail = m_tail.load (std::memory_order_relaxed);
+    bool waited = false;
+    while (tail - m_head.load (std::memory_order_acquire) > m_mask)
+    {
+      if (m_abandoned.load (std::memory_order_acquire))
+        return false;
+      waited = true;
+      std::this_thread::yield ();
+    }
+    if (waited)
+      ++m_stats.fullWaits;
+
+    m_slots[tail & m_mask] = std::move (item);
+    m_tail.store (tail + 1, std::memory_order_release);
+
+    size_t occupancy = tail + 1 - m_head.load (std::memory_order_relaxed);
+    ++m_stats.pushes;
+    m_stats.occupancyTotal += occupancy;
+    if (occupancy > m_stats.maxOccupancy)
+      m_stats.maxOccupancy = occupancy;
+    return true;
+  }
+
+  // Producer: there will be no more items
+  void
+  close ()
+  {
+    m_closed.store (true, std::memory_order_release);
+  }
+
+  // Consumer: takes the oldest item, waiting while the ring is empty.
+  //   Returns false once the ring is closed and drained.
+  bool
+  pop (T& item)
+  {
+    size_t head = m_head.load (std::memory_order_relaxed);
+    bool waited = false;
+    while (head == m_tail.load (std::memory_order_acquire))
+    {
+      if (m_closed.load (std::memory_order_acquire)
+          && head == m_tail.load (std::memory_order_acquire))
+        return false;
+      waited = true;
+      std::this_thread::yield ();
+    }
+    if (waited)
+      ++m_emptyWaits;
+
+    item = std::move (m_slots[head & m_mask]);
+    m_head.store (head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: stop the producer; later pushes are dropped
+  void
+  abandon ()
+  {
+    m_abandoned.store (true, std::memory_order_release);
+  }
+
+  // Only meaningful once both threads are done with the ring
+  QueueStats
+  getStats () const
+  {
+    QueueStats stats = m_stats;
+    stats.emptyWaits = m_emptyWaits;
+    return stats;
+  }
+
+private:
+  std::vector<T> m_slots;
+  size_t         m_mask;
+
+  // Each index is written by one side only; keep them on separate lines
+  alignas (64) std::atomic<size_t> m_head;
+  alignas (64) std::atomic<size_t> m_tail;
+  std::atomic<bool> m_closed;
+  std::atomic<bool> m_abandoned;
+
+  // Producer-side and consumer-side counters
+  QueueStats m_stats;
+  alignas (64) uint64_t m_emptyWaits = 0;
+};
+
+/***********************************************************************/
+
+#endif
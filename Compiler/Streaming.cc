@@ -0,0 +1,169 @@
+/*
+  Filename   : Streaming.cc
+  Author     : Philip Androwick
+  Description: Streaming compilation.  Top-level declarations are parsed
+               one at a time into a scratch arena, checked, written out
+               and freed.  Only a signature of each global declaration,
+               built the way module imports are, stays in the global
+               scope, so memory use follows the largest function rather
+               than the whole program.
+*/
+
+/***********************************************************************/
+// Local includes
+
+#include "CompilerContext.h"
+#include "Streaming.h"
+#include "../Parser/Parser.h"
+#include "../SemanticAnalyzer/SymbolTableVisitor.h"
+#include "../SemanticAnalyzer/SemanticAnalysisVisitor.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // Lexes tokens as the parser asks for them
+  class LexerFeed : public TokenFeed
+  {
+  public:
+    explicit LexerFeed (Lexer& lexer)
+      : m_lexer (lexer), m_done (false)
+    { }
+
+    virtual bool
+    next (std::vector<Token>& batch)
+    {
+      batch.clear ();
+      while (!m_done && batch.size () < STREAM_TOKEN_BATCH)
+      {
+        batch.push_back (m_lexer.getToken ());
+        m_done = batch.back ().type == END_OF_FILE;
+      }
+      return !batch.empty ();
+    }
+
+  private:
+    Lexer& m_lexer;
+    bool   m_done;
+  };
+}
+
+/***********************************************************************/
+
+CompileResult
+CompilerContext::compileStreaming (const char* source, size_t length, FILE* astFile,
+                                   const CompileOptions& options, StreamStats* stats)
+{
+  reset ();
+  m_scratchArena.reset ();
+  StreamStats streamStats;
+
+  // Signatures and imports live in m_arena; trees in m_scratchArena
+  m_table.reset (nullptr);
+  ImportMap imported;
+  bool resolveFailed = false;
+  Diagnostic resolveError;
+  try
+  {
+    declareImports (options, imported);
+  }
+  catch (const CompileError& error)
+  {
+    resolveFailed = true;
+    resolveError = error.diagnostic;
+  }
+
+  m_lexer.reset (source, source + length);
+  LexerFeed feed (m_lexer);
+  Parser par (&feed, &m_scratchArena);
+  SymbolTableVisitor visitor (&m_table);
+  SemanticAnalysisVisitor semanticVisitor (&m_table);
+  semanticVisitor.requireMain = options.requireMain;
+  bool checkFailed = false;
+  Diagnostic checkError;
+
+  fputs ("ProgramNode:\n\n", astFile);
+
+  // Errors are reported in the order a serial compile reports them:
+  //   keep parsing after a semantic error in case a syntax error
+  //   follows, and keep resolving after a check fails
+  CompileResult result;
+  try
+  {
+    while (DeclarationNode* declaration = par.nextDeclaration ())
+    {
+      ++streamStats.declarations;
+      if (!resolveFailed)
+      {
+        try
+        {
+          visitor.walk (declaration);
+        }
+        catch (const CompileError& error)
+        {
+          resolveFailed = true;
+          resolveError = error.diagnostic;
+        }
+      }
+
+      if (!resolveFailed && !checkFailed)
+      {
+        try
+        {
+          semanticVisitor.walk (declaration);
+          fputs (Parser::getAST (declaration).c_str (), astFile);
+        }
+        catch (const CompileError& error)
+        {
+          checkFailed = true;
+          checkError = error.diagnostic;
+        }
+      }
+
+      // Later declarations only need the signature
+      if (!resolveFailed)
+        m_table.replace (ExportedSymbol::describe (declaration).declare (m_arena));
+
+      if (m_scratchArena.bytesUsed () > streamStats.peakDeclarationBytes)
+      {
+        streamStats.peakDeclarationBytes = m_scratchArena.bytesUsed ();
+        streamStats.largestDeclaration = declaration->identifier;
+      }
+      m_scratchArena.reset ();
+    }
+
+    if (!resolveFailed && !checkFailed)
+      semanticVisitor.finishProgram ();
+    result.success = !resolveFailed && !checkFailed;
+  }
+  catch (const CompileError& error)
+  {
+    // A syntax error, or "main" never declared
+    result.diagnostics.push_back (error.diagnostic);
+  }
+
+  if (result.diagnostics.empty ())
+  {
+    if (resolveFailed)
+      result.diagnostics.push_back (resolveError);
+    else if (checkFailed)
+      result.diagnostics.push_back (checkError);
+  }
+
+  m_scratchArena.reset ();
+  streamStats.signatureBytes = m_arena.bytesUsed ();
+  if (stats != nullptr)
+    *stats = streamStats;
+  return result;
+}
+
+/***********************************************************************/
+
+void
+StreamStats::print (FILE* file) const
+{
+  fprintf (file, "Streamed %zu declarations\n", declarations);
+  fprintf (file, "  largest tree: %zu bytes (\"%s\")\n", peakDeclarationBytes,
+           largestDeclaration.c_str ());
+  fprintf (file, "  signatures  : %zu bytes\n", signatureBytes);
+}
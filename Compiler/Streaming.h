@@ -0,0 +1,47 @@
+/*
+  Filename   : Streaming.h
+  Author     : Philip Androwick
+  Description: Statistics of a streaming compilation
+               (CompilerContext::compileStreaming), which holds only one
+               top-level declaration's tree at a time.
+*/
+
+/***********************************************************************/
+
+#ifndef STREAMING_H
+#define STREAMING_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+/***********************************************************************/
+
+// Tokens lexed ahead of the parser at a time
+const size_t STREAM_TOKEN_BATCH = 1024;
+
+/***********************************************************************/
+
+struct StreamStats
+{
+  size_t declarations = 0;
+
+  // Most arena bytes any one declaration's tree used, and which
+  //   declaration that was
+  size_t      peakDeclarationBytes = 0;
+  std::string largestDeclaration;
+
+  // Arena bytes of the signatures kept for the global scope
+  size_t signatureBytes = 0;
+
+  // Writes a readable report to file
+  void
+  print (FILE* file) const;
+};
+
+/***********************************************************************/
+
+#endif
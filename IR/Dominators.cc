@@ -0,0 +1,145 @@
+/*
+  Filename   : Dominators.cc
+  Author     : Philip Androwick
+  Description: Dominators by the Cooper-Harvey-Kennedy algorithm.  The
+               immediate dominators are refined in reverse postorder
+               until nothing changes, which for the reducible graphs C-
+               produces takes two passes.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <utility>
+
+/***********************************************************************/
+// Local includes
+
+#include "Dominators.h"
+
+/***********************************************************************/
+
+DominatorTree::DominatorTree (const IrFunction& function)
+{
+  size_t blockCount = function.blocks.size ();
+  m_idom.assign (blockCount, NO_BLOCK);
+  m_children.assign (blockCount, { });
+  m_frontiers.assign (blockCount, { });
+  m_preorder.assign (blockCount, NO_BLOCK);
+  m_last.assign (blockCount, NO_BLOCK);
+  if (blockCount == 0)
+    return;
+
+  // Postorder by a depth-first walk with an explicit stack of (block,
+  // next successor) pairs
+  std::vector<uint32_t> postorder;
+  std::vector<bool> seen (blockCount, false);
+  std::vector<std::pair<uint32_t, size_t>> stack;
+  stack.push_back ({ 0, 0 });
+  seen[0] = true;
+  while (!stack.empty ())
+  {
+    uint32_t block = stack.back ().first;
+    const std::vector<uint32_t>& successors = function.blocks[block].successors;
+    if (stack.back ().second < successors.size ())
+    {
+      uint32_t successor = successors[stack.back ().second++];
+      if (!seen[successor])
+      {
+        seen[successor] = true;
+        stack.push_back ({ successor, 0 });
+      }
+    }
+    else
+    {
+      postorder.push_back (block);
+      stack.pop_back ();
+    }
+  }
+  m_reversePostorder.assign (postorder.rbegin (), postorder.rend ());
+
+  std::vector<uint32_t> order (blockCount, NO_BLOCK);
+  for (size_t n = 0; n < m_reversePostorder.size (); ++n)
+    order[m_reversePostorder[n]] = (uint32_t) n;
+
+  // Walks up from two blocks until they meet at their nearest common
+  // dominator; blocks later in reverse postorder are deeper
+  auto intersect = [&] (uint32_t a, uint32_t b) {
+    while (a != b)
+    {
+      while (order[a] > order[b])
+        a = m_idom[a];
+      while (order[b] > order[a])
+        b = m_idom[b];
+    }
+    return a;
+  };
+
+  m_idom[0] = 0;
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (size_t n = 1; n < m_reversePostorder.size (); ++n)
+    {
+      uint32_t block = m_reversePostorder[n];
+      uint32_t idom = NO_BLOCK;
+      for (uint32_t predecessor : function.blocks[block].predecessors)
+      {
+        if (m_idom[predecessor] == NO_BLOCK)
+          continue;
+        idom = idom == NO_BLOCK ? predecessor : intersect (predecessor, idom);
+      }
+      if (m_idom[block] != idom)
+      {
+        m_idom[block] = idom;
+        changed = true;
+      }
+    }
+  }
+
+  for (size_t n = 1; n < m_reversePostorder.size (); ++n)
+    m_children[m_idom[m_reversePostorder[n]]].push_back (m_reversePostorder[n]);
+
+  // A join point is in the frontier of each block on the way up from
+  // its predecessors to its immediate dominator
+  for (uint32_t block : m_reversePostorder)
+  {
+    const std::vector<uint32_t>& predecessors = function.blocks[block].predecessors;
+    if (predecessors.size () < 2)
+      continue;
+    for (uint32_t runner : predecessors)
+    {
+      if (m_idom[runner] == NO_BLOCK)
+        continue;
+      while (runner != m_idom[block])
+      {
+        std::vector<uint32_t>& frontier = m_frontiers[runner];
+        if (frontier.empty () || frontier.back () != block)
+          frontier.push_back (block);
+        runner = m_idom[runner];
+      }
+    }
+  }
+
+  // Number the tree in preorder for dominates
+  uint32_t next = 0;
+  std::vector<std::pair<uint32_t, size_t>> walk;
+  walk.push_back ({ 0, 0 });
+  m_preorder[0] = next++;
+  while (!walk.empty ())
+  {
+    uint32_t block = walk.back ().first;
+    if (walk.back ().second < m_children[block].size ())
+    {
+      uint32_t child = m_children[block][walk.back ().second++];
+      m_preorder[child] = next++;
+      walk.push_back ({ child, 0 });
+    }
+    else
+    {
+      m_last[block] = next - 1;
+      walk.pop_back ();
+    }
+  }
+}
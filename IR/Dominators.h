@@ -0,0 +1,92 @@
+/*
+  Filename   : Dominators.h
+  Author     : Philip Androwick
+  Description: Dominator tree and dominance frontiers of a function's
+               control flow graph, found with the iterative algorithm of
+               Cooper, Harvey and Kennedy ("A Simple, Fast Dominance
+               Algorithm").
+*/
+
+/***********************************************************************/
+
+#ifndef DOMINATORS_H
+#define DOMINATORS_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "IR.h"
+
+/***********************************************************************/
+
+// Blocks no path from the entry reaches have no dominator; they are
+//   not in the tree and have empty frontiers
+const uint32_t NO_BLOCK = UINT32_MAX;
+
+class DominatorTree
+{
+public:
+  explicit DominatorTree (const IrFunction& function);
+
+  // Reachable blocks in reverse postorder; the entry is first
+  const std::vector<uint32_t>&
+  getReversePostorder () const
+  {
+    return m_reversePostorder;
+  }
+
+  bool
+  isReachable (uint32_t block) const
+  {
+    return m_idom[block] != NO_BLOCK;
+  }
+
+  // The entry block is its own immediate dominator
+  uint32_t
+  getIdom (uint32_t block) const
+  {
+    return m_idom[block];
+  }
+
+  const std::vector<uint32_t>&
+  getChildren (uint32_t block) const
+  {
+    return m_children[block];
+  }
+
+  // Blocks where block's dominance ends
+  const std::vector<uint32_t>&
+  getFrontier (uint32_t block) const
+  {
+    return m_frontiers[block];
+  }
+
+  // Whether a dominates b (every block dominates itself); both must
+  //   be reachable
+  bool
+  dominates (uint32_t a, uint32_t b) const
+  {
+    return m_preorder[a] <= m_preorder[b] && m_preorder[b] <= m_last[a];
+  }
+
+private:
+  std::vector<uint32_t> m_reversePostorder;
+  std::vector<uint32_t> m_idom;
+  std::vector<std::vector<uint32_t>> m_children;
+  std::vector<std::vector<uint32_t>> m_frontiers;
+
+  // Position of each block in a preorder walk of the tree, and the last
+  //   position within its subtree
+  std::vector<uint32_t> m_preorder;
+  std::vector<uint32_t> m_last;
+};
+
+/***********************************************************************/
+
+#endif
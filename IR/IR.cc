@@ -0,0 +1,500 @@
+/*
+  Filename   : IR.cc
+  Author     : Philip Androwick
+  Description: Text form of the IR and its verifier.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+
+/***********************************************************************/
+// Local includes
+
+#include "IR.h"
+#include "Dominators.h"
+
+/***********************************************************************/
+
+namespace
+{
+  const char*
+  opcodeName (IrOpcode op)
+  {
+    static const char* const names[] = {
+      "const", "param", "copy", "add", "sub", "mul", "div", "lt", "le", "gt", "ge", "eq", "ne",
+      "frameaddr", "globaladdr", "load", "store", "loadglobal", "storeglobal", "call",
+      "input", "output", "phi", "jump", "branch", "ret"
+    };
+    return names[(int) op];
+  }
+
+  std::string
+  typeName (IrType type)
+  {
+    return type == IrType::INT ? "int" : "int[]";
+  }
+
+  std::string
+  valueName (const IrFunction& function, uint32_t value)
+  {
+    if (value >= function.names.size () || function.names[value].empty ())
+      return "%" + std::to_string (value);
+    return "%" + function.names[value] + "." + std::to_string (value);
+  }
+
+  std::string
+  blockName (uint32_t block)
+  {
+    return "b" + std::to_string (block);
+  }
+
+  void
+  printSignature (std::string& out, const IrFunction& function)
+  {
+    out += function.external ? "extern function " : "function ";
+    out += function.returnsValue ? "int " : "void ";
+    out += function.name + " (";
+    for (size_t n = 0; n < function.parameters.size (); ++n)
+      out += (n != 0 ? ", " : "") + typeName (function.parameters[n]);
+    out += ")\n";
+  }
+
+  void
+  printInstruction (std::string& out, const IrModule& module, const IrFunction& function,
+                    const IrBlock& block, const IrInstruction& instruction)
+  {
+    auto value = [&] (uint32_t v) { return valueName (function, v); };
+    auto operandList = [&] () {
+      std::string list;
+      for (uint32_t n = 0; n < instruction.b; ++n)
+        list += (n != 0 ? ", " : "") + value (function.operands[instruction.a + n]);
+      return list;
+    };
+
+    out += "  ";
+    if (instruction.dest != IR_NO_VALUE)
+      out += value (instruction.dest) + " = ";
+    out += opcodeName (instruction.op);
+    switch (instruction.op)
+    {
+    case IrOpcode::CONST:
+      out += " " + std::to_string ((int32_t) instruction.a);
+      break;
+    case IrOpcode::PARAM:
+      out += " " + std::to_string (instruction.a);
+      break;
+    case IrOpcode::FRAME_ADDR:
+      out += " " + std::to_string (instruction.a) + " [" + std::to_string (function.arrays[instruction.a]) + "]";
+      break;
+    case IrOpcode::GLOBAL_ADDR:
+    case IrOpcode::LOAD_GLOBAL:
+      out += " @" + module.globals[instruction.a].name;
+      break;
+    case IrOpcode::STORE_GLOBAL:
+      out += " @" + module.globals[instruction.a].name + ", " + value (instruction.b);
+      break;
+    case IrOpcode::LOAD:
+      out += " " + value (instruction.a) + "[" + value (instruction.b) + "]";
+      break;
+    case IrOpcode::STORE:
+      out += " " + value (instruction.a) + "[" + value (instruction.b) + "], " + value (instruction.c);
+      break;
+    case IrOpcode::CALL:
+      out += " @" + module.functions[instruction.c].name + " (" + operandList () + ")";
+      break;
+    case IrOpcode::PHI:
+    {
+      // Each operand is paired with the predecessor it comes from
+      out += " ";
+      for (uint32_t n = 0; n < instruction.b; ++n)
+      {
+        out += n != 0 ? ", [" : "[";
+        out += value (function.operands[instruction.a + n]);
+        if (n < block.predecessors.size ())
+          out += ", " + blockName (block.predecessors[n]);
+        out += "]";
+      }
+      break;
+    }
+    case IrOpcode::JUMP:
+      out += " " + blockName (instruction.a);
+      break;
+    case IrOpcode::BRANCH:
+      out += " " + value (instruction.a) + ", " + blockName (instruction.b) + ", " + blockName (instruction.c);
+      break;
+    case IrOpcode::RET:
+      if (instruction.a != IR_NO_VALUE)
+        out += " " + value (instruction.a);
+      break;
+    case IrOpcode::INPUT:
+      break;
+    case IrOpcode::COPY:
+    case IrOpcode::OUTPUT:
+      out += " " + value (instruction.a);
+      break;
+    default:
+      out += " " + value (instruction.a) + ", " + value (instruction.b);
+      break;
+    }
+    out += "\n";
+  }
+
+  // Collects the first problem found; checks return whether they passed
+  class Verifier
+  {
+  public:
+    Verifier (const IrModule& module, std::string& error)
+      : m_module (module), m_error (error)
+    { }
+
+    bool
+    verify ()
+    {
+      for (const IrFunction& function : m_module.functions)
+        if (!function.external && !verifyFunction (function))
+          return false;
+      return true;
+    }
+
+  private:
+    bool
+    fail (const IrFunction& function, const std::string& message)
+    {
+      m_error = "in " + function.name + ": " + message;
+      return false;
+    }
+
+    bool
+    verifyFunction (const IrFunction& function)
+    {
+      const std::vector<IrBlock>& blocks = function.blocks;
+      size_t valueCount = function.types.size ();
+      if (blocks.empty ())
+        return fail (function, "no blocks");
+      if (function.names.size () != valueCount)
+        return fail (function, "names and types differ in length");
+
+      // Blocks tile the instruction array and end with their terminators
+      uint32_t next = 0;
+      std::vector<uint32_t> blockOf (function.instructions.size (), NO_BLOCK);
+      std::vector<uint32_t> layout (blocks.size ());
+      for (uint32_t n = 0; n < blocks.size (); ++n)
+        layout[n] = n;
+      std::sort (layout.begin (), layout.end (), [&] (uint32_t a, uint32_t b) {
+        return blocks[a].first < blocks[b].first;
+      });
+      for (uint32_t block : layout)
+      {
+        const IrBlock& b = blocks[block];
+        if (b.first != next || b.count == 0)
+          return fail (function, blockName (block) + " is empty or not contiguous with the block before it");
+        next += b.count;
+        if (next > function.instructions.size ())
+          return fail (function, blockName (block) + " runs past the instructions");
+        for (uint32_t n = b.first; n < next; ++n)
+        {
+          blockOf[n] = block;
+          if (isTerminator (function.instructions[n].op) != (n == next - 1))
+            return fail (function, blockName (block) + " does not end with its only terminator");
+        }
+      }
+      if (next != function.instructions.size ())
+        return fail (function, "instructions after the last block");
+
+      // Edges agree with the terminators and with each other
+      for (uint32_t block = 0; block < blocks.size (); ++block)
+      {
+        const IrBlock& b = blocks[block];
+        const IrInstruction& last = function.instructions[b.first + b.count - 1];
+        std::vector<uint32_t> targets;
+        if (last.op == IrOpcode::JUMP)
+          targets = { last.a };
+        else if (last.op == IrOpcode::BRANCH)
+          targets = { last.b, last.c };
+        for (uint32_t target : targets)
+          if (target >= blocks.size ())
+            return fail (function, blockName (block) + " jumps to a block that does not exist");
+        if (targets != b.successors)
+          return fail (function, blockName (block) + "'s successors differ from its terminator's targets");
+        for (uint32_t successor : b.successors)
+        {
+          const std::vector<uint32_t>& predecessors = blocks[successor].predecessors;
+          if (std::count (predecessors.begin (), predecessors.end (), block)
+              != std::count (b.successors.begin (), b.successors.end (), successor))
+            return fail (function, blockName (successor) + " does not list " + blockName (block) + " as a predecessor");
+        }
+        for (uint32_t predecessor : b.predecessors)
+        {
+          if (predecessor >= blocks.size ())
+            return fail (function, blockName (block) + " has a predecessor that does not exist");
+          const std::vector<uint32_t>& successors = blocks[predecessor].successors;
+          if (std::find (successors.begin (), successors.end (), block) == successors.end ())
+            return fail (function, blockName (block) + " lists " + blockName (predecessor)
+                         + " as a predecessor, but is not its successor");
+        }
+      }
+      if (!blocks[0].predecessors.empty ())
+        return fail (function, "the entry block has predecessors");
+
+      // Operands are in range and of the right types
+      for (uint32_t n = 0; n < function.instructions.size (); ++n)
+        if (!verifyInstruction (function, blockOf[n], function.instructions[n]))
+          return false;
+
+      return !function.ssa || verifySsa (function, blockOf);
+    }
+
+    bool
+    verifyInstruction (const IrFunction& function, uint32_t block, const IrInstruction& instruction)
+    {
+      size_t valueCount = function.types.size ();
+      auto where = [&] () { return blockName (block) + ": " + opcodeName (instruction.op) + " "; };
+      auto isValue = [&] (uint32_t value) { return value < valueCount; };
+      auto typeIs = [&] (uint32_t value, IrType type) { return isValue (value) && function.types[value] == type; };
+
+      bool operandsOkay = true;
+      forEachOperand (instruction, [&] (const uint32_t& value) {
+        if (!isValue (value))
+          operandsOkay = false;
+      });
+      if (!operandsOkay)
+        return fail (function, where () + "reads a value that does not exist");
+
+      bool hasResult = true;
+      IrType result = IrType::INT;
+      switch (instruction.op)
+      {
+      case IrOpcode::CONST: case IrOpcode::INPUT:
+        break;
+      case IrOpcode::PARAM:
+        if (instruction.a >= function.parameters.size ())
+          return fail (function, where () + "of a parameter that does not exist");
+        result = function.parameters[instruction.a];
+        break;
+      case IrOpcode::COPY:
+        result = function.types[instruction.a];
+        break;
+      case IrOpcode::FRAME_ADDR:
+        if (instruction.a >= function.arrays.size ())
+          return fail (function, where () + "of an array that does not exist");
+        result = IrType::ADDRESS;
+        break;
+      case IrOpcode::GLOBAL_ADDR: case IrOpcode::LOAD_GLOBAL: case IrOpcode::STORE_GLOBAL:
+      {
+        bool wantArray = instruction.op == IrOpcode::GLOBAL_ADDR;
+        if (instruction.a >= m_module.globals.size () || m_module.globals[instruction.a].isArray != wantArray)
+          return fail (function, where () + "of a global that does not exist or is of the wrong kind");
+        if (instruction.op == IrOpcode::STORE_GLOBAL)
+        {
+          hasResult = false;
+          if (!typeIs (instruction.b, IrType::INT))
+            return fail (function, where () + "of an address");
+        }
+        result = wantArray ? IrType::ADDRESS : IrType::INT;
+        break;
+      }
+      case IrOpcode::LOAD: case IrOpcode::STORE:
+        if (!typeIs (instruction.a, IrType::ADDRESS) || !typeIs (instruction.b, IrType::INT)
+            || (instruction.op == IrOpcode::STORE && !typeIs (instruction.c, IrType::INT)))
+          return fail (function, where () + "needs an address, an int index and an int value");
+        hasResult = instruction.op == IrOpcode::LOAD;
+        break;
+      case IrOpcode::CALL:
+      {
+        if (instruction.c >= m_module.functions.size ())
+          return fail (function, where () + "of a function that does not exist");
+        const IrFunction& callee = m_module.functions[instruction.c];
+        if (instruction.b != callee.parameters.size () || instruction.a + instruction.b > function.operands.size ())
+          return fail (function, where () + "@" + callee.name + " with the wrong number of arguments");
+        for (uint32_t n = 0; n < instruction.b; ++n)
+          if (!typeIs (function.operands[instruction.a + n], callee.parameters[n]))
+            return fail (function, where () + "@" + callee.name + " with an argument of the wrong type");
+        hasResult = callee.returnsValue;
+        break;
+      }
+      case IrOpcode::OUTPUT: case IrOpcode::BRANCH:
+        if (!typeIs (instruction.a, IrType::INT))
+          return fail (function, where () + "of an address");
+        hasResult = false;
+        break;
+      case IrOpcode::PHI:
+      {
+        if (instruction.a + instruction.b > function.operands.size ())
+          return fail (function, where () + "operands run past the operand pool");
+        if (!isValue (instruction.dest))
+          return fail (function, where () + "defines no value");
+        result = function.types[instruction.dest];
+        for (uint32_t n = 0; n < instruction.b; ++n)
+          if (!typeIs (function.operands[instruction.a + n], result))
+            return fail (function, where () + "operand of the wrong type");
+        break;
+      }
+      case IrOpcode::JUMP:
+        hasResult = false;
+        break;
+      case IrOpcode::RET:
+        if ((instruction.a != IR_NO_VALUE) != function.returnsValue
+            || (instruction.a != IR_NO_VALUE && !typeIs (instruction.a, IrType::INT)))
+          return fail (function, where () + "does not match the function's return type");
+        hasResult = false;
+        break;
+      default:
+        if (!typeIs (instruction.a, IrType::INT) || !typeIs (instruction.b, IrType::INT))
+          return fail (function, where () + "of an address");
+        break;
+      }
+
+      if (!hasResult)
+      {
+        if (instruction.dest != IR_NO_VALUE)
+          return fail (function, where () + "defines a value but produces none");
+      }
+      else if (!typeIs (instruction.dest, result))
+        return fail (function, where () + "defines a value that does not exist or is of the wrong type");
+      return true;
+    }
+
+    bool
+    verifySsa (const IrFunction& function, const std::vector<uint32_t>& blockOf)
+    {
+      DominatorTree tree (function);
+      const std::vector<IrInstruction>& instructions = function.instructions;
+      for (uint32_t block = 0; block < function.blocks.size (); ++block)
+        if (!tree.isReachable (block))
+          return fail (function, blockName (block) + " is unreachable");
+
+      // Each value has one definition
+      std::vector<uint32_t> definition (function.types.size (), IR_NO_VALUE);
+      for (uint32_t n = 0; n < instructions.size (); ++n)
+      {
+        uint32_t dest = instructions[n].dest;
+        if (dest == IR_NO_VALUE)
+          continue;
+        if (definition[dest] != IR_NO_VALUE)
+          return fail (function, valueName (function, dest) + " is defined twice");
+        definition[dest] = n;
+      }
+
+      // Definitions come before their uses in the same block and dominate
+      // them otherwise; a phi's operand need only be available at the end
+      // of the predecessor it comes from
+      auto available = [&] (uint32_t value, uint32_t block, uint32_t position) {
+        uint32_t defined = definition[value];
+        if (defined == IR_NO_VALUE)
+          return false;
+        if (blockOf[defined] == block)
+          return defined < position;
+        return tree.dominates (blockOf[defined], block);
+      };
+
+      for (uint32_t block = 0; block < function.blocks.size (); ++block)
+      {
+        const IrBlock& b = function.blocks[block];
+        bool phisDone = false;
+        for (uint32_t n = b.first; n < b.first + b.count; ++n)
+        {
+          const IrInstruction& instruction = instructions[n];
+          if (instruction.op == IrOpcode::PHI)
+          {
+            if (phisDone)
+              return fail (function, blockName (block) + " has a phi after other instructions");
+            if (instruction.b != b.predecessors.size ())
+              return fail (function, blockName (block) + " has a phi without one operand per predecessor");
+            for (uint32_t k = 0; k < instruction.b; ++k)
+            {
+              uint32_t predecessor = b.predecessors[k];
+              const IrBlock& p = function.blocks[predecessor];
+              if (!available (function.operands[instruction.a + k], predecessor, p.first + p.count))
+                return fail (function, "phi operand " + valueName (function, function.operands[instruction.a + k])
+                             + " of " + blockName (block) + " is not available at the end of "
+                             + blockName (predecessor));
+            }
+            continue;
+          }
+
+          phisDone = true;
+          bool okay = true;
+          uint32_t bad = 0;
+          auto check = [&] (uint32_t value) {
+            if (okay && !available (value, block, n))
+            {
+              okay = false;
+              bad = value;
+            }
+          };
+          if (instruction.op == IrOpcode::CALL)
+          {
+            for (uint32_t k = 0; k < instruction.b; ++k)
+              check (function.operands[instruction.a + k]);
+          }
+          else
+            forEachOperand (instruction, [&] (const uint32_t& value) { check (value); });
+          if (!okay)
+            return fail (function, valueName (function, bad) + " is used in " + blockName (block)
+                         + " where its definition does not reach");
+        }
+      }
+      return true;
+    }
+
+    const IrModule& m_module;
+    std::string&    m_error;
+  };
+}
+
+/***********************************************************************/
+
+std::string
+printIr (const IrModule& module)
+{
+  std::string out;
+  for (const IrGlobal& global : module.globals)
+  {
+    out += global.external ? "extern global @" : "global @";
+    out += global.name;
+    if (global.isArray)
+      out += "[" + std::to_string (global.size) + "]";
+    out += "\n";
+  }
+
+  for (const IrFunction& function : module.functions)
+  {
+    out += "\n";
+    printSignature (out, function);
+    if (function.external)
+      continue;
+    if (!function.arrays.empty ())
+    {
+      out += "  ; arrays";
+      for (uint32_t size : function.arrays)
+        out += " [" + std::to_string (size) + "]";
+      out += "\n";
+    }
+    for (uint32_t block = 0; block < function.blocks.size (); ++block)
+    {
+      const IrBlock& b = function.blocks[block];
+      out += blockName (block) + ":";
+      if (!b.predecessors.empty ())
+      {
+        out += "  ; preds";
+        for (uint32_t predecessor : b.predecessors)
+          out += " " + blockName (predecessor);
+      }
+      out += "\n";
+      for (uint32_t n = b.first; n < b.first + b.count; ++n)
+        printInstruction (out, module, function, b, function.instructions[n]);
+    }
+  }
+  return out;
+}
+
+/***********************************************************************/
+
+bool
+verifyIr (const IrModule& module, std::string& error)
+{
+  Verifier verifier (module, error);
+  return verifier.verify ();
+}
@@ -0,0 +1,215 @@
+/*
+  Filename   : IR.h
+  Author     : Philip Androwick
+  Description: Three-address intermediate representation.  Each function
+               keeps its instructions in one flat array, cut into basic
+               blocks, and its operands are numbered values.  Lowering.h
+               builds it from the checked tree and SSA.h puts it in SSA
+               form.
+*/
+
+/***********************************************************************/
+
+#ifndef IR_H
+#define IR_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+
+// No value: the result of a void call, or a return without one
+const uint32_t IR_NO_VALUE = UINT32_MAX;
+
+enum class IrOpcode : uint8_t
+{
+  // dest = the constant a (an int32_t); dest = parameter number a; dest = a
+  CONST, PARAM, COPY,
+
+  // dest = a op b; comparisons give 1 or 0
+  ADD, SUB, MUL, DIV, LT, LE, GT, GE, EQ, NE,
+
+  // dest = address of frame array a (IrFunction::arrays), or of
+  //   global a (IrModule::globals)
+  FRAME_ADDR, GLOBAL_ADDR,
+
+  // dest = element b of the array at address a; element b of the array
+  //   at address a = c
+  LOAD, STORE,
+
+  // dest = scalar global a; scalar global a = b
+  LOAD_GLOBAL, STORE_GLOBAL,
+
+  // dest = function c (IrModule::functions) called with the b operands
+  //   at IrFunction::operands[a]; dest is IR_NO_VALUE for a void function
+  CALL,
+
+  // dest = the next integer read; write a
+  INPUT, OUTPUT,
+
+  // dest = the operand, of the b at IrFunction::operands[a], for the
+  //   predecessor the block was entered from; one per predecessor, in
+  //   the order of IrBlock::predecessors
+  PHI,
+
+  // Terminators: go to block a; go to block b if a is not 0, otherwise
+  //   to block c; return a, or nothing when a is IR_NO_VALUE
+  JUMP, BRANCH, RET
+};
+
+enum class IrType : uint8_t
+{
+  // Every C- value is a 32-bit int, except the address of an array
+  INT, ADDRESS
+};
+
+struct IrInstruction
+{
+  IrOpcode op;
+  uint32_t dest;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+};
+
+struct IrBlock
+{
+  // The block is instructions [first, first + count) of its function
+  uint32_t first = 0;
+  uint32_t count = 0;
+
+  std::vector<uint32_t> predecessors;
+  std::vector<uint32_t> successors;
+};
+
+struct IrFunction
+{
+  std::string name;
+  bool        returnsValue = false;
+  std::vector<IrType> parameters;
+
+  // Declared by an imported module, so it has no blocks
+  bool external = false;
+
+  // Block 0 is the entry
+  std::vector<IrInstruction> instructions;
+  std::vector<IrBlock>       blocks;
+
+  // Operands of calls and phis
+  std::vector<uint32_t> operands;
+
+  // Type of each value, and the name of the variable it holds (empty
+  //   for temporaries)
+  std::vector<IrType>      types;
+  std::vector<std::string> names;
+
+  // Number of elements of each local array
+  std::vector<uint32_t> arrays;
+
+  // Set once the function is in SSA form: every value has one
+  //   definition, which dominates its uses
+  bool ssa = false;
+
+  uint32_t
+  addValue (IrType type, const std::string& name = "")
+  {
+    types.push_back (type);
+    names.push_back (name);
+    return (uint32_t) types.size () - 1;
+  }
+};
+
+struct IrGlobal
+{
+  std::string name;
+  bool        isArray = false;
+  uint32_t    size = 1;
+
+  // Declared by an imported module
+  bool external = false;
+};
+
+struct IrModule
+{
+  std::vector<IrGlobal>   globals;
+  std::vector<IrFunction> functions;
+
+  void
+  clear ()
+  {
+    globals.clear ();
+    functions.clear ();
+  }
+};
+
+/***********************************************************************/
+
+inline bool
+isTerminator (IrOpcode op)
+{
+  return op == IrOpcode::JUMP || op == IrOpcode::BRANCH || op == IrOpcode::RET;
+}
+
+// Calls f on each value instruction reads, not counting call and phi
+//   operands in IrFunction::operands.  f gets a reference to the operand
+//   field, through which a non-const instruction's operands can be
+//   replaced.
+template<typename Instruction, typename F>
+void
+forEachOperand (Instruction& instruction, F f)
+{
+  switch (instruction.op)
+  {
+  case IrOpcode::CONST: case IrOpcode::PARAM: case IrOpcode::FRAME_ADDR:
+  case IrOpcode::GLOBAL_ADDR: case IrOpcode::LOAD_GLOBAL: case IrOpcode::INPUT:
+  case IrOpcode::CALL: case IrOpcode::PHI: case IrOpcode::JUMP:
+    break;
+
+  case IrOpcode::COPY: case IrOpcode::OUTPUT: case IrOpcode::BRANCH:
+    f (instruction.a);
+    break;
+
+  case IrOpcode::STORE_GLOBAL:
+    f (instruction.b);
+    break;
+
+  case IrOpcode::RET:
+    if (instruction.a != IR_NO_VALUE)
+      f (instruction.a);
+    break;
+
+  case IrOpcode::STORE:
+    f (instruction.a);
+    f (instruction.b);
+    f (instruction.c);
+    break;
+
+  default:
+    // Arithmetic, comparisons and LOAD
+    f (instruction.a);
+    f (instruction.b);
+    break;
+  }
+}
+
+/***********************************************************************/
+
+// The module as text, for --emit=ir
+std::string
+printIr (const IrModule& module);
+
+// Checks that the blocks are well formed, the control flow edges agree
+//   with the terminators and the operands have the right types; for SSA
+//   functions also that each value is defined once, before (dominating)
+//   its uses.  Returns false, with a description in error, at the first
+//   problem.
+bool
+verifyIr (const IrModule& module, std::string& error);
+
+/***********************************************************************/
+
+#endif
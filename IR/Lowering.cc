@@ -0,0 +1,490 @@
+/*
+  Filename   : Lowering.cc
+  Author     : Philip Androwick
+  Description: Lowering of the checked tree to IR.  The tree is walked
+               once; expressions leave their values on a stack, and if
+               and while statements open their blocks from the hooks
+               around their bodies.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <stdexcept>
+#include <unordered_map>
+
+/***********************************************************************/
+// Local includes
+
+#include "Lowering.h"
+
+/***********************************************************************/
+
+namespace
+{
+  class Lowering : public AstWalker
+  {
+  public:
+    explicit Lowering (IrModule& module)
+      : AstWalker ({ ChildSlot::THEN, ChildSlot::BODY }),
+        m_module (module), m_function (nullptr), m_block (0), m_parameter (0)
+    { }
+
+    // Declarations
+
+    virtual bool
+    enter (VariableDeclarationNode* node)
+    {
+      if (m_function == nullptr)
+        m_globals[node] = addGlobal (node->identifier, false, 1, false);
+      else
+        m_locals[node] = emit (IrOpcode::CONST, m_function->addValue (IrType::INT, node->identifier), 0);
+      return true;
+    }
+
+    virtual bool
+    enter (ArrayDeclarationNode* node)
+    {
+      if (m_function == nullptr)
+        m_globals[node] = addGlobal (node->identifier, true, (uint32_t) node->size, false);
+      else
+      {
+        m_function->arrays.push_back ((uint32_t) node->size);
+        m_locals[node] = emit (IrOpcode::FRAME_ADDR, m_function->addValue (IrType::ADDRESS, node->identifier),
+                               (uint32_t) m_function->arrays.size () - 1);
+      }
+      return true;
+    }
+
+    virtual bool
+    enter (FunctionDeclarationNode* node)
+    {
+      m_functions[node] = (uint32_t) m_module.functions.size ();
+      m_module.functions.emplace_back ();
+      m_function = &m_module.functions.back ();
+      m_function->name = node->identifier;
+      m_function->returnsValue = node->valueType == ValueType::INT;
+      for (ParameterNode* parameter : node->parameters)
+        m_function->parameters.push_back (parameter->isArray ? IrType::ADDRESS : IrType::INT);
+
+      m_locals.clear ();
+      m_parameter = 0;
+      startBlock (newBlock ());
+      return true;
+    }
+
+    virtual void
+    leave (FunctionDeclarationNode* node)
+    {
+      // Falling off the end of an int function (only possible after a
+      // return, so never reached) returns 0
+      uint32_t value = IR_NO_VALUE;
+      if (m_function->returnsValue)
+        value = emit (IrOpcode::CONST, m_function->addValue (IrType::INT), 0);
+      terminate (IrOpcode::RET, value);
+      m_function = nullptr;
+    }
+
+    virtual bool
+    enter (ParameterNode* node)
+    {
+      IrType type = node->isArray ? IrType::ADDRESS : IrType::INT;
+      m_locals[node] = emit (IrOpcode::PARAM, m_function->addValue (type, node->identifier), m_parameter++);
+      return true;
+    }
+
+    // Statements
+
+    virtual void
+    enterChild (Node* parent, ChildSlot slot)
+    {
+      // The condition has been evaluated
+      if (slot == ChildSlot::THEN)
+      {
+        uint32_t condition = pop ();
+        uint32_t thenBlock = newBlock ();
+        uint32_t elseBlock = newBlock ();
+        m_joins.push_back (newBlock ());
+        terminate (IrOpcode::BRANCH, condition, thenBlock, elseBlock);
+        startBlock (thenBlock);
+      }
+      else
+      {
+        uint32_t condition = pop ();
+        uint32_t body = newBlock ();
+        m_joins.push_back (newBlock ());
+        terminate (IrOpcode::BRANCH, condition, body, m_joins.back ());
+        startBlock (body);
+      }
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot)
+    {
+      if (slot == ChildSlot::THEN)
+      {
+        // The else block was made right before the join block
+        terminate (IrOpcode::JUMP, m_joins.back ());
+        startBlock (m_joins.back () - 1);
+      }
+      else
+      {
+        terminate (IrOpcode::JUMP, m_headers.back ());
+        m_headers.pop_back ();
+        startBlock (m_joins.back ());
+        m_joins.pop_back ();
+      }
+    }
+
+    virtual void
+    leave (IfStatementNode* node)
+    {
+      terminate (IrOpcode::JUMP, m_joins.back ());
+      startBlock (m_joins.back ());
+      m_joins.pop_back ();
+    }
+
+    virtual bool
+    enter (WhileStatementNode* node)
+    {
+      m_headers.push_back (newBlock ());
+      terminate (IrOpcode::JUMP, m_headers.back ());
+      startBlock (m_headers.back ());
+      return true;
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      terminate (IrOpcode::RET, node->expression != nullptr ? pop () : IR_NO_VALUE);
+      // Anything after the return is unreachable
+      startBlock (newBlock ());
+    }
+
+    virtual void
+    leave (ExpressionStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        pop ();
+    }
+
+    virtual bool
+    enter (ForStatementNode* node)
+    {
+      throw std::logic_error ("lowering: the parser makes no for statements");
+    }
+
+    // Expressions
+
+    virtual bool
+    enter (IntegerLiteralExpressionNode* node)
+    {
+      push (emit (IrOpcode::CONST, m_function->addValue (IrType::INT), (uint32_t) node->value));
+      return true;
+    }
+
+    virtual bool
+    enter (AssignmentExpressionNode* node)
+    {
+      m_targets.push_back (node->variable);
+      return true;
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      uint32_t value = pop ();
+      store (node->variable, value);
+      m_targets.pop_back ();
+      push (value);
+    }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      // An assignment stores to its target instead
+      if (!m_targets.empty () && m_targets.back () == node)
+        return true;
+
+      DeclarationNode* declaration = node->usingDecNode;
+      auto local = m_locals.find (declaration);
+      if (local != m_locals.end ())
+        push (local->second);
+      else if (m_module.globals[global (declaration)].isArray)
+        push (emit (IrOpcode::GLOBAL_ADDR, m_function->addValue (IrType::ADDRESS), global (declaration)));
+      else
+        push (emit (IrOpcode::LOAD_GLOBAL, m_function->addValue (IrType::INT), global (declaration)));
+      return true;
+    }
+
+    virtual void
+    leave (SubscriptExpressionNode* node)
+    {
+      uint32_t index = pop ();
+      uint32_t address = arrayAddress (node->usingDecNode);
+      // An assignment's target leaves the address and index for it
+      if (!m_targets.empty () && m_targets.back () == node)
+      {
+        push (address);
+        push (index);
+      }
+      else
+        push (emit (IrOpcode::LOAD, m_function->addValue (IrType::INT), address, index));
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node)
+    {
+      // input reads into its argument, like an assignment
+      if (node->identifier == "input" && dynamic_cast<FunctionDeclarationNode*> (node->usingDecNode) == nullptr)
+        m_targets.push_back (static_cast<VariableExpressionNode*> (node->arguments[0]));
+      return true;
+    }
+
+    virtual void
+    leave (CallExpressionNode* node)
+    {
+      size_t count = node->arguments.size ();
+      FunctionDeclarationNode* callee = dynamic_cast<FunctionDeclarationNode*> (node->usingDecNode);
+
+      // input and output are the only functions without a declaration
+      // node of their own
+      if (callee == nullptr)
+      {
+        if (node->identifier == "input")
+        {
+          store (m_targets.back (), emit (IrOpcode::INPUT, m_function->addValue (IrType::INT)));
+          m_targets.pop_back ();
+        }
+        else
+          emit (IrOpcode::OUTPUT, IR_NO_VALUE, pop ());
+        push (IR_NO_VALUE);
+        return;
+      }
+
+      uint32_t first = (uint32_t) m_function->operands.size ();
+      m_function->operands.insert (m_function->operands.end (), m_values.end () - count, m_values.end ());
+      m_values.resize (m_values.size () - count);
+      uint32_t result = IR_NO_VALUE;
+      if (callee->valueType == ValueType::INT)
+        result = m_function->addValue (IrType::INT);
+      emit (IrOpcode::CALL, result, first, (uint32_t) count, function (callee));
+      push (result);
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node)
+    {
+      binary (node->addOperator == AdditiveOperatorType::PLUS ? IrOpcode::ADD : IrOpcode::SUB);
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node)
+    {
+      binary (node->multOperator == MultiplicativeOperatorType::TIMES ? IrOpcode::MUL : IrOpcode::DIV);
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node)
+    {
+      static const IrOpcode opcodes[] = {
+        IrOpcode::LT, IrOpcode::LE, IrOpcode::GT, IrOpcode::GE, IrOpcode::EQ, IrOpcode::NE
+      };
+      binary (opcodes[(int) node->relationalOperator]);
+    }
+
+    virtual bool
+    enter (UnaryExpressionNode* node)
+    {
+      throw std::logic_error ("lowering: the parser makes no unary expressions");
+    }
+
+  private:
+    uint32_t
+    newBlock ()
+    {
+      m_function->blocks.emplace_back ();
+      return (uint32_t) m_function->blocks.size () - 1;
+    }
+
+    // Blocks are filled one at a time, so each one's instructions are
+    // contiguous
+    void
+    startBlock (uint32_t block)
+    {
+      m_block = block;
+      m_function->blocks[block].first = (uint32_t) m_function->instructions.size ();
+    }
+
+    // Returns dest
+    uint32_t
+    emit (IrOpcode op, uint32_t dest, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0)
+    {
+      m_function->instructions.push_back ({ op, dest, a, b, c });
+      ++m_function->blocks[m_block].count;
+      return dest;
+    }
+
+    void
+    terminate (IrOpcode op, uint32_t a, uint32_t b = 0, uint32_t c = 0)
+    {
+      emit (op, IR_NO_VALUE, a, b, c);
+      if (op == IrOpcode::JUMP)
+        addEdge (m_block, a);
+      else if (op == IrOpcode::BRANCH)
+      {
+        addEdge (m_block, b);
+        addEdge (m_block, c);
+      }
+    }
+
+    void
+    addEdge (uint32_t from, uint32_t to)
+    {
+      m_function->blocks[from].successors.push_back (to);
+      m_function->blocks[to].predecessors.push_back (from);
+    }
+
+    void
+    binary (IrOpcode op)
+    {
+      uint32_t right = pop ();
+      uint32_t left = pop ();
+      push (emit (op, m_function->addValue (IrType::INT), left, right));
+    }
+
+    void
+    push (uint32_t value)
+    {
+      m_values.push_back (value);
+    }
+
+    uint32_t
+    pop ()
+    {
+      uint32_t value = m_values.back ();
+      m_values.pop_back ();
+      return value;
+    }
+
+    // Stores value to target; a subscript has left its address and
+    // index on the stack
+    void
+    store (VariableExpressionNode* target, uint32_t value)
+    {
+      DeclarationNode* declaration = target->usingDecNode;
+      if (dynamic_cast<SubscriptExpressionNode*> (target) != nullptr)
+      {
+        uint32_t index = pop ();
+        uint32_t address = pop ();
+        emit (IrOpcode::STORE, IR_NO_VALUE, address, index, value);
+      }
+      else if (m_locals.count (declaration) != 0)
+      {
+        uint32_t local = m_locals[declaration];
+        // A read of the local earlier in the expression, still waiting
+        // for its operator, must keep the value it read
+        uint32_t snapshot = IR_NO_VALUE;
+        for (uint32_t& pending : m_values)
+          if (pending == local)
+          {
+            if (snapshot == IR_NO_VALUE)
+              snapshot = emit (IrOpcode::COPY, m_function->addValue (IrType::INT), local);
+            pending = snapshot;
+          }
+        emit (IrOpcode::COPY, local, value);
+      }
+      else
+        emit (IrOpcode::STORE_GLOBAL, IR_NO_VALUE, global (declaration), value);
+    }
+
+    uint32_t
+    arrayAddress (DeclarationNode* declaration)
+    {
+      auto local = m_locals.find (declaration);
+      if (local != m_locals.end ())
+        return local->second;
+      return emit (IrOpcode::GLOBAL_ADDR, m_function->addValue (IrType::ADDRESS), global (declaration));
+    }
+
+    uint32_t
+    addGlobal (const std::string& name, bool isArray, uint32_t size, bool external)
+    {
+      IrGlobal global;
+      global.name = name;
+      global.isArray = isArray;
+      global.size = size;
+      global.external = external;
+      m_module.globals.push_back (global);
+      return (uint32_t) m_module.globals.size () - 1;
+    }
+
+    // Index of a global, declaring imported ones on first use
+    uint32_t
+    global (DeclarationNode* declaration)
+    {
+      auto entry = m_globals.find (declaration);
+      if (entry != m_globals.end ())
+        return entry->second;
+      ArrayDeclarationNode* array = dynamic_cast<ArrayDeclarationNode*> (declaration);
+      uint32_t index = addGlobal (declaration->identifier, array != nullptr,
+                                  array != nullptr ? (uint32_t) array->size : 1, true);
+      m_globals[declaration] = index;
+      return index;
+    }
+
+    // Index of a function, declaring imported ones on first use
+    uint32_t
+    function (FunctionDeclarationNode* declaration)
+    {
+      auto entry = m_functions.find (declaration);
+      if (entry != m_functions.end ())
+        return entry->second;
+
+      // m_function points into the vector
+      size_t current = m_function - m_module.functions.data ();
+      IrFunction external;
+      external.name = declaration->identifier;
+      external.returnsValue = declaration->valueType == ValueType::INT;
+      external.external = true;
+      for (ParameterNode* parameter : declaration->parameters)
+        external.parameters.push_back (parameter->isArray ? IrType::ADDRESS : IrType::INT);
+      m_module.functions.push_back (external);
+      m_function = &m_module.functions[current];
+
+      uint32_t index = (uint32_t) m_module.functions.size () - 1;
+      m_functions[declaration] = index;
+      return index;
+    }
+
+    IrModule&   m_module;
+    IrFunction* m_function;
+    uint32_t    m_block;
+    uint32_t    m_parameter;
+
+    std::unordered_map<DeclarationNode*, uint32_t> m_globals;
+    std::unordered_map<DeclarationNode*, uint32_t> m_functions;
+    // Value or address of each local and parameter of the function
+    std::unordered_map<DeclarationNode*, uint32_t> m_locals;
+
+    // Values of the expressions being evaluated
+    std::vector<uint32_t> m_values;
+    // Targets of the assignments and input calls being evaluated,
+    // innermost last
+    std::vector<VariableExpressionNode*> m_targets;
+    // Join blocks of the ifs and exit blocks of the whiles being
+    // lowered, innermost last, and the whiles' condition blocks
+    std::vector<uint32_t> m_joins;
+    std::vector<uint32_t> m_headers;
+  };
+}
+
+/***********************************************************************/
+
+void
+lowerProgram (ProgramNode* program, IrModule& module)
+{
+  module.clear ();
+  Lowering lowering (module);
+  lowering.walk (program);
+}
@@ -0,0 +1,34 @@
+/*
+  Filename   : Lowering.h
+  Author     : Philip Androwick
+  Description: Lowers a checked tree to the three-address IR.  Scalar
+               locals and parameters become values that are assigned
+               with COPY; the IR is put in SSA form afterwards (SSA.h).
+               Global scalars and every array live in memory.
+*/
+
+/***********************************************************************/
+
+#ifndef LOWERING_H
+#define LOWERING_H
+
+/***********************************************************************/
+// Local includes
+
+#include "IR.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// Replaces module with the IR of program, which must have been resolved
+//   and checked.  Locals start out as 0.  Every block ends with a
+//   terminator, and each if gets an else block of its own, so no edge
+//   goes from a block with several successors to one with several
+//   predecessors.  Code after a return is left in blocks no edge
+//   reaches.
+void
+lowerProgram (ProgramNode* program, IrModule& module);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,366 @@
+/*
+  Filename   : SSA.cc
+  Author     : Philip Androwick
+  Description: SSA construction.  A variable is a value some COPY
+               assigns; every other value already has one definition.
+               Each definition of a variable gets a fresh value, and
+               phis are kept aside per block while renaming and put at
+               the front of their blocks when the instruction array is
+               rebuilt.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+/***********************************************************************/
+// Local includes
+
+#include "SSA.h"
+#include "Dominators.h"
+
+/***********************************************************************/
+
+namespace
+{
+  struct Phi
+  {
+    // Index into the function's variables
+    uint32_t variable;
+    IrInstruction instruction;
+  };
+
+  // Calls f on every value instruction reads, including call and phi
+  // operands
+  template<typename F>
+  void
+  forEachUse (IrFunction& function, IrInstruction& instruction, F f)
+  {
+    if (instruction.op == IrOpcode::CALL || instruction.op == IrOpcode::PHI)
+    {
+      for (uint32_t n = 0; n < instruction.b; ++n)
+        f (function.operands[instruction.a + n]);
+    }
+    else
+      forEachOperand (instruction, f);
+  }
+
+  // Renumbers the values in order of definition and packs the call and
+  // phi operands in instruction order, dropping what nothing refers to
+  void
+  compactValues (IrFunction& function)
+  {
+    std::vector<uint32_t> renumbered (function.types.size (), IR_NO_VALUE);
+    std::vector<IrType> types;
+    std::vector<std::string> names;
+    for (IrInstruction& instruction : function.instructions)
+    {
+      if (instruction.dest == IR_NO_VALUE)
+        continue;
+      renumbered[instruction.dest] = (uint32_t) types.size ();
+      types.push_back (function.types[instruction.dest]);
+      names.push_back (std::move (function.names[instruction.dest]));
+    }
+
+    std::vector<uint32_t> operands;
+    for (IrInstruction& instruction : function.instructions)
+    {
+      if (instruction.dest != IR_NO_VALUE)
+        instruction.dest = renumbered[instruction.dest];
+      if (instruction.op == IrOpcode::CALL || instruction.op == IrOpcode::PHI)
+      {
+        uint32_t first = (uint32_t) operands.size ();
+        for (uint32_t n = 0; n < instruction.b; ++n)
+          operands.push_back (function.operands[instruction.a + n]);
+        instruction.a = first;
+      }
+    }
+    function.operands = std::move (operands);
+
+    for (IrInstruction& instruction : function.instructions)
+      forEachUse (function, instruction, [&] (uint32_t& value) {
+        if (renumbered[value] == IR_NO_VALUE)
+          throw std::logic_error ("ssa: %" + std::to_string (value) + " in " + function.name + " is never defined");
+        value = renumbered[value];
+      });
+    function.types = std::move (types);
+    function.names = std::move (names);
+  }
+}
+
+/***********************************************************************/
+
+void
+removeUnreachableBlocks (IrFunction& function)
+{
+  std::vector<IrBlock>& blocks = function.blocks;
+  std::vector<bool> reachable (blocks.size (), false);
+  std::vector<uint32_t> stack;
+  if (!blocks.empty ())
+  {
+    reachable[0] = true;
+    stack.push_back (0);
+  }
+  while (!stack.empty ())
+  {
+    uint32_t block = stack.back ();
+    stack.pop_back ();
+    for (uint32_t successor : blocks[block].successors)
+      if (!reachable[successor])
+      {
+        reachable[successor] = true;
+        stack.push_back (successor);
+      }
+  }
+
+  // Keep the blocks in layout order, so that falling through a jump to
+  // the next block stays possible for a code generator
+  std::vector<uint32_t> order;
+  for (uint32_t block = 0; block < blocks.size (); ++block)
+    if (reachable[block])
+      order.push_back (block);
+  std::sort (order.begin (), order.end (), [&] (uint32_t a, uint32_t b) {
+    return blocks[a].first < blocks[b].first;
+  });
+  std::vector<uint32_t> renumbered (blocks.size (), IR_NO_VALUE);
+  for (uint32_t n = 0; n < order.size (); ++n)
+    renumbered[order[n]] = n;
+
+  std::vector<IrInstruction> instructions;
+  std::vector<IrBlock> kept;
+  for (uint32_t old : order)
+  {
+    IrBlock block;
+    block.first = (uint32_t) instructions.size ();
+    block.count = blocks[old].count;
+    instructions.insert (instructions.end (), function.instructions.begin () + blocks[old].first,
+                         function.instructions.begin () + blocks[old].first + blocks[old].count);
+    for (uint32_t predecessor : blocks[old].predecessors)
+      if (reachable[predecessor])
+        block.predecessors.push_back (renumbered[predecessor]);
+    for (uint32_t successor : blocks[old].successors)
+      block.successors.push_back (renumbered[successor]);
+
+    IrInstruction& last = instructions.back ();
+    if (last.op == IrOpcode::JUMP)
+      last.a = renumbered[last.a];
+    else if (last.op == IrOpcode::BRANCH)
+    {
+      last.b = renumbered[last.b];
+      last.c = renumbered[last.c];
+    }
+    kept.push_back (std::move (block));
+  }
+  function.instructions = std::move (instructions);
+  function.blocks = std::move (kept);
+}
+
+/***********************************************************************/
+
+void
+buildSsa (IrFunction& function)
+{
+  if (function.external || function.ssa)
+    return;
+  removeUnreachableBlocks (function);
+  size_t blockCount = function.blocks.size ();
+  DominatorTree tree (function);
+
+  // Number the variables and find the blocks that assign each one
+  std::vector<uint32_t> variableOf (function.types.size (), IR_NO_VALUE);
+  std::vector<uint32_t> variables;
+  for (const IrInstruction& instruction : function.instructions)
+    if (instruction.op == IrOpcode::COPY && variableOf[instruction.dest] == IR_NO_VALUE)
+    {
+      variableOf[instruction.dest] = (uint32_t) variables.size ();
+      variables.push_back (instruction.dest);
+    }
+
+  // Only a variable read in some block before that block assigns it can
+  // need a phi
+  std::vector<std::vector<uint32_t>> definingBlocks (variables.size ());
+  std::vector<bool> global (variables.size (), false);
+  std::vector<uint32_t> killedIn (variables.size (), NO_BLOCK);
+  for (uint32_t block = 0; block < blockCount; ++block)
+  {
+    const IrBlock& b = function.blocks[block];
+    for (uint32_t n = b.first; n < b.first + b.count; ++n)
+    {
+      IrInstruction& instruction = function.instructions[n];
+      forEachUse (function, instruction, [&] (uint32_t& value) {
+        uint32_t variable = variableOf[value];
+        if (variable != IR_NO_VALUE && killedIn[variable] != block)
+          global[variable] = true;
+      });
+      if (instruction.dest != IR_NO_VALUE && variableOf[instruction.dest] != IR_NO_VALUE)
+      {
+        uint32_t variable = variableOf[instruction.dest];
+        if (killedIn[variable] != block)
+          definingBlocks[variable].push_back (block);
+        killedIn[variable] = block;
+      }
+    }
+  }
+
+  // Phis go on the iterated dominance frontier of the assignments
+  std::vector<std::vector<Phi>> phis (blockCount);
+  std::vector<uint32_t> hasPhi (blockCount, IR_NO_VALUE);
+  std::vector<uint32_t> queued (blockCount, IR_NO_VALUE);
+  std::vector<uint32_t> worklist;
+  for (uint32_t variable = 0; variable < variables.size (); ++variable)
+  {
+    if (!global[variable])
+      continue;
+    worklist = definingBlocks[variable];
+    for (uint32_t block : worklist)
+      queued[block] = variable;
+    while (!worklist.empty ())
+    {
+      uint32_t block = worklist.back ();
+      worklist.pop_back ();
+      for (uint32_t join : tree.getFrontier (block))
+      {
+        if (hasPhi[join] == variable)
+          continue;
+        hasPhi[join] = variable;
+        uint32_t count = (uint32_t) function.blocks[join].predecessors.size ();
+        uint32_t first = (uint32_t) function.operands.size ();
+        function.operands.insert (function.operands.end (), count, IR_NO_VALUE);
+        phis[join].push_back ({ variable, { IrOpcode::PHI, IR_NO_VALUE, first, count, 0 } });
+        if (queued[join] != variable)
+        {
+          queued[join] = variable;
+          worklist.push_back (join);
+        }
+      }
+    }
+  }
+
+  // Rename along the dominator tree.  Each variable has a stack of its
+  // current values; what a block pushes is logged and popped when the
+  // walk leaves the block.
+  std::vector<std::vector<uint32_t>> current (variables.size ());
+  std::vector<uint32_t> pushed;
+  std::vector<IrInstruction> undefined;
+  uint32_t undefinedValue = IR_NO_VALUE;
+
+  auto define = [&] (uint32_t variable) {
+    uint32_t value = function.addValue (function.types[variables[variable]], function.names[variables[variable]]);
+    current[variable].push_back (value);
+    pushed.push_back (variable);
+    return value;
+  };
+
+  // The walk stack holds (block, next child, log size on entry)
+  struct Frame
+  {
+    uint32_t block;
+    size_t   child;
+    size_t   log;
+  };
+  std::vector<Frame> walk;
+  if (blockCount != 0)
+    walk.push_back ({ 0, 0, 0 });
+  bool entering = true;
+  while (!walk.empty ())
+  {
+    Frame& frame = walk.back ();
+    uint32_t block = frame.block;
+    if (entering)
+    {
+      for (Phi& phi : phis[block])
+        phi.instruction.dest = define (phi.variable);
+
+      const IrBlock& b = function.blocks[block];
+      for (uint32_t n = b.first; n < b.first + b.count; ++n)
+      {
+        IrInstruction& instruction = function.instructions[n];
+        forEachUse (function, instruction, [&] (uint32_t& value) {
+          uint32_t variable = variableOf[value];
+          if (variable == IR_NO_VALUE)
+            return;
+          if (current[variable].empty ())
+            throw std::logic_error ("ssa: " + function.names[value] + " in " + function.name
+                                    + " is read before its declaration");
+          value = current[variable].back ();
+        });
+        if (instruction.dest != IR_NO_VALUE && variableOf[instruction.dest] != IR_NO_VALUE)
+          instruction.dest = define (variableOf[instruction.dest]);
+      }
+
+      // Fill in this block's operand of each successor's phis
+      for (uint32_t successor : b.successors)
+      {
+        const std::vector<uint32_t>& predecessors = function.blocks[successor].predecessors;
+        size_t slot = std::find (predecessors.begin (), predecessors.end (), block) - predecessors.begin ();
+        for (Phi& phi : phis[successor])
+        {
+          uint32_t value;
+          if (!current[phi.variable].empty ())
+            value = current[phi.variable].back ();
+          else
+          {
+            if (undefinedValue == IR_NO_VALUE)
+            {
+              undefinedValue = function.addValue (IrType::INT, "undefined");
+              undefined.push_back ({ IrOpcode::CONST, undefinedValue, 0, 0, 0 });
+            }
+            value = undefinedValue;
+          }
+          function.operands[phi.instruction.a + slot] = value;
+        }
+      }
+    }
+
+    const std::vector<uint32_t>& children = tree.getChildren (block);
+    if (frame.child < children.size ())
+    {
+      uint32_t child = children[frame.child++];
+      walk.push_back ({ child, 0, pushed.size () });
+      entering = true;
+    }
+    else
+    {
+      while (pushed.size () > frame.log)
+      {
+        current[pushed.back ()].pop_back ();
+        pushed.pop_back ();
+      }
+      walk.pop_back ();
+      entering = false;
+    }
+  }
+
+  // Rebuild the instruction array with each block's phis first
+  std::vector<IrInstruction> instructions;
+  instructions.reserve (function.instructions.size () + undefined.size ());
+  for (uint32_t block = 0; block < blockCount; ++block)
+  {
+    IrBlock& b = function.blocks[block];
+    uint32_t first = (uint32_t) instructions.size ();
+    for (const Phi& phi : phis[block])
+      instructions.push_back (phi.instruction);
+    if (block == 0)
+      instructions.insert (instructions.end (), undefined.begin (), undefined.end ());
+    instructions.insert (instructions.end (), function.instructions.begin () + b.first,
+                         function.instructions.begin () + b.first + b.count);
+    b.first = first;
+    b.count = (uint32_t) instructions.size () - first;
+  }
+  function.instructions = std::move (instructions);
+
+  compactValues (function);
+  function.ssa = true;
+}
+
+/***********************************************************************/
+
+void
+buildSsa (IrModule& module)
+{
+  for (IrFunction& function : module.functions)
+    buildSsa (function);
+}
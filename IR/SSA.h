@@ -0,0 +1,42 @@
+/*
+  Filename   : SSA.h
+  Author     : Philip Androwick
+  Description: Conversion of lowered IR to static single assignment form.
+               Phis are placed on the iterated dominance frontiers of
+               each variable's definitions (Cytron et al.), only for
+               variables that are live into some block ("semi-pruned"),
+               and the variables are then renamed along the dominator
+               tree.
+*/
+
+/***********************************************************************/
+
+#ifndef SSA_H
+#define SSA_H
+
+/***********************************************************************/
+// Local includes
+
+#include "IR.h"
+
+/***********************************************************************/
+
+// Drops blocks no path from the entry reaches and renumbers the rest in
+//   the order they appear in the instruction array
+void
+removeUnreachableBlocks (IrFunction& function);
+
+// Puts function, as lowered, in SSA form.  Unreachable blocks are
+//   removed first, and the values are renumbered in order of definition
+//   afterwards.  A phi operand for a path on which its variable was
+//   never assigned (a local declared inside a loop, say) reads 0.
+void
+buildSsa (IrFunction& function);
+
+// Converts every function of module that has a body
+void
+buildSsa (IrModule& module);
+
+/***********************************************************************/
+
+#endif
@@ -29,9 +29,15 @@ using std::string;
 Token
 Lexer::getToken ()
 {
+  if (m_inComment)
+  {
+    m_inComment = false;
+    skipBlockComment ();
+  }
+
   while (true)
   {
-    char c = getChar ();
+    int c = getChar ();
     
     if (isalpha (c))
       return lexId ();
@@ -66,28 +72,17 @@ Lexer::getToken ()
       if (c == '/')
       {
         // Continue down file until end of line is found
-        while (c != '\n') 
+        while (c != '\n' && c != EOF) 
         {
           c = getChar ();
         }
         break;
       }
       // Multi-line comment
+      // An unterminated comment runs to the end of the file
       else if (c == '*')
       {
-        while (true)
-        {  
-          // If a * is found, and then a / is found after
-          // it, then break the loop
-
-          if ((c = getChar()) == '*')
-          {
-            if ((c = getChar ()) != '/') 
-              ungetChar (c);
-            else
-              break;
-          }
-        }
+        skipBlockComment ();
         break;
       }
       ungetChar (c);
@@ -158,7 +153,7 @@ Lexer::getToken ()
       return Token (END_OF_FILE, m_lineNum, m_columnNum);
 
     default:
-      std::string s (1, c);
+      std::string s (1, (char) c);
       return Token (ERROR, m_lineNum, m_columnNum, s);
     }
   }
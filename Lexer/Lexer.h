@@ -12,9 +12,10 @@
 
 /***********************************************************************/
 
+#include <cctype>
 #include <string>
 #include <stdio.h>
-#include <map>
+#include <unordered_map>
 
 /***********************************************************************/
 
@@ -60,11 +61,33 @@ struct Token
 class Lexer
 {
 public:
+  // Lexes the whole of srcFile, which is read into memory up front
   Lexer (FILE* srcFile)
   {
-    m_srcFile = srcFile;
-    m_lineNum = 1;
+    int c;
+    while (srcFile != nullptr && (c = fgetc (srcFile)) != EOF)
+      m_ownedSource += (char) c;
+    reset (m_ownedSource.data (), m_ownedSource.data () + m_ownedSource.size ());
+  }
+
+  // Lexes the characters in [begin, end); the buffer is not copied and
+  //   must outlive the lexer
+  Lexer (const char* begin, const char* end)
+  {
+    reset (begin, end);
+  }
+
+  // Starts over on a new buffer, so one lexer can be reused.  A lexer
+  //   for part of a source starts at the beginning of line lineNum, and
+  //   inComment says whether that line begins inside a /* */ comment.
+  void
+  reset (const char* begin, const char* end, int lineNum = 1, bool inComment = false)
+  {
+    m_current = begin;
+    m_end = end;
+    m_lineNum = lineNum;
     m_columnNum = 1;
+    m_inComment = inComment;
   }
 
   Token
@@ -86,8 +109,16 @@ private:
   int
   getChar ()
   {
-    int letter = fgetc (m_srcFile);
+    m_prevLineNum = m_lineNum;
+    m_prevColumnNum = m_columnNum;
     ++m_columnNum;
+    if (m_current == m_end)
+    {
+      recentLetter = EOF;
+      return EOF;
+    }
+
+    int letter = (unsigned char) *m_current++;
     if (letter == '\n')
     {
       ++m_lineNum;
@@ -97,33 +128,59 @@ private:
     return letter;
   }
 
+  // Only the most recent character may be pushed back
   void
   ungetChar (int c)
   {
-    ungetc (c, m_srcFile);
-    --m_columnNum;
+    if (c != EOF)
+      --m_current;
+    m_lineNum = m_prevLineNum;
+    m_columnNum = m_prevColumnNum;
+  }
+
+  // Skips to just past the "*/" ending a comment, or to the end of the
+  //   file for an unterminated comment
+  void
+  skipBlockComment ()
+  {
+    int c;
+    while (true)
+    {  
+      // If a * is found, and then a / is found after
+      // it, then break the loop
+      if ((c = getChar()) == EOF)
+        break;
+      else if (c == '*')
+      {
+        if ((c = getChar ()) != '/') 
+          ungetChar (c);
+        else
+          break;
+      }
+    }
   }
 
   Token
   lexId ()
   {
     std::string id = "";
-    id += recentLetter;
-    char c;
+    id += (char) recentLetter;
+    int c;
 
     // Continue down file, until you hit a non-alpha char
     while (isalpha (c = getChar ()))
     {
-      id += c;
+      id += (char) c;
     }
     ungetChar (c);
 
-    std::map<std::string, TokenType> tokenMap { {"if", IF}, {"else", ELSE},
+    static const std::unordered_map<std::string, TokenType> tokenMap { {"if", IF}, {"else", ELSE},
       {"int", INT}, {"void", VOID}, {"return", RETURN}, {"while", WHILE} };
     
-    // Return akeyword token if found in map
-    if (tokenMap[id] != 0)
-      return Token(tokenMap[id], m_lineNum, m_columnNum, id);
+    // Return a keyword token if found in map
+    auto keyword = tokenMap.find (id);
+    if (keyword != tokenMap.end ())
+      return Token(keyword->second, m_lineNum, m_columnNum, id);
     else
       return Token(ID, m_lineNum, m_columnNum, id);
   }
@@ -132,16 +189,20 @@ private:
   lexNum ()
   {
     std::string id = "";
-    id += recentLetter;
-    char c;
+    id += (char) recentLetter;
+    int c;
 
     // Continue down file, until you hit a non-digit char
     while (isdigit (c = getChar ()))
     {
-      id += c;
+      id += (char) c;
     }
     ungetChar (c);
 
+    // Literals too large for an int are not valid numbers
+    if (id.size () > 10 || std::stoll (id) > 2147483647LL)
+      return Token (ERROR, m_lineNum, m_columnNum, id);
+
     // Convert string id into a number
     int num = stoi (id);
 
@@ -149,10 +210,15 @@ private:
   }
   
 private:
-  FILE* m_srcFile;
-  char  recentLetter;
+  std::string m_ownedSource;
+  const char* m_current;
+  const char* m_end;
+  int   recentLetter;
   int   m_lineNum;
   int   m_columnNum;
+  int   m_prevLineNum;
+  int   m_prevColumnNum;
+  bool  m_inComment;
 };
 
 /***********************************************************************/
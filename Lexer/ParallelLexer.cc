@@ -0,0 +1,168 @@
+/*
+  Filename   : ParallelLexer.cc
+  Author     : Philip Androwick
+  Description: Chunked lexing.  No token spans a line break, so the only
+               lexer state that carries over a break is whether it is
+               inside a block comment.  Each chunk is scanned once for
+               each of those two entry states; a serial pass over the
+               chunks then picks each one's real entry state and first
+               line number.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <cstring>
+
+/***********************************************************************/
+// Local includes
+
+#include "ParallelLexer.h"
+#include "../Compiler/Parallel.h"
+
+/***********************************************************************/
+
+namespace
+{
+  struct Chunk
+  {
+    const char* begin;
+    const char* end;
+    int         newlines;
+
+    // Indexed by whether the chunk is entered inside a comment: whether
+    //   it is left inside one, and whether a '$' ends lexing in it
+    bool        exitsInComment[2];
+    bool        terminates[2];
+
+    // Where lexing really enters the chunk
+    int         lineNum;
+    bool        inComment;
+
+    std::vector<Token> tokens;
+  };
+
+  // Follows comments through [p, end) the way Lexer::getToken does,
+  //   without making tokens.  No other token contains '/', '*' or '$'.
+  void
+  scanChunk (const char* p, const char* end, bool inComment,
+             bool& exitsInComment, bool& terminates)
+  {
+    terminates = false;
+    while (p < end)
+    {
+      char c = *p++;
+      if (inComment)
+      {
+        if (c == '*' && p < end && *p == '/')
+        {
+          ++p;
+          inComment = false;
+        }
+      }
+      else if (c == '$')
+      {
+        terminates = true;
+        break;
+      }
+      else if (c == '/' && p < end && *p == '/')
+      {
+        const char* newline = (const char*) memchr (p, '\n', end - p);
+        p = newline != nullptr ? newline + 1 : end;
+      }
+      else if (c == '/' && p < end && *p == '*')
+      {
+        ++p;
+        inComment = true;
+      }
+    }
+    exitsInComment = inComment;
+  }
+}
+
+/***********************************************************************/
+
+size_t
+lexParallel (const char* begin, const char* end, unsigned jobs,
+             std::vector<Token>& tokens)
+{
+  tokens.clear ();
+  size_t length = end - begin;
+  if (jobs <= 1 || length < 2 * PARALLEL_LEX_MIN_CHUNK)
+  {
+    Lexer lexer (begin, end);
+    do
+      tokens.push_back (lexer.getToken ());
+    while (tokens.back ().type != END_OF_FILE);
+    return 1;
+  }
+
+  // A few chunks per thread evens out the load; every chunk after the
+  //   first starts just after a line break
+  size_t target = std::max (PARALLEL_LEX_MIN_CHUNK, length / (jobs * 4));
+  std::vector<Chunk> chunks;
+  const char* start = begin;
+  while (start < end)
+  {
+    const char* split = end;
+    if ((size_t) (end - start) > target)
+    {
+      const char* newline = (const char*) memchr (start + target, '\n', end - start - target);
+      if (newline != nullptr)
+        split = newline + 1;
+    }
+    Chunk chunk;
+    chunk.begin = start;
+    chunk.end = split;
+    chunks.push_back (std::move (chunk));
+    start = split;
+  }
+
+  parallelFor (chunks.size (), jobs, [&] (size_t index, unsigned worker) {
+    Chunk& chunk = chunks[index];
+    chunk.newlines = (int) std::count (chunk.begin, chunk.end, '\n');
+    for (int inComment = 0; inComment < 2; ++inComment)
+      scanChunk (chunk.begin, chunk.end, inComment,
+                 chunk.exitsInComment[inComment], chunk.terminates[inComment]);
+  });
+
+  // Chunks after the one holding the '$' are never lexed
+  int lineNum = 1;
+  bool inComment = false;
+  size_t used = chunks.size ();
+  for (size_t n = 0; n < chunks.size (); ++n)
+  {
+    chunks[n].lineNum = lineNum;
+    chunks[n].inComment = inComment;
+    if (chunks[n].terminates[inComment])
+    {
+      used = n + 1;
+      break;
+    }
+    inComment = chunks[n].exitsInComment[inComment];
+    lineNum += chunks[n].newlines;
+  }
+
+  parallelFor (used, jobs, [&] (size_t index, unsigned worker) {
+    Chunk& chunk = chunks[index];
+    Lexer lexer (nullptr, nullptr);
+    lexer.reset (chunk.begin, chunk.end, chunk.lineNum, chunk.inComment);
+    do
+      chunk.tokens.push_back (lexer.getToken ());
+    while (chunk.tokens.back ().type != END_OF_FILE);
+  });
+
+  // Only the last chunk's END_OF_FILE is real
+  size_t total = 0;
+  for (size_t n = 0; n < used; ++n)
+    total += chunks[n].tokens.size () - 1;
+  tokens.reserve (total + 1);
+  for (size_t n = 0; n < used; ++n)
+  {
+    std::vector<Token>& chunkTokens = chunks[n].tokens;
+    size_t count = n + 1 < used ? chunkTokens.size () - 1 : chunkTokens.size ();
+    std::move (chunkTokens.begin (), chunkTokens.begin () + count, std::back_inserter (tokens));
+  }
+  return used;
+}
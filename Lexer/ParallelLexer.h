@@ -0,0 +1,42 @@
+/*
+  Filename   : ParallelLexer.h
+  Author     : Philip Androwick
+  Description: Lexes a large source on several threads.  The source is
+               split into chunks at line breaks; a quick scan of every
+               chunk finds where block comments cross from one chunk into
+               the next, and the chunks are then lexed independently and
+               joined.  The tokens, and their lines and columns, are the
+               same as a single Lexer produces.
+*/
+
+/***********************************************************************/
+
+#ifndef PARALLEL_LEXER_H
+#define PARALLEL_LEXER_H
+
+/***********************************************************************/
+// System includes
+
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "Lexer.h"
+
+/***********************************************************************/
+
+// Sources smaller than this are lexed serially; larger ones are split
+//   into chunks of at least this many bytes
+const size_t PARALLEL_LEX_MIN_CHUNK = 64 * 1024;
+
+// Replaces tokens with every token of [begin, end), ending with
+//   END_OF_FILE, using up to jobs threads.  Returns the number of chunks
+//   the source was split into.
+size_t
+lexParallel (const char* begin, const char* end, unsigned jobs,
+             std::vector<Token>& tokens);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,424 @@
+/*
+  Filename   : AstRewriter.cc
+  Author     : Philip Androwick
+  Description: Replacing expressions during a walk, and facts about
+               trees the optimization passes share.
+*/
+
+/***********************************************************************/
+// Local includes
+
+#include "AstRewriter.h"
+
+/***********************************************************************/
+
+namespace
+{
+  class SideEffectFinder : public AstWalker
+  {
+  public:
+    SideEffectFinder ()
+      : found (false)
+    { }
+
+    bool enter (AssignmentExpressionNode* node) { found = true; return false; }
+    bool enter (CallExpressionNode* node) { found = true; return false; }
+    bool enter (SubscriptExpressionNode* node) { found = true; return false; }
+
+    virtual bool
+    enter (MultiplicativeExpressionNode* node)
+    {
+      IntegerLiteralExpressionNode* divisor = asLiteral (node->right);
+      if (node->multOperator == MultiplicativeOperatorType::DIVIDE && (divisor == nullptr || divisor->value == 0))
+        found = true;
+      return !found;
+    }
+
+    bool found;
+  };
+
+  class Renamer : public AstWalker
+  {
+  public:
+    Renamer (DeclarationNode* declaration)
+      : m_declaration (declaration)
+    { }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      if (node->usingDecNode == m_declaration)
+        node->identifier = m_declaration->identifier;
+      return true;
+    }
+
+    virtual bool
+    enter (SubscriptExpressionNode* node)
+    {
+      if (node->usingDecNode == m_declaration)
+        node->identifier = m_declaration->identifier;
+      return true;
+    }
+
+  private:
+    DeclarationNode* m_declaration;
+  };
+}
+
+/***********************************************************************/
+
+AstRewriter::AstRewriter (std::initializer_list<ChildSlot> edgeSlots)
+  : AstWalker (edgeSlots), m_replaced (nullptr), m_replacement (nullptr)
+{
+  for (ChildSlot slot : { ChildSlot::CONDITION, ChildSlot::RETURN_VALUE, ChildSlot::EXPRESSION,
+                          ChildSlot::VALUE, ChildSlot::INDEX, ChildSlot::ARGUMENT,
+                          ChildSlot::LEFT, ChildSlot::RIGHT })
+    addEdgeSlot (slot);
+}
+
+/***********************************************************************/
+
+void
+AstRewriter::leaveChild (Node* parent, ChildSlot slot)
+{
+  // The child just walked is the only one that can have been replaced
+  if (m_replaced == nullptr)
+    return;
+  std::vector<ExpressionNode**> slots;
+  getExpressionSlots (parent, slots);
+  for (ExpressionNode** child : slots)
+    if (*child == m_replaced)
+    {
+      *child = m_replacement;
+      break;
+    }
+  m_replaced = nullptr;
+}
+
+/***********************************************************************/
+
+void
+AstRewriter::replace (ExpressionNode* node, ExpressionNode* replacement)
+{
+  m_replaced = node;
+  m_replacement = replacement;
+}
+
+/***********************************************************************/
+
+bool
+WriteCollector::enter (AssignmentExpressionNode* node)
+{
+  written.insert (node->variable->usingDecNode);
+  return true;
+}
+
+/***********************************************************************/
+
+bool
+WriteCollector::enter (CallExpressionNode* node)
+{
+  if (isInputCall (node))
+    written.insert (static_cast<VariableExpressionNode*> (node->arguments[0])->usingDecNode);
+  return true;
+}
+
+/***********************************************************************/
+
+bool
+LoopEffectCollector::enter (WhileStatementNode* node)
+{
+  m_loops.push_back (&effects[node]);
+  return true;
+}
+
+void
+LoopEffectCollector::leave (WhileStatementNode* node)
+{
+  LoopEffects* loop = m_loops.back ();
+  m_loops.pop_back ();
+  if (m_loops.empty ())
+    return;
+  // What the inner loop changes, the loop around it changes too
+  m_loops.back ()->written.insert (loop->written.begin (), loop->written.end ());
+  m_loops.back ()->calls = m_loops.back ()->calls || loop->calls;
+}
+
+bool
+LoopEffectCollector::enter (VariableDeclarationNode* node)
+{
+  write (node);
+  return true;
+}
+
+bool
+LoopEffectCollector::enter (ArrayDeclarationNode* node)
+{
+  write (node);
+  return true;
+}
+
+bool
+LoopEffectCollector::enter (AssignmentExpressionNode* node)
+{
+  write (node->variable->usingDecNode);
+  return true;
+}
+
+bool
+LoopEffectCollector::enter (CallExpressionNode* node)
+{
+  if (isInputCall (node))
+    write (static_cast<VariableExpressionNode*> (node->arguments[0])->usingDecNode);
+  else if (!isBuiltinCall (node) && !m_loops.empty ())
+    m_loops.back ()->calls = true;
+  return true;
+}
+
+void
+LoopEffectCollector::write (DeclarationNode* declaration)
+{
+  if (!m_loops.empty ())
+    m_loops.back ()->written.insert (declaration);
+}
+
+/***********************************************************************/
+
+bool
+CallCollector::enter (CallExpressionNode* node)
+{
+  if (!isBuiltinCall (node))
+    calls.push_back (node);
+  return true;
+}
+
+/***********************************************************************/
+
+bool
+DeclarationCollector::enter (VariableDeclarationNode* node)
+{
+  declarations.push_back (node);
+  return true;
+}
+
+bool
+DeclarationCollector::enter (ArrayDeclarationNode* node)
+{
+  declarations.push_back (node);
+  return true;
+}
+
+bool
+DeclarationCollector::enter (ParameterNode* node)
+{
+  declarations.push_back (node);
+  return true;
+}
+
+/***********************************************************************/
+
+bool
+StatementSlotCollector::enter (CompoundStatementNode* node)
+{
+  getStatementSlots (node, slots);
+  return true;
+}
+
+bool
+StatementSlotCollector::enter (IfStatementNode* node)
+{
+  getStatementSlots (node, slots);
+  return true;
+}
+
+bool
+StatementSlotCollector::enter (WhileStatementNode* node)
+{
+  getStatementSlots (node, slots);
+  return true;
+}
+
+/***********************************************************************/
+
+void
+getExpressionSlots (Node* node, std::vector<ExpressionNode**>& slots)
+{
+  if (IfStatementNode* statement = dynamic_cast<IfStatementNode*> (node))
+    slots.push_back (&statement->conditionalExpression);
+  else if (WhileStatementNode* statement = dynamic_cast<WhileStatementNode*> (node))
+    slots.push_back (&statement->conditionalExpression);
+  else if (ReturnStatementNode* statement = dynamic_cast<ReturnStatementNode*> (node))
+  {
+    if (statement->expression != nullptr)
+      slots.push_back (&statement->expression);
+  }
+  else if (ExpressionStatementNode* statement = dynamic_cast<ExpressionStatementNode*> (node))
+  {
+    if (statement->expression != nullptr)
+      slots.push_back (&statement->expression);
+  }
+  else if (AssignmentExpressionNode* expression = dynamic_cast<AssignmentExpressionNode*> (node))
+    slots.push_back (&expression->expression);
+  else if (SubscriptExpressionNode* expression = dynamic_cast<SubscriptExpressionNode*> (node))
+    slots.push_back (&expression->index);
+  else if (CallExpressionNode* expression = dynamic_cast<CallExpressionNode*> (node))
+  {
+    for (ExpressionNode*& argument : expression->arguments)
+      slots.push_back (&argument);
+  }
+  else if (AdditiveExpressionNode* expression = dynamic_cast<AdditiveExpressionNode*> (node))
+  {
+    slots.push_back (&expression->left);
+    slots.push_back (&expression->right);
+  }
+  else if (MultiplicativeExpressionNode* expression = dynamic_cast<MultiplicativeExpressionNode*> (node))
+  {
+    slots.push_back (&expression->left);
+    slots.push_back (&expression->right);
+  }
+  else if (RelationalExpressionNode* expression = dynamic_cast<RelationalExpressionNode*> (node))
+  {
+    slots.push_back (&expression->left);
+    slots.push_back (&expression->right);
+  }
+}
+
+/***********************************************************************/
+
+void
+getStatementSlots (Node* node, std::vector<StatementNode**>& slots)
+{
+  if (CompoundStatementNode* statement = dynamic_cast<CompoundStatementNode*> (node))
+  {
+    for (StatementNode*& child : statement->statements)
+      slots.push_back (&child);
+  }
+  else if (IfStatementNode* statement = dynamic_cast<IfStatementNode*> (node))
+  {
+    slots.push_back (&statement->thenStatement);
+    if (statement->elseStatement != nullptr)
+      slots.push_back (&statement->elseStatement);
+  }
+  else if (WhileStatementNode* statement = dynamic_cast<WhileStatementNode*> (node))
+    slots.push_back (&statement->body);
+}
+
+/***********************************************************************/
+
+size_t
+countNodes (Node* root)
+{
+  NodeCounter counter;
+  counter.walk (root);
+  return counter.count;
+}
+
+/***********************************************************************/
+
+bool
+isScalarLocal (DeclarationNode* declaration)
+{
+  if (ParameterNode* parameter = dynamic_cast<ParameterNode*> (declaration))
+    return !parameter->isArray;
+  return declaration->nestLevel > 0 && dynamic_cast<VariableDeclarationNode*> (declaration) != nullptr
+    && dynamic_cast<ArrayDeclarationNode*> (declaration) == nullptr;
+}
+
+/***********************************************************************/
+
+bool
+hasSideEffects (ExpressionNode* expression)
+{
+  SideEffectFinder finder;
+  finder.walk (expression);
+  return finder.found;
+}
+
+/***********************************************************************/
+
+namespace
+{
+  bool
+  isPlainRead (ExpressionNode* expression, DeclarationNode* variable)
+  {
+    VariableExpressionNode* read = dynamic_cast<VariableExpressionNode*> (expression);
+    return read != nullptr && dynamic_cast<SubscriptExpressionNode*> (read) == nullptr
+      && read->usingDecNode == variable;
+  }
+}
+
+bool
+isIncrement (StatementNode* statement, DeclarationNode*& variable, uint32_t& step)
+{
+  ExpressionStatementNode* expression = dynamic_cast<ExpressionStatementNode*> (statement);
+  if (expression == nullptr)
+    return false;
+  AssignmentExpressionNode* assignment = dynamic_cast<AssignmentExpressionNode*> (expression->expression);
+  if (assignment == nullptr || dynamic_cast<SubscriptExpressionNode*> (assignment->variable) != nullptr)
+    return false;
+  AdditiveExpressionNode* sum = dynamic_cast<AdditiveExpressionNode*> (assignment->expression);
+  if (sum == nullptr)
+    return false;
+
+  DeclarationNode* target = assignment->variable->usingDecNode;
+  IntegerLiteralExpressionNode* literal = asLiteral (sum->right);
+  bool plus = sum->addOperator == AdditiveOperatorType::PLUS;
+  if (literal != nullptr && isPlainRead (sum->left, target))
+    step = plus ? (uint32_t) literal->value : 0u - (uint32_t) literal->value;
+  else if (plus && (literal = asLiteral (sum->left)) != nullptr && isPlainRead (sum->right, target))
+    step = (uint32_t) literal->value;
+  else
+    return false;
+  variable = target;
+  return true;
+}
+
+/***********************************************************************/
+
+void
+renameDeclaration (DeclarationNode* declaration, Node* scope, const std::string& name)
+{
+  declaration->identifier = name;
+  Renamer renamer (declaration);
+  renamer.walk (scope);
+}
+
+/***********************************************************************/
+
+VariableDeclarationNode*
+makeLocal (AstArena& arena, NameSupply& names, const std::string& base, int row, int col)
+{
+  VariableDeclarationNode* local
+    = arena.make<VariableDeclarationNode> (ValueType::INT, names.make (base), DataType::VARIABLE, row, col);
+  // Any level above the globals' until the tree is resolved again
+  local->nestLevel = 1;
+  return local;
+}
+
+/***********************************************************************/
+
+VariableExpressionNode*
+makeRead (AstArena& arena, DeclarationNode* variable, int row, int col)
+{
+  VariableExpressionNode* use
+    = arena.make<VariableExpressionNode> (variable->identifier, ValueType::INT, DataType::VARIABLE, row, col);
+  use->usingDecNode = variable;
+  return use;
+}
+
+/***********************************************************************/
+
+StatementNode*
+makeAssignment (AstArena& arena, VariableDeclarationNode* local, ExpressionNode* value)
+{
+  return arena.make<ExpressionStatementNode> (arena.make<AssignmentExpressionNode> (
+    ValueType::INT, makeRead (arena, local, value->row, value->col), value, value->row, value->col));
+}
+
+/***********************************************************************/
+
+std::string
+NameSupply::make (const std::string& base)
+{
+  return base + "_" + std::to_string (m_next.emplace (base, 1).first->second++);
+}
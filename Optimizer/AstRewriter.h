@@ -0,0 +1,291 @@
+/*
+  Filename   : AstRewriter.h
+  Author     : Philip Androwick
+  Description: What the optimization passes share for changing a checked
+               tree in place.  The tree must not be hash-consed: a shared
+               subtree would be changed everywhere it is used.
+*/
+
+/***********************************************************************/
+
+#ifndef AST_REWRITER_H
+#define AST_REWRITER_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+// An AstWalker whose hooks may replace the expression they are in: the
+//   replacement takes the expression's place in its parent as soon as
+//   the expression has been walked, before the parent's leave hook
+//   runs.  Subclasses that override leaveChild call this one's first.
+class AstRewriter : public AstWalker
+{
+public:
+  explicit AstRewriter (std::initializer_list<ChildSlot> edgeSlots = { });
+
+  virtual void
+  leaveChild (Node* parent, ChildSlot slot) override;
+
+protected:
+  // Puts replacement in node's place; called from node's enter or
+  //   leave hook
+  void
+  replace (ExpressionNode* node, ExpressionNode* replacement);
+
+private:
+  ExpressionNode* m_replaced;
+  ExpressionNode* m_replacement;
+};
+
+/***********************************************************************/
+
+// Variables and arrays that an assignment or input call under the
+//   walked nodes writes
+class WriteCollector : public AstWalker
+{
+public:
+  virtual bool
+  enter (AssignmentExpressionNode* node) override;
+
+  virtual bool
+  enter (CallExpressionNode* node) override;
+
+  std::unordered_set<DeclarationNode*> written;
+};
+
+// What a while loop may change from one iteration to the next
+struct LoopEffects
+{
+  // Variables and arrays its condition and body write, and the locals
+  //   declared in it, which each iteration starts again
+  std::unordered_set<DeclarationNode*> written;
+  // Whether it calls a function with a declaration node, which may
+  //   write any global or array
+  bool calls = false;
+};
+
+// The effects of every while loop under the walked nodes, each loop's
+//   including those of the loops inside it, in one walk rather than
+//   one for each loop
+class LoopEffectCollector : public AstWalker
+{
+public:
+  virtual bool
+  enter (WhileStatementNode* node) override;
+
+  virtual void
+  leave (WhileStatementNode* node) override;
+
+  virtual bool
+  enter (VariableDeclarationNode* node) override;
+
+  virtual bool
+  enter (ArrayDeclarationNode* node) override;
+
+  virtual bool
+  enter (AssignmentExpressionNode* node) override;
+
+  virtual bool
+  enter (CallExpressionNode* node) override;
+
+  std::unordered_map<WhileStatementNode*, LoopEffects> effects;
+
+private:
+  void
+  write (DeclarationNode* declaration);
+
+  // The effects of the loops being walked, innermost last
+  std::vector<LoopEffects*> m_loops;
+};
+
+// Calls to functions with declaration nodes under the walked nodes, in
+//   the order walked
+class CallCollector : public AstWalker
+{
+public:
+  virtual bool
+  enter (CallExpressionNode* node) override;
+
+  std::vector<CallExpressionNode*> calls;
+};
+
+// The parameters and locals declared under the walked nodes
+class DeclarationCollector : public AstWalker
+{
+public:
+  virtual bool
+  enter (VariableDeclarationNode* node) override;
+
+  virtual bool
+  enter (ArrayDeclarationNode* node) override;
+
+  virtual bool
+  enter (ParameterNode* node) override;
+
+  std::vector<DeclarationNode*> declarations;
+};
+
+// The places of the statements under the walked one, outer statements
+//   before those inside them
+class StatementSlotCollector : public AstWalker
+{
+public:
+  virtual bool
+  enter (CompoundStatementNode* node) override;
+
+  virtual bool
+  enter (IfStatementNode* node) override;
+
+  virtual bool
+  enter (WhileStatementNode* node) override;
+
+  std::vector<StatementNode**> slots;
+};
+
+// The nodes under the walked one, itself included.  Subclasses that
+//   override an enter hook call this one's first.
+class NodeCounter : public AstWalker
+{
+public:
+  NodeCounter ()
+    : count (0)
+  { }
+
+  virtual bool enter (ProgramNode* node) override { ++count; return true; }
+  virtual bool enter (FunctionDeclarationNode* node) override { ++count; return true; }
+  virtual bool enter (VariableDeclarationNode* node) override { ++count; return true; }
+  virtual bool enter (ArrayDeclarationNode* node) override { ++count; return true; }
+  virtual bool enter (ParameterNode* node) override { ++count; return true; }
+  virtual bool enter (CompoundStatementNode* node) override { ++count; return true; }
+  virtual bool enter (IfStatementNode* node) override { ++count; return true; }
+  virtual bool enter (WhileStatementNode* node) override { ++count; return true; }
+  virtual bool enter (ForStatementNode* node) override { ++count; return true; }
+  virtual bool enter (ReturnStatementNode* node) override { ++count; return true; }
+  virtual bool enter (ExpressionStatementNode* node) override { ++count; return true; }
+  virtual bool enter (AssignmentExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (VariableExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (SubscriptExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (CallExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (AdditiveExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (MultiplicativeExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (RelationalExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (UnaryExpressionNode* node) override { ++count; return true; }
+  virtual bool enter (IntegerLiteralExpressionNode* node) override { ++count; return true; }
+
+  size_t count;
+};
+
+/***********************************************************************/
+
+// Adds the addresses of node's expression children to slots, in the
+//   order they are evaluated.  An assignment's target is not one: it
+//   is always a variable or a subscript.
+void
+getExpressionSlots (Node* node, std::vector<ExpressionNode**>& slots);
+
+// Adds the addresses of node's statement children to slots: the
+//   statements of a compound statement, the branches of an if, or the
+//   body of a while
+void
+getStatementSlots (Node* node, std::vector<StatementNode**>& slots);
+
+// Nodes in the tree under root, root included
+size_t
+countNodes (Node* root);
+
+// The literal expression is, or nullptr
+inline IntegerLiteralExpressionNode*
+asLiteral (ExpressionNode* expression)
+{
+  return dynamic_cast<IntegerLiteralExpressionNode*> (expression);
+}
+
+// Whether call is to input or output, the functions with no declaration
+//   node of their own
+inline bool
+isBuiltinCall (CallExpressionNode* call)
+{
+  return dynamic_cast<FunctionDeclarationNode*> (call->usingDecNode) == nullptr;
+}
+
+// Whether call is to input, which reads into its argument
+inline bool
+isInputCall (CallExpressionNode* call)
+{
+  return isBuiltinCall (call) && call->identifier == "input";
+}
+
+// Whether declaration is a scalar local or parameter.  Nothing but its
+//   own function's assignments and input calls can change one.
+bool
+isScalarLocal (DeclarationNode* declaration);
+
+// Whether evaluating expression can do more than compute its value:
+//   assign, call, or stop the program with a subscript out of bounds
+//   or a division that is not by a nonzero literal
+bool
+hasSideEffects (ExpressionNode* expression);
+
+// Whether statement is i = i + c, i = c + i or i = i - c for a scalar
+//   variable i and a literal c; if so, sets variable to i and step to
+//   what the statement adds, wrapping
+bool
+isIncrement (StatementNode* statement, DeclarationNode*& variable, uint32_t& step);
+
+// Gives declaration the name name, and every use of it under scope
+void
+renameDeclaration (DeclarationNode* declaration, Node* scope, const std::string& name);
+
+/***********************************************************************/
+
+class NameSupply;
+
+// A new int local named from base, for a pass to declare.  Until the
+//   tree is resolved again it counts as a local of any function.
+VariableDeclarationNode*
+makeLocal (AstArena& arena, NameSupply& names, const std::string& base, int row, int col);
+
+// A read of variable, a scalar
+VariableExpressionNode*
+makeRead (AstArena& arena, DeclarationNode* variable, int row, int col);
+
+// The statement local = value;
+StatementNode*
+makeAssignment (AstArena& arena, VariableDeclarationNode* local, ExpressionNode* value);
+
+/***********************************************************************/
+
+// Names for the declarations the passes make or move, unlike any in
+//   the program.  Source names are letters only, so a name with a digit
+//   cannot clash with one, and the base a name was made from is what
+//   comes before its last "_", so no two names made from one supply are
+//   the same.  The passes of a compilation share one.
+class NameSupply
+{
+public:
+  // base followed by "_" and the next number for base
+  std::string
+  make (const std::string& base);
+
+private:
+  // The number to give next for each base
+  std::unordered_map<std::string, unsigned> m_next;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,503 @@
+/*
+  Filename   : CommonSubexpressions.cc
+  Author     : Philip Androwick
+  Description: One walk numbers the values and decides, as it leaves
+               each operator, whether the operator repeats a value; a
+               repeat takes back the decisions made inside it, since its
+               operands will not be evaluated.  A second walk then
+               replaces the repeats and has the first computations they
+               read assign new locals.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "CommonSubexpressions.h"
+#include "AstRewriter.h"
+
+/***********************************************************************/
+
+namespace
+{
+  enum class ValueKind
+  {
+    LITERAL, ADDITIVE, MULTIPLICATIVE, RELATIONAL, ELEMENT
+  };
+
+  // What a value is computed from: the kind, the operator or literal,
+  //   the numbers of the operands, and for an element its array
+  typedef std::tuple<ValueKind, int, uint32_t, uint32_t, DeclarationNode*> ValueKey;
+
+  // An operator or subscript that is the first to compute its number,
+  //   or one that repeats it; a repeat reads holder, or the local the
+  //   first computation at first will assign
+  struct Decision
+  {
+    ExpressionNode*        node;
+    uint32_t               number;
+    bool                   repeat;
+    DeclarationNode*       holder;
+    size_t                 first;
+    CompoundStatementNode* compound;
+  };
+
+  // A number, and the calls and stores made before it was given; a
+  //   call loses the numbers of globals and of elements, and a store to
+  //   an array those of the elements it could change
+  struct Stamped
+  {
+    uint32_t number = 0;
+    size_t   calls = 0;
+    size_t   parameterStores = 0;
+    size_t   arrayStores = 0;
+  };
+
+  class ValueNumberer : public AstWalker
+  {
+  public:
+    ValueNumberer ()
+      : AstWalker ({ ChildSlot::CONDITION, ChildSlot::THEN, ChildSlot::ELSE, ChildSlot::BODY }), m_next (0),
+        m_calls (0), m_parameterStores (0), m_arrayStores (0)
+    { }
+
+    // Regions
+
+    virtual bool
+    enter (CompoundStatementNode* node) override
+    {
+      m_compounds.push_back (node);
+      reset ();
+      return true;
+    }
+
+    virtual void
+    leave (CompoundStatementNode* node) override
+    {
+      m_compounds.pop_back ();
+      reset ();
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node) override
+    {
+      reset ();
+    }
+
+    // An if's condition ends the region before it, while a while's is
+    //   evaluated again after the body
+    virtual void
+    enterChild (Node* parent, ChildSlot slot) override
+    {
+      if (slot != ChildSlot::CONDITION || dynamic_cast<WhileStatementNode*> (parent) != nullptr)
+        reset ();
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot) override
+    {
+      reset ();
+    }
+
+    // Writes
+
+    virtual bool
+    enter (AssignmentExpressionNode* node) override
+    {
+      m_targets.insert (node->variable);
+      return true;
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node) override
+    {
+      uint32_t value = m_numbers[node->expression];
+      DeclarationNode* declaration = node->variable->usingDecNode;
+      if (SubscriptExpressionNode* element = dynamic_cast<SubscriptExpressionNode*> (node->variable))
+      {
+        storeTo (declaration);
+        m_values[elementKey (declaration, m_numbers[element->index])] = value;
+      }
+      else
+      {
+        m_current[declaration] = stamp (value);
+        if (isScalarLocal (declaration))
+          m_holders[value].push_back (declaration);
+      }
+      m_numbers[node] = value;
+      m_effects.insert (node);
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node) override
+    {
+      if (isInputCall (node))
+        m_targets.insert (node->arguments[0]);
+      return true;
+    }
+
+    virtual void
+    leave (CallExpressionNode* node) override
+    {
+      if (isInputCall (node))
+      {
+        VariableExpressionNode* target = static_cast<VariableExpressionNode*> (node->arguments[0]);
+        if (dynamic_cast<SubscriptExpressionNode*> (target) != nullptr)
+          storeTo (target->usingDecNode);
+        else
+          m_current[target->usingDecNode] = stamp (++m_next);
+      }
+      // The function may store to any array and global
+      else if (!isBuiltinCall (node))
+        ++m_calls;
+      m_numbers[node] = ++m_next;
+      m_effects.insert (node);
+    }
+
+    // Values
+
+    virtual void
+    leave (IntegerLiteralExpressionNode* node) override
+    {
+      m_numbers[node] = numberOf (ValueKey (ValueKind::LITERAL, node->value, 0, 0, nullptr));
+    }
+
+    virtual void
+    leave (VariableExpressionNode* node) override
+    {
+      if (m_targets.count (node) != 0)
+        return;
+      Stamped& value = m_current[node->usingDecNode];
+      if (value.number == 0 || (value.calls != m_calls && !isScalarLocal (node->usingDecNode)))
+        value = stamp (++m_next);
+      m_numbers[node] = value.number;
+    }
+
+    virtual bool
+    enter (SubscriptExpressionNode* node) override
+    {
+      m_marks.push_back (decisions.size ());
+      return true;
+    }
+
+    virtual void
+    leave (SubscriptExpressionNode* node) override
+    {
+      if (m_targets.count (node) != 0)
+        m_marks.pop_back ();
+      else
+        decide (node, elementKey (node->usingDecNode, m_numbers[node->index]));
+    }
+
+    virtual bool
+    enter (AdditiveExpressionNode* node) override
+    {
+      m_marks.push_back (decisions.size ());
+      return true;
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node) override
+    {
+      bool commutes = node->addOperator == AdditiveOperatorType::PLUS;
+      decide (node, operatorKey (ValueKind::ADDITIVE, (int) node->addOperator, node->left, node->right, commutes));
+    }
+
+    virtual bool
+    enter (MultiplicativeExpressionNode* node) override
+    {
+      m_marks.push_back (decisions.size ());
+      return true;
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node) override
+    {
+      bool commutes = node->multOperator == MultiplicativeOperatorType::TIMES;
+      decide (node, operatorKey (ValueKind::MULTIPLICATIVE, (int) node->multOperator, node->left, node->right,
+                                 commutes));
+    }
+
+    virtual bool
+    enter (RelationalExpressionNode* node) override
+    {
+      m_marks.push_back (decisions.size ());
+      return true;
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node) override
+    {
+      decide (node, operatorKey (ValueKind::RELATIONAL, (int) node->relationalOperator, node->left, node->right,
+                                 false));
+    }
+
+    // Every decision made, those inside a repeat taken back
+    std::vector<Decision> decisions;
+
+  private:
+    // Regions follow one another closely, most of them empty, so only
+    //   the tables with entries are cleared
+    void
+    reset ()
+    {
+      clear (m_values);
+      clear (m_current);
+      clear (m_holders);
+      clear (m_first);
+      clear (m_versions);
+      clear (m_numbers);
+      clear (m_targets);
+      clear (m_effects);
+    }
+
+    template<typename T>
+    static void
+    clear (T& table)
+    {
+      if (!table.empty ())
+        table.clear ();
+    }
+
+    // number, stamped with the calls and stores made so far
+    Stamped
+    stamp (uint32_t number) const
+    {
+      return { number, m_calls, m_parameterStores, m_arrayStores };
+    }
+
+    uint32_t
+    numberOf (const ValueKey& key)
+    {
+      uint32_t& value = m_values[key];
+      if (value == 0)
+        value = ++m_next;
+      return value;
+    }
+
+    ValueKey
+    operatorKey (ValueKind kind, int op, ExpressionNode* left, ExpressionNode* right, bool commutes)
+    {
+      uint32_t first = m_numbers[left];
+      uint32_t second = m_numbers[right];
+      if (commutes && second < first)
+        std::swap (first, second);
+      return ValueKey (kind, op, first, second, nullptr);
+    }
+
+    ValueKey
+    elementKey (DeclarationNode* array, uint32_t index)
+    {
+      Stamped& version = m_versions[array];
+      if (version.number == 0 || version.calls != m_calls || version.parameterStores != m_parameterStores
+          || (dynamic_cast<ParameterNode*> (array) != nullptr && version.arrayStores != m_arrayStores))
+        version = stamp (++m_next);
+      return ValueKey (ValueKind::ELEMENT, 0, index, version.number, array);
+    }
+
+    // Invalidates the elements a store to array can change: an array
+    //   parameter may be any array, so a store to one changes them all,
+    //   and a store to another array changes the parameters
+    void
+    storeTo (DeclarationNode* array)
+    {
+      if (dynamic_cast<ParameterNode*> (array) != nullptr)
+        ++m_parameterStores;
+      else
+        ++m_arrayStores;
+      m_versions[array] = stamp (++m_next);
+    }
+
+    // A scalar local that holds value, or nullptr
+    DeclarationNode*
+    holderOf (uint32_t value)
+    {
+      auto holders = m_holders.find (value);
+      if (holders == m_holders.end ())
+        return nullptr;
+      for (DeclarationNode* holder : holders->second)
+        if (m_current[holder].number == value)
+          return holder;
+      return nullptr;
+    }
+
+    void
+    decide (ExpressionNode* node, const ValueKey& key)
+    {
+      size_t mark = m_marks.back ();
+      m_marks.pop_back ();
+      std::vector<ExpressionNode**> operands;
+      getExpressionSlots (node, operands);
+      bool effects = false;
+      for (ExpressionNode** operand : operands)
+        effects = effects || m_effects.count (*operand) != 0;
+      if (effects)
+        m_effects.insert (node);
+
+      bool known = m_values.count (key) != 0;
+      uint32_t value = numberOf (key);
+      m_numbers[node] = value;
+      auto first = m_first.find (value);
+      if (known && !effects)
+      {
+        DeclarationNode* holder = holderOf (value);
+        if (holder != nullptr || (first != m_first.end () && first->second < mark))
+        {
+          takeBack (mark);
+          decisions.push_back ({ node, value, true, holder, holder == nullptr ? first->second : 0, nullptr });
+          return;
+        }
+      }
+      if (first == m_first.end ())
+      {
+        m_first[value] = decisions.size ();
+        decisions.push_back ({ node, value, false, nullptr, 0, m_compounds.back () });
+      }
+    }
+
+    // Takes back the decisions from mark on, made inside a repeat
+    void
+    takeBack (size_t mark)
+    {
+      for (size_t n = mark; n < decisions.size (); ++n)
+      {
+        auto first = m_first.find (decisions[n].number);
+        if (first != m_first.end () && first->second == n)
+          m_first.erase (first);
+      }
+      decisions.resize (mark);
+    }
+
+    uint32_t m_next;
+    size_t   m_calls;
+    size_t   m_parameterStores;
+    size_t   m_arrayStores;
+    std::vector<size_t> m_marks;
+    std::vector<CompoundStatementNode*> m_compounds;
+
+    // The region's numbers: of each computation, of each variable's
+    //   current value, and of the decision that first computed each
+    std::map<ValueKey, uint32_t> m_values;
+    std::unordered_map<DeclarationNode*, Stamped> m_current;
+    std::unordered_map<uint32_t, std::vector<DeclarationNode*>> m_holders;
+    std::unordered_map<uint32_t, size_t> m_first;
+    // A number for the elements of each array, renewed after stores
+    //   and calls
+    std::unordered_map<DeclarationNode*, Stamped> m_versions;
+    std::unordered_map<ExpressionNode*, uint32_t> m_numbers;
+    // Assignment targets, and expressions with assignments or calls
+    std::unordered_set<ExpressionNode*> m_targets;
+    std::unordered_set<ExpressionNode*> m_effects;
+  };
+
+  // Operators and subscripts under the walked expression
+  class EvaluationCounter : public AstWalker
+  {
+  public:
+    EvaluationCounter ()
+      : count (0)
+    { }
+
+    bool enter (SubscriptExpressionNode* node) { ++count; return true; }
+    bool enter (AdditiveExpressionNode* node) { ++count; return true; }
+    bool enter (MultiplicativeExpressionNode* node) { ++count; return true; }
+    bool enter (RelationalExpressionNode* node) { ++count; return true; }
+
+    size_t count;
+  };
+
+  // Replaces repeats with reads, and has first computations assign
+  //   the locals that are read
+  class RepeatReplacer : public AstRewriter
+  {
+  public:
+    RepeatReplacer (AstArena& arena, const std::unordered_map<ExpressionNode*, DeclarationNode*>& repeats,
+                    const std::unordered_map<ExpressionNode*, VariableDeclarationNode*>& temporaries)
+      : m_arena (arena), m_repeats (repeats), m_temporaries (temporaries)
+    { }
+
+    bool enter (SubscriptExpressionNode* node) { return replaceRepeat (node); }
+    bool enter (AdditiveExpressionNode* node) { return replaceRepeat (node); }
+    bool enter (MultiplicativeExpressionNode* node) { return replaceRepeat (node); }
+    bool enter (RelationalExpressionNode* node) { return replaceRepeat (node); }
+
+    void leave (SubscriptExpressionNode* node) { assign (node); }
+    void leave (AdditiveExpressionNode* node) { assign (node); }
+    void leave (MultiplicativeExpressionNode* node) { assign (node); }
+    void leave (RelationalExpressionNode* node) { assign (node); }
+
+  private:
+    bool
+    replaceRepeat (ExpressionNode* node)
+    {
+      auto repeat = m_repeats.find (node);
+      if (repeat == m_repeats.end ())
+        return true;
+      replace (node, makeRead (m_arena, repeat->second, node->row, node->col));
+      return false;
+    }
+
+    void
+    assign (ExpressionNode* node)
+    {
+      auto temporary = m_temporaries.find (node);
+      if (temporary != m_temporaries.end ())
+        replace (node, m_arena.make<AssignmentExpressionNode> (
+          ValueType::INT, makeRead (m_arena, temporary->second, node->row, node->col), node, node->row, node->col));
+    }
+
+    AstArena& m_arena;
+    const std::unordered_map<ExpressionNode*, DeclarationNode*>& m_repeats;
+    const std::unordered_map<ExpressionNode*, VariableDeclarationNode*>& m_temporaries;
+  };
+}
+
+/***********************************************************************/
+
+CommonSubexpressionStats
+eliminateCommonSubexpressions (ProgramNode* program, AstArena& arena, NameSupply& names)
+{
+  CommonSubexpressionStats stats;
+  ValueNumberer numberer;
+  numberer.walk (program);
+  const std::vector<Decision>& decisions = numberer.decisions;
+
+  std::unordered_map<ExpressionNode*, DeclarationNode*> repeats;
+  std::unordered_map<ExpressionNode*, VariableDeclarationNode*> temporaries;
+  for (const Decision& decision : decisions)
+  {
+    if (!decision.repeat)
+      continue;
+    DeclarationNode* holder = decision.holder;
+    if (holder == nullptr)
+    {
+      const Decision& first = decisions[decision.first];
+      VariableDeclarationNode*& temporary = temporaries[first.node];
+      if (temporary == nullptr)
+      {
+        temporary = makeLocal (arena, names, "common", first.node->row, first.node->col);
+        first.compound->localDeclarations.push_back (temporary);
+        ++stats.temporaries;
+      }
+      holder = temporary;
+    }
+    repeats[decision.node] = holder;
+    EvaluationCounter evaluations;
+    evaluations.walk (decision.node);
+    stats.evaluations += evaluations.count;
+    ++stats.repeats;
+  }
+
+  RepeatReplacer replacer (arena, repeats, temporaries);
+  replacer.walk (program);
+  return stats;
+}
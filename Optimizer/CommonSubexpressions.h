@@ -0,0 +1,64 @@
+/*
+  Filename   : CommonSubexpressions.h
+  Author     : Philip Androwick
+  Description: Local common subexpression elimination on the checked
+               tree, by value numbering: an operator or subscript that
+               computes a value already computed in the same run of
+               straight-line statements reads it instead.
+*/
+
+/***********************************************************************/
+
+#ifndef COMMON_SUBEXPRESSIONS_H
+#define COMMON_SUBEXPRESSIONS_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+class NameSupply;
+
+struct CommonSubexpressionStats
+{
+  // Expressions replaced by reads, and the operators and subscripts
+  //   they no longer evaluate
+  size_t repeats = 0;
+  size_t evaluations = 0;
+  // New locals that keep a value for its repeats
+  size_t temporaries = 0;
+};
+
+// Eliminates the repeated expressions of program, which must have been
+//   resolved and checked.  A region is a run of expression statements
+//   of a compound statement, together with the condition of an if or
+//   the value of a return that ends it; a while condition is a region
+//   of its own.  Each region is numbered in the order it is evaluated:
+//   a literal or an operator on numbered operands gets the number of
+//   an earlier one that is the same (sums and products in either
+//   order), a read of a variable the number it was last assigned, and
+//   a subscript the number of an earlier read of the same element not
+//   since invalidated, or of the value last stored to it.  A store to
+//   an array invalidates its elements and, since an array parameter
+//   may be any array passed, those of the arrays it could be; a call
+//   to a function invalidates every element and every global.
+//
+// An operator or subscript without assignments or calls in it whose
+//   number was computed before becomes a read of a scalar local that
+//   still holds the number, if one was assigned it, or else of a new
+//   local that the first expression to compute it now assigns.  New
+//   nodes are made in arena and new names by names.
+CommonSubexpressionStats
+eliminateCommonSubexpressions (ProgramNode* program, AstArena& arena, NameSupply& names);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,280 @@
+/*
+  Filename   : ConstantFolding.cc
+  Author     : Philip Androwick
+  Description: Folds operators as the walk leaves them, so that their
+               operands are already folded.  The constants known at each
+               point are carried along the walk, copied where if and
+               while statements branch.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "ConstantFolding.h"
+#include "AstRewriter.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // Constants of the scalar locals known at a point of a function
+  struct KnownValues
+  {
+    std::unordered_map<DeclarationNode*, int> values;
+    // False after a return, where no path goes on
+    bool reachable = true;
+
+    // What is known where control from here and from other joins
+    void
+    join (const KnownValues& other)
+    {
+      if (!other.reachable)
+        return;
+      if (!reachable)
+      {
+        *this = other;
+        return;
+      }
+      for (auto value = values.begin (); value != values.end (); )
+      {
+        auto entry = other.values.find (value->first);
+        if (entry == other.values.end () || entry->second != value->second)
+          value = values.erase (value);
+        else
+          ++value;
+      }
+    }
+  };
+
+  class ConstantFolder : public AstRewriter
+  {
+  public:
+    ConstantFolder (AstArena& arena, const std::unordered_map<WhileStatementNode*, LoopEffects>& loops,
+                    FoldStats& stats)
+      : AstRewriter ({ ChildSlot::THEN, ChildSlot::BODY }), m_arena (arena), m_loops (loops), m_stats (stats)
+    { }
+
+    virtual bool
+    enter (FunctionDeclarationNode* node)
+    {
+      // Nothing is known about the parameters
+      m_known = KnownValues ();
+      return true;
+    }
+
+    virtual bool
+    enter (VariableDeclarationNode* node)
+    {
+      if (isScalarLocal (node))
+        m_known.values[node] = 0;
+      return true;
+    }
+
+    // Statements
+
+    virtual bool
+    enter (WhileStatementNode* node)
+    {
+      // Only what no iteration changes is known in the loop
+      for (DeclarationNode* declaration : m_loops.at (node).written)
+        m_known.values.erase (declaration);
+      return true;
+    }
+
+    virtual void
+    enterChild (Node* parent, ChildSlot slot)
+    {
+      // Either branch, or the loop's exit, starts from here
+      if (slot == ChildSlot::THEN || slot == ChildSlot::BODY)
+        m_branches.push_back (m_known);
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot)
+    {
+      AstRewriter::leaveChild (parent, slot);
+      if (slot == ChildSlot::THEN)
+        // The else part starts where the then part did
+        std::swap (m_known, m_branches.back ());
+      else if (slot == ChildSlot::BODY)
+      {
+        // The loop is left after its condition, where the body began
+        m_known = std::move (m_branches.back ());
+        m_branches.pop_back ();
+      }
+    }
+
+    virtual void
+    leave (IfStatementNode* node)
+    {
+      m_known.join (m_branches.back ());
+      m_branches.pop_back ();
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      m_known.reachable = false;
+    }
+
+    // Expressions
+
+    virtual bool
+    enter (AssignmentExpressionNode* node)
+    {
+      m_targets.push_back (node->variable);
+      return true;
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      m_targets.pop_back ();
+      DeclarationNode* declaration = node->variable->usingDecNode;
+      if (!isScalarLocal (declaration) || dynamic_cast<SubscriptExpressionNode*> (node->variable) != nullptr)
+        return;
+      if (IntegerLiteralExpressionNode* literal = asLiteral (node->expression))
+        m_known.values[declaration] = literal->value;
+      else
+        m_known.values.erase (declaration);
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node)
+    {
+      if (isInputCall (node))
+        m_targets.push_back (static_cast<VariableExpressionNode*> (node->arguments[0]));
+      return true;
+    }
+
+    virtual void
+    leave (CallExpressionNode* node)
+    {
+      if (isInputCall (node))
+      {
+        m_targets.pop_back ();
+        m_known.values.erase (static_cast<VariableExpressionNode*> (node->arguments[0])->usingDecNode);
+      }
+    }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      if (!m_targets.empty () && m_targets.back () == node)
+        return true;
+      auto entry = m_known.values.find (node->usingDecNode);
+      if (entry != m_known.values.end ())
+      {
+        replace (node, literal (entry->second, node));
+        ++m_stats.propagated;
+      }
+      return true;
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node)
+    {
+      IntegerLiteralExpressionNode* left = asLiteral (node->left);
+      IntegerLiteralExpressionNode* right = asLiteral (node->right);
+      if (left == nullptr || right == nullptr)
+        return;
+      uint32_t a = (uint32_t) left->value;
+      uint32_t b = (uint32_t) right->value;
+      fold (node, (int32_t) (node->addOperator == AdditiveOperatorType::PLUS ? a + b : a - b));
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node)
+    {
+      IntegerLiteralExpressionNode* right = asLiteral (node->right);
+      // Left for the program to stop at, if it ever comes to it
+      if (node->multOperator == MultiplicativeOperatorType::DIVIDE && right != nullptr && right->value == 0)
+      {
+        ++m_stats.zeroDivisions;
+        return;
+      }
+
+      IntegerLiteralExpressionNode* left = asLiteral (node->left);
+      if (left == nullptr || right == nullptr)
+        return;
+      if (node->multOperator == MultiplicativeOperatorType::TIMES)
+        fold (node, (int32_t) ((uint32_t) left->value * (uint32_t) right->value));
+      // INT_MIN / -1 overflows; it wraps to INT_MIN
+      else if (right->value == -1)
+        fold (node, (int32_t) (0u - (uint32_t) left->value));
+      else
+        fold (node, left->value / right->value);
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node)
+    {
+      IntegerLiteralExpressionNode* left = asLiteral (node->left);
+      IntegerLiteralExpressionNode* right = asLiteral (node->right);
+      if (left == nullptr || right == nullptr)
+        return;
+      int a = left->value;
+      int b = right->value;
+      bool result = false;
+      switch (node->relationalOperator)
+      {
+        case RelationalOperatorType::LT:  result = a < b;  break;
+        case RelationalOperatorType::LTE: result = a <= b; break;
+        case RelationalOperatorType::GT:  result = a > b;  break;
+        case RelationalOperatorType::GTE: result = a >= b; break;
+        case RelationalOperatorType::EQ:  result = a == b; break;
+        case RelationalOperatorType::NEQ: result = a != b; break;
+      }
+      fold (node, result);
+    }
+
+  private:
+    IntegerLiteralExpressionNode*
+    literal (int value, ExpressionNode* at)
+    {
+      return m_arena.make<IntegerLiteralExpressionNode> (value, at->row, at->col);
+    }
+
+    void
+    fold (ExpressionNode* node, int value)
+    {
+      replace (node, literal (value, node));
+      ++m_stats.folded;
+      // The operator and its two literals became one literal
+      m_stats.removedNodes += 2;
+    }
+
+    AstArena&  m_arena;
+    const std::unordered_map<WhileStatementNode*, LoopEffects>& m_loops;
+    FoldStats& m_stats;
+
+    KnownValues m_known;
+    // For each if, what its else part starts from, or once the else
+    // part is walked, what its then part ended with; for each while,
+    // what its exit starts from
+    std::vector<KnownValues> m_branches;
+    // Targets of the assignments and input calls being walked,
+    // innermost last
+    std::vector<VariableExpressionNode*> m_targets;
+  };
+}
+
+/***********************************************************************/
+
+FoldStats
+foldConstants (ProgramNode* program, AstArena& arena)
+{
+  FoldStats stats;
+  LoopEffectCollector loops;
+  loops.walk (program);
+  ConstantFolder folder (arena, loops.effects, stats);
+  folder.walk (program);
+  return stats;
+}
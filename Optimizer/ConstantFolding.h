@@ -0,0 +1,55 @@
+/*
+  Filename   : ConstantFolding.h
+  Author     : Philip Androwick
+  Description: Constant folding and propagation on the checked tree.
+               Operators whose operands are literals become literals,
+               computed as the backends compute them: arithmetic wraps,
+               division truncates, and INT_MIN / -1 is INT_MIN.  Within
+               a function, a scalar local or parameter known to hold a
+               constant where it is read is replaced by the constant.
+*/
+
+/***********************************************************************/
+
+#ifndef CONSTANT_FOLDING_H
+#define CONSTANT_FOLDING_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+struct FoldStats
+{
+  // Operators replaced by literals
+  size_t folded = 0;
+  // Reads of variables replaced by literals
+  size_t propagated = 0;
+  // Nodes the tree lost
+  size_t removedNodes = 0;
+  // Divisions by a constant 0, which are left as they are
+  size_t zeroDivisions = 0;
+};
+
+// Folds and propagates the constants of program, which must have been
+//   resolved and checked, making the new literals in arena.  A value is
+//   known after straight-line code assigns it, including the 0 a local
+//   starts with; where control flow joins, only values known on every
+//   path are kept, and a loop forgets what its body or condition may
+//   assign.  Globals are never propagated, as a call can change them.
+//   A division by a constant 0 is not folded, so a program that comes
+//   to it still stops with a division by zero when it runs.
+FoldStats
+foldConstants (ProgramNode* program, AstArena& arena);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,338 @@
+/*
+  Filename   : DeadCode.cc
+  Author     : Philip Androwick
+  Description: Statements are removed as the walk leaves them: each
+               statement that goes or gives way to another is recorded,
+               and the compound, if or while statement around it takes
+               the record into account when the walk leaves that.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "DeadCode.h"
+#include "AstRewriter.h"
+#include "../SemanticAnalyzer/ReferenceVisitor.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // Counts the references to each declaration under the walked nodes
+  //   other than as the variable an assignment stores to, or takes
+  //   them back from the counts when the nodes go
+  class UseCounter : public AstWalker
+  {
+  public:
+    UseCounter (std::unordered_map<DeclarationNode*, size_t>& uses, bool forget)
+      : freed (false), m_uses (uses), m_forget (forget)
+    { }
+
+    virtual bool
+    enter (AssignmentExpressionNode* node)
+    {
+      m_targets.insert (node->variable);
+      return true;
+    }
+
+    virtual bool
+    enter (VariableExpressionNode* node)
+    {
+      if (m_targets.count (node) == 0)
+        count (node->usingDecNode);
+      return true;
+    }
+
+    // Whether an element is read or written, the array stays
+    virtual bool
+    enter (SubscriptExpressionNode* node)
+    {
+      count (node->usingDecNode);
+      return true;
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node)
+    {
+      count (node->usingDecNode);
+      return true;
+    }
+
+    // Whether a scalar local lost its last reference
+    bool freed;
+
+  private:
+    void
+    count (DeclarationNode* declaration)
+    {
+      if (!m_forget)
+        ++m_uses[declaration];
+      else if (--m_uses[declaration] == 0 && isScalarLocal (declaration))
+        freed = true;
+    }
+
+    std::unordered_map<DeclarationNode*, size_t>& m_uses;
+    bool m_forget;
+    std::unordered_set<VariableExpressionNode*> m_targets;
+  };
+
+  // Removes the dead code of the walked function, keeping the counts
+  //   of references up to date as code goes
+  class DeadCodeRemover : public AstRewriter
+  {
+  public:
+    DeadCodeRemover (AstArena& arena, NameSupply& names, std::unordered_map<DeclarationNode*, size_t>& uses,
+                     DeadCodeStats& stats)
+      : freed (false), m_arena (arena), m_names (names), m_uses (uses), m_stats (stats)
+    { }
+
+    // Statements
+
+    virtual void
+    leave (CompoundStatementNode* node)
+    {
+      std::vector<StatementNode*> statements;
+      for (size_t n = 0; n < node->statements.size (); ++n)
+      {
+        StatementNode* statement = survivor (node->statements[n]);
+        if (statement == nullptr)
+          continue;
+        statements.push_back (statement);
+        // Nothing after a statement that always returns is reached
+        if (m_returns.count (statement) != 0)
+        {
+          m_returns.insert (node);
+          m_stats.statements += node->statements.size () - n - 1;
+          while (++n < node->statements.size ())
+            if (StatementNode* unreached = survivor (node->statements[n]))
+              discard (unreached);
+          break;
+        }
+      }
+      node->statements = std::move (statements);
+
+      // Every reference to a local is inside its compound statement, so
+      // the counts are final here
+      std::vector<VariableDeclarationNode*> declarations;
+      for (VariableDeclarationNode* declaration : node->localDeclarations)
+        if (isUsed (declaration))
+          declarations.push_back (declaration);
+      m_stats.locals += node->localDeclarations.size () - declarations.size ();
+      m_stats.removedNodes += node->localDeclarations.size () - declarations.size ();
+      node->localDeclarations = std::move (declarations);
+    }
+
+    virtual void
+    leave (IfStatementNode* node)
+    {
+      node->thenStatement = orEmpty (survivor (node->thenStatement));
+      if (node->elseStatement != nullptr)
+        node->elseStatement = survivor (node->elseStatement);
+
+      IntegerLiteralExpressionNode* condition = asLiteral (node->conditionalExpression);
+      if (condition == nullptr)
+      {
+        if (m_returns.count (node->thenStatement) != 0 && m_returns.count (node->elseStatement) != 0)
+          m_returns.insert (node);
+        // Nothing left to choose between
+        else if (isEmpty (node->thenStatement) && (node->elseStatement == nullptr || isEmpty (node->elseStatement))
+                 && !hasSideEffects (node->conditionalExpression))
+          remove (node);
+        return;
+      }
+
+      // The branch taken stands in for the if, without the scope an if
+      // gives it, so its locals get names of their own
+      StatementNode* branch = condition->value != 0 ? node->thenStatement : node->elseStatement;
+      StatementNode* other = condition->value != 0 ? node->elseStatement : node->thenStatement;
+      if (other != nullptr)
+        discard (other);
+      discard (condition);
+      ++m_stats.removedNodes;
+      if (CompoundStatementNode* compound = dynamic_cast<CompoundStatementNode*> (branch))
+        for (VariableDeclarationNode* declaration : compound->localDeclarations)
+          renameDeclaration (declaration, compound, m_names.make (declaration->identifier));
+      m_statements[node] = branch;
+      ++m_stats.statements;
+    }
+
+    virtual void
+    leave (WhileStatementNode* node)
+    {
+      node->body = orEmpty (survivor (node->body));
+      IntegerLiteralExpressionNode* condition = asLiteral (node->conditionalExpression);
+      if (condition != nullptr && condition->value == 0)
+        remove (node);
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      m_returns.insert (node);
+    }
+
+    virtual void
+    leave (ExpressionStatementNode* node)
+    {
+      if (node->expression == nullptr || !hasSideEffects (node->expression))
+        remove (node);
+    }
+
+    // Expressions
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      DeclarationNode* declaration = node->variable->usingDecNode;
+      if (dynamic_cast<SubscriptExpressionNode*> (node->variable) == nullptr && isScalarLocal (declaration)
+          && !isUsed (declaration))
+      {
+        replace (node, node->expression);
+        ++m_stats.assignments;
+        // The assignment and the variable it stored to
+        m_stats.removedNodes += 2;
+      }
+    }
+
+    // Whether code that went left a scalar local unread after the walk
+    //   had passed assignments to it
+    bool freed;
+
+  private:
+    // What stands in for statement now; nullptr if it is gone
+    StatementNode*
+    survivor (StatementNode* statement) const
+    {
+      auto entry = m_statements.find (statement);
+      return entry != m_statements.end () ? entry->second : statement;
+    }
+
+    void
+    remove (StatementNode* statement)
+    {
+      m_statements[statement] = nullptr;
+      ++m_stats.statements;
+      discard (statement);
+    }
+
+    // Takes the references and nodes under node out of the counts, as
+    //   it goes
+    void
+    discard (Node* node)
+    {
+      UseCounter forgotten (m_uses, true);
+      forgotten.walk (node);
+      freed = freed || forgotten.freed;
+      m_stats.removedNodes += countNodes (node);
+    }
+
+    bool
+    isUsed (DeclarationNode* declaration) const
+    {
+      auto entry = m_uses.find (declaration);
+      return entry != m_uses.end () && entry->second != 0;
+    }
+
+    static bool
+    isEmpty (StatementNode* statement)
+    {
+      CompoundStatementNode* compound = dynamic_cast<CompoundStatementNode*> (statement);
+      return compound != nullptr && compound->statements.empty () && compound->localDeclarations.empty ();
+    }
+
+    // An if or while needs a statement for its branch or body
+    StatementNode*
+    orEmpty (StatementNode* statement)
+    {
+      if (statement != nullptr)
+        return statement;
+      --m_stats.removedNodes;
+      return m_arena.make<CompoundStatementNode> (std::vector<VariableDeclarationNode*> (),
+                                                  std::vector<StatementNode*> ());
+    }
+
+    AstArena&      m_arena;
+    NameSupply&    m_names;
+    // References to each declaration left in the function
+    std::unordered_map<DeclarationNode*, size_t>& m_uses;
+    DeadCodeStats& m_stats;
+
+    // Statements that went or gave way to another, and what took their
+    // place
+    std::unordered_map<StatementNode*, StatementNode*> m_statements;
+    // Statements that always return
+    std::unordered_set<StatementNode*> m_returns;
+  };
+
+  // Removes the functions and globals that main does not reach
+  void
+  removeUnreached (ProgramNode* program, DeadCodeStats& stats)
+  {
+    FunctionDeclarationNode* main = nullptr;
+    for (DeclarationNode* declaration : program->declarations)
+      if (declaration->identifier == "main")
+        main = dynamic_cast<FunctionDeclarationNode*> (declaration);
+    if (main == nullptr)
+      return;
+
+    std::unordered_set<DeclarationNode*> reached = { main };
+    std::vector<FunctionDeclarationNode*> functions = { main };
+    while (!functions.empty ())
+    {
+      ReferenceVisitor references;
+      references.walk (functions.back ());
+      functions.pop_back ();
+      for (DeclarationNode* declaration : references.references)
+        if (reached.insert (declaration).second)
+          if (FunctionDeclarationNode* function = dynamic_cast<FunctionDeclarationNode*> (declaration))
+            functions.push_back (function);
+    }
+
+    std::vector<DeclarationNode*> declarations;
+    for (DeclarationNode* declaration : program->declarations)
+      if (reached.count (declaration) != 0)
+        declarations.push_back (declaration);
+      else
+      {
+        ++stats.globals;
+        stats.removedNodes += countNodes (declaration);
+      }
+    program->declarations = std::move (declarations);
+  }
+}
+
+/***********************************************************************/
+
+DeadCodeStats
+eliminateDeadCode (ProgramNode* program, AstArena& arena, NameSupply& names, bool wholeProgram)
+{
+  DeadCodeStats stats;
+
+  // Each function is walked again only while removing code leaves a
+  // local unread that an earlier part of the function assigns
+  for (DeclarationNode* declaration : program->declarations)
+    if (FunctionDeclarationNode* function = dynamic_cast<FunctionDeclarationNode*> (declaration))
+    {
+      std::unordered_map<DeclarationNode*, size_t> uses;
+      UseCounter counter (uses, false);
+      counter.walk (function);
+      bool freed;
+      do
+      {
+        DeadCodeRemover remover (arena, names, uses, stats);
+        remover.walk (function);
+        freed = remover.freed;
+      } while (freed);
+    }
+
+  if (wholeProgram)
+    removeUnreached (program, stats);
+  return stats;
+}
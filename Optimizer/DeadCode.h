@@ -0,0 +1,63 @@
+/*
+  Filename   : DeadCode.h
+  Author     : Philip Androwick
+  Description: Dead code elimination on the checked tree.  Removes the
+               statements no path reaches, the branches a constant
+               condition rules out, the locals nothing reads, and the
+               functions and globals main never comes to.
+*/
+
+/***********************************************************************/
+
+#ifndef DEAD_CODE_H
+#define DEAD_CODE_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+class NameSupply;
+
+struct DeadCodeStats
+{
+  // Statements removed, or replaced by the branch a constant condition
+  //   takes
+  size_t statements = 0;
+  // Local declarations removed, and assignments to them
+  size_t locals = 0;
+  size_t assignments = 0;
+  // Functions and global variables removed
+  size_t globals = 0;
+  // Nodes the tree lost
+  size_t removedNodes = 0;
+};
+
+// Removes the dead code of program, which must have been resolved and
+//   checked.  Within a compound statement, statements after one that
+//   always returns go.  An if with a literal condition becomes the
+//   branch it takes, and a while whose condition is 0 goes, as does an
+//   if with empty branches and a condition without side effects.  A
+//   scalar local or parameter that is never read stops being assigned,
+//   the assignments giving way to their values, and then a local
+//   declaration nothing refers to goes, as does an expression statement
+//   that does nothing.  These repeat in each function until nothing
+//   changes.  Then, if wholeProgram, functions and globals that main
+//   does not reach through the call graph are removed.  The branch that
+//   takes the place of an if loses the scope the if gave it, so its
+//   locals are renamed.  New nodes are made in arena and new names by
+//   names.
+DeadCodeStats
+eliminateDeadCode (ProgramNode* program, AstArena& arena, NameSupply& names, bool wholeProgram);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,642 @@
+/*
+  Filename   : Inliner.cc
+  Author     : Philip Androwick
+  Description: A body is copied by a walk that builds each node as it
+               leaves it, from the copies of its children.  The copy is
+               reshaped so that every return ends a path through it, and
+               then each return assigns the result.  Bodies are no larger
+               than the budget, so the reshaping may recurse.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "Inliner.h"
+#include "AstRewriter.h"
+#include "TreeCloner.h"
+#include "../SemanticAnalyzer/ReferenceVisitor.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // Whether the walked statements return or declare a local array
+  class BodyScanner : public AstWalker
+  {
+  public:
+    BodyScanner ()
+      : returns (false), arrays (false)
+    { }
+
+    bool enter (ReturnStatementNode* node) { returns = true; return false; }
+    bool enter (ArrayDeclarationNode* node) { arrays = true; return false; }
+
+    bool returns;
+    bool arrays;
+  };
+
+  /*********************************************************************/
+
+  bool
+  containsReturn (StatementNode* statement)
+  {
+    BodyScanner scanner;
+    scanner.walk (statement);
+    return scanner.returns;
+  }
+
+  // Whether every path through statement returns, once its returns all
+  //   end paths
+  bool
+  alwaysReturns (StatementNode* statement)
+  {
+    if (dynamic_cast<ReturnStatementNode*> (statement) != nullptr)
+      return true;
+    if (CompoundStatementNode* compound = dynamic_cast<CompoundStatementNode*> (statement))
+      return !compound->statements.empty () && alwaysReturns (compound->statements.back ());
+    if (IfStatementNode* branch = dynamic_cast<IfStatementNode*> (statement))
+      return branch->elseStatement != nullptr && alwaysReturns (branch->thenStatement)
+        && alwaysReturns (branch->elseStatement);
+    return false;
+  }
+
+  // A compound statement of statement, if any, and then rest
+  StatementNode*
+  append (StatementNode* statement, const std::vector<StatementNode*>& rest, AstArena& arena)
+  {
+    std::vector<StatementNode*> statements;
+    if (statement != nullptr)
+      statements.push_back (statement);
+    statements.insert (statements.end (), rest.begin (), rest.end ());
+    return arena.make<CompoundStatementNode> (std::vector<VariableDeclarationNode*> (), statements);
+  }
+
+  bool
+  endReturns (StatementNode*& statement, AstArena& arena);
+
+  // Moves the statements that follow one that may return into the
+  //   branch of it that goes on, until every return ends a path through
+  //   statements.  False if a return is in a loop, or if the paths
+  //   through both branches of an if may go on.
+  bool
+  endReturns (std::vector<StatementNode*>& statements, AstArena& arena)
+  {
+    for (size_t n = 0; n < statements.size (); ++n)
+    {
+      StatementNode* statement = statements[n];
+      if (!containsReturn (statement))
+        continue;
+      std::vector<StatementNode*> rest (statements.begin () + n + 1, statements.end ());
+      statements.resize (n + 1);
+
+      // Nothing after a return is reached
+      if (dynamic_cast<ReturnStatementNode*> (statement) != nullptr)
+        return true;
+      // A compound statement within another has no scope of its own
+      if (CompoundStatementNode* compound = dynamic_cast<CompoundStatementNode*> (statement))
+      {
+        compound->statements.insert (compound->statements.end (), rest.begin (), rest.end ());
+        return endReturns (compound->statements, arena);
+      }
+      IfStatementNode* branch = dynamic_cast<IfStatementNode*> (statement);
+      if (branch == nullptr)
+        return false;
+      if (!endReturns (branch->thenStatement, arena)
+          || (branch->elseStatement != nullptr && !endReturns (branch->elseStatement, arena)))
+        return false;
+      if (rest.empty ())
+        return true;
+
+      StatementNode** goesOn;
+      if (alwaysReturns (branch->thenStatement))
+        goesOn = &branch->elseStatement;
+      else if (branch->elseStatement != nullptr && alwaysReturns (branch->elseStatement))
+        goesOn = &branch->thenStatement;
+      else
+        return false;
+      *goesOn = append (*goesOn, rest, arena);
+      return endReturns (*goesOn, arena);
+    }
+    return true;
+  }
+
+  // The same, for a branch or body on its own
+  bool
+  endReturns (StatementNode*& statement, AstArena& arena)
+  {
+    std::vector<StatementNode*> statements = { statement };
+    bool ended = endReturns (statements, arena);
+    statement = statements[0];
+    return ended;
+  }
+
+  bool
+  isArray (DeclarationNode* declaration)
+  {
+    if (ParameterNode* parameter = dynamic_cast<ParameterNode*> (declaration))
+      return parameter->isArray;
+    return dynamic_cast<ArrayDeclarationNode*> (declaration) != nullptr;
+  }
+
+  /*********************************************************************/
+
+  class Inliner
+  {
+  public:
+    Inliner (ProgramNode* program, AstArena& arena, NameSupply& names, size_t budget, InlineStats& stats)
+      : m_program (program), m_arena (arena), m_names (names), m_budget (budget), m_stats (stats)
+    { }
+
+    void
+    run ()
+    {
+      std::vector<FunctionDeclarationNode*> functions;
+      for (DeclarationNode* declaration : m_program->declarations)
+      {
+        FunctionDeclarationNode* function = dynamic_cast<FunctionDeclarationNode*> (declaration);
+        if (function == nullptr || function->functionBody == nullptr)
+          continue;
+        functions.push_back (function);
+        CallCollector calls;
+        calls.walk (function->functionBody);
+        std::vector<FunctionDeclarationNode*>& callees = m_callees[function];
+        for (CallExpressionNode* call : calls.calls)
+        {
+          FunctionDeclarationNode* callee = static_cast<FunctionDeclarationNode*> (call->usingDecNode);
+          if (std::find (callees.begin (), callees.end (), callee) == callees.end ())
+            callees.push_back (callee);
+        }
+      }
+
+      for (FunctionDeclarationNode* caller : calleesFirst (functions))
+        inlineCalls (caller);
+    }
+
+  private:
+    // functions, each after those it calls, except around a cycle.  The
+    //   walk also finds the strongly connected components of the calls,
+    //   as Tarjan's algorithm does, and marks the functions of each one
+    //   with a cycle as recursive.
+    std::vector<FunctionDeclarationNode*>
+    calleesFirst (const std::vector<FunctionDeclarationNode*>& functions)
+    {
+      std::vector<FunctionDeclarationNode*> order;
+      // When each function was reached, and the earliest reached of the
+      // functions still on the stack that it reaches
+      std::unordered_map<FunctionDeclarationNode*, size_t> reached;
+      std::unordered_map<FunctionDeclarationNode*, size_t> lowest;
+      // The functions reached whose component is not yet complete
+      std::vector<FunctionDeclarationNode*> stack;
+      std::unordered_set<FunctionDeclarationNode*> onStack;
+      auto reach = [&] (FunctionDeclarationNode* function)
+      {
+        lowest[function] = reached[function] = reached.size ();
+        stack.push_back (function);
+        onStack.insert (function);
+      };
+
+      for (FunctionDeclarationNode* function : functions)
+      {
+        if (reached.count (function) != 0)
+          continue;
+        reach (function);
+        // Each function being visited, and how many of its callees have
+        // been
+        std::vector<std::pair<FunctionDeclarationNode*, size_t>> path = { { function, 0 } };
+        while (!path.empty ())
+        {
+          FunctionDeclarationNode* current = path.back ().first;
+          const std::vector<FunctionDeclarationNode*>& callees = m_callees[current];
+          if (path.back ().second < callees.size ())
+          {
+            FunctionDeclarationNode* callee = callees[path.back ().second++];
+            if (reached.count (callee) == 0)
+            {
+              reach (callee);
+              path.push_back ({ callee, 0 });
+            }
+            else if (onStack.count (callee) != 0)
+              lowest[current] = std::min (lowest[current], reached[callee]);
+            continue;
+          }
+
+          if (current->functionBody != nullptr)
+            order.push_back (current);
+          path.pop_back ();
+          if (!path.empty ())
+            lowest[path.back ().first] = std::min (lowest[path.back ().first], lowest[current]);
+          if (lowest[current] != reached[current])
+            continue;
+          // current was reached first in its component, whose functions
+          // are those above it on the stack
+          bool cycle = stack.back () != current
+            || std::find (callees.begin (), callees.end (), current) != callees.end ();
+          FunctionDeclarationNode* member;
+          do
+          {
+            member = stack.back ();
+            stack.pop_back ();
+            onStack.erase (member);
+            if (cycle)
+              m_recursive.insert (member);
+          } while (member != current);
+        }
+      }
+      return order;
+    }
+
+    // Whether calls to function may be inlined; its calls have already
+    //   been inlined, so its body is as large as it gets
+    bool
+    isInlinable (FunctionDeclarationNode* function)
+    {
+      auto entry = m_inlinable.find (function);
+      if (entry != m_inlinable.end ())
+        return entry->second;
+
+      bool inlinable = false;
+      if (function->functionBody != nullptr && m_recursive.count (function) == 0
+          && countNodes (function->functionBody) <= m_budget)
+      {
+        BodyScanner scanner;
+        scanner.walk (function->functionBody);
+        // A copy shows whether the returns can be made to end the body
+        std::unordered_map<DeclarationNode*, DeclarationNode*> none;
+        TreeCloner cloner (m_arena, nullptr, none);
+        StatementNode* copy = static_cast<StatementNode*> (cloner.copy (function->functionBody));
+        inlinable = !scanner.arrays && endReturns (copy, m_arena);
+      }
+      m_inlinable[function] = inlinable;
+      return inlinable;
+    }
+
+    // Inlines the calls in caller that can be
+    void
+    inlineCalls (FunctionDeclarationNode* caller)
+    {
+      // Only the caller's own declarations can hide a global; the ones
+      // inlining makes have names with digits, which no global has
+      DeclarationCollector locals;
+      locals.walk (caller);
+      m_locals.clear ();
+      for (DeclarationNode* declaration : locals.declarations)
+        m_locals[declaration->identifier].push_back (declaration);
+
+      StatementSlotCollector statements;
+      statements.walk (caller->functionBody);
+      std::vector<StatementNode**>& slots = statements.slots;
+      for (size_t n = 0; n < slots.size (); ++n)
+      {
+        StatementInliner inliner (*this, caller, slots[n]);
+        inliner.walk (*slots[n]);
+        // The statements now ahead of it, the arguments and the bodies,
+        // are looked at next for the calls they have left
+        for (CompoundStatementNode* compound : inliner.inlined)
+          for (size_t m = 0; m + 1 < compound->statements.size (); ++m)
+          {
+            slots.push_back (&compound->statements[m]);
+            StatementSlotCollector nested;
+            nested.walk (compound->statements[m]);
+            slots.insert (slots.end (), nested.slots.begin (), nested.slots.end ());
+          }
+      }
+    }
+
+    // Inlines the calls of the statement in slot that can be, walking
+    //   its expressions once in the order they are evaluated, so that
+    //   each call is decided after the calls in its arguments.  A call
+    //   is inlined only if what the statement evaluates before it could
+    //   come after its arguments and body instead, so the walk carries
+    //   along how many of the nodes before it cannot: assignments,
+    //   calls, subscripts, divisions that may stop the program and
+    //   reads of global scalars.  It also notes where each local is
+    //   first read, and a write to the local in a call's arguments then
+    //   keeps the call where it is if the read came before the call.
+    class StatementInliner : public AstWalker
+    {
+    public:
+      StatementInliner (Inliner& inliner, FunctionDeclarationNode* caller, StatementNode** slot)
+        : AstWalker ({ ChildSlot::TARGET }), m_inliner (inliner), m_caller (caller), m_slot (slot),
+          m_statement (*slot), m_path ({ *slot }), m_position (0), m_unmovable (0), m_targets (0)
+      { }
+
+      // Only the walked statement's expressions; a loop's condition is
+      // evaluated again on each iteration
+      bool enter (CompoundStatementNode* node) { return false; }
+      bool enter (WhileStatementNode* node) { return false; }
+      bool enter (IfStatementNode* node) { return node == m_statement; }
+      bool enter (ReturnStatementNode* node) { return node == m_statement; }
+      bool enter (ExpressionStatementNode* node) { return node == m_statement; }
+
+      // The calls in an assignment target's index are passed over
+      void enterChild (Node* parent, ChildSlot slot) { ++m_targets; }
+      void leaveChild (Node* parent, ChildSlot slot) { --m_targets; }
+
+      bool enter (AssignmentExpressionNode* node) { return arrive (node); }
+      bool enter (VariableExpressionNode* node) { return arrive (node); }
+      bool enter (SubscriptExpressionNode* node) { return arrive (node); }
+      bool enter (AdditiveExpressionNode* node) { return arrive (node); }
+      bool enter (MultiplicativeExpressionNode* node) { return arrive (node); }
+      bool enter (RelationalExpressionNode* node) { return arrive (node); }
+      bool enter (UnaryExpressionNode* node) { return arrive (node); }
+      bool enter (IntegerLiteralExpressionNode* node) { return arrive (node); }
+
+      virtual bool
+      enter (CallExpressionNode* node)
+      {
+        arrive (node);
+        if (!isBuiltinCall (node) && m_targets == 0)
+          m_calls.push_back ({ node, m_position, m_unmovable, m_reads.size (), SIZE_MAX });
+        return true;
+      }
+
+      virtual void
+      leave (AssignmentExpressionNode* node)
+      {
+        depart ();
+        if (dynamic_cast<SubscriptExpressionNode*> (node->variable) == nullptr)
+          write (node->variable->usingDecNode);
+        ++m_unmovable;
+      }
+
+      virtual void
+      leave (VariableExpressionNode* node)
+      {
+        if (depart ())
+          return;
+        DeclarationNode* declaration = node->usingDecNode;
+        if (isScalarLocal (declaration))
+        {
+          if (m_firstReads.emplace (declaration, m_position).second)
+            m_reads.push_back (declaration);
+        }
+        else if (!isArray (declaration))
+          ++m_unmovable;
+      }
+
+      virtual void
+      leave (SubscriptExpressionNode* node)
+      {
+        // It may be out of bounds, unless it is what is stored to
+        if (!depart ())
+          ++m_unmovable;
+      }
+
+      void leave (AdditiveExpressionNode* node) { depart (); }
+      void leave (RelationalExpressionNode* node) { depart (); }
+      void leave (UnaryExpressionNode* node) { depart (); }
+      void leave (IntegerLiteralExpressionNode* node) { depart (); }
+
+      virtual void
+      leave (MultiplicativeExpressionNode* node)
+      {
+        depart ();
+        IntegerLiteralExpressionNode* divisor = asLiteral (node->right);
+        if (node->multOperator == MultiplicativeOperatorType::DIVIDE && (divisor == nullptr || divisor->value == 0))
+          ++m_unmovable;
+      }
+
+      virtual void
+      leave (CallExpressionNode* node)
+      {
+        m_path.pop_back ();
+        Node* parent = m_path.back ();
+        if (isInputCall (node))
+        {
+          VariableExpressionNode* target = static_cast<VariableExpressionNode*> (node->arguments[0]);
+          if (dynamic_cast<SubscriptExpressionNode*> (target) == nullptr)
+            write (target->usingDecNode);
+        }
+        if (m_calls.empty () || m_calls.back ().call != node)
+        {
+          ++m_unmovable;
+          return;
+        }
+
+        OpenCall call = m_calls.back ();
+        m_calls.pop_back ();
+        // A write blocks the calls it is in from blockedFrom on
+        size_t index = m_calls.size ();
+        if (call.blockedFrom < index)
+          m_calls.back ().blockedFrom = std::min (m_calls.back ().blockedFrom, call.blockedFrom);
+        if (call.unmovable != 0 || call.blockedFrom <= index || !m_inliner.canInline (m_statement, node, parent))
+        {
+          ++m_unmovable;
+          return;
+        }
+
+        m_inliner.inlineCall (m_caller, m_slot, node, parent);
+        CompoundStatementNode* compound = static_cast<CompoundStatementNode*> (*m_slot);
+        inlined.push_back (compound);
+        m_slot = &compound->statements.back ();
+        // The arguments now go ahead of the statement, and a read of the
+        // result takes the call's place
+        m_unmovable = call.unmovable;
+        for (; m_reads.size () > call.reads; m_reads.pop_back ())
+          m_firstReads.erase (m_reads.back ());
+      }
+
+      // The compound statements that calls were inlined into, innermost
+      //   first
+      std::vector<CompoundStatementNode*> inlined;
+
+    private:
+      struct OpenCall
+      {
+        CallExpressionNode* call;
+        size_t position;
+        // The nodes before it that cannot move, and the reads before it
+        size_t unmovable;
+        size_t reads;
+        // The index of the first call around it, itself included, that a
+        //   write in it blocks, once it is left
+        size_t blockedFrom;
+      };
+
+      bool
+      arrive (ExpressionNode* node)
+      {
+        ++m_position;
+        m_path.push_back (node);
+        return true;
+      }
+
+      // Leaves the expression walked; whether an assignment stores to it
+      bool
+      depart ()
+      {
+        Node* node = m_path.back ();
+        m_path.pop_back ();
+        AssignmentExpressionNode* assignment = dynamic_cast<AssignmentExpressionNode*> (m_path.back ());
+        return assignment != nullptr && assignment->variable == node;
+      }
+
+      // Blocks the calls being walked that were entered after declaration
+      //   was first read, if it is a local
+      void
+      write (DeclarationNode* declaration)
+      {
+        auto read = m_firstReads.find (declaration);
+        if (read == m_firstReads.end ())
+          return;
+        auto after = std::upper_bound (m_calls.begin (), m_calls.end (), read->second,
+                                       [] (size_t position, const OpenCall& call) { return position < call.position; });
+        if (after != m_calls.end ())
+          m_calls.back ().blockedFrom = std::min (m_calls.back ().blockedFrom, (size_t) (after - m_calls.begin ()));
+      }
+
+      Inliner&                 m_inliner;
+      FunctionDeclarationNode* m_caller;
+      StatementNode**          m_slot;
+      StatementNode*           m_statement;
+      // The expressions being walked, below the statement
+      std::vector<Node*>       m_path;
+      size_t                   m_position;
+      size_t                   m_unmovable;
+      unsigned                 m_targets;
+      // The calls being walked that may be inlined, outermost first
+      std::vector<OpenCall>    m_calls;
+      // Where each local was first read, and the locals in the order
+      //   they were
+      std::unordered_map<DeclarationNode*, size_t> m_firstReads;
+      std::vector<DeclarationNode*> m_reads;
+    };
+
+    // Whether call, in statement under parent, can be inlined there
+    bool
+    canInline (StatementNode* statement, CallExpressionNode* call, Node* parent)
+    {
+      FunctionDeclarationNode* callee = static_cast<FunctionDeclarationNode*> (call->usingDecNode);
+      if (!isInlinable (callee))
+        return false;
+      // Without a result, the call must be all the statement computes
+      if (callee->valueType == ValueType::VOID
+          && (parent != statement || dynamic_cast<ExpressionStatementNode*> (statement) == nullptr))
+        return false;
+      for (size_t n = 0; n < callee->parameters.size (); ++n)
+        if (callee->parameters[n]->isArray && (dynamic_cast<VariableExpressionNode*> (call->arguments[n]) == nullptr
+                                               || dynamic_cast<SubscriptExpressionNode*> (call->arguments[n]) != nullptr))
+          return false;
+      return true;
+    }
+
+    // Puts the body of call's function, with locals for the result and
+    //   the parameters, ahead of the statement in slot, and the result
+    //   in place of call in its parent
+    void
+    inlineCall (FunctionDeclarationNode* caller, StatementNode** slot, CallExpressionNode* call, Node* parent)
+    {
+      FunctionDeclarationNode* callee = static_cast<FunctionDeclarationNode*> (call->usingDecNode);
+      unhideGlobals (caller, callee);
+
+      std::unordered_map<DeclarationNode*, DeclarationNode*> substitutions;
+      std::vector<VariableDeclarationNode*> declarations;
+      std::vector<StatementNode*> statements;
+      VariableDeclarationNode* result = nullptr;
+      if (callee->valueType != ValueType::VOID)
+      {
+        result = makeLocal (m_arena, m_names, callee->identifier, call->row, call->col);
+        declarations.push_back (result);
+      }
+      for (size_t n = 0; n < callee->parameters.size (); ++n)
+      {
+        ParameterNode* parameter = callee->parameters[n];
+        if (parameter->isArray)
+        {
+          substitutions[parameter] = static_cast<VariableExpressionNode*> (call->arguments[n])->usingDecNode;
+          continue;
+        }
+        VariableDeclarationNode* local
+          = makeLocal (m_arena, m_names, parameter->identifier, parameter->row, parameter->col);
+        substitutions[parameter] = local;
+        declarations.push_back (local);
+        statements.push_back (makeAssignment (m_arena, local, call->arguments[n]));
+      }
+
+      TreeCloner cloner (m_arena, &m_names, substitutions);
+      StatementNode* body = static_cast<StatementNode*> (cloner.copy (callee->functionBody));
+      endReturns (body, m_arena);
+      StatementSlotCollector bodyStatements;
+      bodyStatements.walk (body);
+      for (StatementNode** bodySlot : bodyStatements.slots)
+        if (ReturnStatementNode* statement = dynamic_cast<ReturnStatementNode*> (*bodySlot))
+        {
+          if (result != nullptr && statement->expression != nullptr)
+            *bodySlot = makeAssignment (m_arena, result, statement->expression);
+          else
+            *bodySlot = m_arena.make<ExpressionStatementNode> (nullptr);
+        }
+      statements.push_back (body);
+      // The body, a declaration and an assignment for each scalar
+      // parameter, and the result's declaration and read, less the call
+      // and the arrays it passed; the compound statement takes the
+      // call's place
+      m_stats.addedNodes += countNodes (body) + 4 * (statements.size () - 1) + (result != nullptr ? 2 : 0)
+        - (callee->parameters.size () - (statements.size () - 1));
+
+      std::vector<ExpressionNode**> children;
+      getExpressionSlots (parent, children);
+      for (ExpressionNode** child : children)
+        if (*child == call)
+          *child = result != nullptr ? makeRead (m_arena, result, call->row, call->col) : nullptr;
+      statements.push_back (*slot);
+      *slot = m_arena.make<CompoundStatementNode> (declarations, statements);
+      ++m_stats.calls[callee->identifier];
+    }
+
+    // Renames the declarations of caller that would hide from callee's
+    //   body, once it is in caller, the globals it refers to
+    void
+    unhideGlobals (FunctionDeclarationNode* caller, FunctionDeclarationNode* callee)
+    {
+      ReferenceVisitor references;
+      references.walk (callee->functionBody);
+      for (DeclarationNode* declaration : references.references)
+      {
+        if (declaration->nestLevel != 0)
+          continue;
+        auto hiding = m_locals.find (declaration->identifier);
+        if (hiding == m_locals.end ())
+          continue;
+        for (DeclarationNode* local : hiding->second)
+          renameDeclaration (local, caller, m_names.make (local->identifier));
+        m_locals.erase (hiding);
+      }
+    }
+
+    ProgramNode*  m_program;
+    AstArena&     m_arena;
+    NameSupply&   m_names;
+    size_t        m_budget;
+    InlineStats&  m_stats;
+
+    // The functions each function calls, in the order first called
+    std::unordered_map<FunctionDeclarationNode*, std::vector<FunctionDeclarationNode*>> m_callees;
+    std::unordered_set<FunctionDeclarationNode*> m_recursive;
+    std::unordered_map<FunctionDeclarationNode*, bool> m_inlinable;
+    // The declarations of the caller being inlined into that have their
+    //   own names yet, by name
+    std::unordered_map<std::string, std::vector<DeclarationNode*>> m_locals;
+  };
+}
+
+/***********************************************************************/
+
+InlineStats
+inlineCalls (ProgramNode* program, AstArena& arena, NameSupply& names, size_t budget)
+{
+  InlineStats stats;
+  Inliner inliner (program, arena, names, budget, stats);
+  inliner.run ();
+  return stats;
+}
@@ -0,0 +1,68 @@
+/*
+  Filename   : Inliner.h
+  Author     : Philip Androwick
+  Description: Inlining of small functions on the checked tree: a call
+               gives way to a copy of the body of the function called.
+*/
+
+/***********************************************************************/
+
+#ifndef INLINER_H
+#define INLINER_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+class NameSupply;
+
+struct InlineStats
+{
+  // Calls inlined, by the name of the function called
+  std::map<std::string, size_t> calls;
+  // Nodes the tree gained
+  size_t addedNodes = 0;
+};
+
+// Inlines calls in program, which must have been resolved and checked,
+//   to the functions whose bodies have at most budget nodes.  Functions
+//   are taken callees first, following the call graph, so that a body
+//   is measured and copied with its own calls already inlined; those
+//   that can call themselves are never inlined.
+//
+// A call in the expression of an expression statement, a return or
+//   the condition of an if gives way to a read of a new local, the
+//   callee's result.  Ahead of the statement go new locals for the
+//   scalar parameters, assigned the arguments, and then the body, in
+//   which each return assigns the result instead; an array parameter
+//   becomes the array passed, as it is passed by reference.  The
+//   body's locals are renamed, and a caller's local that would hide a
+//   global the body uses is too.  A return that does not end the body
+//   is handled by moving what follows it into the other branch of its
+//   if; a function with a return in a loop, or in one branch of an if
+//   that the other branch's path continues past, is not inlined, nor is
+//   one with a local array, which each call would clear.  Nor is a call
+//   in a loop condition inlined, nor one whose statement first does
+//   something that moving the body ahead of it would change: it may
+//   only compute from literals and locals that the call's arguments do
+//   not assign.  A statement's calls are decided in one walk of it in
+//   the order they are evaluated, so a call nested in another's
+//   arguments is inlined first.  New nodes are made in arena and new
+//   names by names.
+InlineStats
+inlineCalls (ProgramNode* program, AstArena& arena, NameSupply& names, size_t budget);
+
+/***********************************************************************/
+
+#endif
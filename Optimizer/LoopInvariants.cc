@@ -0,0 +1,265 @@
+/*
+  Filename   : LoopInvariants.cc
+  Author     : Philip Androwick
+  Description: One walk finds, for each expression in a loop, the
+               outermost of the loops around it that it is invariant in,
+               and so which loop each operator leaves; the loops are
+               then changed outermost first.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "LoopInvariants.h"
+#include "AstRewriter.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // An operator to hoist, by its place in its parent
+  struct Hoist
+  {
+    ExpressionNode** slot;
+    // Where the operator comes in the walk
+    size_t order;
+  };
+
+  // The operators to hoist out of each while loop: those invariant in
+  //   it but not in the loop around it, whose parent is not invariant
+  //   in it too.  A loop's effects include those of the loops inside
+  //   it, so an expression invariant in a loop is invariant in every
+  //   loop inside it as well.
+  class InvariantFinder : public AstWalker
+  {
+  public:
+    explicit InvariantFinder (const std::unordered_map<WhileStatementNode*, LoopEffects>& effects)
+      : m_effects (effects), m_order (0)
+    { }
+
+    virtual bool
+    enter (WhileStatementNode* node)
+    {
+      m_loops.push_back (node);
+      m_loopEffects.push_back (&m_effects.at (node));
+      return true;
+    }
+
+    virtual void
+    leave (WhileStatementNode* node)
+    {
+      settle (&node->conditionalExpression, m_loops.size ());
+      m_loops.pop_back ();
+      m_loopEffects.pop_back ();
+    }
+
+    virtual void
+    leave (IfStatementNode* node)
+    {
+      settle (&node->conditionalExpression, m_loops.size ());
+    }
+
+    virtual void
+    leave (ReturnStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        settle (&node->expression, m_loops.size ());
+    }
+
+    virtual void
+    leave (ExpressionStatementNode* node)
+    {
+      if (node->expression != nullptr)
+        settle (&node->expression, m_loops.size ());
+    }
+
+    virtual void
+    leave (AssignmentExpressionNode* node)
+    {
+      settle (&node->expression, m_loops.size ());
+    }
+
+    virtual void
+    leave (SubscriptExpressionNode* node)
+    {
+      settle (&node->index, m_loops.size ());
+    }
+
+    virtual void
+    leave (CallExpressionNode* node)
+    {
+      for (ExpressionNode*& argument : node->arguments)
+        settle (&argument, m_loops.size ());
+    }
+
+    virtual void
+    leave (IntegerLiteralExpressionNode* node)
+    {
+      invariant (node, 0, false);
+    }
+
+    virtual void
+    leave (VariableExpressionNode* node)
+    {
+      DeclarationNode* declaration = node->usingDecNode;
+      bool global = isScalarGlobal (declaration);
+      if (!global && !isScalarLocal (declaration))
+        return;
+      // The loops that leave it alone are the innermost ones
+      auto first = std::partition_point (m_loopEffects.begin (), m_loopEffects.end (),
+        [declaration, global] (const LoopEffects* loop)
+        {
+          return loop->written.count (declaration) != 0 || (global && loop->calls);
+        });
+      invariant (node, first - m_loopEffects.begin (), false);
+    }
+
+    virtual void
+    leave (AdditiveExpressionNode* node)
+    {
+      operate (node, &node->left, &node->right);
+    }
+
+    virtual void
+    leave (MultiplicativeExpressionNode* node)
+    {
+      // Computed ahead of the loop, a division by 0 could stop a program
+      // that would never have come to it
+      IntegerLiteralExpressionNode* divisor = asLiteral (node->right);
+      if (node->multOperator == MultiplicativeOperatorType::TIMES || (divisor != nullptr && divisor->value != 0))
+        operate (node, &node->left, &node->right);
+      else
+      {
+        settle (&node->left, m_loops.size ());
+        settle (&node->right, m_loops.size ());
+      }
+    }
+
+    virtual void
+    leave (RelationalExpressionNode* node)
+    {
+      operate (node, &node->left, &node->right);
+    }
+
+    // The operators to hoist out of each loop, with where each comes in
+    //   the walk
+    std::unordered_map<WhileStatementNode*, std::vector<Hoist>> hoists;
+
+  private:
+    // How invariant an expression under the loops being walked is
+    struct Invariance
+    {
+      // The outermost loop it is invariant in, by its place among them
+      size_t loop;
+      // Where an operator comes in the walk, or 0 for a literal or a
+      //   variable, which are never hoisted
+      size_t order;
+    };
+
+    static bool
+    isScalarGlobal (DeclarationNode* declaration)
+    {
+      return declaration->nestLevel == 0 && dynamic_cast<VariableDeclarationNode*> (declaration) != nullptr
+        && dynamic_cast<ArrayDeclarationNode*> (declaration) == nullptr;
+    }
+
+    // The outermost loop expression is invariant in, or the number of
+    //   loops if it is invariant in none
+    size_t
+    getLoop (ExpressionNode* expression) const
+    {
+      auto found = m_invariance.find (expression);
+      return found != m_invariance.end () ? found->second.loop : m_loops.size ();
+    }
+
+    void
+    invariant (ExpressionNode* expression, size_t loop, bool isOperator)
+    {
+      if (loop < m_loops.size ())
+        m_invariance[expression] = { loop, isOperator ? ++m_order : 0 };
+    }
+
+    void
+    operate (ExpressionNode* node, ExpressionNode** left, ExpressionNode** right)
+    {
+      size_t loop = std::max (getLoop (*left), getLoop (*right));
+      settle (left, loop);
+      settle (right, loop);
+      invariant (node, loop, true);
+    }
+
+    // Hoists the operator in slot out of the loop it is invariant in, if
+    //   its parent, invariant in the loops from loop in, is not
+    //   invariant there
+    void
+    settle (ExpressionNode** slot, size_t loop)
+    {
+      auto found = m_invariance.find (*slot);
+      if (found == m_invariance.end ())
+        return;
+      if (found->second.order != 0 && found->second.loop < loop)
+        hoists[m_loops[found->second.loop]].push_back ({ slot, found->second.order });
+      m_invariance.erase (found);
+    }
+
+    const std::unordered_map<WhileStatementNode*, LoopEffects>& m_effects;
+    // The loops around the walked node, outermost first
+    std::vector<WhileStatementNode*> m_loops;
+    std::vector<const LoopEffects*> m_loopEffects;
+    // The expressions walked whose parents have not been, when they are
+    //   invariant in one of the loops around them
+    std::unordered_map<ExpressionNode*, Invariance> m_invariance;
+    size_t m_order;
+  };
+}
+
+/***********************************************************************/
+
+LoopInvariantStats
+hoistLoopInvariants (ProgramNode* program, AstArena& arena, NameSupply& names)
+{
+  LoopInvariantStats stats;
+  LoopEffectCollector effects;
+  effects.walk (program);
+  InvariantFinder finder (effects.effects);
+  finder.walk (program);
+  if (finder.hoists.empty ())
+    return stats;
+
+  // Outer loops first, as an operator hoisted out of an inner loop may
+  // hold reads of those hoisted out of the loops around it
+  StatementSlotCollector statements;
+  statements.walk (program);
+  for (StatementNode** slot : statements.slots)
+  {
+    auto found = finder.hoists.find (dynamic_cast<WhileStatementNode*> (*slot));
+    if (found == finder.hoists.end ())
+      continue;
+
+    std::vector<Hoist>& hoists = found->second;
+    std::sort (hoists.begin (), hoists.end (),
+               [] (const Hoist& left, const Hoist& right) { return left.order < right.order; });
+    std::vector<VariableDeclarationNode*> declarations;
+    std::vector<StatementNode*> assignments;
+    for (const Hoist& hoist : hoists)
+    {
+      ExpressionNode* node = *hoist.slot;
+      VariableDeclarationNode* local = makeLocal (arena, names, "invariant", node->row, node->col);
+      declarations.push_back (local);
+      assignments.push_back (makeAssignment (arena, local, node));
+      *hoist.slot = makeRead (arena, local, node->row, node->col);
+    }
+    assignments.push_back (*slot);
+    *slot = arena.make<CompoundStatementNode> (declarations, assignments);
+    stats.hoisted += hoists.size ();
+    ++stats.loops;
+  }
+  return stats;
+}
@@ -0,0 +1,53 @@
+/*
+  Filename   : LoopInvariants.h
+  Author     : Philip Androwick
+  Description: Loop-invariant code motion on the checked tree: what a
+               while loop computes the same way on every iteration is
+               computed once, ahead of it.
+*/
+
+/***********************************************************************/
+
+#ifndef LOOP_INVARIANTS_H
+#define LOOP_INVARIANTS_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+class NameSupply;
+
+struct LoopInvariantStats
+{
+  // Expressions hoisted, and the loops they were hoisted out of
+  size_t hoisted = 0;
+  size_t loops = 0;
+};
+
+// Hoists the invariant expressions of the while loops of program, which
+//   must have been resolved and checked.  An expression in a loop's
+//   condition or body is invariant if it is a literal, a scalar local or
+//   parameter declared outside the loop that the loop does not assign, a
+//   scalar global the loop neither assigns nor can change by a call, or
+//   an operator on invariant operands that cannot stop the program: a
+//   division only counts if it is by a nonzero literal.  Subscripts and
+//   calls never count.  Each largest invariant operator gives way to a
+//   read of a new local, assigned the operator ahead of the loop, in a
+//   compound statement that takes the loop's place.  Loops are taken
+//   outermost first, so an expression leaves every loop it is invariant
+//   in.  New nodes are made in arena and new names by names.
+LoopInvariantStats
+hoistLoopInvariants (ProgramNode* program, AstArena& arena, NameSupply& names);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,488 @@
+/*
+  Filename   : LoopUnroller.cc
+  Author     : Philip Androwick
+  Description: One walk finds the loops with their sizes and writes,
+               and they are then unrolled inner loops first, each adding
+               what it has become to the loop around it, so that an outer
+               loop is measured with the copies its inner loops have
+               become without walking it again.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "LoopUnroller.h"
+#include "AstRewriter.h"
+#include "TreeCloner.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // Where a while loop is: its slot, and the compound statement and
+  //   index the slot is at, if it is one of a compound's statements
+  struct LoopPlace
+  {
+    StatementNode** slot;
+    CompoundStatementNode* compound;
+    size_t index;
+  };
+
+  const size_t NO_LOOP = SIZE_MAX;
+
+  // A while loop as walked, and what its body has become once the loops
+  //   inside it are unrolled
+  struct LoopInfo
+  {
+    LoopPlace place;
+    // The loop around it, or NO_LOOP
+    size_t parent = NO_LOOP;
+    // Nodes in the loop and in its body, as walked
+    size_t nodes = 0;
+    size_t bodyNodes = 0;
+    // Nodes the loops inside it have gained
+    long long addedNodes = 0;
+    // Writes to each variable and array in its body, and whether the
+    //   body still has loops in it
+    std::unordered_map<DeclarationNode*, size_t> writes;
+    bool hasLoops = false;
+  };
+
+  // The while loops under the walked statement, outer loops first, with
+  //   their sizes, their writes and the loops around them, in one walk
+  //   rather than one for each loop
+  class LoopCollector : public NodeCounter
+  {
+  public:
+    LoopCollector ()
+    {
+      addEdgeSlot (ChildSlot::BODY);
+    }
+
+    virtual bool
+    enter (CompoundStatementNode* node) override
+    {
+      NodeCounter::enter (node);
+      for (size_t n = 0; n < node->statements.size (); ++n)
+        add (&node->statements[n], node, n);
+      return true;
+    }
+
+    virtual bool
+    enter (IfStatementNode* node) override
+    {
+      NodeCounter::enter (node);
+      add (&node->thenStatement, nullptr, 0);
+      if (node->elseStatement != nullptr)
+        add (&node->elseStatement, nullptr, 0);
+      return true;
+    }
+
+    virtual bool
+    enter (WhileStatementNode* node) override
+    {
+      LoopInfo& loop = loops[m_indices.at (node)];
+      loop.parent = m_open.empty () ? NO_LOOP : m_open.back ();
+      loop.nodes = count;
+      NodeCounter::enter (node);
+      add (&node->body, nullptr, 0);
+      return true;
+    }
+
+    virtual void
+    leave (WhileStatementNode* node) override
+    {
+      LoopInfo& loop = loops[m_indices.at (node)];
+      loop.nodes = count - loop.nodes;
+    }
+
+    // The condition of a loop is walked before its body, and its
+    //   writes are those of the loop around it
+    virtual void
+    enterChild (Node* parent, ChildSlot slot) override
+    {
+      size_t index = m_indices.at (static_cast<WhileStatementNode*> (parent));
+      loops[index].bodyNodes = count;
+      m_open.push_back (index);
+    }
+
+    virtual void
+    leaveChild (Node* parent, ChildSlot slot) override
+    {
+      LoopInfo& loop = loops[m_open.back ()];
+      loop.bodyNodes = count - loop.bodyNodes;
+      m_open.pop_back ();
+    }
+
+    virtual bool
+    enter (AssignmentExpressionNode* node) override
+    {
+      NodeCounter::enter (node);
+      write (node->variable->usingDecNode);
+      return true;
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node) override
+    {
+      NodeCounter::enter (node);
+      if (isInputCall (node))
+        write (static_cast<VariableExpressionNode*> (node->arguments[0])->usingDecNode);
+      return true;
+    }
+
+    std::vector<LoopInfo> loops;
+
+  private:
+    void
+    add (StatementNode** slot, CompoundStatementNode* compound, size_t index)
+    {
+      WhileStatementNode* loop = dynamic_cast<WhileStatementNode*> (*slot);
+      if (loop == nullptr)
+        return;
+      m_indices[loop] = loops.size ();
+      loops.emplace_back ();
+      loops.back ().place = { slot, compound, index };
+    }
+
+    void
+    write (DeclarationNode* declaration)
+    {
+      if (!m_open.empty ())
+        ++loops[m_open.back ()].writes[declaration];
+    }
+
+    std::unordered_map<WhileStatementNode*, size_t> m_indices;
+    // The loops whose bodies are being walked, innermost last
+    std::vector<size_t> m_open;
+  };
+
+  // A counted loop: while (variable comparison bound), stepped by step
+  struct CountedLoop
+  {
+    DeclarationNode*       variable;
+    RelationalOperatorType comparison;
+    ExpressionNode*        bound;
+    int32_t                step;
+  };
+
+  // The comparison with its sides swapped
+  RelationalOperatorType
+  mirror (RelationalOperatorType op)
+  {
+    switch (op)
+    {
+      case RelationalOperatorType::LT:
+        return RelationalOperatorType::GT;
+      case RelationalOperatorType::LTE:
+        return RelationalOperatorType::GTE;
+      case RelationalOperatorType::GT:
+        return RelationalOperatorType::LT;
+      case RelationalOperatorType::GTE:
+        return RelationalOperatorType::LTE;
+      default:
+        return op;
+    }
+  }
+
+  // The scalar local or parameter expression reads, or nullptr
+  DeclarationNode*
+  readLocal (ExpressionNode* expression)
+  {
+    VariableExpressionNode* read = dynamic_cast<VariableExpressionNode*> (expression);
+    if (read == nullptr || dynamic_cast<SubscriptExpressionNode*> (read) != nullptr
+        || !isScalarLocal (read->usingDecNode))
+      return nullptr;
+    return read->usingDecNode;
+  }
+
+  // Writes of declaration in a loop's body with writes
+  size_t
+  countWrites (const std::unordered_map<DeclarationNode*, size_t>& writes, DeclarationNode* declaration)
+  {
+    auto found = writes.find (declaration);
+    return found != writes.end () ? found->second : 0;
+  }
+
+  // Whether loop, whose body has writes, counts variable, compared by
+  //   comparison with bound
+  bool
+  isCounted (WhileStatementNode* loop, const std::unordered_map<DeclarationNode*, size_t>& writes,
+             DeclarationNode* variable, RelationalOperatorType comparison, ExpressionNode* bound,
+             CountedLoop& counted)
+  {
+    if (variable == nullptr)
+      return false;
+    CompoundStatementNode* body = static_cast<CompoundStatementNode*> (loop->body);
+    bool stepped = false;
+    for (StatementNode* statement : body->statements)
+    {
+      DeclarationNode* incremented;
+      uint32_t step;
+      if (isIncrement (statement, incremented, step) && incremented == variable)
+      {
+        stepped = true;
+        counted.step = (int32_t) step;
+        break;
+      }
+    }
+    // The increment must be the only write
+    if (!stepped || counted.step == 0 || countWrites (writes, variable) != 1)
+      return false;
+
+    if (asLiteral (bound) == nullptr)
+    {
+      DeclarationNode* limit = readLocal (bound);
+      if (limit == nullptr || limit == variable || countWrites (writes, limit) != 0)
+        return false;
+    }
+
+    bool up = comparison == RelationalOperatorType::LT || comparison == RelationalOperatorType::LTE;
+    bool down = comparison == RelationalOperatorType::GT || comparison == RelationalOperatorType::GTE;
+    if (!(up && counted.step > 0) && !(down && counted.step < 0))
+      return false;
+    counted.variable = variable;
+    counted.comparison = comparison;
+    counted.bound = bound;
+    return true;
+  }
+
+  // Whether loop is counted, with the variable on either side of its
+  //   condition
+  bool
+  analyze (WhileStatementNode* loop, const std::unordered_map<DeclarationNode*, size_t>& writes,
+           CountedLoop& counted)
+  {
+    RelationalExpressionNode* condition = dynamic_cast<RelationalExpressionNode*> (loop->conditionalExpression);
+    if (condition == nullptr || dynamic_cast<CompoundStatementNode*> (loop->body) == nullptr)
+      return false;
+    return isCounted (loop, writes, readLocal (condition->left), condition->relationalOperator, condition->right,
+                      counted)
+      || isCounted (loop, writes, readLocal (condition->right), mirror (condition->relationalOperator),
+                    condition->left, counted);
+  }
+
+  // The literal variable is assigned ahead of the loop at place, if
+  //   nothing between them can change variable or leave the block
+  bool
+  findStart (const LoopPlace& place, DeclarationNode* variable, int32_t& start)
+  {
+    if (place.compound == nullptr)
+      return false;
+    for (size_t n = place.index; n-- > 0; )
+    {
+      ExpressionStatementNode* statement = dynamic_cast<ExpressionStatementNode*> (place.compound->statements[n]);
+      if (statement == nullptr)
+        return false;
+      AssignmentExpressionNode* assignment = dynamic_cast<AssignmentExpressionNode*> (statement->expression);
+      if (assignment != nullptr && readLocal (assignment->variable) == variable)
+      {
+        IntegerLiteralExpressionNode* literal = asLiteral (assignment->expression);
+        if (literal == nullptr)
+          return false;
+        start = literal->value;
+        return true;
+      }
+      WriteCollector writes;
+      writes.walk (statement);
+      if (writes.written.count (variable) != 0)
+        return false;
+    }
+    return false;
+  }
+
+  // Iterations of counted from start to a literal bound, or -1 if more
+  //   than limit or if the variable would wrap
+  long long
+  countIterations (const CountedLoop& counted, int32_t start, size_t limit)
+  {
+    int64_t value = start;
+    int64_t bound = asLiteral (counted.bound)->value;
+    long long iterations = 0;
+    while (true)
+    {
+      bool runs;
+      switch (counted.comparison)
+      {
+        case RelationalOperatorType::LT:
+          runs = value < bound;
+          break;
+        case RelationalOperatorType::LTE:
+          runs = value <= bound;
+          break;
+        case RelationalOperatorType::GT:
+          runs = value > bound;
+          break;
+        default:
+          runs = value >= bound;
+          break;
+      }
+      if (!runs)
+        return iterations;
+      value += counted.step;
+      if (++iterations > (long long) limit || value > INT32_MAX || value < INT32_MIN)
+        return -1;
+    }
+  }
+
+  class Unroller
+  {
+  public:
+    Unroller (AstArena& arena, NameSupply& names, unsigned factor, UnrollStats& stats)
+      : m_arena (arena), m_names (names), m_factor (factor), m_stats (stats)
+    { }
+
+    // Unrolls loop, if it is counted, and adds what it changed to
+    //   the loop around it
+    void
+    unroll (std::vector<LoopInfo>& loops, size_t index)
+    {
+      LoopInfo& loop = loops[index];
+      long long before = (long long) loop.nodes + loop.addedNodes;
+      Unrolled unrolled = unroll (loop);
+      if (unrolled != Unrolled::NONE)
+      {
+        long long after = (long long) countNodes (*loop.place.slot);
+        m_stats.addedNodes += after - before;
+        loop.addedNodes += after - before;
+      }
+      if (loop.parent == NO_LOOP)
+        return;
+
+      LoopInfo& parent = loops[loop.parent];
+      parent.addedNodes += loop.addedNodes;
+      // A loop without copies left takes its writes with it, and one
+      //   replaced by copies of its body has loops only if the body did
+      if (unrolled == Unrolled::FULL && static_cast<CompoundStatementNode*> (*loop.place.slot)->statements.empty ())
+        return;
+      parent.hasLoops = parent.hasLoops || unrolled != Unrolled::FULL || loop.hasLoops;
+      if (parent.writes.size () < loop.writes.size ())
+        parent.writes.swap (loop.writes);
+      for (const std::pair<DeclarationNode* const, size_t>& write : loop.writes)
+        parent.writes[write.first] += write.second;
+    }
+
+  private:
+    // What unrolling a loop did: nothing, replace it by copies of its
+    //   body, or put a loop of copies ahead of it
+    enum class Unrolled
+    {
+      NONE, FULL, PARTIAL
+    };
+
+    // Unrolls loop, if it is counted
+    Unrolled
+    unroll (LoopInfo& loop)
+    {
+      const LoopPlace& place = loop.place;
+      WhileStatementNode* node = static_cast<WhileStatementNode*> (*place.slot);
+      CountedLoop counted;
+      if (!analyze (node, loop.writes, counted))
+        return Unrolled::NONE;
+      size_t bodyNodes = (size_t) ((long long) loop.bodyNodes + loop.addedNodes);
+
+      int32_t start;
+      if (asLiteral (counted.bound) != nullptr && findStart (place, counted.variable, start))
+      {
+        long long iterations = countIterations (counted, start, MAX_UNROLLED_NODES / bodyNodes);
+        if (iterations >= 0)
+        {
+          *place.slot = m_arena.make<CompoundStatementNode> (std::vector<VariableDeclarationNode*> (),
+                                                             copies (node->body, (size_t) iterations));
+          ++m_stats.full;
+          return Unrolled::FULL;
+        }
+      }
+
+      if (m_factor < 2 || loop.hasLoops || bodyNodes * m_factor > MAX_UNROLLED_NODES)
+        return Unrolled::NONE;
+      int64_t distance = (int64_t) (m_factor - 1) * counted.step;
+      if (distance > INT32_MAX || distance < INT32_MIN)
+        return Unrolled::NONE;
+
+      RelationalExpressionNode* condition = static_cast<RelationalExpressionNode*> (node->conditionalExpression);
+      int row = condition->row;
+      int col = condition->col;
+      std::vector<VariableDeclarationNode*> declarations;
+      std::vector<StatementNode*> statements;
+      ExpressionNode* limit;
+      ExpressionNode* guard = nullptr;
+      if (IntegerLiteralExpressionNode* literal = asLiteral (counted.bound))
+      {
+        int64_t value = literal->value - distance;
+        // No iteration could run all the copies
+        if (value > INT32_MAX || value < INT32_MIN)
+          return Unrolled::NONE;
+        limit = m_arena.make<IntegerLiteralExpressionNode> ((int32_t) value, row, col);
+      }
+      else
+      {
+        DeclarationNode* bound = readLocal (counted.bound);
+        VariableDeclarationNode* local = makeLocal (m_arena, m_names, "limit", row, col);
+        declarations.push_back (local);
+        statements.push_back (makeAssignment (m_arena, local, m_arena.make<AdditiveExpressionNode> (
+          AdditiveOperatorType::MINUS, makeRead (m_arena, bound, row, col),
+          m_arena.make<IntegerLiteralExpressionNode> ((int32_t) distance, row, col), row, col)));
+        // The limit wrapped if it is not on the near side of the bound
+        guard = m_arena.make<RelationalExpressionNode> (
+          distance > 0 ? RelationalOperatorType::LT : RelationalOperatorType::GT,
+          makeRead (m_arena, local, row, col), makeRead (m_arena, bound, row, col), row, col);
+        limit = makeRead (m_arena, local, row, col);
+      }
+
+      StatementNode* unrolled = m_arena.make<WhileStatementNode> (
+        m_arena.make<RelationalExpressionNode> (counted.comparison, makeRead (m_arena, counted.variable, row, col),
+                                                limit, row, col),
+        m_arena.make<CompoundStatementNode> (std::vector<VariableDeclarationNode*> (),
+                                             copies (node->body, m_factor)));
+      if (guard != nullptr)
+        unrolled = m_arena.make<IfStatementNode> (guard, unrolled, nullptr);
+      statements.push_back (unrolled);
+      statements.push_back (node);
+      *place.slot = m_arena.make<CompoundStatementNode> (declarations, statements);
+      ++m_stats.partial;
+      return Unrolled::PARTIAL;
+    }
+
+    // count copies of body, each with locals of its own
+    std::vector<StatementNode*>
+    copies (StatementNode* body, size_t count)
+    {
+      std::vector<StatementNode*> statements;
+      for (size_t n = 0; n < count; ++n)
+      {
+        std::unordered_map<DeclarationNode*, DeclarationNode*> substitutions;
+        TreeCloner cloner (m_arena, &m_names, substitutions);
+        statements.push_back (static_cast<StatementNode*> (cloner.copy (body)));
+      }
+      return statements;
+    }
+
+    AstArena&    m_arena;
+    NameSupply&  m_names;
+    unsigned     m_factor;
+    UnrollStats& m_stats;
+  };
+}
+
+/***********************************************************************/
+
+UnrollStats
+unrollLoops (ProgramNode* program, AstArena& arena, NameSupply& names, unsigned factor)
+{
+  UnrollStats stats;
+  Unroller unroller (arena, names, factor, stats);
+
+  LoopCollector loops;
+  loops.walk (program);
+  for (size_t n = loops.loops.size (); n-- > 0; )
+    unroller.unroll (loops.loops, n);
+  return stats;
+}
@@ -0,0 +1,69 @@
+/*
+  Filename   : LoopUnroller.h
+  Author     : Philip Androwick
+  Description: Unrolling of counted while loops on the checked tree: the
+               body is repeated so that the condition is tested less
+               often, or not at all when the number of iterations is
+               known and small.
+*/
+
+/***********************************************************************/
+
+#ifndef LOOP_UNROLLER_H
+#define LOOP_UNROLLER_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+class NameSupply;
+
+// Most nodes the copies of an unrolled loop's body may come to
+const size_t MAX_UNROLLED_NODES = 300;
+
+struct UnrollStats
+{
+  // Loops replaced by copies of their bodies, and loops unrolled by the
+  //   factor
+  size_t full = 0;
+  size_t partial = 0;
+  // Nodes the tree gained, less those it lost
+  long long addedNodes = 0;
+};
+
+// Unrolls the counted while loops of program, which must have been
+//   resolved and checked.  A loop is counted if its condition compares a
+//   scalar local or parameter i with a bound, a literal or a scalar
+//   local that the loop does not write, and its body is a compound
+//   statement one of whose statements is i = i + c or i = i - c for a
+//   literal c, the only write to i in the loop; c must move i toward the
+//   bound, so the comparison is <, <=, > or >= with i on the side that
+//   c makes smaller or larger.
+//
+// When i is assigned a literal before the loop, with nothing but
+//   expression statements that leave i alone in between, and the bound
+//   is a literal, the number of iterations is known.  If that many
+//   copies of the body come to at most MAX_UNROLLED_NODES, they replace
+//   the loop.  Otherwise a loop without loops in its body is unrolled
+//   by factor, if factor copies come to at most MAX_UNROLLED_NODES: a
+//   loop whose body is factor copies and whose condition asks whether
+//   all of them will run goes ahead of the original, which does what
+//   is left.  The new condition compares i with a limit, the bound less
+//   (factor - 1) * c, computed ahead of the loop and only used if it
+//   did not wrap.  The locals of each copy are renamed.  New nodes are
+//   made in arena and new names by names.
+UnrollStats
+unrollLoops (ProgramNode* program, AstArena& arena, NameSupply& names, unsigned factor);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,561 @@
+/*
+  Filename   : StrengthReduction.cc
+  Author     : Philip Androwick
+  Description: One walk finds where each variable is written and which
+               loops the writes are in, and a second the loop each
+               product is reduced in: the outermost around it that steps
+               its variable and leaves its factor alone.  The loops are
+               then reduced outermost first, and a last walk over the
+               loops with products replaces them.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "StrengthReduction.h"
+#include "AstRewriter.h"
+
+/***********************************************************************/
+
+namespace
+{
+  // A statement i = i + c, with c as a wrapping step, and where it is
+  //   among the writes walked
+  struct Increment
+  {
+    StatementNode* statement;
+    uint32_t step;
+    size_t position;
+  };
+
+  // The writes to a variable, in the order walked: its increments, and
+  //   its other writes and declaration
+  struct Writes
+  {
+    std::vector<Increment> increments;
+    std::vector<size_t> others;
+  };
+
+  // The writes walked before a loop, with those in it, and the loop
+  //   around it
+  struct LoopSpan
+  {
+    size_t start;
+    size_t end;
+    WhileStatementNode* parent;
+  };
+
+  // The writes of every variable under the walked nodes, the spans of
+  //   the loops, and the places of the statements
+  class WriteFinder : public StatementSlotCollector
+  {
+  public:
+    WriteFinder (std::unordered_map<DeclarationNode*, Writes>& writes,
+                 std::unordered_map<WhileStatementNode*, LoopSpan>& loops)
+      : m_writes (writes), m_loops (loops), m_position (0), m_increment (nullptr)
+    { }
+
+    virtual bool
+    enter (WhileStatementNode* node) override
+    {
+      m_loops[node] = { m_position, 0, m_open.empty () ? nullptr : m_open.back () };
+      m_open.push_back (node);
+      return StatementSlotCollector::enter (node);
+    }
+
+    virtual void
+    leave (WhileStatementNode* node) override
+    {
+      m_loops[node].end = m_position;
+      m_open.pop_back ();
+    }
+
+    virtual bool
+    enter (ExpressionStatementNode* node) override
+    {
+      DeclarationNode* variable;
+      uint32_t step;
+      if (isIncrement (node, variable, step))
+      {
+        m_writes[variable].increments.push_back ({ node, step, ++m_position });
+        m_increment = node->expression;
+      }
+      return true;
+    }
+
+    virtual bool
+    enter (AssignmentExpressionNode* node) override
+    {
+      if (node != m_increment)
+        write (node->variable->usingDecNode);
+      return true;
+    }
+
+    virtual bool
+    enter (CallExpressionNode* node) override
+    {
+      if (isInputCall (node))
+        write (static_cast<VariableExpressionNode*> (node->arguments[0])->usingDecNode);
+      return true;
+    }
+
+    // A local declared in a loop is out of scope ahead of it
+    virtual bool
+    enter (VariableDeclarationNode* node) override
+    {
+      write (node);
+      return true;
+    }
+
+    virtual bool
+    enter (ArrayDeclarationNode* node) override
+    {
+      write (node);
+      return true;
+    }
+
+  private:
+    void
+    write (DeclarationNode* declaration)
+    {
+      m_writes[declaration].others.push_back (++m_position);
+    }
+
+    std::unordered_map<DeclarationNode*, Writes>& m_writes;
+    std::unordered_map<WhileStatementNode*, LoopSpan>& m_loops;
+    // The loops around the walked node, outermost first
+    std::vector<WhileStatementNode*> m_open;
+    size_t m_position;
+    ExpressionNode* m_increment;
+  };
+
+  // A product of an induction variable and a factor: a local, or a
+  //   literal when factor is nullptr
+  typedef std::tuple<DeclarationNode*, DeclarationNode*, int32_t> ProductKey;
+
+  // A product to reduce, with where it comes in the walk and the
+  //   innermost loop around it
+  struct Product
+  {
+    MultiplicativeExpressionNode* node;
+    ProductKey key;
+    size_t order;
+    WhileStatementNode* loop;
+  };
+
+  class LoopReducer
+  {
+  public:
+    LoopReducer (AstArena& arena, NameSupply& names, StrengthStats& stats)
+      : m_arena (arena), m_names (names), m_stats (stats)
+    { }
+
+    // Reduces the products in the loops of program
+    void
+    reduce (ProgramNode* program)
+    {
+      WriteFinder writes (m_writes, m_loops);
+      writes.walk (program);
+      for (StatementNode** slot : writes.slots)
+        m_slots[*slot] = slot;
+      ProductFinder finder (*this);
+      finder.walk (program);
+
+      for (StatementNode** slot : writes.slots)
+      {
+        auto products = m_products.find (dynamic_cast<WhileStatementNode*> (*slot));
+        if (products != m_products.end ())
+          reduce (slot, products->second);
+      }
+      // Every product reduced is in one of the outermost loops with
+      //   products to reduce, or in what has taken its place
+      ProductReplacer replacer (m_arena, m_replaced);
+      for (WhileStatementNode* root : m_roots)
+        replacer.walk (*m_slots.at (root));
+    }
+
+  private:
+    // Finds the loop each product of an induction variable is reduced
+    //   in, and the products whose operands are products
+    class ProductFinder : public AstWalker
+    {
+    public:
+      explicit ProductFinder (LoopReducer& reducer)
+        : m_reducer (reducer), m_order (0)
+      { }
+
+      virtual bool
+      enter (WhileStatementNode* node)
+      {
+        m_open.push_back (node);
+        return true;
+      }
+
+      virtual void
+      leave (WhileStatementNode* node)
+      {
+        m_open.pop_back ();
+      }
+
+      virtual bool
+      enter (MultiplicativeExpressionNode* node)
+      {
+        ++m_order;
+        if (m_open.empty () || node->multOperator != MultiplicativeOperatorType::TIMES)
+          return true;
+        for (ExpressionNode* operand : { node->left, node->right })
+          if (MultiplicativeExpressionNode* product = dynamic_cast<MultiplicativeExpressionNode*> (operand))
+            m_reducer.m_parents[product] = { node, m_order };
+
+        // A loop's writes include those of the loops inside it, so each
+        //   key can be reduced in a run of the loops around the product:
+        //   those inside the last that writes its variable or factor, up
+        //   to the last that steps its variable
+        ProductKey keys[2];
+        size_t first[2] = { 0, 0 };
+        size_t last[2] = { 0, 0 };
+        for (int side = 0; side < 2; ++side)
+        {
+          bool found = side == 0 ? m_reducer.getKey (node->left, node->right, keys[side])
+                                 : m_reducer.getKey (node->right, node->left, keys[side]);
+          if (!found)
+            continue;
+          DeclarationNode* variable = std::get<0> (keys[side]);
+          DeclarationNode* factor = std::get<1> (keys[side]);
+          first[side] = std::partition_point (m_open.begin (), m_open.end (),
+            [this, variable, factor] (WhileStatementNode* loop)
+            {
+              return m_reducer.hasWrite (variable, loop) || (factor != nullptr && m_reducer.changes (factor, loop));
+            }) - m_open.begin ();
+          last[side] = std::partition_point (m_open.begin (), m_open.end (),
+            [this, variable] (WhileStatementNode* loop) { return m_reducer.hasIncrement (variable, loop); })
+            - m_open.begin ();
+        }
+        // The outermost loop, trying the left operand as the variable
+        //   first
+        int side = first[0] < last[0] && (first[1] >= last[1] || first[0] <= first[1]) ? 0 : 1;
+        if (first[side] < last[side])
+        {
+          m_reducer.m_products[m_open[first[side]]].push_back ({ node, keys[side], m_order, m_open.back () });
+          if (m_reducer.m_roots.empty () || m_reducer.m_roots.back () != m_open.front ())
+            m_reducer.m_roots.push_back (m_open.front ());
+        }
+        return true;
+      }
+
+    private:
+      LoopReducer& m_reducer;
+      // The loops around the walked node, outermost first
+      std::vector<WhileStatementNode*> m_open;
+      size_t m_order;
+    };
+
+    // Replaces the products in locals with reads of them
+    class ProductReplacer : public AstRewriter
+    {
+    public:
+      ProductReplacer (AstArena& arena,
+                       const std::unordered_map<ExpressionNode*, VariableDeclarationNode*>& locals)
+        : m_arena (arena), m_locals (locals)
+      { }
+
+      virtual bool
+      enter (MultiplicativeExpressionNode* node)
+      {
+        auto local = m_locals.find (node);
+        if (local == m_locals.end ())
+          return true;
+        replace (node, makeRead (m_arena, local->second, node->row, node->col));
+        return false;
+      }
+
+    private:
+      AstArena& m_arena;
+      const std::unordered_map<ExpressionNode*, VariableDeclarationNode*>& m_locals;
+    };
+
+    // A product with a product for an operand, and where it comes in
+    //   the walk
+    struct Parent
+    {
+      MultiplicativeExpressionNode* node;
+      size_t order;
+    };
+
+    // Reduces products, the products of the loop in slot
+    void
+    reduce (StatementNode** slot, std::vector<Product>& products)
+    {
+      WhileStatementNode* loop = static_cast<WhileStatementNode*> (*slot);
+      std::sort (products.begin (), products.end (),
+                 [] (const Product& left, const Product& right) { return left.order < right.order; });
+      std::map<ProductKey, std::vector<Product*>> groups;
+      for (Product& product : products)
+        groups[product.key].push_back (&product);
+
+      std::vector<VariableDeclarationNode*> declarations;
+      std::vector<StatementNode*> statements;
+      // The updates to put after each increment
+      std::unordered_map<StatementNode*, std::vector<StatementNode*>> updates;
+      std::vector<Product*> reduced;
+      for (auto& group : groups)
+      {
+        DeclarationNode* variable = std::get<0> (group.first);
+        MultiplicativeExpressionNode* product = group.second[0]->node;
+        VariableDeclarationNode* local = makeLocal (m_arena, m_names, variable->identifier, product->row, product->col);
+        declarations.push_back (local);
+        statements.push_back (makeAssignment (m_arena, local, copyProduct (group.first, product)));
+        for (Product* member : group.second)
+        {
+          m_replaced[member->node] = local;
+          reduced.push_back (member);
+        }
+
+        // The updates write the local where the increments are, and
+        //   step it too when the factor is a literal
+        Writes& localWrites = m_writes[local];
+        const std::vector<Increment>& increments = m_writes.at (variable).increments;
+        std::pair<size_t, size_t> range = getIncrements (variable, loop);
+        std::map<uint32_t, VariableDeclarationNode*> steps;
+        for (size_t n = range.first; n < range.second; ++n)
+        {
+          const Increment& increment = increments[n];
+          ExpressionNode* sum = stepped (local, group.first, increment.step, product, declarations, statements, steps);
+          StatementNode* update = makeAssignment (m_arena, local, sum);
+          updates[increment.statement].push_back (update);
+          if (std::get<1> (group.first) == nullptr)
+            localWrites.increments.push_back ({ update, increment.step * (uint32_t) std::get<2> (group.first),
+                                                increment.position });
+          else
+            localWrites.others.push_back (increment.position);
+        }
+        m_stats.products += group.second.size ();
+        ++m_stats.locals;
+      }
+      for (Product* product : reduced)
+        reduceParent (*product, loop);
+
+      for (auto& update : updates)
+      {
+        StatementNode** statementSlot = m_slots.at (update.first);
+        std::vector<StatementNode*> stepped = { update.first };
+        stepped.insert (stepped.end (), update.second.begin (), update.second.end ());
+        CompoundStatementNode* compound
+          = m_arena.make<CompoundStatementNode> (std::vector<VariableDeclarationNode*> (), stepped);
+        *statementSlot = compound;
+        for (StatementNode*& statement : compound->statements)
+          m_slots[statement] = &statement;
+      }
+
+      statements.push_back (loop);
+      *slot = m_arena.make<CompoundStatementNode> (declarations, statements);
+      ++m_stats.loops;
+    }
+
+    // Once product has given way to a read in loop, the product it is
+    //   an operand of may be one to reduce in a loop inside
+    void
+    reduceParent (const Product& product, WhileStatementNode* loop)
+    {
+      auto parent = m_parents.find (product.node);
+      if (parent == m_parents.end ())
+        return;
+      MultiplicativeExpressionNode* node = parent->second.node;
+      if (m_replaced.count (node) != 0 || !m_reparented.insert (node).second)
+        return;
+      ProductKey keys[2];
+      bool found[2] = { getKey (node->left, node->right, keys[0]), getKey (node->right, node->left, keys[1]) };
+      if (!found[0] && !found[1])
+      {
+        m_reparented.erase (node);
+        return;
+      }
+
+      std::vector<WhileStatementNode*> inside;
+      for (WhileStatementNode* open = product.loop; open != loop; open = m_loops.at (open).parent)
+        inside.push_back (open);
+      for (auto open = inside.rbegin (); open != inside.rend (); ++open)
+        for (int side = 0; side < 2; ++side)
+          if (found[side] && canReduce (keys[side], *open))
+          {
+            m_products[*open].push_back ({ node, keys[side], parent->second.order, product.loop });
+            return;
+          }
+    }
+
+    // The key of variable times factor, if variable is a read of a
+    //   scalar local or a product given way to one and factor a
+    //   literal other than 0 and 1 or such a read
+    bool
+    getKey (ExpressionNode* variable, ExpressionNode* factor, ProductKey& key) const
+    {
+      DeclarationNode* read = getRead (variable);
+      if (read == nullptr || !isScalarLocal (read))
+        return false;
+      if (IntegerLiteralExpressionNode* literal = asLiteral (factor))
+      {
+        // Multiplying by 0 or 1 is left to folding
+        if (literal->value == 0 || literal->value == 1)
+          return false;
+        key = ProductKey (read, nullptr, literal->value);
+        return true;
+      }
+      DeclarationNode* local = getRead (factor);
+      if (local == nullptr || !isScalarLocal (local))
+        return false;
+      key = ProductKey (read, local, 0);
+      return true;
+    }
+
+    // The variable expression reads, or nullptr
+    DeclarationNode*
+    getRead (ExpressionNode* expression) const
+    {
+      if (VariableExpressionNode* read = dynamic_cast<VariableExpressionNode*> (expression))
+        return read->usingDecNode;
+      auto local = m_replaced.find (expression);
+      return local != m_replaced.end () ? local->second : nullptr;
+    }
+
+    // Whether loop steps the variable of key and nothing else in it
+    //   writes it or the factor
+    bool
+    canReduce (const ProductKey& key, WhileStatementNode* loop) const
+    {
+      DeclarationNode* factor = std::get<1> (key);
+      return hasIncrement (std::get<0> (key), loop) && !hasWrite (std::get<0> (key), loop)
+        && (factor == nullptr || !changes (factor, loop));
+    }
+
+    bool
+    hasIncrement (DeclarationNode* variable, WhileStatementNode* loop) const
+    {
+      std::pair<size_t, size_t> increments = getIncrements (variable, loop);
+      return increments.first != increments.second;
+    }
+
+    bool
+    hasWrite (DeclarationNode* variable, WhileStatementNode* loop) const
+    {
+      auto writes = m_writes.find (variable);
+      if (writes == m_writes.end ())
+        return false;
+      const LoopSpan& span = m_loops.at (loop);
+      auto first = std::upper_bound (writes->second.others.begin (), writes->second.others.end (), span.start);
+      return first != writes->second.others.end () && *first <= span.end;
+    }
+
+    bool
+    changes (DeclarationNode* variable, WhileStatementNode* loop) const
+    {
+      return hasIncrement (variable, loop) || hasWrite (variable, loop);
+    }
+
+    // The increments of variable in loop, in the order walked, by
+    //   their places among its increments
+    std::pair<size_t, size_t>
+    getIncrements (DeclarationNode* variable, WhileStatementNode* loop) const
+    {
+      auto writes = m_writes.find (variable);
+      if (writes == m_writes.end ())
+        return { 0, 0 };
+      const LoopSpan& span = m_loops.at (loop);
+      const std::vector<Increment>& increments = writes->second.increments;
+      size_t first = std::partition_point (increments.begin (), increments.end (),
+        [&span] (const Increment& increment) { return increment.position <= span.start; }) - increments.begin ();
+      size_t last = std::partition_point (increments.begin () + first, increments.end (),
+        [&span] (const Increment& increment) { return increment.position <= span.end; }) - increments.begin ();
+      return { first, last };
+    }
+
+    // variable * factor, made anew
+    ExpressionNode*
+    copyProduct (const ProductKey& key, MultiplicativeExpressionNode* product)
+    {
+      return m_arena.make<MultiplicativeExpressionNode> (MultiplicativeOperatorType::TIMES,
+        makeRead (m_arena, std::get<0> (key), product->row, product->col),
+        factorOf (key, product), product->row, product->col);
+    }
+
+    ExpressionNode*
+    factorOf (const ProductKey& key, MultiplicativeExpressionNode* product)
+    {
+      if (std::get<1> (key) == nullptr)
+        return m_arena.make<IntegerLiteralExpressionNode> (std::get<2> (key), product->row, product->col);
+      return makeRead (m_arena, std::get<1> (key), product->row, product->col);
+    }
+
+    // local plus step times the factor; a step of a local factor other
+    //   than 1 and -1 is computed once, ahead of the loop, into steps
+    ExpressionNode*
+    stepped (VariableDeclarationNode* local, const ProductKey& key, uint32_t step,
+             MultiplicativeExpressionNode* product, std::vector<VariableDeclarationNode*>& declarations,
+             std::vector<StatementNode*>& statements, std::map<uint32_t, VariableDeclarationNode*>& steps)
+    {
+      int row = product->row;
+      int col = product->col;
+      ExpressionNode* addend;
+      AdditiveOperatorType op = AdditiveOperatorType::PLUS;
+      if (std::get<1> (key) == nullptr)
+        addend = m_arena.make<IntegerLiteralExpressionNode> ((int32_t) (step * (uint32_t) std::get<2> (key)), row, col);
+      else if (step == 1 || step == UINT32_MAX)
+      {
+        addend = makeRead (m_arena, std::get<1> (key), row, col);
+        op = step == 1 ? AdditiveOperatorType::PLUS : AdditiveOperatorType::MINUS;
+      }
+      else
+      {
+        VariableDeclarationNode*& stepLocal = steps[step];
+        if (stepLocal == nullptr)
+        {
+          stepLocal = makeLocal (m_arena, m_names, "step", row, col);
+          declarations.push_back (stepLocal);
+          statements.push_back (makeAssignment (m_arena, stepLocal, m_arena.make<MultiplicativeExpressionNode> (
+            MultiplicativeOperatorType::TIMES, makeRead (m_arena, std::get<1> (key), row, col),
+            m_arena.make<IntegerLiteralExpressionNode> ((int32_t) step, row, col), row, col)));
+        }
+        addend = makeRead (m_arena, stepLocal, row, col);
+      }
+      return m_arena.make<AdditiveExpressionNode> (op, makeRead (m_arena, local, row, col), addend, row, col);
+    }
+
+    AstArena&      m_arena;
+    NameSupply&    m_names;
+    StrengthStats& m_stats;
+
+    std::unordered_map<DeclarationNode*, Writes> m_writes;
+    std::unordered_map<WhileStatementNode*, LoopSpan> m_loops;
+    // The place of each statement
+    std::unordered_map<StatementNode*, StatementNode**> m_slots;
+    // The products to reduce in each loop
+    std::unordered_map<WhileStatementNode*, std::vector<Product>> m_products;
+    // The outermost loops with products to reduce, in the order walked
+    std::vector<WhileStatementNode*> m_roots;
+    std::unordered_map<MultiplicativeExpressionNode*, Parent> m_parents;
+    std::unordered_set<MultiplicativeExpressionNode*> m_reparented;
+    // The local that each reduced product gives way to
+    std::unordered_map<ExpressionNode*, VariableDeclarationNode*> m_replaced;
+  };
+}
+
+/***********************************************************************/
+
+StrengthStats
+reduceStrength (ProgramNode* program, AstArena& arena, NameSupply& names)
+{
+  StrengthStats stats;
+  LoopReducer reducer (arena, names, stats);
+  reducer.reduce (program);
+  return stats;
+}
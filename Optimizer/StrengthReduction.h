@@ -0,0 +1,60 @@
+/*
+  Filename   : StrengthReduction.h
+  Author     : Philip Androwick
+  Description: Strength reduction of induction variables on the checked
+               tree: a product of a variable that a while loop steps by
+               a constant is kept up to date by additions instead.
+*/
+
+/***********************************************************************/
+
+#ifndef STRENGTH_REDUCTION_H
+#define STRENGTH_REDUCTION_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Parser/AstArena.h"
+#include "../Parser/CMinusAst.h"
+
+/***********************************************************************/
+
+class NameSupply;
+
+struct StrengthStats
+{
+  // Products replaced, the new locals that replaced them, and the loops
+  //   they were in
+  size_t products = 0;
+  size_t locals = 0;
+  size_t loops = 0;
+};
+
+// Reduces the products of induction variables in the while loops of
+//   program, which must have been resolved and checked.  A basic
+//   induction variable of a loop is a scalar local or parameter declared
+//   outside it whose every write in the loop, condition and nested loops
+//   included, is a statement i = i + c or i = i - c for a literal c.
+//   Each product of one and a factor the loop leaves alone, a literal or
+//   a scalar local it does not write, gives way to a read of a new
+//   local: the local is assigned the product ahead of the loop, and c
+//   times the factor is added to it after each statement stepping the
+//   variable.  Arithmetic wraps, so the local equals the product at
+//   every point of the loop.  Loops are taken outermost first.  New
+//   nodes are made in arena and new names by names.
+//
+// Multiplication and division by constants are cheapened by the x86-64
+//   code generator instead (see Codegen/CodeGenerator.cc), where a shift
+//   or a multiplication costs less than what it replaces; on the virtual
+//   machine each is one instruction either way.
+StrengthStats
+reduceStrength (ProgramNode* program, AstArena& arena, NameSupply& names);
+
+/***********************************************************************/
+
+#endif
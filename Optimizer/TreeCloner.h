@@ -0,0 +1,245 @@
+/*
+  Filename   : TreeCloner.h
+  Author     : Philip Androwick
+  Description: Copying part of a checked tree, for the passes that
+               duplicate code.  The copy is built by a walk that makes
+               each node as it leaves it, from the copies of its
+               children.
+*/
+
+/***********************************************************************/
+
+#ifndef TREE_CLONER_H
+#define TREE_CLONER_H
+
+/***********************************************************************/
+// System includes
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "AstRewriter.h"
+
+/***********************************************************************/
+
+// Copies the walked tree.  A use of a declaration in substitutions
+//   refers to its substitute instead.  The declarations in the tree
+//   are copied under new names from names, or under their own without
+//   names, and their uses follow them.
+class TreeCloner : public AstWalker
+{
+public:
+  TreeCloner (AstArena& arena, NameSupply* names,
+              std::unordered_map<DeclarationNode*, DeclarationNode*>& substitutions)
+    : m_arena (arena), m_names (names), m_substitutions (substitutions)
+  { }
+
+  Node*
+  copy (Node* root)
+  {
+    walk (root);
+    return pop<Node> ();
+  }
+
+  virtual bool
+  enter (ForStatementNode* node)
+  {
+    throw std::logic_error ("copying: the parser makes no for statements");
+  }
+
+  virtual bool
+  enter (UnaryExpressionNode* node)
+  {
+    throw std::logic_error ("copying: the parser makes no unary expressions");
+  }
+
+  // Declarations
+
+  virtual void
+  leave (VariableDeclarationNode* node)
+  {
+    declare (node, m_arena.make<VariableDeclarationNode> (node->valueType, rename (node), node->dataType,
+                                                          node->row, node->col));
+  }
+
+  virtual void
+  leave (ArrayDeclarationNode* node)
+  {
+    declare (node, m_arena.make<ArrayDeclarationNode> (node->valueType, rename (node), node->size,
+                                                       node->row, node->col));
+  }
+
+  // Statements
+
+  virtual void
+  leave (CompoundStatementNode* node)
+  {
+    std::vector<StatementNode*> statements = pop<StatementNode> (node->statements.size ());
+    std::vector<VariableDeclarationNode*> declarations
+      = pop<VariableDeclarationNode> (node->localDeclarations.size ());
+    m_built.push_back (m_arena.make<CompoundStatementNode> (declarations, statements));
+  }
+
+  virtual void
+  leave (IfStatementNode* node)
+  {
+    StatementNode* elseStatement = node->elseStatement != nullptr ? pop<StatementNode> () : nullptr;
+    StatementNode* thenStatement = pop<StatementNode> ();
+    m_built.push_back (m_arena.make<IfStatementNode> (pop<ExpressionNode> (), thenStatement, elseStatement));
+  }
+
+  virtual void
+  leave (WhileStatementNode* node)
+  {
+    StatementNode* body = pop<StatementNode> ();
+    m_built.push_back (m_arena.make<WhileStatementNode> (pop<ExpressionNode> (), body));
+  }
+
+  virtual void
+  leave (ReturnStatementNode* node)
+  {
+    m_built.push_back (m_arena.make<ReturnStatementNode> (
+      node->expression != nullptr ? pop<ExpressionNode> () : nullptr));
+  }
+
+  virtual void
+  leave (ExpressionStatementNode* node)
+  {
+    m_built.push_back (m_arena.make<ExpressionStatementNode> (
+      node->expression != nullptr ? pop<ExpressionNode> () : nullptr));
+  }
+
+  // Expressions
+
+  virtual void
+  leave (AssignmentExpressionNode* node)
+  {
+    ExpressionNode* value = pop<ExpressionNode> ();
+    VariableExpressionNode* target = pop<VariableExpressionNode> ();
+    m_built.push_back (m_arena.make<AssignmentExpressionNode> (node->valueType, target, value,
+                                                               node->row, node->col));
+  }
+
+  virtual void
+  leave (VariableExpressionNode* node)
+  {
+    DeclarationNode* declaration = substitute (node->usingDecNode);
+    VariableExpressionNode* copy = m_arena.make<VariableExpressionNode> (
+      identifier (node, declaration), node->valueType, node->dataType, node->row, node->col);
+    copy->usingDecNode = declaration;
+    m_built.push_back (copy);
+  }
+
+  virtual void
+  leave (SubscriptExpressionNode* node)
+  {
+    DeclarationNode* declaration = substitute (node->usingDecNode);
+    SubscriptExpressionNode* copy = m_arena.make<SubscriptExpressionNode> (
+      identifier (node, declaration), pop<ExpressionNode> (), node->valueType, node->row, node->col);
+    copy->usingDecNode = declaration;
+    m_built.push_back (copy);
+  }
+
+  virtual void
+  leave (CallExpressionNode* node)
+  {
+    CallExpressionNode* copy = m_arena.make<CallExpressionNode> (
+      node->identifier, pop<ExpressionNode> (node->arguments.size ()), node->valueType, node->row, node->col);
+    copy->usingDecNode = node->usingDecNode;
+    m_built.push_back (copy);
+  }
+
+  virtual void
+  leave (AdditiveExpressionNode* node)
+  {
+    ExpressionNode* right = pop<ExpressionNode> ();
+    m_built.push_back (m_arena.make<AdditiveExpressionNode> (node->addOperator, pop<ExpressionNode> (), right,
+                                                             node->row, node->col));
+  }
+
+  virtual void
+  leave (MultiplicativeExpressionNode* node)
+  {
+    ExpressionNode* right = pop<ExpressionNode> ();
+    m_built.push_back (m_arena.make<MultiplicativeExpressionNode> (node->multOperator, pop<ExpressionNode> (),
+                                                                   right, node->row, node->col));
+  }
+
+  virtual void
+  leave (RelationalExpressionNode* node)
+  {
+    ExpressionNode* right = pop<ExpressionNode> ();
+    m_built.push_back (m_arena.make<RelationalExpressionNode> (node->relationalOperator, pop<ExpressionNode> (),
+                                                               right, node->row, node->col));
+  }
+
+  virtual void
+  leave (IntegerLiteralExpressionNode* node)
+  {
+    m_built.push_back (m_arena.make<IntegerLiteralExpressionNode> (node->value, node->row, node->col));
+  }
+
+private:
+  // The copy built last
+  template<typename T>
+  T*
+  pop ()
+  {
+    T* node = static_cast<T*> (m_built.back ());
+    m_built.pop_back ();
+    return node;
+  }
+
+  // The copies built last, in the order they were built
+  template<typename T>
+  std::vector<T*>
+  pop (size_t count)
+  {
+    std::vector<T*> nodes;
+    for (size_t n = m_built.size () - count; n < m_built.size (); ++n)
+      nodes.push_back (static_cast<T*> (m_built[n]));
+    m_built.resize (m_built.size () - count);
+    return nodes;
+  }
+
+  std::string
+  rename (DeclarationNode* declaration)
+  {
+    return m_names != nullptr ? m_names->make (declaration->identifier) : declaration->identifier;
+  }
+
+  void
+  declare (VariableDeclarationNode* declaration, VariableDeclarationNode* copy)
+  {
+    copy->nestLevel = declaration->nestLevel;
+    m_substitutions[declaration] = copy;
+    m_built.push_back (copy);
+  }
+
+  DeclarationNode*
+  substitute (DeclarationNode* declaration) const
+  {
+    auto entry = m_substitutions.find (declaration);
+    return entry != m_substitutions.end () ? entry->second : declaration;
+  }
+
+  static std::string
+  identifier (VariableExpressionNode* use, DeclarationNode* declaration)
+  {
+    return declaration != use->usingDecNode ? declaration->identifier : use->identifier;
+  }
+
+  AstArena&          m_arena;
+  NameSupply*        m_names;
+  std::unordered_map<DeclarationNode*, DeclarationNode*>& m_substitutions;
+  std::vector<Node*> m_built;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,150 @@
+/*
+  Filename   : AstArena.h
+  Author     : Philip Androwick
+  Description: Bump allocator for AST nodes.  Every node of a compilation is
+               placed in large blocks and destroyed all at once by reset (),
+               which keeps the blocks so the next compilation does not go
+               back to the heap.
+*/
+
+/***********************************************************************/
+
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "CMinusAst.h"
+
+/***********************************************************************/
+
+class AstArena
+{
+public:
+  AstArena ()
+    : m_block (0), m_offset (0), m_bytesUsed (0)
+  { }
+
+  ~AstArena ()
+  {
+    reset ();
+  }
+
+  AstArena (const AstArena&) = delete;
+  AstArena& operator= (const AstArena&) = delete;
+
+  // Constructs a node in the arena; it lives until the next reset ()
+  template<typename T, typename... Args>
+  T*
+  make (Args&&... args)
+  {
+    static_assert (std::is_base_of<Node, T>::value, "AstArena only holds AST nodes");
+    void* memory = allocate (sizeof (T), alignof (T));
+    T* node = new (memory) T (std::forward<Args> (args)...);
+    m_nodes.push_back (node);
+    return node;
+  }
+
+  // Destroys every node, keeping the blocks for reuse
+  void
+  reset ()
+  {
+    for (size_t n = m_nodes.size (); n > 0; --n)
+      m_nodes[n - 1]->~Node ();
+    m_nodes.clear ();
+
+    // Oversized blocks are not worth keeping around
+    size_t kept = 0;
+    for (size_t n = 0; n < m_blocks.size (); ++n)
+      if (m_blocks[n].size == BLOCK_SIZE)
+        m_blocks[kept++] = std::move (m_blocks[n]);
+    m_blocks.resize (kept);
+
+    m_block = 0;
+    m_offset = 0;
+    m_bytesUsed = 0;
+  }
+
+  size_t
+  nodeCount () const
+  {
+    return m_nodes.size ();
+  }
+
+  // Bytes handed out since the last reset
+  size_t
+  bytesUsed () const
+  {
+    return m_bytesUsed;
+  }
+
+  // Bytes held by the arena, including free space
+  size_t
+  bytesReserved () const
+  {
+    size_t total = 0;
+    for (const Block& block : m_blocks)
+      total += block.size;
+    return total;
+  }
+
+private:
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  struct Block
+  {
+    std::unique_ptr<char[]> memory;
+    size_t size;
+  };
+
+  void*
+  allocate (size_t size, size_t alignment)
+  {
+    while (m_block < m_blocks.size ())
+    {
+      Block& block = m_blocks[m_block];
+      size_t start = (m_offset + alignment - 1) & ~(alignment - 1);
+      if (start + size <= block.size)
+      {
+        m_offset = start + size;
+        m_bytesUsed += size;
+        return block.memory.get () + start;
+      }
+      ++m_block;
+      m_offset = 0;
+    }
+
+    // Out of blocks; the new block becomes the current one
+    Block block;
+    block.size = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+    block.memory.reset (new char[block.size]);
+    m_blocks.push_back (std::move (block));
+    m_block = m_blocks.size () - 1;
+    m_offset = size;
+    m_bytesUsed += size;
+    return m_blocks.back ().memory.get ();
+  }
+
+  std::vector<Block> m_blocks;
+  size_t m_block;
+  size_t m_offset;
+  size_t m_bytesUsed;
+
+  // Every node made, in construction order, so they can be destroyed
+  std::vector<Node*> m_nodes;
+};
+
+/***********************************************************************/
+
+#endif
@@ -4,6 +4,8 @@
 /********************************************************************/
 // System Includes
 
+#include <cstdint>
+#include <initializer_list>
 #include <string>
 #include <vector>
 #include <map>
@@ -154,7 +156,7 @@ struct ProgramNode : Node
 struct DeclarationNode : Node
 {
   DeclarationNode (ValueType t, string id, DataType pDataType, int pRow, int pCol)
-    : valueType (t), identifier (id), dataType(pDataType), row(pRow), col(pCol)
+    : valueType (t), identifier (id), dataType(pDataType), nestLevel(0), row(pRow), col(pCol)
   { }
 
   virtual ~DeclarationNode ()
@@ -200,7 +202,7 @@ struct FunctionDeclarationNode : DeclarationNode
 struct VariableDeclarationNode : DeclarationNode
 {
   VariableDeclarationNode (ValueType t, string id, DataType pDataType, int pRow, int pCol)
-    : DeclarationNode (t, id, pDataType, pRow, pCol)
+    : DeclarationNode (t, id, pDataType, pRow, pCol), framePointerOffset (0)
   { }
 
   virtual ~VariableDeclarationNode ()
@@ -214,7 +216,8 @@ struct VariableDeclarationNode : DeclarationNode
 
   // Used for code gen
   // Parameters and local variables are stored at addresses
-  //   offset from the frame pointer (ebp)
+  //   offset from the frame pointer (rbp); set by layoutFrame
+  //   (Codegen/FrameLayout.h)
   int framePointerOffset;
 };
 
@@ -239,7 +242,8 @@ struct ArrayDeclarationNode : VariableDeclarationNode
 struct ParameterNode : DeclarationNode
 {
   ParameterNode (ValueType t, string id, bool pIsArray, int pRow, int pCol)
-    : DeclarationNode (t, id, DataType::PARAMETER, pRow, pCol), isArray (pIsArray)
+    : DeclarationNode (t, id, DataType::PARAMETER, pRow, pCol), isArray (pIsArray),
+      framePointerOffset (0)
   { }
 
   virtual ~ParameterNode ()
@@ -252,6 +256,9 @@ struct ParameterNode : DeclarationNode
   }
 
   bool isArray;
+
+  // Used for code gen, as in VariableDeclarationNode
+  int framePointerOffset;
 };
 
 /********************************************************************/
@@ -430,7 +437,7 @@ struct AssignmentExpressionNode : ExpressionNode
 struct VariableExpressionNode : ExpressionNode
 {
   VariableExpressionNode (string id, ValueType pValueType, DataType pdataType, int pRow, int pCol)
-    : ExpressionNode(pValueType, pRow, pCol), identifier (id), dataType(pdataType)
+    : ExpressionNode(pValueType, pRow, pCol), identifier (id), dataType(pdataType), usingDecNode (nullptr)
   { }
 
   virtual ~VariableExpressionNode ()
@@ -468,7 +475,7 @@ struct SubscriptExpressionNode : VariableExpressionNode
 struct CallExpressionNode : ExpressionNode
 {
   CallExpressionNode (string id, vector<ExpressionNode*> args, ValueType pValueType, int pRow, int pCol)
-    : ExpressionNode(pValueType, pRow, pCol), identifier (id), arguments (args)
+    : ExpressionNode(pValueType, pRow, pCol), identifier (id), arguments (args), usingDecNode (nullptr)
   { }
 
   virtual ~CallExpressionNode ()
@@ -584,331 +591,658 @@ struct IntegerLiteralExpressionNode : ExpressionNode
   int value;
 };
 
-struct EvaluationVisitor : IVisitor
+/********************************************************************/
+// TRAVERSAL
+
+// Which child of its parent a node is
+enum class ChildSlot
 {
-  // Returns the num tabs
-  virtual std::string
-  indentation (int num)
+  DECLARATION, PARAMETER, FUNCTION_BODY, LOCAL_DECLARATION, STATEMENT,
+  CONDITION, THEN, ELSE, BODY, RETURN_VALUE, EXPRESSION,
+  TARGET, VALUE, INDEX, ARGUMENT, LEFT, RIGHT
+};
+
+// Walks a tree without recursion.  The nodes still to be visited are
+//   kept on a stack in the heap, so a tree of any depth can be walked.
+//   The enter hook of a node runs before its children are walked; if it
+//   returns false the children and the leave hook are skipped.  The
+//   leave hook runs after the children.  enterChild and leaveChild run
+//   around each child in one of the slots the walker was made with,
+//   and are given the parent and the slot.
+class AstWalker : private IVisitor
+{
+public:
+  explicit AstWalker (std::initializer_list<ChildSlot> edgeSlots = { })
+    : m_edgeSlots (0), m_leaving (*this)
+  {
+    for (ChildSlot slot : edgeSlots)
+      m_edgeSlots |= 1u << (unsigned) slot;
+  }
+
+  virtual ~AstWalker ()
+  { }
+
+  void
+  walk (Node* root)
   {
-    string returnStr = "";
-    for (int x = 0; x < num; ++x)
+    // Left over if a hook threw during the last walk
+    m_stack.clear ();
+    m_slots.clear ();
+
+    m_stack.push_back ((uintptr_t) root | ENTER);
+    while (!m_stack.empty ())
     {
-      returnStr += "\t";
+      uintptr_t frame = m_stack.back ();
+      m_stack.pop_back ();
+      Node* node = (Node*) (frame & ~STEP_MASK);
+      switch (frame & STEP_MASK)
+      {
+        case ENTER:
+          node->accept (this);
+          break;
+        case LEAVE:
+          node->accept (&m_leaving);
+          break;
+        case ENTER_CHILD:
+          enterChild (node, m_slots.back ());
+          m_slots.pop_back ();
+          break;
+        case LEAVE_CHILD:
+          leaveChild (node, m_slots.back ());
+          m_slots.pop_back ();
+          break;
+      }
     }
-    return returnStr;
   }
 
+  virtual bool enter (ProgramNode* node) { return true; }
+  virtual bool enter (DeclarationNode* node) { return true; }
+  virtual bool enter (FunctionDeclarationNode* node) { return true; }
+  virtual bool enter (VariableDeclarationNode* node) { return true; }
+  virtual bool enter (ArrayDeclarationNode* node) { return true; }
+  virtual bool enter (ParameterNode* node) { return true; }
+  virtual bool enter (StatementNode* node) { return true; }
+  virtual bool enter (CompoundStatementNode* node) { return true; }
+  virtual bool enter (IfStatementNode* node) { return true; }
+  virtual bool enter (WhileStatementNode* node) { return true; }
+  virtual bool enter (ForStatementNode* node) { return true; }
+  virtual bool enter (ReturnStatementNode* node) { return true; }
+  virtual bool enter (ExpressionStatementNode* node) { return true; }
+  virtual bool enter (ExpressionNode* node) { return true; }
+  virtual bool enter (AssignmentExpressionNode* node) { return true; }
+  virtual bool enter (VariableExpressionNode* node) { return true; }
+  virtual bool enter (SubscriptExpressionNode* node) { return true; }
+  virtual bool enter (CallExpressionNode* node) { return true; }
+  virtual bool enter (AdditiveExpressionNode* node) { return true; }
+  virtual bool enter (MultiplicativeExpressionNode* node) { return true; }
+  virtual bool enter (RelationalExpressionNode* node) { return true; }
+  virtual bool enter (UnaryExpressionNode* node) { return true; }
+  virtual bool enter (IntegerLiteralExpressionNode* node) { return true; }
+
+  virtual void leave (ProgramNode* node) { }
+  virtual void leave (DeclarationNode* node) { }
+  virtual void leave (FunctionDeclarationNode* node) { }
+  virtual void leave (VariableDeclarationNode* node) { }
+  virtual void leave (ArrayDeclarationNode* node) { }
+  virtual void leave (ParameterNode* node) { }
+  virtual void leave (StatementNode* node) { }
+  virtual void leave (CompoundStatementNode* node) { }
+  virtual void leave (IfStatementNode* node) { }
+  virtual void leave (WhileStatementNode* node) { }
+  virtual void leave (ForStatementNode* node) { }
+  virtual void leave (ReturnStatementNode* node) { }
+  virtual void leave (ExpressionStatementNode* node) { }
+  virtual void leave (ExpressionNode* node) { }
+  virtual void leave (AssignmentExpressionNode* node) { }
+  virtual void leave (VariableExpressionNode* node) { }
+  virtual void leave (SubscriptExpressionNode* node) { }
+  virtual void leave (CallExpressionNode* node) { }
+  virtual void leave (AdditiveExpressionNode* node) { }
+  virtual void leave (MultiplicativeExpressionNode* node) { }
+  virtual void leave (RelationalExpressionNode* node) { }
+  virtual void leave (UnaryExpressionNode* node) { }
+  virtual void leave (IntegerLiteralExpressionNode* node) { }
+
   virtual void
-  visit (ProgramNode* node)
+  enterChild (Node* parent, ChildSlot slot)
+  { }
+
+  virtual void
+  leaveChild (Node* parent, ChildSlot slot)
+  { }
+
+protected:
+  // Runs enterChild and leaveChild around the children in slot too
+  void
+  addEdgeSlot (ChildSlot slot)
   {
-    output = "ProgramNode:\n";
+    m_edgeSlots |= 1u << (unsigned) slot;
   }
 
-  virtual void
-  visit (DeclarationNode* node)
+private:
+  // Each frame of the stack is a node, or the parent for an edge,
+  //   with the step to take in its low bits; nodes are at least
+  //   pointer aligned.  The slot of an edge is on m_slots.
+  enum Step : uintptr_t
   {
-    output = indentation (num) + "Dec\n";
+    ENTER, LEAVE, ENTER_CHILD, LEAVE_CHILD, STEP_MASK = 3
+  };
+
+  // Runs the leave hooks
+  struct Leaving : IVisitor
+  {
+    Leaving (AstWalker& pWalker)
+      : walker (pWalker)
+    { }
+
+    void visit (ProgramNode* node) { walker.leave (node); }
+    void visit (DeclarationNode* node) { walker.leave (node); }
+    void visit (FunctionDeclarationNode* node) { walker.leave (node); }
+    void visit (VariableDeclarationNode* node) { walker.leave (node); }
+    void visit (ArrayDeclarationNode* node) { walker.leave (node); }
+    void visit (ParameterNode* node) { walker.leave (node); }
+    void visit (StatementNode* node) { walker.leave (node); }
+    void visit (CompoundStatementNode* node) { walker.leave (node); }
+    void visit (IfStatementNode* node) { walker.leave (node); }
+    void visit (WhileStatementNode* node) { walker.leave (node); }
+    void visit (ForStatementNode* node) { walker.leave (node); }
+    void visit (ReturnStatementNode* node) { walker.leave (node); }
+    void visit (ExpressionStatementNode* node) { walker.leave (node); }
+    void visit (ExpressionNode* node) { walker.leave (node); }
+    void visit (AssignmentExpressionNode* node) { walker.leave (node); }
+    void visit (VariableExpressionNode* node) { walker.leave (node); }
+    void visit (SubscriptExpressionNode* node) { walker.leave (node); }
+    void visit (CallExpressionNode* node) { walker.leave (node); }
+    void visit (AdditiveExpressionNode* node) { walker.leave (node); }
+    void visit (MultiplicativeExpressionNode* node) { walker.leave (node); }
+    void visit (RelationalExpressionNode* node) { walker.leave (node); }
+    void visit (UnaryExpressionNode* node) { walker.leave (node); }
+    void visit (IntegerLiteralExpressionNode* node) { walker.leave (node); }
+
+    AstWalker& walker;
+  };
+
+  void
+  pushLeave (Node* node)
+  {
+    m_stack.push_back ((uintptr_t) node | LEAVE);
   }
 
-  virtual void
-  visit (VariableDeclarationNode* node)
+  // Children are pushed last first, so that they are walked in order
+  void
+  pushChild (Node* parent, ChildSlot slot, Node* child)
   {
-    output = (indentation (num) + "VariableDeclaration: " + node->identifier + ": " + valueTypeMap[node->valueType] + " type\n");
+    if (child == nullptr)
+      return;
+    bool edge = (m_edgeSlots & (1u << (unsigned) slot)) != 0;
+    if (edge)
+    {
+      m_stack.push_back ((uintptr_t) parent | LEAVE_CHILD);
+      m_slots.push_back (slot);
+    }
+    m_stack.push_back ((uintptr_t) child | ENTER);
+    if (edge)
+    {
+      m_stack.push_back ((uintptr_t) parent | ENTER_CHILD);
+      m_slots.push_back (slot);
+    }
   }
 
-  virtual void
+  template<typename T>
+  void
+  pushChildren (Node* parent, ChildSlot slot, const vector<T*>& children)
+  {
+    for (size_t n = children.size (); n > 0; --n)
+      pushChild (parent, slot, children[n - 1]);
+  }
+
+  // Nodes without children are left right away
+  template<typename T>
+  void
+  visitLeaf (T* node)
+  {
+    if (enter (node))
+      leave (node);
+  }
+
+  void
+  visit (ProgramNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChildren (node, ChildSlot::DECLARATION, node->declarations);
+  }
+
+  void visit (DeclarationNode* node) { visitLeaf (node); }
+  void visit (VariableDeclarationNode* node) { visitLeaf (node); }
+  void visit (ArrayDeclarationNode* node) { visitLeaf (node); }
+  void visit (ParameterNode* node) { visitLeaf (node); }
+  void visit (StatementNode* node) { visitLeaf (node); }
+  void visit (ForStatementNode* node) { visitLeaf (node); }
+  void visit (ExpressionNode* node) { visitLeaf (node); }
+  void visit (VariableExpressionNode* node) { visitLeaf (node); }
+  void visit (UnaryExpressionNode* node) { visitLeaf (node); }
+  void visit (IntegerLiteralExpressionNode* node) { visitLeaf (node); }
+
+  void
   visit (FunctionDeclarationNode* node)
   {
-    string localOutput = (indentation (num) + "Function: " + node->identifier + ": " + valueTypeMap[node->valueType] + " type\n");
-    ++num;
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::FUNCTION_BODY, node->functionBody);
+    pushChildren (node, ChildSlot::PARAMETER, node->parameters);
+  }
 
-    // Returns the parameters
-    for (ParameterNode* parameter : node->parameters)
-    {
-      parameter->accept (this);
-      localOutput += output;
-    }
+  void
+  visit (CompoundStatementNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChildren (node, ChildSlot::STATEMENT, node->statements);
+    pushChildren (node, ChildSlot::LOCAL_DECLARATION, node->localDeclarations);
+  }
 
-    node->functionBody->accept (this);
-    localOutput += output;
-    --num;
-    output = localOutput;
+  void
+  visit (IfStatementNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::ELSE, node->elseStatement);
+    pushChild (node, ChildSlot::THEN, node->thenStatement);
+    pushChild (node, ChildSlot::CONDITION, node->conditionalExpression);
   }
 
-  virtual void
-  visit (ArrayDeclarationNode* node)
+  void
+  visit (WhileStatementNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::BODY, node->body);
+    pushChild (node, ChildSlot::CONDITION, node->conditionalExpression);
+  }
+
+  void
+  visit (ReturnStatementNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::RETURN_VALUE, node->expression);
+  }
+
+  void
+  visit (ExpressionStatementNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::EXPRESSION, node->expression);
+  }
+
+  void
+  visit (AssignmentExpressionNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::VALUE, node->expression);
+    pushChild (node, ChildSlot::TARGET, node->variable);
+  }
+
+  void
+  visit (SubscriptExpressionNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::INDEX, node->index);
+  }
+
+  void
+  visit (CallExpressionNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChildren (node, ChildSlot::ARGUMENT, node->arguments);
+  }
+
+  void
+  visit (AdditiveExpressionNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::RIGHT, node->right);
+    pushChild (node, ChildSlot::LEFT, node->left);
+  }
+
+  void
+  visit (MultiplicativeExpressionNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::RIGHT, node->right);
+    pushChild (node, ChildSlot::LEFT, node->left);
+  }
+
+  void
+  visit (RelationalExpressionNode* node)
+  {
+    if (!enter (node))
+      return;
+    pushLeave (node);
+    pushChild (node, ChildSlot::RIGHT, node->right);
+    pushChild (node, ChildSlot::LEFT, node->left);
+  }
+
+  unsigned               m_edgeSlots;
+  Leaving                m_leaving;
+  std::vector<uintptr_t> m_stack;
+  std::vector<ChildSlot> m_slots;
+};
+
+/********************************************************************/
+// AST PRINTER
+
+// Prints the .ast text of a tree into output
+struct EvaluationVisitor : AstWalker
+{
+  EvaluationVisitor ()
+    : AstWalker ({ ChildSlot::LEFT, ChildSlot::RIGHT, ChildSlot::INDEX })
+  { }
+
+  // Returns the num tabs
+  virtual std::string
+  indentation (int num)
+  {
+    return string (num, '\t');
+  }
+
+  // Only the program's own line; its declarations are printed one at a
+  //   time
+  virtual bool
+  enter (ProgramNode* node)
+  {
+    output += "ProgramNode:\n";
+    return false;
+  }
+
+  virtual bool
+  enter (DeclarationNode* node)
   {
-    output = (indentation (num) + "VariableDeclaration: " + node->identifier + "["
-            + std::to_string (node->size) + "]: " + valueTypeMap[node->valueType] + " type\n");
+    output += indentation (num) + "Dec\n";
+    return false;
+  }
+
+  virtual bool
+  enter (VariableDeclarationNode* node)
+  {
+    output += indentation (num) + "VariableDeclaration: " + node->identifier + ": " + valueTypeMap[node->valueType] + " type\n";
+    return false;
+  }
+
+  virtual bool
+  enter (FunctionDeclarationNode* node)
+  {
+    output += indentation (num) + "Function: " + node->identifier + ": " + valueTypeMap[node->valueType] + " type\n";
+    ++num;
+    return true;
   }
 
   virtual void
-  visit (ParameterNode* node)
+  leave (FunctionDeclarationNode* node)
+  {
+    --num;
+  }
+
+  virtual bool
+  enter (ArrayDeclarationNode* node)
+  {
+    output += indentation (num) + "VariableDeclaration: " + node->identifier + "["
+            + std::to_string (node->size) + "]: " + valueTypeMap[node->valueType] + " type\n";
+    return false;
+  }
+
+  virtual bool
+  enter (ParameterNode* node)
   {
     if (node->isArray)
-      output = (indentation (num) + "Parameter: " + node->identifier + "[]: " + valueTypeMap[node->valueType] + " type\n");
+      output += indentation (num) + "Parameter: " + node->identifier + "[]: " + valueTypeMap[node->valueType] + " type\n";
     else 
-      output = (indentation (num) + "Parameter: " + node->identifier + ": " + valueTypeMap[node->valueType] + " type\n");
+      output += indentation (num) + "Parameter: " + node->identifier + ": " + valueTypeMap[node->valueType] + " type\n";
+    return false;
   }
 
-  virtual void
-  visit (StatementNode* node)
+  virtual bool
+  enter (StatementNode* node)
   {
-    output = "Statement\n";
+    output += "Statement\n";
+    return false;
   }
 
-  virtual void
-  visit (CompoundStatementNode* node)
+  virtual bool
+  enter (CompoundStatementNode* node)
   {
-    string localOutput = indentation(num) + "CompoundStatement:\n";
+    output += indentation (num) + "CompoundStatement:\n";
     ++num;
+    return true;
+  }
 
-    // Adds the variable declarations
-    for (VariableDeclarationNode* varDec : node->localDeclarations)
-    {
-      varDec->accept (this);
-      localOutput += output;
-    }
-
-    // Adds the statements
-    for (StatementNode* statement : node->statements)
-    {
-      statement->accept (this);
-      localOutput += output;
-    }
+  virtual void
+  leave (CompoundStatementNode* node)
+  {
     --num;
-    output = localOutput;
   }
 
-  virtual void
-  visit (IfStatementNode* node)
+  virtual bool
+  enter (IfStatementNode* node)
   {
-    string localOutput = indentation (num) + "If\n";
+    output += indentation (num) + "If\n";
     ++num;
+    return true;
+  }
 
-    node->conditionalExpression->accept (this);
-    localOutput += output;
-
-    node->thenStatement->accept (this);
-    localOutput += output;
-    
-    // Adds the else statement if used
-    if (node->elseStatement != nullptr)
-    {
-      node->elseStatement->accept (this);
-      localOutput += output;
-    }
-    
+  virtual void
+  leave (IfStatementNode* node)
+  {
     --num;
-    output = localOutput;
   }
 
-  virtual void
-  visit (WhileStatementNode* node)
+  virtual bool
+  enter (WhileStatementNode* node)
   {
-    string localOutput = indentation (num) + "While\n";
+    output += indentation (num) + "While\n";
     ++num;
-    node->conditionalExpression->accept (this);
-    localOutput += output;
+    return true;
+  }
 
-    node->body->accept (this);
-    localOutput += output;
+  virtual void
+  leave (WhileStatementNode* node)
+  {
     --num;
+  }
 
-    output = localOutput;
+  virtual bool
+  enter (ForStatementNode* node)
+  {
+    return false;
   }
 
-  virtual void
-  visit (ForStatementNode* node)
+  virtual bool
+  enter (ReturnStatementNode* node)
   {
+    output += indentation (num) + "Return\n";
+    ++num;
+    return true;
   }
 
   virtual void
-  visit (ReturnStatementNode* node)
+  leave (ReturnStatementNode* node)
   {
-    string localOutput = indentation (num) + "Return\n";
-    ++num;
-    if (node->expression != nullptr)
-    {
-      node->expression->accept (this);
-      localOutput += output;
-    }
     --num;
-    output = localOutput;
   }
 
-  virtual void
-  visit (ExpressionStatementNode* node)
+  virtual bool
+  enter (ExpressionStatementNode* node)
   {
-    string localOutput = indentation (num) + "ExpressionStatement:\n";
+    output += indentation (num) + "ExpressionStatement:\n";
     ++num;
-    if (node->expression != nullptr)
-    {
-      node->expression->accept (this);
-      localOutput += output;
-    }
-    --num;
-    output = localOutput;
+    return true;
   }
 
   virtual void
-  visit (ExpressionNode* node)
+  leave (ExpressionStatementNode* node)
   {
-    output = "Expression\n";
+    --num;
   }
 
-  virtual void
-  visit (AssignmentExpressionNode* node)
+  virtual bool
+  enter (ExpressionNode* node)
+  {
+    output += "Expression\n";
+    return false;
+  }
+
+  virtual bool
+  enter (AssignmentExpressionNode* node)
   {
-    string localOutput = indentation (num) + "Assignment: \n";
+    output += indentation (num) + "Assignment: \n";
     ++num;
+    return true;
+  }
 
-    // Adds the left side of assignment
-    if (node->variable != nullptr)
-    {
-      node->variable->accept (this);
-      localOutput += output;
-    }
-    
-    // Adds right side of assignment
-    if (node->expression != nullptr)
-    {
-      node->expression->accept (this);
-      localOutput += output;
-    }
+  virtual void
+  leave (AssignmentExpressionNode* node)
+  {
     --num;
-    output = localOutput;
   }
 
-  virtual void
-  visit (VariableExpressionNode* node)
+  virtual bool
+  enter (VariableExpressionNode* node)
   {
-    output = indentation (num) + "Variable: " + node->identifier + ": " + valueTypeMap[node->usingDecNode->valueType] + " type" + "\n";
+    output += indentation (num) + "Variable: " + node->identifier + ": " + valueTypeMap[node->usingDecNode->valueType] + " type" + "\n";
+    return false;
   }
 
-  virtual void
-  visit (SubscriptExpressionNode* node)
+  virtual bool
+  enter (SubscriptExpressionNode* node)
   {
-    string localOutput = indentation (num) + "Subscript: " + node->identifier + ": " + valueTypeMap[node->usingDecNode->valueType] + " type" + "\n";
-    ++num;
-    localOutput += indentation (num) + "Index:\n";
+    output += indentation (num) + "Subscript: " + node->identifier + ": " + valueTypeMap[node->usingDecNode->valueType] + " type" + "\n";
     ++num;
+    return true;
+  }
 
-    if (node->index != nullptr)
-    {
-      node->index->accept (this);
-      localOutput += output;
-    }
-    --num;
+  virtual void
+  leave (SubscriptExpressionNode* node)
+  {
     --num;
-    output = localOutput;
   }
 
-  virtual void
-  visit (CallExpressionNode* node)
+  virtual bool
+  enter (CallExpressionNode* node)
   {
-    string localOutput = indentation (num) + "FunctionCall: " + node->identifier + ": " + valueTypeMap[node->usingDecNode->valueType] + " type" + "\n";
-    
+    output += indentation (num) + "FunctionCall: " + node->identifier + ": " + valueTypeMap[node->usingDecNode->valueType] + " type" + "\n";
     if (!node->arguments.empty ())
     {
       ++num;
-      localOutput += indentation (num) + "Arguments:\n";
+      output += indentation (num) + "Arguments:\n";
       ++num;
-      for (ExpressionNode* arg : node->arguments)
-      {
-        arg->accept (this);
-        localOutput += output;
-      }
-      --num;
-      --num;
     }
-    output = localOutput;
+    return true;
   }
 
   virtual void
-  visit (AdditiveExpressionNode* node)
+  leave (CallExpressionNode* node)
   {
-    string localOutput = indentation (num) + "AdditiveExpression: " + addTypeMap[node->addOperator] + "\n";
-    ++num;
-    localOutput += indentation (num) + "Left:\n";
-    ++num;
-    if (node->left != nullptr)
+    if (!node->arguments.empty ())
     {
-      node->left->accept (this);
-      localOutput += output;
+      --num;
+      --num;
     }
-    --num;
-    localOutput += indentation (num) + "Right:\n";
+  }
+
+  virtual bool
+  enter (AdditiveExpressionNode* node)
+  {
+    output += indentation (num) + "AdditiveExpression: " + addTypeMap[node->addOperator] + "\n";
     ++num;
-    if (node->right != nullptr)
-    {
-      node->right->accept (this);
-      localOutput += output;
-    }
-    --num;
-    --num;
-    output = localOutput;
+    return true;
   }
 
   virtual void
-  visit (MultiplicativeExpressionNode* node)
+  leave (AdditiveExpressionNode* node)
   {
-    string localOutput = indentation (num) + "MultiplicativeExpression: " + multTypeMap[node->multOperator] + "\n";
-    ++num;
-    localOutput += indentation (num) + "Left:\n";
-    ++num;
-    if (node->left != nullptr)
-    {
-      node->left->accept (this);
-      localOutput += output;
-    }
     --num;
-    localOutput += indentation (num) + "Right:\n";
+  }
+
+  virtual bool
+  enter (MultiplicativeExpressionNode* node)
+  {
+    output += indentation (num) + "MultiplicativeExpression: " + multTypeMap[node->multOperator] + "\n";
     ++num;
-    if (node->right != nullptr)
-    {
-      node->right->accept (this);
-      localOutput += output;
-    }
-    --num;
-    --num;
-    output = localOutput;
+    return true;
   }
 
   virtual void
-  visit (RelationalExpressionNode* node)
+  leave (MultiplicativeExpressionNode* node)
   {
-    string localOutput = indentation (num) + "RelationalExpression: " + relTypeMap[node->relationalOperator] + "\n";
-    ++num;
-    localOutput += indentation (num) + "Left:\n";
-    ++num;
-    if (node->left != nullptr)
-    {
-      node->left->accept(this);
-      localOutput += output;
-    }
     --num;
-    localOutput += indentation (num) + "Right:\n";
+  }
+
+  virtual bool
+  enter (RelationalExpressionNode* node)
+  {
+    output += indentation (num) + "RelationalExpression: " + relTypeMap[node->relationalOperator] + "\n";
     ++num;
-    if (node->right != nullptr)
-    {
-      node->right->accept (this);
-      localOutput += output;
-    }
-    --num;
+    return true;
+  }
+
+  virtual void
+  leave (RelationalExpressionNode* node)
+  {
     --num;
-    output = localOutput;
   }
 
+  virtual bool
+  enter (UnaryExpressionNode* node)
+  {
+    return false;
+  }
+
+  virtual bool
+  enter (IntegerLiteralExpressionNode* node)
+  {
+    output += indentation (num) + "Integer: " + std::to_string (node->value) + "\n";
+    return false;
+  }
+
+  // Operands and indexes are printed under a heading of their own
   virtual void
-  visit (UnaryExpressionNode* node)
+  enterChild (Node* parent, ChildSlot slot)
   {
+    if (slot == ChildSlot::LEFT)
+      output += indentation (num) + "Left:\n";
+    else if (slot == ChildSlot::RIGHT)
+      output += indentation (num) + "Right:\n";
+    else if (slot == ChildSlot::INDEX)
+      output += indentation (num) + "Index:\n";
+    else
+      return;
+    ++num;
   }
 
   virtual void
-  visit (IntegerLiteralExpressionNode* node)
+  leaveChild (Node* parent, ChildSlot slot)
   {
-    output = indentation (num) + "Integer: " + std::to_string (node->value) + "\n";
+    if (slot == ChildSlot::LEFT || slot == ChildSlot::RIGHT || slot == ChildSlot::INDEX)
+      --num;
   }
 
   std::map<ValueType, std::string> valueTypeMap { {ValueType::INT, "Int"}, 
@@ -0,0 +1,169 @@
+/*
+  Filename   : NodeFactory.cc
+  Author     : Philip Androwick
+  Description: Hash-consing of expression nodes.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <functional>
+
+/***********************************************************************/
+// Local includes
+
+#include "NodeFactory.h"
+
+/***********************************************************************/
+
+NodeFactory::NodeFactory (AstArena* arena)
+  : m_arena (arena), m_declarationCount (0), m_requested (0), m_shared (0), m_bytesSaved (0)
+{
+  // The global scope, holding input and output
+  enterScope ();
+  declare ("input");
+  declare ("output");
+}
+
+/***********************************************************************/
+
+void
+NodeFactory::enterScope ()
+{
+  m_scopes.emplace_back ();
+}
+
+/***********************************************************************/
+
+void
+NodeFactory::exitScope ()
+{
+  m_scopes.pop_back ();
+}
+
+/***********************************************************************/
+
+void
+NodeFactory::declare (const std::string& name)
+{
+  m_scopes.back ()[name] = ++m_declarationCount;
+}
+
+/***********************************************************************/
+
+size_t
+NodeFactory::getTableBytes () const
+{
+  // Each entry is a node of its own, holding the next entry's address
+  size_t bytes = m_nodes.bucket_count () * sizeof (void*)
+    + m_nodes.size () * (sizeof (std::pair<const Key, ExpressionNode*>) + sizeof (void*));
+  for (const auto& entry : m_nodes)
+    if (entry.first.name.capacity () >= sizeof (std::string))
+      bytes += entry.first.name.capacity () + 1;
+  for (const auto& scope : m_scopes)
+    bytes += scope.bucket_count () * sizeof (void*)
+      + scope.size () * (sizeof (std::pair<const std::string, uint64_t>) + sizeof (void*));
+  return bytes;
+}
+
+/***********************************************************************/
+
+uint64_t
+NodeFactory::resolve (const std::string& name) const
+{
+  for (size_t n = m_scopes.size (); n > 0; --n)
+  {
+    auto entry = m_scopes[n - 1].find (name);
+    if (entry != m_scopes[n - 1].end ())
+      return entry->second;
+  }
+  return 0;
+}
+
+/***********************************************************************/
+
+size_t
+NodeFactory::KeyHash::operator() (const Key& key) const
+{
+  size_t hash = std::hash<int> () ((int) key.kind);
+  auto mix = [&hash] (size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  };
+  mix (std::hash<int> () (key.value));
+  mix (std::hash<uint64_t> () (key.declaration));
+  mix (std::hash<const void*> () (key.left));
+  mix (std::hash<const void*> () (key.right));
+  if (key.declaration == 0)
+    mix (std::hash<std::string> () (key.name));
+  return hash;
+}
+
+/***********************************************************************/
+
+IntegerLiteralExpressionNode*
+NodeFactory::literal (int value, int row, int col)
+{
+  Key key { Kind::LITERAL, value, 0, "", nullptr, nullptr };
+  return find<IntegerLiteralExpressionNode> (key, [&] {
+    return m_arena->make<IntegerLiteralExpressionNode> (value, row, col);
+  });
+}
+
+/***********************************************************************/
+
+VariableExpressionNode*
+NodeFactory::variable (const std::string& name, ValueType type, int row, int col)
+{
+  Key key { Kind::VARIABLE, 0, resolve (name), name, nullptr, nullptr };
+  return find<VariableExpressionNode> (key, [&] {
+    return m_arena->make<VariableExpressionNode> (name, type, DataType::VARIABLE, row, col);
+  });
+}
+
+/***********************************************************************/
+
+SubscriptExpressionNode*
+NodeFactory::subscript (const std::string& name, ExpressionNode* index, ValueType type,
+                        int row, int col)
+{
+  Key key { Kind::SUBSCRIPT, 0, resolve (name), name, index, nullptr };
+  return find<SubscriptExpressionNode> (key, [&] {
+    return m_arena->make<SubscriptExpressionNode> (name, index, type, row, col);
+  });
+}
+
+/***********************************************************************/
+
+AdditiveExpressionNode*
+NodeFactory::additive (AdditiveOperatorType op, ExpressionNode* left, ExpressionNode* right,
+                       int row, int col)
+{
+  Key key { Kind::ADDITIVE, (int) op, 0, "", left, right };
+  return find<AdditiveExpressionNode> (key, [&] {
+    return m_arena->make<AdditiveExpressionNode> (op, left, right, row, col);
+  });
+}
+
+/***********************************************************************/
+
+MultiplicativeExpressionNode*
+NodeFactory::multiplicative (MultiplicativeOperatorType op, ExpressionNode* left,
+                             ExpressionNode* right, int row, int col)
+{
+  Key key { Kind::MULTIPLICATIVE, (int) op, 0, "", left, right };
+  return find<MultiplicativeExpressionNode> (key, [&] {
+    return m_arena->make<MultiplicativeExpressionNode> (op, left, right, row, col);
+  });
+}
+
+/***********************************************************************/
+
+RelationalExpressionNode*
+NodeFactory::relational (RelationalOperatorType op, ExpressionNode* left, ExpressionNode* right,
+                         int row, int col)
+{
+  Key key { Kind::RELATIONAL, (int) op, 0, "", left, right };
+  return find<RelationalExpressionNode> (key, [&] {
+    return m_arena->make<RelationalExpressionNode> (op, left, right, row, col);
+  });
+}
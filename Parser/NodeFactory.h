@@ -0,0 +1,159 @@
+/*
+  Filename   : NodeFactory.h
+  Author     : Philip Androwick
+  Description: Hash-consing factory for side-effect-free expression nodes.
+               Asking for a literal, variable, subscript or operator node
+               that was already made with the same contents returns the
+               existing node, so identical subtrees are shared and can be
+               compared by pointer.  Variables are only shared when they
+               resolve to the same declaration, which the factory tracks
+               with the same scope rules as SymbolTableVisitor.
+               Assignment targets and calls are never shared.
+*/
+
+/***********************************************************************/
+
+#ifndef NODE_FACTORY_H
+#define NODE_FACTORY_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "AstArena.h"
+#include "CMinusAst.h"
+
+/***********************************************************************/
+
+class NodeFactory
+{
+public:
+  explicit NodeFactory (AstArena* arena);
+
+  // Scopes, entered and exited where SymbolTableVisitor does
+  void
+  enterScope ();
+
+  void
+  exitScope ();
+
+  // A declaration of name in the current scope
+  void
+  declare (const std::string& name);
+
+  IntegerLiteralExpressionNode*
+  literal (int value, int row, int col);
+
+  VariableExpressionNode*
+  variable (const std::string& name, ValueType type, int row, int col);
+
+  SubscriptExpressionNode*
+  subscript (const std::string& name, ExpressionNode* index, ValueType type, int row, int col);
+
+  AdditiveExpressionNode*
+  additive (AdditiveOperatorType op, ExpressionNode* left, ExpressionNode* right, int row, int col);
+
+  MultiplicativeExpressionNode*
+  multiplicative (MultiplicativeOperatorType op, ExpressionNode* left, ExpressionNode* right,
+                  int row, int col);
+
+  RelationalExpressionNode*
+  relational (RelationalOperatorType op, ExpressionNode* left, ExpressionNode* right,
+              int row, int col);
+
+  // Nodes asked for, nodes that were shared instead of made, and the
+  //   arena bytes that sharing saved
+  size_t
+  getRequested () const
+  {
+    return m_requested;
+  }
+
+  size_t
+  getShared () const
+  {
+    return m_shared;
+  }
+
+  size_t
+  getBytesSaved () const
+  {
+    return m_bytesSaved;
+  }
+
+  // Heap bytes the factory's own tables take, about; sharing only
+  //   saves memory when this is less than the bytes saved
+  size_t
+  getTableBytes () const;
+
+private:
+  enum class Kind { LITERAL, VARIABLE, SUBSCRIPT, ADDITIVE, MULTIPLICATIVE, RELATIONAL };
+
+  struct Key
+  {
+    Kind        kind;
+    // Literal value or operator
+    int         value;
+    // Declaration a variable resolves to; 0 if it does not resolve
+    uint64_t    declaration;
+    std::string name;
+    const ExpressionNode* left;
+    const ExpressionNode* right;
+
+    bool
+    operator== (const Key& other) const
+    {
+      return kind == other.kind && value == other.value && declaration == other.declaration
+        && left == other.left && right == other.right && name == other.name;
+    }
+  };
+
+  struct KeyHash
+  {
+    size_t
+    operator() (const Key& key) const;
+  };
+
+  uint64_t
+  resolve (const std::string& name) const;
+
+  // Returns the node for key, calling make for a new one
+  template<typename T, typename Make>
+  T*
+  find (const Key& key, Make make)
+  {
+    ++m_requested;
+    auto entry = m_nodes.find (key);
+    if (entry != m_nodes.end ())
+    {
+      ++m_shared;
+      m_bytesSaved += sizeof (T);
+      return static_cast<T*> (entry->second);
+    }
+    T* node = make ();
+    m_nodes.emplace (key, node);
+    return node;
+  }
+
+  AstArena* m_arena;
+  std::unordered_map<Key, ExpressionNode*, KeyHash> m_nodes;
+
+  // Declarations visible in each open scope, innermost last
+  std::vector<std::unordered_map<std::string, uint64_t>> m_scopes;
+  uint64_t m_declarationCount;
+
+  size_t m_requested;
+  size_t m_shared;
+  size_t m_bytesSaved;
+};
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,121 @@
+/*
+  Filename   : ParallelParser.cc
+  Author     : Philip Androwick
+  Description: Speculative parallel parsing.  The declarations are split
+               into a few batches per thread, and each batch is parsed by
+               its own Parser.  Every declaration must end exactly where
+               the brace count said it would; if any does not, or any
+               batch has a syntax error, the parallel result is dropped.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <atomic>
+
+/***********************************************************************/
+// Local includes
+
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "../Compiler/Parallel.h"
+
+/***********************************************************************/
+
+bool
+findDeclarationEnds (const std::vector<Token>& tokens, std::vector<size_t>& ends)
+{
+  ends.clear ();
+  int depth = 0;
+  size_t last = tokens.size () - 1;
+  for (size_t n = 0; n < last; ++n)
+  {
+    switch (tokens[n].type)
+    {
+    case LBRACE:
+      ++depth;
+      break;
+
+    case RBRACE:
+      if (--depth < 0)
+        return false;
+      if (depth == 0)
+        ends.push_back (n + 1);
+      break;
+
+    case SEMI:
+      if (depth == 0)
+        ends.push_back (n + 1);
+      break;
+
+    // Let the serial parser report these
+    case ERROR:
+    case END_OF_FILE:
+      return false;
+
+    default:
+      break;
+    }
+  }
+  return !ends.empty () && ends.back () == last;
+}
+
+/***********************************************************************/
+
+ProgramNode*
+parseParallel (const std::vector<Token>& tokens, unsigned jobs, AstArena& arena,
+               std::vector<std::unique_ptr<AstArena>>& workerArenas)
+{
+  std::vector<size_t> ends;
+  if (jobs <= 1 || tokens.size () < PARALLEL_PARSE_MIN_TOKENS
+      || !findDeclarationEnds (tokens, ends))
+    return nullptr;
+
+  while (workerArenas.size () < jobs)
+    workerArenas.emplace_back (new AstArena ());
+
+  // Declarations [firsts[b], firsts[b + 1]) make up batch b
+  size_t batchCount = std::min (ends.size (), (size_t) jobs * 4);
+  std::vector<size_t> firsts;
+  for (size_t b = 0; b <= batchCount; ++b)
+    firsts.push_back (ends.size () * b / batchCount);
+
+  std::vector<std::vector<DeclarationNode*>> batches (batchCount);
+  std::atomic<bool> failed (false);
+  parallelFor (batchCount, jobs, [&] (size_t batch, unsigned worker) {
+    size_t begin = firsts[batch] == 0 ? 0 : ends[firsts[batch] - 1];
+    size_t end = ends[firsts[batch + 1] - 1];
+    Parser par (tokens.data () + begin, end - begin, workerArenas[worker].get ());
+    try
+    {
+      for (size_t d = firsts[batch]; d < firsts[batch + 1] && !failed; ++d)
+      {
+        DeclarationNode* declaration = par.nextDeclaration ();
+        // The parser must agree with the brace count
+        if (declaration == nullptr || par.getTokensConsumed () != ends[d] - begin)
+        {
+          failed = true;
+          return;
+        }
+        batches[batch].push_back (declaration);
+      }
+    }
+    catch (const CompileError&)
+    {
+      failed = true;
+    }
+  });
+
+  if (failed)
+  {
+    for (std::unique_ptr<AstArena>& workerArena : workerArenas)
+      workerArena->reset ();
+    return nullptr;
+  }
+
+  std::vector<DeclarationNode*> declarations;
+  declarations.reserve (ends.size ());
+  for (std::vector<DeclarationNode*>& batch : batches)
+    declarations.insert (declarations.end (), batch.begin (), batch.end ());
+  return arena.make<ProgramNode> (declarations);
+}
@@ -0,0 +1,52 @@
+/*
+  Filename   : ParallelParser.h
+  Author     : Philip Androwick
+  Description: Parses the top-level declarations of a program on several
+               threads.  A declaration ends at a ';' outside of any braces
+               or at the '}' closing a function body, so the token stream
+               can be cut into declarations by counting braces before
+               anything is parsed.
+*/
+
+/***********************************************************************/
+
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+/***********************************************************************/
+// System includes
+
+#include <memory>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "AstArena.h"
+#include "CMinusAst.h"
+#include "../Lexer/Lexer.h"
+
+/***********************************************************************/
+
+// Programs with fewer tokens are parsed serially
+const size_t PARALLEL_PARSE_MIN_TOKENS = 16 * 1024;
+
+// Fills ends with the index just past each top-level declaration of
+//   tokens, which ends with END_OF_FILE.  Returns false if the braces do
+//   not balance or tokens are left after the last declaration.
+bool
+findDeclarationEnds (const std::vector<Token>& tokens, std::vector<size_t>& ends);
+
+// Parses tokens using up to jobs threads.  Worker threads allocate from
+//   arenas of their own in workerArenas, which must live as long as the
+//   tree; the ProgramNode itself is made in arena.  Returns nullptr
+//   when the program is too small or does not split into declarations
+//   that parse on their own; the caller then parses it serially, which
+//   also reports any syntax error.
+ProgramNode*
+parseParallel (const std::vector<Token>& tokens, unsigned jobs, AstArena& arena,
+               std::vector<std::unique_ptr<AstArena>>& workerArenas);
+
+/***********************************************************************/
+
+#endif
@@ -64,10 +64,10 @@ Parser::decList ()
 	vector<DeclarationNode*> declarations;
 	declarations.push_back (dec ());
     
-    while (g_token.type != tokenMap["END_OF_FILE"])
+    while (g_token.type != END_OF_FILE)
 		declarations.push_back (dec ());
 
-	return new ProgramNode (declarations);
+	return arena->make<ProgramNode> (declarations);
 }
 
 // dec -> nameState (varDec | funDec)
@@ -76,9 +76,9 @@ Parser::dec ()
 {
 	DeclarationNode* node = nameState ();
 		
-	if (g_token.type == tokenMap["LBRACK"] || g_token.type == tokenMap["SEMI"])
+	if (g_token.type == LBRACK || g_token.type == SEMI)
 		return varDec (node);
-	else if (g_token.type == tokenMap["LPAREN"])
+	else if (g_token.type == LPAREN)
 		return funDec (node);
 	else
 	{
@@ -102,7 +102,7 @@ Parser::nameState ()
 	 
 	typeSpec ();
 	
-	DeclarationNode* varNode = new DeclarationNode (type, g_token.lexeme, DataType::VARIABLE, g_token.lineNum, g_token.columnNum);
+	DeclarationNode* varNode = arena->make<DeclarationNode> (type, g_token.lexeme, DataType::VARIABLE, g_token.lineNum, g_token.columnNum);
 	match ("nameState", {"ID"}); 
 	return varNode;
 }
@@ -114,12 +114,12 @@ Parser::varDec (DeclarationNode* decName)
 	int tempRow = g_token.lineNum;
 	int tempCol = g_token.columnNum;
 	// Optional array declaration
-	if (g_token.type == tokenMap["LBRACK"])
+	if (g_token.type == LBRACK)
 	{
 		match ("varDec", {"LBRACK"});
-		int x = std::stoi (g_token.lexeme);
-		ArrayDeclarationNode* arrayName = new ArrayDeclarationNode (decName->valueType, decName->identifier, x, tempRow, tempCol);
-		delete decName;
+		int x = g_token.number;
+		ArrayDeclarationNode* arrayName = arena->make<ArrayDeclarationNode> (decName->valueType, decName->identifier, x, tempRow, tempCol);
+		declare (decName->identifier);
 		match ("varDec", {"NUM"});
 		match ("varDec", {"RBRACK"});
 		match ("varDec", {"SEMI"});
@@ -128,7 +128,8 @@ Parser::varDec (DeclarationNode* decName)
 	
 	// Necessary semicolon
 	match ("varDec", {"SEMI"});
-	return new VariableDeclarationNode (decName->valueType, decName->identifier, DataType::VARIABLE, tempRow, tempCol);
+	declare (decName->identifier);
+	return arena->make<VariableDeclarationNode> (decName->valueType, decName->identifier, DataType::VARIABLE, tempRow, tempCol);
 }
 
 // typeSpec -> int | void
@@ -150,11 +151,41 @@ Parser::funDec (DeclarationNode* funcName)
 {
 	int tempRow = g_token.lineNum;
 	int tempCol = g_token.columnNum;
+	declare (funcName->identifier);
+	enterScope ();
 	match ("funDec", {"LPAREN"});
 	vector<ParameterNode*> parameters = params ();
 	match ("funDec", {"RPAREN"});
 	CompoundStatementNode* body = compoundStmt ();
-	return new FunctionDeclarationNode (funcName->valueType, funcName->identifier, parameters, body, tempRow, tempCol);
+	exitScope ();
+	return arena->make<FunctionDeclarationNode> (funcName->valueType, funcName->identifier, parameters, body, tempRow, tempCol);
+}
+
+// funDec without its compoundStmt, for declaring a function before
+// (or instead of) parsing its body
+DeclarationNode*
+Parser::nextHeader ()
+{
+	if (declarationCount++ == 0)
+		g_token = getToken ();
+
+	DeclarationNode* node = nameState ();
+	if (g_token.type == LBRACK || g_token.type == SEMI)
+		return varDec (node);
+	else if (g_token.type != LPAREN)
+		error ("dec", {"VAR"});
+
+	int tempRow = g_token.lineNum;
+	int tempCol = g_token.columnNum;
+	declare (node->identifier);
+	enterScope ();
+	match ("funDec", {"LPAREN"});
+	vector<ParameterNode*> parameters = params ();
+	match ("funDec", {"RPAREN"});
+	exitScope ();
+	if (g_token.type != LBRACE)
+		error ("compoundState", {"LBRACE"});
+	return arena->make<FunctionDeclarationNode> (node->valueType, node->identifier, parameters, nullptr, tempRow, tempCol);
 }
 
 // params -> void [ID paramList] | int ID paramList
@@ -164,11 +195,11 @@ Parser::params ()
 	vector<ParameterNode*> parameters;
 	// If the first parameter starts with void, the parameter list
 	// can end with just void it can be a variable
-	if (g_token.type == tokenMap["VOID"])
+	if (g_token.type == VOID)
 	{
 		match ("params", {"VOID"});
 		
-		if (g_token.type == tokenMap["ID"])
+		if (g_token.type == ID)
 		{
 			std::string tempLex = g_token.lexeme;
 			match ("params", {"ID"});
@@ -178,7 +209,7 @@ Parser::params ()
 	}
 	// If the first parameter start with int, the parameter
 	// MUST be a variable
-	else if (g_token.type == tokenMap["INT"])
+	else if (g_token.type == INT)
 	{		
 		match ("params", {"INT"});
 		std::string tempLex = g_token.lexeme;
@@ -201,18 +232,19 @@ Parser::paramList (ValueType type, std::string lexeme)
 	int tempRow = g_token.lineNum;
 	int tempCol = g_token.columnNum;
 	// Optional array for first parameter
-	if (g_token.type == tokenMap["LBRACK"])
+	if (g_token.type == LBRACK)
 	{
 		match ("paramList", {"LBRACK"});
 		match ("paramList", {"RBRACK"});
 		isArray = true;
 	}
 
-	ParameterNode* parameter = new ParameterNode (type, lexeme, isArray, tempRow, tempCol);
+	ParameterNode* parameter = arena->make<ParameterNode> (type, lexeme, isArray, tempRow, tempCol);
+	declare (lexeme);
 	parameters.push_back (parameter);
 
 	// Multiple parameters
-	while (g_token.type == tokenMap["COMMA"])
+	while (g_token.type == COMMA)
 	{
 		match ("paramList", {"COMMA"});
 		ParameterNode* newParameter = param ();
@@ -231,18 +263,19 @@ Parser::param ()
 	int tempCol = g_token.columnNum;
 	// Optional array for non-first parameters
 	bool isArray = false;
-	if (g_token.type == tokenMap["LBRACK"])
+	if (g_token.type == LBRACK)
 	{
 		match ("param", {"LBRACK"});
 		match ("param", {"RBRACK"});
 		isArray = true;
 	}
 
-	return new ParameterNode (node->valueType, node->identifier, isArray, tempRow, tempCol);
+	declare (node->identifier);
+	return arena->make<ParameterNode> (node->valueType, node->identifier, isArray, tempRow, tempCol);
 }                     
 
 /**************************************************************************************/
-// compoundStmt, localDec, stateList, state
+// compoundStmt, localDec, state
 // compoundStmt catches the multiple states that can happen in functions.  states include
 // expressions, if/else statements, while loops, a return statement, and even another 
 // compoundStmt.  compoundStmts must start with variable declarations, followed by states.
@@ -251,11 +284,9 @@ Parser::param ()
 CompoundStatementNode*
 Parser::compoundStmt ()
 {
-	match ("compoundState", {"LBRACE"});
-	vector<VariableDeclarationNode*> localDeclarations = localDec ();
-	vector<StatementNode*> statements = stateList ();
-	match ("compoundState", {"RBRACE"});
-	return new CompoundStatementNode (localDeclarations, statements);
+	if (g_token.type != LBRACE)
+		match ("compoundState", {"LBRACE"});
+	return static_cast<CompoundStatementNode*> (state ());
 }
 
 // localDec -> { nameState varDec }
@@ -263,7 +294,7 @@ vector<VariableDeclarationNode*>
 Parser::localDec ()
 {
 	vector<VariableDeclarationNode*> varVec;
-	while (g_token.type == tokenMap["INT"] || g_token.type == tokenMap["VOID"])
+	while (g_token.type == INT || g_token.type == VOID)
 	{
 		DeclarationNode* node = nameState ();
 		VariableDeclarationNode* varNode = varDec (node);
@@ -272,79 +303,108 @@ Parser::localDec ()
 	return varVec;
 }
 
-// stateList -> { state } 
-vector<StatementNode*>
-Parser::stateList ()
+// state -> compoundState | selectionState | iterationState | returnState | expressionState
+// stateList -> { state }
+// The statements that the one being parsed is nested in are kept on a stack rather than
+// parsed recursively, so nesting is limited by memory rather than by the call stack.
+StatementNode*
+Parser::state ()
 {
-	vector<StatementNode*> stateNodeVec;
-	while (g_token.type != tokenMap["RBRACE"])
+	vector<PendingStatement> pending;
+	while (true)
 	{
-		StatementNode* stateNode = state ();
-		stateNodeVec.push_back (stateNode);
-	}
-	return stateNodeVec;
-}
+		StatementNode* statement = nullptr;
+		if (g_token.type == LBRACE)
+		{
+			match ("compoundState", {"LBRACE"});
+			pending.push_back (PendingStatement (StatementRole::COMPOUND));
+			pending.back ().declarations = localDec ();
+		}
+		// selectionStmt -> if ( expression ) statement [ else statement ]
+		else if (g_token.type == IF)
+		{
+			pending.push_back (PendingStatement (StatementRole::THEN));
+			pending.back ().condition = condition ("selectionStmt", "IF");
+			enterScope ();
+		}
+		// iterationStmt -> while ( expression ) statement
+		else if (g_token.type == WHILE)
+		{
+			pending.push_back (PendingStatement (StatementRole::BODY));
+			pending.back ().condition = condition ("iterationStmt", "WHILE");
+			enterScope ();
+		}
+		else if (g_token.type == RETURN)
+			statement = returnStmt ();
+		else
+			statement = expressionStmt ();
 
-// state -> compoundState | selectionState | iterationState | returnState | expressionState 
-StatementNode*
-Parser::state()
-{
-	if (g_token.type == tokenMap["LBRACE"])
-		return compoundStmt ();
-	else if (g_token.type == tokenMap["IF"])
-		return selectionStmt ();
-	else if (g_token.type == tokenMap["WHILE"])
-		return iterationStmt ();
-	else if (g_token.type == tokenMap["RETURN"])
-		return returnStmt ();
-	else
-		return expressionStmt ();
+		// Hand each finished statement to the one it is nested in, until one
+		// needs another statement
+		while (true)
+		{
+			if (statement == nullptr)
+			{
+				if (pending.back ().role != StatementRole::COMPOUND || g_token.type != RBRACE)
+					break;
+				match ("compoundState", {"RBRACE"});
+				statement = arena->make<CompoundStatementNode> (pending.back ().declarations,
+					pending.back ().statements);
+				pending.pop_back ();
+			}
+			if (pending.empty ())
+				return statement;
+
+			PendingStatement& outer = pending.back ();
+			if (outer.role == StatementRole::COMPOUND)
+			{
+				outer.statements.push_back (statement);
+				statement = nullptr;
+				continue;
+			}
+			exitScope ();
+			// Optional else statement
+			if (outer.role == StatementRole::THEN && g_token.type == ELSE)
+			{
+				match ("selectionStmt", {"ELSE"});
+				enterScope ();
+				outer.role = StatementRole::ELSE;
+				outer.thenStatement = statement;
+				break;
+			}
+			if (outer.role == StatementRole::BODY)
+				statement = arena->make<WhileStatementNode> (outer.condition, statement);
+			else if (outer.role == StatementRole::THEN)
+				statement = arena->make<IfStatementNode> (outer.condition, statement, nullptr);
+			else
+				statement = arena->make<IfStatementNode> (outer.condition, outer.thenStatement, statement);
+			pending.pop_back ();
+		}
+	}
 }
 
 /**************************************************************************************/
-// expressionStmt, selectionStmt, iterationStmt, returnStmt
-// These for statements are different types of states.
+// expressionStmt, condition, returnStmt
+// These are the statements that are not nested in a statement of their own.
 
 // expressionStmt -> expression ; | ;
 ExpressionStatementNode*
 Parser::expressionStmt ()
 {
-	ExpressionStatementNode* exprNode = new ExpressionStatementNode (expression ());
+	ExpressionStatementNode* exprNode = arena->make<ExpressionStatementNode> (expression ());
 	match ("expressionStmt", {"SEMI"});
 	return exprNode;
 }
 
-// selectionStmt -> if ( expression ) statement [ else statement ]
-IfStatementNode*
-Parser::selectionStmt ()
-{
-	match ("selectionStmt", {"IF"});
-	match ("selectionStmt", {"LPAREN"});
-	ExpressionNode* exprNode = expression ();
-	match ("selectionStmt", {"RPAREN"});
-	StatementNode* thenNode = state ();
-	
-	// Optional else statement
-	StatementNode* elseNode = nullptr;
-	if (g_token.type == tokenMap["ELSE"])
-	{
-		match ("selectionStmt", {"ELSE"});
-		elseNode = state ();
-	}
-	
-	return new IfStatementNode (exprNode, thenNode, elseNode);
-}
-
-// iterationStmt -> while ( expression ) statement
-WhileStatementNode*
-Parser::iterationStmt ()
+// The keyword ( expression ) that begins an if or while statement
+ExpressionNode*
+Parser::condition (const std::string& function, const std::string& keyword)
 {
-	match ("iterationStmt", {"WHILE"});
-	match ("iterationStmt", {"LPAREN"});
+	match (function, {keyword});
+	match (function, {"LPAREN"});
 	ExpressionNode* exprNode = expression ();
-	match ("iterationStmt", {"RPAREN"});
-	StatementNode* statement = state ();
-  	return new WhileStatementNode (exprNode, statement);
+	match (function, {"RPAREN"});
+	return exprNode;
 }
 
 // returnStmt -> return [ expression ] ;
@@ -352,89 +412,237 @@ ReturnStatementNode*
 Parser::returnStmt ()
 {
 	match ("returnStmt", {"RETURN"});
-	ReturnStatementNode* returnNode = new ReturnStatementNode (expression ());
+	ReturnStatementNode* returnNode = arena->make<ReturnStatementNode> (expression ());
 	match ("returnStmt", {"SEMI"});
 
 	return returnNode;
 }
 
 /**************************************************************************************/
-// expression, var, simpleExpr, additiveExpr, addop, term, mulop, factor, call, args
+// expression, var, relop, addop, mulop
 // This huge section is for expressions.  These include math (+, -, /, and *), comparisons
 // (<, <=, >, >=, ==, and !=), and even other function calls (with parameters) that can return
 // values for the expression. 
 
-// expression -> [ ID var = expression ] simpleExpr
+// expression        -> [ ID var = expression ] simpleExpr
+// simple-expression -> additiveExpr [ relop additiveExpr ]
+// additiveExpr      -> term { addop term }
+// term              -> factor { mulop factor }
+// factor            -> '(' expression ')' | ID ( var | call ) | NUM
+// call              -> ( args )
+// args              -> [ expression { , expression } ]
+// The expressions that the one being parsed is nested in, as a parenthesized expression,
+// an index, an argument or an assigned value, are kept on a stack rather than parsed
+// recursively, so nesting is limited by memory rather than by the call stack.
 ExpressionNode*
 Parser::expression ()
-{	
-	std::deque<Token> tempTokens = tokens;
-	tempTokens.push_front (g_token);
-
-	if (g_token.type == tokenMap["ID"])
+{
+	vector<PendingExpression> pending;
+	pending.push_back (PendingExpression (ExpressionRole::WHOLE));
+	while (true)
 	{
-		std::string tempID = g_token.lexeme;
-		int tempRow = g_token.lineNum;
-		int tempCol = g_token.columnNum;
-		std::map<int, ValueType> valueTypeMap { {INT, ValueType::INT}, 
+		ExpressionNode* node = nullptr;
+		if (g_token.type == LPAREN)
+		{
+			match ("factor", {"LPAREN"});
+			pending.push_back (PendingExpression (ExpressionRole::PARENTHESIZED));
+			continue;
+		}
+		else if (g_token.type == ID)
+		{
+			std::map<int, ValueType> valueTypeMap { {INT, ValueType::INT}, 
 			{VOID, ValueType::VOID} };
-		ValueType type = valueTypeMap[g_token.type];
+			PendingExpression name (ExpressionRole::INDEX);
+			name.identifier = g_token.lexeme;
+			name.type = valueTypeMap[g_token.type];
+			name.row = g_token.lineNum;
+			name.col = g_token.columnNum;
+			match ("factor", {"ID"});
+			if (g_token.type == LPAREN)
+			{
+				match ("factor", {"LPAREN"});
+				name.role = ExpressionRole::ARGUMENT;
+				pending.push_back (name);
+				continue;
+			}
+			if (g_token.type == LBRACK)
+			{
+				match ("var", {"LBRACK"});
+				pending.push_back (name);
+				continue;
+			}
+			if (assignment (pending, name, false, nullptr))
+				continue;
+			node = var (name, false, nullptr, false);
+		}
+		else if (g_token.type == NUM)
+		{
+			int x = g_token.number;
+			int tempRow = g_token.lineNum;
+			int tempCol = g_token.columnNum;
+			match ("factor", {"NUM"});
+			if (factory != nullptr)
+				node = factory->literal (x, tempRow, tempCol);
+			else
+				node = arena->make<IntegerLiteralExpressionNode> (x, tempRow, tempCol);
+		}
 
-		match ("expression", {"ID"});
-		VariableExpressionNode* varExpNode = var (tempID, type, tempRow, tempCol);
+		if (reduce (pending, node))
+			return node;
+	}
+}
 
-		if (g_token.type == tokenMap["ASSIGN"])
+// Folds node, a factor of the innermost pending expression, into the expressions it
+// completes.  Returns true with node set to the expression begun by expression () once
+// that one is complete, or false when another factor is needed.
+bool
+Parser::reduce (vector<PendingExpression>& pending, ExpressionNode*& node)
+{
+	// Whether node is the whole of the innermost expression rather than a factor of it
+	bool whole = false;
+	while (true)
+	{
+		PendingExpression& current = pending.back ();
+		if (!whole)
 		{
-			tempRow = g_token.lineNum;
-			tempCol = g_token.columnNum;
-			match ("expression", {"ASSIGN"});
-			return new AssignmentExpressionNode (type, varExpNode, expression (), tempRow, tempCol);
+			current.started = true;
+			if (current.multiplicative.waiting)
+			{
+				node = multiplicative (current, node);
+				current.multiplicative.waiting = false;
+			}
+			if (g_token.type == TIMES || g_token.type == DIVIDE)
+			{
+				current.multiplicative = PendingOperand (node, g_token);
+				current.multiplicativeOperator = mulop ();
+				return false;
+			}
+			if (current.additive.waiting)
+			{
+				node = additive (current, node);
+				current.additive.waiting = false;
+			}
+			if (g_token.type == PLUS || g_token.type == MINUS)
+			{
+				current.additive = PendingOperand (node, g_token);
+				current.additiveOperator = addop ();
+				return false;
+			}
+			if (current.relational.waiting)
+				node = relational (current, node);
+			else if (node != nullptr && (g_token.type == LTE || g_token.type == LT ||
+				g_token.type == GT || g_token.type == GTE ||
+				g_token.type == EQ || g_token.type == NEQ))
+			{
+				current.relational = PendingOperand (node, g_token);
+				current.relationalOperator = relop ();
+				return false;
+			}
+		}
+
+		PendingExpression done = std::move (current);
+		pending.pop_back ();
+		whole = false;
+		if (done.role == ExpressionRole::WHOLE)
+			return true;
+		else if (done.role == ExpressionRole::ASSIGNED)
+		{
+			node = arena->make<AssignmentExpressionNode> (done.type, done.target, node, done.row, done.col);
+			whole = true;
+		}
+		else if (done.role == ExpressionRole::PARENTHESIZED)
+			match ("factor", {"RPAREN"});
+		else if (done.role == ExpressionRole::INDEX)
+		{
+			match ("var", {"RBRACK"});
+			if (assignment (pending, done, true, node))
+				return false;
+			node = var (done, true, node, false);
 		}
 		else
 		{
-			tokens = tempTokens;
-			g_token = getToken ();
+			if (node != nullptr)
+			{
+				done.arguments.push_back (node);
+				if (g_token.type == COMMA)
+				{
+					match ("argsList", {"COMMA"});
+					done.started = false;
+					pending.push_back (std::move (done));
+					return false;
+				}
+			}
+			match ("factor", {"RPAREN"});
+			node = arena->make<CallExpressionNode> (done.identifier, done.arguments, done.type, done.row, done.col);
 		}
 	}
+}
 
-	ExpressionNode* node = simpleExpr ();
-	return node;
+// expression -> ID var = expression
+// If the variable named by name, with index if it is subscripted, begins its expression
+// and is followed by '=', starts the expression assigned to it and returns true.  The
+// assignment is then all of the expression it begins.
+bool
+Parser::assignment (vector<PendingExpression>& pending, const PendingExpression& name, bool subscripted,
+	ExpressionNode* index)
+{
+	if (pending.back ().started || g_token.type != ASSIGN)
+		return false;
+	PendingExpression value (ExpressionRole::ASSIGNED);
+	value.type = name.type;
+	value.target = var (name, subscripted, index, true);
+	value.row = g_token.lineNum;
+	value.col = g_token.columnNum;
+	match ("expression", {"ASSIGN"});
+	pending.push_back (value);
+	return true;
 }
 
 // var -> '[' expression ']'
+// The variable named by name, with index if it is subscripted
 VariableExpressionNode*
-Parser::var (std::string tempID, ValueType type, int tempRow, int tempCol)
+Parser::var (const PendingExpression& name, bool subscripted, ExpressionNode* index, bool isTarget)
 {
-	if (g_token.type == tokenMap["LBRACK"])
+	// Assignment targets are never shared
+	bool share = factory != nullptr && !isTarget;
+	if (subscripted)
 	{
-		match ("var", {"LBRACK"});
-		ExpressionNode* exNode = expression ();
-		match ("var", {"RBRACK"});
-		return new SubscriptExpressionNode (tempID, exNode, type, tempRow, tempCol);
+		if (share)
+			return factory->subscript (name.identifier, index, name.type, name.row, name.col);
+		return arena->make<SubscriptExpressionNode> (name.identifier, index, name.type, name.row, name.col);
 	}
-	return new VariableExpressionNode (tempID, type, DataType::VARIABLE, tempRow, tempCol);
+	if (share)
+		return factory->variable (name.identifier, name.type, name.row, name.col);
+	return arena->make<VariableExpressionNode> (name.identifier, name.type, DataType::VARIABLE, name.row, name.col);
 }
 
-// simple-expression -> additiveExpr [ relop additiveExpr ]
+// The operators, applied to the left operand waiting in current and right
 ExpressionNode*
-Parser::simpleExpr ()
+Parser::relational (const PendingExpression& current, ExpressionNode* right)
 {
-	ExpressionNode* left = additiveExpr ();
-	if (left != nullptr)
-	{
-		RelationalOperatorType type;
-		if (g_token.type == tokenMap["LTE"] || g_token.type == tokenMap["LT"] ||
-			g_token.type == tokenMap["GT"] || g_token.type == tokenMap["GTE"] ||
-			g_token.type == tokenMap["EQ"] || g_token.type == tokenMap["NEQ"])
-		{
-			int tempRow = g_token.lineNum;
-			int tempCol = g_token.columnNum;
-			type = relop ();
-			ExpressionNode* right = additiveExpr ();
-			left = new RelationalExpressionNode (type, left, right, tempRow, tempCol);
-		}
-	}
-	return left;
+	const PendingOperand& left = current.relational;
+	if (factory != nullptr)
+		return factory->relational (current.relationalOperator, left.node, right, left.row, left.col);
+	return arena->make<RelationalExpressionNode> (current.relationalOperator, left.node, right, left.row, left.col);
+}
+
+ExpressionNode*
+Parser::additive (const PendingExpression& current, ExpressionNode* right)
+{
+	const PendingOperand& left = current.additive;
+	if (factory != nullptr)
+		return factory->additive (current.additiveOperator, left.node, right, left.row, left.col);
+	return arena->make<AdditiveExpressionNode> (current.additiveOperator, left.node, right, left.row, left.col);
+}
+
+ExpressionNode*
+Parser::multiplicative (const PendingExpression& current, ExpressionNode* right)
+{
+	const PendingOperand& left = current.multiplicative;
+	if (factory != nullptr)
+		return factory->multiplicative (current.multiplicativeOperator, left.node, right, left.row, left.col);
+	return arena->make<MultiplicativeExpressionNode> (current.multiplicativeOperator, left.node, right, left.row,
+		left.col);
 }
 
 // relop -> <= | < | > | >= | == | !=
@@ -443,154 +651,40 @@ Parser::relop ()
 {
 	TokenType tempTok = g_token.type;
 	match ("relop", {"LTE", "LT", "GT", "GTE", "EQ", "NEQ"});
-	if (tempTok == tokenMap["LTE"])
+	if (tempTok == LTE)
 		return RelationalOperatorType::LTE;
-	else if (tempTok == tokenMap["LT"])
+	else if (tempTok == LT)
 		return RelationalOperatorType::LT;
-	else if (tempTok == tokenMap["GT"])
+	else if (tempTok == GT)
 		return RelationalOperatorType::GT;
-	else if (tempTok == tokenMap["GTE"])
+	else if (tempTok == GTE)
 		return RelationalOperatorType::GTE;
-	else if (tempTok == tokenMap["EQ"])
+	else if (tempTok == EQ)
 		return RelationalOperatorType::EQ;
 	else
 		return RelationalOperatorType::NEQ;	
 }
 
-// additiveExpr -> term { addop term }
-ExpressionNode*
-Parser::additiveExpr ()
-{
-	ExpressionNode* left = term ();
-
-	AdditiveOperatorType type;
-	while (g_token.type == tokenMap["PLUS"] || g_token.type == tokenMap["MINUS"])
-	{
-		int tempRow = g_token.lineNum;
-		int tempCol = g_token.columnNum;
-		type = addop ();
-		ExpressionNode* right = term ();
-		left = new AdditiveExpressionNode (type, left, right, tempRow, tempCol);
-	}
-	
-	return left;
-}
-
 // addop -> +|-
 AdditiveOperatorType
 Parser::addop ()
 {
 	TokenType tempTok = g_token.type;
 	match ("addop", {"PLUS", "MINUS"});
-	if (tempTok == tokenMap["PLUS"])
+	if (tempTok == PLUS)
 		return AdditiveOperatorType::PLUS;
 	else
 		return AdditiveOperatorType::MINUS;
 }
 
-// term -> factor { mulop factor }
-ExpressionNode*
-Parser::term ()
-{
-	ExpressionNode* left = factor ();
-
-	MultiplicativeOperatorType type;
-	while (g_token.type == tokenMap["TIMES"] || g_token.type == tokenMap["DIVIDE"])
-	{
-		int tempRow = g_token.lineNum;
-		int tempCol = g_token.columnNum;
-		type = mulop ();
-		ExpressionNode* right = factor ();
-		left = new MultiplicativeExpressionNode (type, left, right, tempRow, tempCol);
-	}
-	
-	return left;
-}
-
 // mulop -> * | /
 MultiplicativeOperatorType
 Parser::mulop ()
 {
 	TokenType tempTok = g_token.type;
 	match ("mulop", {"TIMES", "DIVIDE"});
-	if (tempTok == tokenMap["TIMES"])
+	if (tempTok == TIMES)
 		return MultiplicativeOperatorType::TIMES;
 	else
 		return MultiplicativeOperatorType::DIVIDE;
 }
-
-// factor -> '(' expression ')' | ID ( var | call ) | NUM
-ExpressionNode*
-Parser::factor ()
-{
-	if (g_token.type == tokenMap["LPAREN"])
-	{
-		match ("factor", {"LPAREN"});
-		ExpressionNode* node = expression ();
-		match ("factor", {"RPAREN"});
-		return node;
-	}
-	else if (g_token.type == tokenMap["ID"])
-	{
-		std::string tempID = g_token.lexeme;
-		int tempRow = g_token.lineNum;
-		int tempCol = g_token.columnNum;
-		std::map<int, ValueType> valueTypeMap { {INT, ValueType::INT}, 
-		{VOID, ValueType::VOID} };
-		ValueType type = valueTypeMap[g_token.type];
-		match ("factor", {"ID"});
-		if (g_token.type == tokenMap["LPAREN"])
-			return call (tempID, type, tempRow, tempCol);
-		else
-			return var (tempID, type, tempRow, tempCol);
-	}
-	else if (g_token.type == tokenMap["NUM"])
-	{
-		int x = std::stoi (g_token.lexeme);
-		int tempRow = g_token.lineNum;
-		int tempCol = g_token.columnNum;
-		match ("factor", {"NUM"});
-		IntegerLiteralExpressionNode* node = new IntegerLiteralExpressionNode (x, tempRow, tempCol);
-		return node;
-	}
-	else
-	{
-		return nullptr;
-	}
-}
-
-// call -> ( args )
-CallExpressionNode*
-Parser::call (std::string tempID, ValueType type, int tempRow, int tempCol)
-{
-	match ("factor", {"LPAREN"});
-	CallExpressionNode* callNode = new CallExpressionNode (tempID, args (), type, tempRow, tempCol);
-	match ("factor", {"RPAREN"});
-	return callNode;
-}
-
-// args -> [ expression { , expression } ]
-vector<ExpressionNode*>
-Parser::args ()
-{
-	vector<ExpressionNode*> argList;
-
-	ExpressionNode* argument = expression ();
-	if (argument == nullptr)
-		return argList;
-	else
-		argList.push_back (argument);
-
-	while (g_token.type == tokenMap["COMMA"])
-	{
-		match ("argsList", {"COMMA"});
-
-		ExpressionNode* argument = expression ();
-		if (argument == nullptr)
-			return argList;
-		else
-			argList.push_back (argument);
-	}
-
-	return argList;
-}
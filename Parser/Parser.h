@@ -1,15 +1,101 @@
-#include <deque>
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <vector>
 #include "../Lexer/Lexer.h"
+#include "../Compiler/Diagnostic.h"
 #include "CMinusAst.h"
+#include "AstArena.h"
+#include "NodeFactory.h"
+
+// Supplies tokens to a parser in batches, for parsing while the
+// lexer is still running
+class TokenFeed
+{
+	public :
+		virtual ~TokenFeed ()
+		{
+		}
+
+		// Replaces batch with the next tokens; returns false when there
+		// are no more.  The last token fed is END_OF_FILE.
+		virtual bool
+		next (std::vector<Token>& batch) = 0;
+};
 
 class Parser
 {
 	public :
-		Parser (std::deque<Token> tokensPar)
+		// tokensPar must end with END_OF_FILE and outlive the parser.
+		// Every node is allocated from arenaPar.
+		Parser (const std::vector<Token>& tokensPar, AstArena* arenaPar)
+			: tokens (tokensPar.data ()), tokenCount (tokensPar.size ()), position (0), arena (arenaPar),
+			  feed (nullptr), declarationCount (0), sliced (false), factory (nullptr)
+		{
+		}
+
+		// Pulls tokens from feedPar as they are needed
+		Parser (TokenFeed* feedPar, AstArena* arenaPar)
+			: tokens (nullptr), tokenCount (0), position (0), arena (arenaPar),
+			  feed (feedPar), declarationCount (0), sliced (false), factory (nullptr)
+		{
+		}
+
+		// Parses declarations from the countPar tokens at tokensPar, a
+		// slice of a larger stream; an END_OF_FILE follows the slice
+		Parser (const Token* tokensPar, size_t countPar, AstArena* arenaPar)
+			: tokens (tokensPar), tokenCount (countPar), position (0), arena (arenaPar),
+			  feed (nullptr), declarationCount (0), sliced (true), factory (nullptr)
 		{
-			tokens = tokensPar;
 		}
 
+		// Makes expression nodes through factoryPar, sharing identical
+		// ones; it must see the whole program from the start
+		void
+		setNodeFactory (NodeFactory* factoryPar)
+		{
+			factory = factoryPar;
+		}
+
+		// Tokens read so far, not counting g_token
+		size_t
+		getTokensConsumed () const
+		{
+			return position - 1;
+		}
+
+		// Parses the next top-level declaration, returning nullptr at the
+		// end of the program.  Use instead of program () to handle
+		// declarations as they are parsed.
+		DeclarationNode*
+		nextDeclaration ()
+		{
+			if (declarationCount == 0)
+				g_token = getToken ();
+			// A program has at least one declaration
+			else if (g_token.type == END_OF_FILE)
+				return nullptr;
+
+			// Nothing backs up past a declaration, so the tokens
+			// before it can go
+			if (feed != nullptr)
+			{
+				buffer.erase (buffer.begin (), buffer.begin () + position);
+				position = 0;
+				tokens = buffer.data ();
+				tokenCount = buffer.size ();
+			}
+
+			++declarationCount;
+			return dec ();
+		}
+
+		// Parses just the header of the next top-level declaration: all
+		// of a variable declaration, or a function's name and parameters
+		// with a nullptr body.  The body's tokens are left unread.
+		DeclarationNode*
+		nextHeader ();
+
 		ProgramNode*
 		program ();
 
@@ -46,20 +132,14 @@ class Parser
 		vector<VariableDeclarationNode*>
 		localDec();
 
-		vector<StatementNode*>
-		stateList();
-
 		StatementNode*
 		state();
 
 		ExpressionStatementNode*
 		expressionStmt ();
 
-		IfStatementNode*
-		selectionStmt ();
-
-		WhileStatementNode*
-		iterationStmt ();
+		ExpressionNode*
+		condition (const std::string& function, const std::string& keyword);
 
 		ReturnStatementNode*
 		returnStmt ();
@@ -67,59 +147,43 @@ class Parser
 		ExpressionNode*
 		expression ();
 
-		VariableExpressionNode*
-		var (std::string tempID, ValueType type, int tempRow, int tempCol);
-
-		ExpressionNode*
-		simpleExpr ();
-
 		RelationalOperatorType
 		relop ();
 
-		ExpressionNode*
-		additiveExpr ();
-
 		AdditiveOperatorType
 		addop ();
 
-		ExpressionNode*
-		term ();
-
 		MultiplicativeOperatorType
 		mulop ();
 
-		ExpressionNode*
-		factor ();
-
-		CallExpressionNode*
-		call (std::string tempID, ValueType type, int tempRow, int tempCol);
-
-		vector<ExpressionNode*>
-		args ();
-
-		std::string
+		static std::string
 		getAST (ProgramNode* tree)
 		{
 			std::string finalOutput = "";
 			
 			EvaluationVisitor visitor;
-			tree->accept (&visitor);
+			visitor.walk (tree);
 			finalOutput += visitor.output;
 			finalOutput += "\n";
 
 			for (DeclarationNode* node : tree->declarations)
-			{
-				EvaluationVisitor visitor;
-				node->accept (&visitor);
-				finalOutput += visitor.output;
-				finalOutput += "\n";
-			}
+				finalOutput += getAST (node);
 			
 			return finalOutput;
 		}
 
+		// The .ast text of one top-level declaration
+		static std::string
+		getAST (DeclarationNode* node)
+		{
+			EvaluationVisitor visitor;
+			visitor.walk (node);
+			return visitor.output + "\n";
+		}
+
 	public :
-		std::map<std::string, int> tokenMap { {"END_OF_FILE", 0}, {"ERROR", 1},
+		// Token names used in error messages
+		static inline const std::map<std::string, int> tokenMap { {"END_OF_FILE", 0}, {"ERROR", 1},
 			    {"IF", IF}, {"ELSE", ELSE}, {"INT", INT}, {"VOID", VOID}, {"RETURN", RETURN},
 				{"WHILE", WHILE}, {"PLUS", PLUS}, {"MINUS", MINUS}, {"TIMES", TIMES},
 				{"DIVIDE", DIVIDE}, {"LT", LT}, {"LTE", LTE}, {"GT", GT}, {"GTE", GTE},
@@ -129,15 +193,170 @@ class Parser
 				{"NUM", NUM} };
 		
 		Token g_token;
-		std::deque<Token> tokens;
 	private :
-		// Pops the front token in the deque and returns it
+		const Token* tokens;
+		size_t tokenCount;
+		// Index of the token after g_token
+		size_t position;
+		AstArena* arena;
+
+		// Tokens received from the feed and not yet released
+		TokenFeed* feed;
+		std::vector<Token> buffer;
+		size_t declarationCount;
+
+		// Parsing a slice, which is followed by an END_OF_FILE of its own
+		bool sliced;
+
+		// Hash-consing of expression nodes; nullptr when off
+		NodeFactory* factory;
+
+		// A statement being parsed that has others nested in it: a compound
+		// statement, either branch of an if or the body of a while
+		enum class StatementRole { COMPOUND, THEN, ELSE, BODY };
+
+		struct PendingStatement
+		{
+			explicit PendingStatement (StatementRole rolePar)
+				: role (rolePar), condition (nullptr), thenStatement (nullptr)
+			{
+			}
+
+			StatementRole role;
+			ExpressionNode* condition;
+			StatementNode* thenStatement;
+			vector<VariableDeclarationNode*> declarations;
+			vector<StatementNode*> statements;
+		};
+
+		// A left operand waiting for the right operand of its operator
+		struct PendingOperand
+		{
+			PendingOperand ()
+				: waiting (false), node (nullptr), row (0), col (0)
+			{
+			}
+
+			// The operator is token
+			PendingOperand (ExpressionNode* nodePar, const Token& token)
+				: waiting (true), node (nodePar), row (token.lineNum), col (token.columnNum)
+			{
+			}
+
+			bool waiting;
+			ExpressionNode* node;
+			int row;
+			int col;
+		};
+
+		// What an expression being parsed is: the one expression () began,
+		// an assigned value, the index of a subscript, a parenthesized
+		// expression or an argument of a call
+		enum class ExpressionRole { WHOLE, ASSIGNED, INDEX, PARENTHESIZED, ARGUMENT };
+
+		struct PendingExpression
+		{
+			explicit PendingExpression (ExpressionRole rolePar)
+				: role (rolePar), type (ValueType::INT), row (0), col (0), target (nullptr), started (false),
+				  relationalOperator (RelationalOperatorType::LT), additiveOperator (AdditiveOperatorType::PLUS),
+				  multiplicativeOperator (MultiplicativeOperatorType::TIMES)
+			{
+			}
+
+			ExpressionRole role;
+			// The variable assigned, subscripted or called, and where
+			std::string identifier;
+			ValueType type;
+			int row;
+			int col;
+			VariableExpressionNode* target;
+			vector<ExpressionNode*> arguments;
+
+			// Whether a factor or operator of the expression has been parsed
+			bool started;
+			PendingOperand relational;
+			RelationalOperatorType relationalOperator;
+			PendingOperand additive;
+			AdditiveOperatorType additiveOperator;
+			PendingOperand multiplicative;
+			MultiplicativeOperatorType multiplicativeOperator;
+		};
+
+		bool
+		reduce (vector<PendingExpression>& pending, ExpressionNode*& node);
+
+		bool
+		assignment (vector<PendingExpression>& pending, const PendingExpression& name, bool subscripted,
+			ExpressionNode* index);
+
+		VariableExpressionNode*
+		var (const PendingExpression& name, bool subscripted, ExpressionNode* index, bool isTarget);
+
+		ExpressionNode*
+		relational (const PendingExpression& current, ExpressionNode* right);
+
+		ExpressionNode*
+		additive (const PendingExpression& current, ExpressionNode* right);
+
+		ExpressionNode*
+		multiplicative (const PendingExpression& current, ExpressionNode* right);
+
+		// Scopes the factory needs to resolve variables
+		void
+		declare (const std::string& name)
+		{
+			if (factory != nullptr)
+				factory->declare (name);
+		}
+
+		void
+		enterScope ()
+		{
+			if (factory != nullptr)
+				factory->enterScope ();
+		}
+
+		void
+		exitScope ()
+		{
+			if (factory != nullptr)
+				factory->exitScope ();
+		}
+
+		// Returns the next token; END_OF_FILE repeats once reached
 		Token
 		getToken ()
 		{
-			Token val = tokens.front ();
-			tokens.pop_front ();
-			return val;
+			if (position == tokenCount && feed != nullptr)
+				refill ();
+			if (position < tokenCount)
+				return tokens[position++];
+			if (sliced)
+			{
+				position = tokenCount + 1;
+				return Token (END_OF_FILE);
+			}
+			return tokens[tokenCount - 1];
+		}
+
+		void
+		refill ()
+		{
+			std::vector<Token> batch;
+			while (batch.empty () && feed->next (batch))
+				;
+			for (Token& token : batch)
+				buffer.push_back (std::move (token));
+			tokens = buffer.data ();
+			tokenCount = buffer.size ();
+			if (tokenCount == 0)
+			{
+				// The feed ended without END_OF_FILE
+				buffer.push_back (Token (END_OF_FILE));
+				tokens = buffer.data ();
+				tokenCount = 1;
+				feed = nullptr;
+			}
 		}
 
 		void
@@ -145,7 +364,7 @@ class Parser
 		{
 			for (std::string expectedToken : expectedTokenTypes)
 			{
-				if (g_token.type == tokenMap[expectedToken])
+				if (g_token.type == tokenMap.at (expectedToken))
 				{
 					g_token = getToken ();
 					return;
@@ -154,21 +373,24 @@ class Parser
 			error (function, expectedTokenTypes);
 		}
 
-		// Prints out an error message
-		void 
+		// Reports an error message
+		[[noreturn]] void 
 		error (const std::string& function, std::initializer_list<std::string> const &expectedTokenTypes)
 		{
-			printf ("\nError while parsing \'%s\'\n", function.c_str ());
-			printf ("  Encountered: \'%s\' (line %d, column %d)\n", g_token.lexeme.c_str (), g_token.lineNum, g_token.columnNum);
-			printf ("  Expected   : %s\n", expectedTokenTypes.begin ()->c_str ());
+			std::string message = "\nError while parsing \'" + function + "\'\n";
+			message += "  Encountered: \'" + g_token.lexeme + "\' (line " + std::to_string (g_token.lineNum)
+				+ ", column " + std::to_string (g_token.columnNum) + ")\n";
+			message += "  Expected   : " + *expectedTokenTypes.begin () + "\n";
 			if (expectedTokenTypes.size () > 1)
 			{
 				for (std::initializer_list<std::string>::iterator x = expectedTokenTypes.begin ()+1; x != expectedTokenTypes.end (); ++x)
 				{
-					printf ("            or %s\n", x->c_str ());
+					message += "            or " + *x + "\n";
 				}
 			}
-			printf("\n");
-			exit (1);
+			message += "\n";
+			raiseError (g_token.type == ERROR ? DiagnosticPhase::LEXER : DiagnosticPhase::PARSER, g_token.lineNum, g_token.columnNum, "%s", message.c_str ());
 		}		
-};
\ No newline at end of file
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef REFERENCE_VISITOR_H
+#define REFERENCE_VISITOR_H
+
+#include <unordered_set>
+#include "../Parser/CMinusAst.h"
+
+// Collects the declarations that resolved variables, subscripts and
+// calls refer to.  Run after the SymbolTableVisitor.
+class ReferenceVisitor : public AstWalker
+{ 
+public:
+  virtual bool
+  enter (VariableExpressionNode* node)
+  {
+    references.insert (node->usingDecNode);
+    return true;
+  }
+
+  virtual bool
+  enter (SubscriptExpressionNode* node)
+  {
+    references.insert (node->usingDecNode);
+    return true;
+  }
+
+  virtual bool
+  enter (CallExpressionNode* node)
+  {
+    references.insert (node->usingDecNode);
+    return true;
+  }
+
+  std::unordered_set<DeclarationNode*> references;
+};
+
+#endif
@@ -1,47 +1,48 @@
+#ifndef SEMANTIC_ANALYSIS_VISITOR_H
+#define SEMANTIC_ANALYSIS_VISITOR_H
+
 #include <iostream>
 #include "../Parser/CMinusAst.h"
 #include "SymbolTable.h"
+#include "../Compiler/Diagnostic.h"
 
-class IVisitor;
 class SymbolTable;
 
-class SemanticAnalysisVisitor : public IVisitor
+class SemanticAnalysisVisitor : public AstWalker
 { 
 public:
 	SemanticAnalysisVisitor(SymbolTable* symTab)
-	: table (symTab), foundMain(false)
+	: table (symTab), foundMain(false), requireMain(true)
 	{ }
 
   virtual void
-  visit (ProgramNode* node)
+  leave (ProgramNode* node)
   {
-  	for (DeclarationNode* decNode : node->declarations)
-      decNode->accept (this);
-
-    if (!foundMain)
-    {
-      printf("\nERROR: \"main\" function was never declared\n\n");
-      exit(1);
-    }
+    finishProgram ();
   }
 
-  virtual void
-  visit (DeclarationNode* node)
+  // Checks made once every declaration has been visited
+  void
+  finishProgram ()
   {
+    if (requireMain && !foundMain)
+    {
+      raiseError(DiagnosticPhase::SEMANTIC, 0, 0, "\nERROR: \"main\" function was never declared\n\n");
+    }
   }
 
-  virtual void
-  visit (VariableDeclarationNode* node)
+  virtual bool
+  enter (VariableDeclarationNode* node)
   {
     if (node->valueType == ValueType::VOID)
     {
-      printf("\nERROR: Declared variable \"%s\" as void (Line: %d; Column %d)\n\n", node->identifier.c_str(), node->row, node->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Declared variable \"%s\" as void (Line: %d; Column %d)\n\n", node->identifier.c_str(), node->row, node->col);
     }
+    return true;
   }
 
-  virtual void
-  visit (FunctionDeclarationNode* node)
+  virtual bool
+  enter (FunctionDeclarationNode* node)
   {
     bool foundReturn = false;
     for (StatementNode* statement : node->functionBody->statements)
@@ -53,16 +54,16 @@ public:
       {
         if (node->valueType == ValueType::VOID && newStatement->expression != nullptr)
         {
-          printf("\nERROR: Returning a value from a void function (Line: %d, Column: %d)\n\n", newStatement->expression->row, newStatement->expression->col);
-          exit(1);
+          raiseError(DiagnosticPhase::SEMANTIC, newStatement->expression->row, newStatement->expression->col, "\nERROR: Returning a value from a void function (Line: %d, Column: %d)\n\n", newStatement->expression->row, newStatement->expression->col);
         }
         else if (node->valueType == ValueType::INT)
         {
           // Not returning an int value
-          if (newStatement->expression->valueType != node->valueType)
+          if (newStatement->expression == nullptr)
+            raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Returning a void value from a non-void function (Line: %d, Column: %d)\n\n", node->row, node->col);
+          else if (newStatement->expression->valueType != node->valueType)
           {
-            printf("\nERROR: Returning a void value from a non-void function (Line: %d, Column: %d)\n\n", newStatement->expression->row, newStatement->expression->col);
-            exit(1);
+            raiseError(DiagnosticPhase::SEMANTIC, newStatement->expression->row, newStatement->expression->col, "\nERROR: Returning a void value from a non-void function (Line: %d, Column: %d)\n\n", newStatement->expression->row, newStatement->expression->col);
           }
           // Returning an int value
           else
@@ -74,263 +75,199 @@ public:
     }
     if (node->valueType == ValueType::INT && !foundReturn)
     {
-      printf("\nERROR: Not returning a value from a non-void function (Line: %d, Column: %d)\n\n", node->row, node->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Not returning a value from a non-void function (Line: %d, Column: %d)\n\n", node->row, node->col);
     }
     if (foundMain)
     {
-      printf ("\nERROR: \"main\" function was not declared last\n\n");
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, 0, 0, "\nERROR: \"main\" function was not declared last\n\n");
     }
     if (node->identifier == "main")
     {
       foundMain = true;
     }
-    
-  	for (ParameterNode* parameter : node->parameters)
-      parameter->accept (this);
-
-    node->functionBody->accept(this);
+    return true;
   }
 
-  virtual void
-  visit (ArrayDeclarationNode* node)
+  virtual bool
+  enter (ArrayDeclarationNode* node)
   {
     if (node->valueType == ValueType::VOID)
     {
-      printf("\nERROR: Declared array variable \"%s\" as void (Line: %d; Column %d)\n\n", node->identifier.c_str(), node->row, node->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Declared array variable \"%s\" as void (Line: %d; Column %d)\n\n", node->identifier.c_str(), node->row, node->col);
     }
+    return true;
   }
 
-  virtual void
-  visit (ParameterNode* node)
+  virtual bool
+  enter (ParameterNode* node)
   {
     if (node->valueType == ValueType::VOID)
     {
-      printf("\nERROR: Declared parameter \"%s\" as void (Line: %d; Column %d)\n\n", node->identifier.c_str(), node->row, node->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Declared parameter \"%s\" as void (Line: %d; Column %d)\n\n", node->identifier.c_str(), node->row, node->col);
     }
+    return true;
   }
 
-  virtual void
-  visit (StatementNode* node)
-  {
-  }
-
-  virtual void
-  visit (CompoundStatementNode* node)
-  {
-  	for (VariableDeclarationNode* varDec : node->localDeclarations)
-  	  varDec->accept (this);
-
-  	for (StatementNode* statement : node->statements)
-  	  statement->accept (this);
-  }
-
-  virtual void
-  visit (IfStatementNode* node)
-  {
-  	node->conditionalExpression->accept (this);
-
-  	node->thenStatement->accept (this);
-
-  	if (node->elseStatement != nullptr)
-  		node->elseStatement->accept (this);
-  }
-
-  virtual void
-  visit (WhileStatementNode* node)
-  {
-  	node->conditionalExpression->accept (this);
-
-  	node->body->accept (this);
-  }
-
-  virtual void
-  visit (ForStatementNode* node)
-  {
-  }
-
-  virtual void
-  visit (ReturnStatementNode* node)
-  {
-  	if (node->expression != nullptr)
-      node->expression->accept (this);
-  }
-
-  virtual void
-  visit (ExpressionStatementNode* node)
-  {
-  	if (node->expression != nullptr)
-      node->expression->accept (this);
-  }
-
-  virtual void
-  visit (ExpressionNode* node)
-  {
-  }
-
-  virtual void
-  visit (AssignmentExpressionNode* node)
+  virtual bool
+  enter (AssignmentExpressionNode* node)
   {
     DeclarationNode* useNode = node->variable->usingDecNode;
 
     // Declaration is an array, but the use is not subscripting
-    if (useNode->dataType == DataType::ARRAY && node->variable->dataType != DataType::ARRAY)
+    if (isArrayDeclaration (useNode) && node->variable->dataType != DataType::ARRAY)
     {
-      printf("\nERROR: Assigning a value to \"%s\" with no subscript (Line: %d; Column: %d)\n", useNode->identifier.c_str(), node->variable->row, node->variable->col);
-      printf("       - Variable declared back on (Line %d; Column: %d)\n\n", useNode->row, useNode->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->variable->row, node->variable->col,
+                 "\nERROR: Assigning a value to \"%s\" with no subscript (Line: %d; Column: %d)\n"
+                 "       - Variable declared back on (Line %d; Column: %d)\n\n",
+                 useNode->identifier.c_str(), node->variable->row, node->variable->col, useNode->row, useNode->col);
     }
     // Assigning to a function name
     else if (useNode->dataType == DataType::FUNCTION)
     {
-      printf("\nERROR: Assigning a value to the function \"%s\" (Line: %d; Column: %d)\n", useNode->identifier.c_str(), node->variable->row, node->variable->col);
-      printf("       - Variable declared back on (Line %d; Column: %d)\n\n", useNode->row, useNode->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->variable->row, node->variable->col,
+                 "\nERROR: Assigning a value to the function \"%s\" (Line: %d; Column: %d)\n"
+                 "       - Variable declared back on (Line %d; Column: %d)\n\n",
+                 useNode->identifier.c_str(), node->variable->row, node->variable->col, useNode->row, useNode->col);
     }
-    
-  	if (node->variable != nullptr)
-      node->variable->accept (this);
-    
-    // Adds right side of assignment
-    if (node->expression != nullptr)
-      node->expression->accept (this); 
+    // Storing an array or the result of a void function
+    else if (node->expression->valueType != ValueType::INT)
+    {
+      raiseError(DiagnosticPhase::SEMANTIC, node->expression->row, node->expression->col,
+                 "\nERROR: Assigning a non-integer value to \"%s\" (Line: %d; Column: %d)\n\n",
+                 useNode->identifier.c_str(), node->expression->row, node->expression->col);
+    }
+    return true;
   }
 
-  virtual void
-  visit (VariableExpressionNode* node)
+  virtual bool
+  enter (SubscriptExpressionNode* node)
   {
-    
+    if (!isArrayDeclaration (node->usingDecNode))
+    {
+      raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Subscripting \"%s\", which is not an array (Line: %d; Column: %d)\n\n", node->identifier.c_str(), node->row, node->col);
+    }
+    if (node->index == nullptr || node->index->valueType != ValueType::INT)
+    {
+      raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Subscripting \"%s\" with a non-integer index (Line: %d; Column: %d)\n\n", node->identifier.c_str(), node->row, node->col);
+    }
+    return true;
   }
 
-  virtual void
-  visit (SubscriptExpressionNode* node)
+  virtual bool
+  enter (IfStatementNode* node)
   {
-  	if (node->index != nullptr)
-    {
-      if (node->usingDecNode->dataType != DataType::ARRAY)
-      {
-        printf("\nERROR: Subscripting \"%s\", which is not an array (Line: %d; Column: %d)\n\n", node->identifier.c_str(), node->row, node->col);
-        exit(1);
-      }
-      node->index->accept (this);
-    }
+    checkCondition (node->conditionalExpression);
+    return true;
   }
 
-  virtual void
-  visit (CallExpressionNode* node)
+  virtual bool
+  enter (WhileStatementNode* node)
+  {
+    checkCondition (node->conditionalExpression);
+    return true;
+  }
+
+  virtual bool
+  enter (CallExpressionNode* node)
   {
     if (node->identifier == "output" || node->identifier == "input")
     {
       if (node->arguments.size() != 1)
       {
-        printf("\nERROR: More than one parameter for input/output (Line: %d; Column: %d)\n\n", node->row, node->col);
-        exit(1);
+        raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: More than one parameter for input/output (Line: %d; Column: %d)\n\n", node->row, node->col);
+      }
+      // input reads into its argument, output writes it
+      VariableExpressionNode* target = dynamic_cast<VariableExpressionNode*>(node->arguments[0]);
+      if (node->identifier == "input" && (target == nullptr || target->valueType != ValueType::INT
+                                           || target->usingDecNode->dataType == DataType::FUNCTION))
+      {
+        raiseError(DiagnosticPhase::SEMANTIC, node->arguments[0]->row, node->arguments[0]->col, "\nERROR: Reading input into something other than an integer variable (Line: %d; Column: %d)\n\n", node->arguments[0]->row, node->arguments[0]->col);
+      }
+      else if (node->arguments[0]->valueType != ValueType::INT)
+      {
+        raiseError(DiagnosticPhase::SEMANTIC, node->arguments[0]->row, node->arguments[0]->col, "\nERROR: Writing a non-integer value with output (Line: %d; Column: %d)\n\n", node->arguments[0]->row, node->arguments[0]->col);
       }
     }
     else
     {
       if (node->usingDecNode->dataType != DataType::FUNCTION)
       {
-        printf ("\nERROR: \"%s\" is not a function (Line: %d; Column: %d)\n\n", node->identifier.c_str(), node->row, node->col);
-        exit(1);
+        raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: \"%s\" is not a function (Line: %d; Column: %d)\n\n", node->identifier.c_str(), node->row, node->col);
       }
       FunctionDeclarationNode* DecNode = dynamic_cast<FunctionDeclarationNode*>(node->usingDecNode);
       
       if (node->arguments.size() != DecNode->parameters.size())
       {
-        printf("\nERROR: Number of parameters does not match the number of arguments from the declaration (Line: %d; Column: %d)\n\n", node->row, node->col);
-        exit(1);
+        raiseError(DiagnosticPhase::SEMANTIC, node->row, node->col, "\nERROR: Number of parameters does not match the number of arguments from the declaration (Line: %d; Column: %d)\n\n", node->row, node->col);
       }
       
+      // Array parameters take whole arrays
       for (size_t n = 0; n < node->arguments.size(); ++n)
-        if (node->arguments[n]->valueType != DecNode->parameters[n]->valueType)
+        if (node->arguments[n]->valueType != (DecNode->parameters[n]->isArray ? ValueType::ARRAY : DecNode->parameters[n]->valueType))
         {
-          printf("\nERROR: Parameter\'s type does not match the argument type (Line: %d; Column: %d)\n\n", node->arguments[n]->row, node->arguments[n]->col);
-          exit(1);
+          raiseError(DiagnosticPhase::SEMANTIC, node->arguments[n]->row, node->arguments[n]->col, "\nERROR: Parameter\'s type does not match the argument type (Line: %d; Column: %d)\n\n", node->arguments[n]->row, node->arguments[n]->col);
         }
     }
-    
-    
-  	if (!node->arguments.empty ())
-      for (ExpressionNode* arg : node->arguments)
-      {
-          arg->accept (this);
-      }
+    return true;
   }
 
-  virtual void
-  visit (AdditiveExpressionNode* node)
+  virtual bool
+  enter (AdditiveExpressionNode* node)
   {
     if (node->left->valueType != ValueType::INT)
     {
-      printf("\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->left->row, node->left->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->left->row, node->left->col, "\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->left->row, node->left->col);
     }
     else if (node->right->valueType != ValueType::INT)
     {
-      printf("\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->right->row, node->right->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->right->row, node->right->col, "\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->right->row, node->right->col);
     }
 
-  	if (node->left != nullptr)
-      node->left->accept (this);
-    if (node->right != nullptr)
-      node->right->accept (this);
+    return true;
   }
 
-  virtual void
-  visit (MultiplicativeExpressionNode* node)
+  virtual bool
+  enter (MultiplicativeExpressionNode* node)
   {
     if (node->left->valueType != ValueType::INT)
     {
-      printf("\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->left->row, node->left->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->left->row, node->left->col, "\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->left->row, node->left->col);
     }
     else if (node->right->valueType != ValueType::INT)
     {
-      printf("\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->right->row, node->right->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->right->row, node->right->col, "\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->right->row, node->right->col);
     }
-    
-  	if (node->left != nullptr)
-      node->left->accept (this);
-    if (node->right != nullptr)
-      node->right->accept (this);
+    return true;
   }
 
-  virtual void
-  visit (RelationalExpressionNode* node)
+  virtual bool
+  enter (RelationalExpressionNode* node)
   {
     if (node->left->valueType != ValueType::INT)
     {
-      printf("\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->left->row, node->left->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->left->row, node->left->col, "\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->left->row, node->left->col);
     }
     else if (node->right->valueType != ValueType::INT)
     {
-      printf("\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->right->row, node->right->col);
-      exit(1);
+      raiseError(DiagnosticPhase::SEMANTIC, node->right->row, node->right->col, "\nERROR: An operator is being applied to a non-integer type (Line: %d; Column: %d)\n", node->right->row, node->right->col);
     }
-    
-  	if (node->left != nullptr)
-      node->left->accept (this);
-    if (node->right != nullptr)
-      node->right->accept (this);
-  }
-
-  virtual void
-  visit (UnaryExpressionNode* node)
-  {
+    return true;
   }
 
-  virtual void
-  visit (IntegerLiteralExpressionNode* node)
+  // Conditions of if and while statements must be integers
+  void
+  checkCondition (ExpressionNode* condition)
   {
+    if (condition->valueType != ValueType::INT)
+    {
+      raiseError(DiagnosticPhase::SEMANTIC, condition->row, condition->col, "\nERROR: Condition is not an integer (Line: %d; Column: %d)\n\n", condition->row, condition->col);
+    }
   }
 
   SymbolTable* table;
   bool foundMain;
+  // Off for modules other than the last one of a program
+  bool requireMain;
 };
+
+#endif
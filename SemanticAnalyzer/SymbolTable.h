@@ -7,6 +7,7 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <functional>
 // For unique_ptr
 #include <memory>
 
@@ -14,6 +15,7 @@
 // Local Includes
 
 #include "../Parser/CMinusAst.h"
+#include "../Compiler/Diagnostic.h"
 
 /********************************************************************/
 // Using Declarations
@@ -22,93 +24,128 @@ using ScopeTable = std::unordered_map<std::string, DeclarationNode*>;
 
 /********************************************************************/
 
+// Whether declaration names an array: a declared array or an array
+// parameter
+inline bool
+isArrayDeclaration (const DeclarationNode* declaration)
+{
+  const ParameterNode* parameter = dynamic_cast<const ParameterNode*> (declaration);
+  return declaration->dataType == DataType::ARRAY || (parameter != nullptr && parameter->isArray);
+}
+
+/********************************************************************/
+
 class SymbolTable 
 {
 public:
 
   SymbolTable (ProgramNode* pAstTree)
-  : astTree(pAstTree), m_nestLevel(-1)
+  : astTree(pAstTree), m_nestLevel(-1), m_scopeCount(0),
+    m_input (ValueType::VOID, std::string("input"), DataType::FUNCTION, 0, 0),
+    m_output (ValueType::VOID, std::string("output"), DataType::FUNCTION, 0, 0)
+  {
+    reset (pAstTree);
+  } 
+
+  // Start over with only the global scope and the input and output
+  // functions.  Scope tables are cleared rather than freed, so their
+  // buckets are reused by the next tree.
+  void
+  reset (ProgramNode* pAstTree)
   {
-    m_nestLevel = -1;
+    astTree = pAstTree;
+    m_outerLookup = nullptr;
+    while (m_nestLevel >= 0)
+      exitScope ();
     enterScope();
   
     // Add input and output functions
-    DeclarationNode* input = new DeclarationNode(ValueType::VOID, std::string("input"), DataType::FUNCTION, 0, 0);
-    DeclarationNode* output = new DeclarationNode(ValueType::VOID, std::string("output"), DataType::FUNCTION, 0, 0);
-    insert(input);
-    insert(output);
-  } 
+    insert(&m_input);
+    insert(&m_output);
+  }
  
   // Adjust the nest level; add a new scope table
   void
   enterScope ()
   {
     ++m_nestLevel;
-    ScopeTable entryTable;
-    std::unique_ptr<ScopeTable> entry (new ScopeTable(entryTable));
-    m_table.push_back(std::move(entry));
+    if (m_scopeCount == m_table.size())
+      m_table.push_back(std::unique_ptr<ScopeTable> (new ScopeTable()));
+    ++m_scopeCount;
   }
 
   // Adjust the nest level; remove most recent scope table
   void
   exitScope ()
   {
-    m_table.pop_back();
+    --m_scopeCount;
+    for (const auto& entry : *m_table[m_scopeCount])
+      m_visible[entry.first].pop_back();
+    m_table[m_scopeCount]->clear();
     --m_nestLevel;
   }
 
   // Add a (name, declarationPtr) entry to table
   // If successful set nest level in *declarationPtr
-  // Return true if successful, false o/w
+  // Return true if successful, raise an error o/w
   bool 
   insert (DeclarationNode* declarationPtr)
   {
-    ScopeTable table = *(std::move(m_table.back()));
+    ScopeTable& table = *m_table[m_scopeCount-1];
 
     // Declaration is not in the table yet
-    if (table.find(declarationPtr->identifier) == table.end())
+    if (table.emplace(declarationPtr->identifier, declarationPtr).second)
     { 
-      std::pair<std::string, DeclarationNode*> decl (declarationPtr->identifier, declarationPtr);
-      table.insert(decl); 
-      m_table.back().reset(new ScopeTable (table));
-
       declarationPtr->nestLevel = m_nestLevel;
+      m_visible[declarationPtr->identifier].push_back(declarationPtr);
       
       return true;
     }
     else
     {
-      printf("\nERROR: Multiply-declared variable %s (Line: %d; Column: %d)\n\n", declarationPtr->identifier.c_str(), declarationPtr->row, declarationPtr->col);
-      exit(1);
-      return false;
+      raiseError(DiagnosticPhase::SEMANTIC, declarationPtr->row, declarationPtr->col, "\nERROR: Multiply-declared variable %s (Line: %d; Column: %d)\n\n", declarationPtr->identifier.c_str(), declarationPtr->row, declarationPtr->col);
     }
   }
   
+  // Puts declarationPtr in place of the declaration of the same name in
+  // the current scope, which must already be there
+  void
+  replace (DeclarationNode* declarationPtr)
+  {
+    (*m_table[m_scopeCount-1])[declarationPtr->identifier] = declarationPtr;
+    m_visible[declarationPtr->identifier].back() = declarationPtr;
+    declarationPtr->nestLevel = m_nestLevel;
+  }
+
+  // Names that are in none of the scopes are then looked up with
+  // outerLookup, which returns nullptr for a name it does not know.
+  // Lets a caller supply global declarations without inserting them
+  // all.  Cleared by reset.
+  void
+  setOuterLookup (std::function<DeclarationNode* (const std::string&)> outerLookup)
+  {
+    m_outerLookup = outerLookup;
+  }
+
   // Lookup a name corresponding to a Use node
   // Return corresponding declaration pointer on success,
-  //   nullptr o/w
+  //   raise an error o/w
   DeclarationNode* 
   lookup (const std::string& name, int row, int col)
   {
-    ScopeTable table = *(std::move(m_table[m_table.size()-1]));
-    ScopeTable::iterator lookupNode = table.find(name);
-
-    // Check if name is in any of the tables
-    for (int itr = m_table.size()-2; lookupNode == table.end() && itr >= 0; --itr)
+    // Check if name is in any of the tables; the innermost declaration
+    // is on top of its stack
+    auto visible = m_visible.find(name);
+    if (visible != m_visible.end() && !visible->second.empty())
+      return visible->second.back();
+    if (m_outerLookup)
     {
-      table = *(std::move(m_table[itr]));
-      lookupNode = table.find(name);
+      DeclarationNode* outer = m_outerLookup(name);
+      if (outer != nullptr)
+        return outer;
     }
     
-    if (lookupNode == table.end())
-    {
-      printf("\nERROR: Undeclared variable %s (Line: %d; Column: %d)\n\n", name.c_str(), row, col);
-      exit(1);
-    }
-    else
-    {
-      return lookupNode->second;
-    }
+    raiseError(DiagnosticPhase::SEMANTIC, row, col, "\nERROR: Undeclared variable %s (Line: %d; Column: %d)\n\n", name.c_str(), row, col);
   }
 
   int
@@ -129,9 +166,21 @@ private:
   // Current nest level; 0 is global
   int  m_nestLevel;
 
-  // The symbol table is a vector of scope tables
+  // The symbol table is a vector of scope tables.  Only the first
+  // m_scopeCount are in use; the rest are kept for reuse.
   std::vector<std::unique_ptr<ScopeTable>> m_table;
+  size_t m_scopeCount;
+
+  // For each name, its declarations in the scopes in use, outermost
+  // first, so a lookup does not search every scope
+  std::unordered_map<std::string, std::vector<DeclarationNode*>> m_visible;
+
+  // Built-in functions
+  DeclarationNode m_input;
+  DeclarationNode m_output;
 
+  // See setOuterLookup
+  std::function<DeclarationNode* (const std::string&)> m_outerLookup;
 };
 
 #endif
@@ -1,207 +1,109 @@
+#ifndef SYMBOL_TABLE_VISITOR_H
+#define SYMBOL_TABLE_VISITOR_H
+
 #include <iostream>
 #include "../Parser/CMinusAst.h"
 #include "SymbolTable.h"
 
-class IVisitor;
 class SymbolTable;
 
-class SymbolTableVisitor : public IVisitor
+class SymbolTableVisitor : public AstWalker
 { 
 public:
-	SymbolTableVisitor(SymbolTable* symTab)
-	: table (symTab)
-	{ }
+  // If and while bodies each get a scope of their own
+  SymbolTableVisitor(SymbolTable* symTab)
+    : AstWalker ({ ChildSlot::THEN, ChildSlot::ELSE, ChildSlot::BODY }), table (symTab)
+  { }
 
-  virtual void
-  visit (ProgramNode* node)
+  virtual bool
+  enter (VariableDeclarationNode* node)
   {
-  	for (DeclarationNode* decNode : node->declarations)
-      decNode->accept (this);
+    table->insert(node);
+    return true;
   }
 
-  virtual void
-  visit (DeclarationNode* node)
+  virtual bool
+  enter (FunctionDeclarationNode* node)
   {
-  }
+    table->insert(node);
 
-  virtual void
-  visit (VariableDeclarationNode* node)
-  {
-	table->insert(node);
+    table->enterScope();
+    return true;
   }
 
   virtual void
-  visit (FunctionDeclarationNode* node)
+  leave (FunctionDeclarationNode* node)
   {
-  	table->insert(node);
-
-  	table->enterScope();
-  	for (ParameterNode* parameter : node->parameters)
-      parameter->accept (this);
-
-    node->functionBody->accept(this);
     table->exitScope();
   }
 
-  virtual void
-  visit (ArrayDeclarationNode* node)
-  {
-  	table->insert(node);
-  }
-
-  virtual void
-  visit (ParameterNode* node)
-  {
-  	table->insert(node);
-  }
-
-  virtual void
-  visit (StatementNode* node)
-  {
-  }
-
-  virtual void
-  visit (CompoundStatementNode* node)
-  {
-  	for (VariableDeclarationNode* varDec : node->localDeclarations)
-  	  varDec->accept (this);
-
-  	for (StatementNode* statement : node->statements)
-  	  statement->accept (this);
-  }
-
-  virtual void
-  visit (IfStatementNode* node)
-  {
-  	node->conditionalExpression->accept (this);
-
-  	table->enterScope ();
-  	node->thenStatement->accept (this);
-  	table->exitScope ();
-
-  	if (node->elseStatement != nullptr)
-  	{
-  		table->enterScope ();
-  		node->elseStatement->accept (this);
-  		table->exitScope ();
-  	}
-  }
-
-  virtual void
-  visit (WhileStatementNode* node)
-  {
-  	node->conditionalExpression->accept (this);
-
-  	table->enterScope ();
-  	node->body->accept (this);
-  	table->exitScope ();
-  }
-
-  virtual void
-  visit (ForStatementNode* node)
-  {
-  }
-
-  virtual void
-  visit (ReturnStatementNode* node)
+  virtual bool
+  enter (ArrayDeclarationNode* node)
   {
-  	if (node->expression != nullptr)
-      node->expression->accept (this);
+    table->insert(node);
+    return true;
   }
 
-  virtual void
-  visit (ExpressionStatementNode* node)
+  virtual bool
+  enter (ParameterNode* node)
   {
-  	if (node->expression != nullptr)
-      node->expression->accept (this);
+    table->insert(node);
+    return true;
   }
 
   virtual void
-  visit (ExpressionNode* node)
+  enterChild (Node* parent, ChildSlot slot)
   {
+    table->enterScope ();
   }
 
   virtual void
-  visit (AssignmentExpressionNode* node)
+  leaveChild (Node* parent, ChildSlot slot)
   {
-  	if (node->variable != nullptr)
-      node->variable->accept (this);
-    
-    // Adds right side of assignment
-    if (node->expression != nullptr)
-      node->expression->accept (this);
+    table->exitScope ();
   }
 
-  virtual void
-  visit (VariableExpressionNode* node)
+  virtual bool
+  enter (VariableExpressionNode* node)
   {
-  	DeclarationNode* DecNode = table->lookup(node->identifier, node->row, node->col);
-  	node->usingDecNode = DecNode;
+    DeclarationNode* DecNode = table->lookup(node->identifier, node->row, node->col);
+    node->usingDecNode = DecNode;
     // Fix valueType (parser can't accurately know this
     // until it knows what the declaration variable is) 
     node->valueType = DecNode->valueType;
+    // An array named without a subscript is the whole array
+    if (isArrayDeclaration (DecNode))
+      node->valueType = ValueType::ARRAY;
+    return true;
   }
 
-  virtual void
-  visit (SubscriptExpressionNode* node)
+  virtual bool
+  enter (SubscriptExpressionNode* node)
   {
-  	DeclarationNode* DecNode = table->lookup(node->identifier, node->row, node->col);
+    DeclarationNode* DecNode = table->lookup(node->identifier, node->row, node->col);
     node->usingDecNode = DecNode;
     node->valueType = DecNode->valueType;
-  	if (node->index != nullptr)
-      node->index->accept (this);
-  }
-
-  virtual void
-  visit (CallExpressionNode* node)
-  {
-  	DeclarationNode* DecNode = table->lookup(node->identifier, node->row, node->col);
-  	node->usingDecNode = DecNode;
-    node->valueType = DecNode->valueType;
-  	if (!node->arguments.empty ())
-      for (ExpressionNode* arg : node->arguments)
-      { 
-        arg->accept (this);
-      }
+    return true;
   }
 
+  // An assignment's value is the one stored in its variable
   virtual void
-  visit (AdditiveExpressionNode* node)
+  leave (AssignmentExpressionNode* node)
   {
-  	if (node->left != nullptr)
-      node->left->accept (this);
-    if (node->right != nullptr)
-      node->right->accept (this);
+    node->valueType = node->variable->valueType;
   }
 
-  virtual void
-  visit (MultiplicativeExpressionNode* node)
-  {
-  	if (node->left != nullptr)
-      node->left->accept (this);
-    if (node->right != nullptr)
-      node->right->accept (this);
-  }
-
-  virtual void
-  visit (RelationalExpressionNode* node)
-  {
-  	if (node->left != nullptr)
-      node->left->accept (this);
-    if (node->right != nullptr)
-      node->right->accept (this);
-  }
-
-  virtual void
-  visit (UnaryExpressionNode* node)
-  {
-  }
-
-  virtual void
-  visit (IntegerLiteralExpressionNode* node)
+  virtual bool
+  enter (CallExpressionNode* node)
   {
+    DeclarationNode* DecNode = table->lookup(node->identifier, node->row, node->col);
+    node->usingDecNode = DecNode;
+    node->valueType = DecNode->valueType;
+    return true;
   }
 
   SymbolTable* table;
 
 };
+
+#endif
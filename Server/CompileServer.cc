@@ -0,0 +1,372 @@
+/*
+  Filename   : CompileServer.cc
+  Author     : Philip Androwick
+  Description: Socket handling, worker pool, result cache and statistics
+               of the compile server, and the client side of the protocol.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+/***********************************************************************/
+// Local includes
+
+#include "CompileServer.h"
+#include "Protocol.h"
+
+/***********************************************************************/
+
+// Number of results kept in the cache
+static const size_t CACHE_CAPACITY = 512;
+
+// Number of recent requests the latency percentiles cover
+static const size_t LATENCY_WINDOW = 8192;
+
+// Seconds a connection may wait on its client before it is closed
+static const int IDLE_TIMEOUT = 30;
+
+static volatile sig_atomic_t g_stopRequested = 0;
+
+static void
+requestStop (int)
+{
+  g_stopRequested = 1;
+}
+
+/***********************************************************************/
+
+CompileServer::CompileServer (const std::string& socketPath, unsigned workerCount)
+  : m_socketPath (socketPath), m_workerCount (workerCount > 0 ? workerCount : 1),
+    m_stopping (false), m_startTime (std::chrono::steady_clock::now ()),
+    m_requests (0), m_cacheHits (0), m_latencyNext (0)
+{
+}
+
+/***********************************************************************/
+
+bool
+CompileServer::run ()
+{
+  sockaddr_un address;
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  if (m_socketPath.size () >= sizeof (address.sun_path))
+  {
+    fprintf (stderr, "Socket path \"%s\" is too long\n", m_socketPath.c_str ());
+    return false;
+  }
+  strcpy (address.sun_path, m_socketPath.c_str ());
+  if (!removeStaleSocket (address))
+    return false;
+
+  int listenFd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (listenFd < 0 || bind (listenFd, (sockaddr*) &address, sizeof (address)) < 0
+      || listen (listenFd, 64) < 0)
+  {
+    perror ("CMinus --serve");
+    if (listenFd >= 0)
+      close (listenFd);
+    return false;
+  }
+
+  // A client hanging up mid-reply must not kill the server
+  signal (SIGPIPE, SIG_IGN);
+  signal (SIGINT, requestStop);
+  signal (SIGTERM, requestStop);
+
+  std::vector<std::thread> workers;
+  for (unsigned n = 0; n < m_workerCount; ++n)
+    workers.emplace_back (&CompileServer::workerLoop, this);
+
+  printf ("Serving on \"%s\" with %u workers\n", m_socketPath.c_str (), m_workerCount);
+  fflush (stdout);
+
+  while (!g_stopRequested)
+  {
+    pollfd listening = { listenFd, POLLIN, 0 };
+    if (poll (&listening, 1, 200) <= 0)
+      continue;
+
+    int fd = accept (listenFd, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+
+    std::lock_guard<std::mutex> lock (m_queueMutex);
+    m_pending.push_back (fd);
+    m_queueReady.notify_one ();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock (m_queueMutex);
+    m_stopping = true;
+  }
+  m_queueReady.notify_all ();
+  for (std::thread& worker : workers)
+    worker.join ();
+
+  close (listenFd);
+  unlink (m_socketPath.c_str ());
+  return true;
+}
+
+/***********************************************************************/
+
+bool
+CompileServer::removeStaleSocket (const sockaddr_un& address)
+{
+  struct stat status;
+  if (lstat (m_socketPath.c_str (), &status) < 0)
+  {
+    if (errno == ENOENT)
+      return true;
+    perror ("CMinus --serve");
+    return false;
+  }
+  if (!S_ISSOCK (status.st_mode))
+  {
+    fprintf (stderr, "\"%s\" exists and is not a socket\n", m_socketPath.c_str ());
+    return false;
+  }
+
+  // Only a socket nobody is listening on is left over from a server
+  //   that did not shut down
+  int probeFd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (probeFd < 0)
+  {
+    perror ("CMinus --serve");
+    return false;
+  }
+  bool refused = connect (probeFd, (const sockaddr*) &address, sizeof (address)) < 0 && errno == ECONNREFUSED;
+  close (probeFd);
+  if (!refused)
+  {
+    fprintf (stderr, "A server is already serving on \"%s\"\n", m_socketPath.c_str ());
+    return false;
+  }
+  if (unlink (m_socketPath.c_str ()) < 0)
+  {
+    perror ("CMinus --serve");
+    return false;
+  }
+  return true;
+}
+
+/***********************************************************************/
+
+void
+CompileServer::workerLoop ()
+{
+  // Kept for the life of the worker so its storage stays warm
+  CompilerContext context;
+
+  while (true)
+  {
+    int fd;
+    {
+      std::unique_lock<std::mutex> lock (m_queueMutex);
+      m_queueReady.wait (lock, [this] { return m_stopping || !m_pending.empty (); });
+      if (m_pending.empty ())
+        return;
+      fd = m_pending.front ();
+      m_pending.pop_front ();
+    }
+
+    serveConnection (fd, context);
+    close (fd);
+  }
+}
+
+/***********************************************************************/
+
+void
+CompileServer::serveConnection (int fd, CompilerContext& context)
+{
+  // A client that stops reading or writing would otherwise hold the
+  //   worker forever
+  timeval timeout = { IDLE_TIMEOUT, 0 };
+  setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+  setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof (timeout));
+
+  MessageType type;
+  std::string payload;
+  while (receiveMessage (fd, type, payload))
+  {
+    if (type == MessageType::COMPILE)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      std::string reply;
+      bool cacheHit = findCached (payload, reply);
+      if (!cacheHit)
+      {
+        CompileResult result = context.compile (payload);
+        reply = encodeResult (result);
+        addCached (payload, reply);
+        context.reset ();
+      }
+      recordRequest (start, cacheHit);
+
+      if (!sendMessage (fd, MessageType::RESULT, reply))
+        return;
+    }
+    else if (type == MessageType::STATS)
+    {
+      if (!sendMessage (fd, MessageType::STATS_RESULT, statsReport ()))
+        return;
+    }
+    else
+    {
+      // Unknown request; the stream can no longer be trusted
+      return;
+    }
+  }
+}
+
+/***********************************************************************/
+
+bool
+CompileServer::findCached (const std::string& source, std::string& payload)
+{
+  std::lock_guard<std::mutex> lock (m_cacheMutex);
+  auto entry = m_cache.find (source);
+  if (entry == m_cache.end ())
+    return false;
+  payload = entry->second;
+  return true;
+}
+
+void
+CompileServer::addCached (const std::string& source, const std::string& payload)
+{
+  std::lock_guard<std::mutex> lock (m_cacheMutex);
+  if (!m_cache.emplace (source, payload).second)
+    return;
+
+  m_cacheOrder.push_back (source);
+  if (m_cacheOrder.size () > CACHE_CAPACITY)
+  {
+    m_cache.erase (m_cacheOrder.front ());
+    m_cacheOrder.pop_front ();
+  }
+}
+
+/***********************************************************************/
+
+void
+CompileServer::recordRequest (std::chrono::steady_clock::time_point start, bool cacheHit)
+{
+  std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now () - start;
+  uint32_t micros = (uint32_t) std::chrono::duration_cast<std::chrono::microseconds> (elapsed).count ();
+
+  std::lock_guard<std::mutex> lock (m_statsMutex);
+  ++m_requests;
+  if (cacheHit)
+    ++m_cacheHits;
+  if (m_latencies.size () < LATENCY_WINDOW)
+    m_latencies.push_back (micros);
+  else
+    m_latencies[m_latencyNext] = micros;
+  m_latencyNext = (m_latencyNext + 1) % LATENCY_WINDOW;
+}
+
+std::string
+CompileServer::statsReport ()
+{
+  std::vector<uint32_t> latencies;
+  uint64_t requests, cacheHits;
+  double seconds;
+  {
+    std::lock_guard<std::mutex> lock (m_statsMutex);
+    latencies = m_latencies;
+    requests = m_requests;
+    cacheHits = m_cacheHits;
+    seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - m_startTime).count ();
+  }
+
+  uint32_t p50 = 0, p99 = 0;
+  if (!latencies.empty ())
+  {
+    std::sort (latencies.begin (), latencies.end ());
+    p50 = latencies[(latencies.size () - 1) * 50 / 100];
+    p99 = latencies[(latencies.size () - 1) * 99 / 100];
+  }
+
+  char report[512];
+  snprintf (report, sizeof (report),
+            "requests:        %llu\n"
+            "requests/sec:    %.2f\n"
+            "p50 latency:     %u us\n"
+            "p99 latency:     %u us\n"
+            "cache hits:      %llu\n"
+            "workers:         %u\n",
+            (unsigned long long) requests, seconds > 0 ? requests / seconds : 0.0,
+            p50, p99, (unsigned long long) cacheHits, m_workerCount);
+  return report;
+}
+
+/***********************************************************************/
+// Client side
+
+static int
+connectToServer (const std::string& socketPath)
+{
+  sockaddr_un address;
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.size () >= sizeof (address.sun_path))
+    return -1;
+  strcpy (address.sun_path, socketPath.c_str ());
+
+  int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 && connect (fd, (sockaddr*) &address, sizeof (address)) < 0)
+  {
+    close (fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool
+compileRemote (const std::string& socketPath, const std::string& source,
+               CompileResult& result)
+{
+  int fd = connectToServer (socketPath);
+  if (fd < 0)
+    return false;
+
+  MessageType type;
+  std::string payload;
+  bool ok = sendMessage (fd, MessageType::COMPILE, source)
+    && receiveMessage (fd, type, payload)
+    && type == MessageType::RESULT
+    && decodeResult (payload, result);
+  close (fd);
+  return ok;
+}
+
+bool
+fetchServerStats (const std::string& socketPath, std::string& report)
+{
+  int fd = connectToServer (socketPath);
+  if (fd < 0)
+    return false;
+
+  MessageType type;
+  bool ok = sendMessage (fd, MessageType::STATS, "")
+    && receiveMessage (fd, type, report)
+    && type == MessageType::STATS_RESULT;
+  close (fd);
+  return ok;
+}
@@ -0,0 +1,112 @@
+/*
+  Filename   : CompileServer.h
+  Author     : Philip Androwick
+  Description: Persistent compile server (CMinus --serve).  Connections on
+               a Unix domain socket are handed to a pool of workers, each of
+               which keeps its own warm CompilerContext.  Results of recent
+               compilations are cached by source text.
+*/
+
+/***********************************************************************/
+
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+/***********************************************************************/
+// System includes
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sys/un.h>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Compiler/CompilerContext.h"
+
+/***********************************************************************/
+
+class CompileServer
+{
+public:
+  CompileServer (const std::string& socketPath, unsigned workerCount);
+
+  // Accepts connections until SIGINT or SIGTERM.  Returns false if the
+  //   socket could not be set up.
+  bool
+  run ();
+
+private:
+  // Removes a socket left at the socket path by a server that is gone.
+  //   Returns false, having said why, if something else is there.
+  bool
+  removeStaleSocket (const sockaddr_un& address);
+
+  void
+  workerLoop ();
+
+  // Serves requests on fd until the client hangs up, sends something
+  //   unexpected or is idle for too long
+  void
+  serveConnection (int fd, CompilerContext& context);
+
+  // Looks up source in the cache; returns true and sets payload on a hit
+  bool
+  findCached (const std::string& source, std::string& payload);
+
+  void
+  addCached (const std::string& source, const std::string& payload);
+
+  void
+  recordRequest (std::chrono::steady_clock::time_point start, bool cacheHit);
+
+  std::string
+  statsReport ();
+
+private:
+  std::string m_socketPath;
+  unsigned    m_workerCount;
+
+  // Accepted connections waiting for a worker
+  std::mutex              m_queueMutex;
+  std::condition_variable m_queueReady;
+  std::deque<int>         m_pending;
+  bool                    m_stopping;
+
+  // Compiled results keyed by source text; the oldest entry is evicted
+  //   first once the cache is full
+  std::mutex                                   m_cacheMutex;
+  std::unordered_map<std::string, std::string> m_cache;
+  std::deque<std::string>                      m_cacheOrder;
+
+  // Request statistics; latencies of the most recent requests are kept
+  //   in a ring for the percentiles
+  std::mutex                            m_statsMutex;
+  std::chrono::steady_clock::time_point m_startTime;
+  uint64_t                              m_requests;
+  uint64_t                              m_cacheHits;
+  std::vector<uint32_t>                 m_latencies;
+  size_t                                m_latencyNext;
+};
+
+/***********************************************************************/
+
+// Sends the source to the server at socketPath and fills in result.
+// Returns false if the server could not be reached.
+bool
+compileRemote (const std::string& socketPath, const std::string& source,
+               CompileResult& result);
+
+// Fetches the server's statistics report
+bool
+fetchServerStats (const std::string& socketPath, std::string& report);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,122 @@
+/*
+  Filename   : Protocol.cc
+  Author     : Philip Androwick
+  Description: Framing and encoding of compile server messages.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cerrno>
+#include <unistd.h>
+
+/***********************************************************************/
+// Local includes
+
+#include "Protocol.h"
+#include "../Compiler/BinaryIO.h"
+
+/***********************************************************************/
+
+static bool
+writeAll (int fd, const char* data, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t written = write (fd, data, length);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    data += written;
+    length -= written;
+  }
+  return true;
+}
+
+static bool
+readAll (int fd, char* data, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t count = read (fd, data, length);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    data += count;
+    length -= count;
+  }
+  return true;
+}
+
+/***********************************************************************/
+
+bool
+sendMessage (int fd, MessageType type, const std::string& payload)
+{
+  uint32_t header[2] = { (uint32_t) type, (uint32_t) payload.size () };
+  return writeAll (fd, (const char*) header, sizeof (header))
+    && writeAll (fd, payload.data (), payload.size ());
+}
+
+bool
+receiveMessage (int fd, MessageType& type, std::string& payload)
+{
+  uint32_t header[2];
+  if (!readAll (fd, (char*) header, sizeof (header)) || header[1] > MAX_PAYLOAD)
+    return false;
+
+  type = (MessageType) header[0];
+  payload.resize (header[1]);
+  return readAll (fd, &payload[0], header[1]);
+}
+
+/***********************************************************************/
+// Results are a sequence of 32-bit words and length-prefixed strings:
+//   success, ast, diagnostic count, then phase, line, column and
+//   message for each diagnostic
+
+std::string
+encodeResult (const CompileResult& result)
+{
+  std::string out;
+  putWord (out, result.success);
+  putString (out, result.ast);
+  putWord (out, result.diagnostics.size ());
+  for (const Diagnostic& diagnostic : result.diagnostics)
+  {
+    putWord (out, (uint32_t) diagnostic.phase);
+    putWord (out, diagnostic.lineNum);
+    putWord (out, diagnostic.columnNum);
+    putString (out, diagnostic.message);
+  }
+  return out;
+}
+
+bool
+decodeResult (const std::string& payload, CompileResult& result)
+{
+  size_t offset = 0;
+  uint32_t success, count;
+  if (!getWord (payload, offset, success) || !getString (payload, offset, result.ast)
+      || !getWord (payload, offset, count))
+    return false;
+
+  result.success = success != 0;
+  result.program = nullptr;
+  result.diagnostics.clear ();
+  for (uint32_t n = 0; n < count; ++n)
+  {
+    uint32_t phase, line, column;
+    Diagnostic diagnostic;
+    if (!getWord (payload, offset, phase) || !getWord (payload, offset, line)
+        || !getWord (payload, offset, column) || !getString (payload, offset, diagnostic.message))
+      return false;
+    diagnostic.phase = (DiagnosticPhase) phase;
+    diagnostic.lineNum = (int) line;
+    diagnostic.columnNum = (int) column;
+    result.diagnostics.push_back (diagnostic);
+  }
+  return offset == payload.size ();
+}
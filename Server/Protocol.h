@@ -0,0 +1,62 @@
+/*
+  Filename   : Protocol.h
+  Author     : Philip Androwick
+  Description: Wire format spoken over the compile server's Unix domain
+               socket.  Every message is a header of two 32-bit words, the
+               message type and the payload length, followed by the payload.
+*/
+
+/***********************************************************************/
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************************/
+// Local includes
+
+#include "../Compiler/CompilerContext.h"
+
+/***********************************************************************/
+
+enum class MessageType : uint32_t
+{
+  // Client to server
+  COMPILE = 1, STATS = 2,
+
+  // Server to client
+  RESULT = 3, STATS_RESULT = 4
+};
+
+// Socket used when none is given on the command line
+const char* const DEFAULT_SOCKET_PATH = "/tmp/cminus.sock";
+
+// Largest payload either side will accept
+const uint32_t MAX_PAYLOAD = 256u * 1024 * 1024;
+
+/***********************************************************************/
+
+// Return false if the connection failed or was closed
+bool
+sendMessage (int fd, MessageType type, const std::string& payload);
+
+bool
+receiveMessage (int fd, MessageType& type, std::string& payload);
+
+// A RESULT payload: the AST text and the diagnostics of a compilation
+std::string
+encodeResult (const CompileResult& result);
+
+// Returns false if the payload is malformed.  The program of the
+//   decoded result is always nullptr.
+bool
+decodeResult (const std::string& payload, CompileResult& result);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,24 @@
+#!/bin/bash
+#
+# Filename   : backends.sh
+# Author     : Philip Androwick
+# Description: Runs each program in Tests/programs on its .in file with
+#              every backend that runs in process, with and without -O1,
+#              and reports each output that differs from the program's
+#              .out file.  Run from the repository root after make.
+#              Usage: Tests/backends.sh
+#
+
+MODES=("--run" "--jit" "--jit --stack-code" "-O1 --run" "-O1 --jit" "-O1 --jit --stack-code")
+
+failed=0
+for program in Tests/programs/*.cm; do
+  name=${program%.cm}
+  for mode in "${MODES[@]}"; do
+    if ! ./CMinus $mode "$program" < "$name.in" 2>&1 | cmp -s - "$name.out"; then
+      echo "$(basename "$name"): $mode differs from $(basename "$name").out"
+      failed=1
+    fi
+  done
+done
+exit $failed
@@ -0,0 +1,118 @@
+/*
+  Filename   : Bytecode.h
+  Author     : Philip Androwick
+  Description: Register bytecode run by the virtual machine
+               (VirtualMachine.h).  It is compiled from the IR in SSA
+               form: each value gets a register of its function's frame,
+               copies share their source's register, and phis become
+               moves at the ends of their predecessors.
+*/
+
+/***********************************************************************/
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "../IR/IR.h"
+
+/***********************************************************************/
+
+// An instruction is its opcode followed by its operands, each one
+//   32-bit word of BcProgram::code.  d, a, b and s are registers of
+//   the frame, k a constant and t the offset of a jump target.
+enum class BcOp : int32_t
+{
+  // d = k; d = s
+  LOADK, MOV,
+
+  // d = a op b; d = a op k (never dividing by 0 or -1)
+  ADD, SUB, MUL, DIV,
+  ADDK, SUBK, MULK, DIVK,
+
+  // d = a op b, 1 or 0
+  LT, LE, GT, GE, EQ, NE,
+
+  // Go to t; if s is 0; if s is not 0
+  JMP, JZ, JNZ,
+
+  // Go to t if a op b; if a op k
+  BLT, BLE, BGT, BGE, BEQ, BNE,
+  BLTK, BLEK, BGTK, BGEK, BEQK, BNEK,
+
+  // d = address of the frame's arrays + k; d = memory[k];
+  //   memory[k] = s
+  FRAMEADDR, LOADG, STOREG,
+
+  // d = memory[a + b]; memory[a + b] = s (operands a, b, s)
+  LOAD, STORE,
+
+  // Call function k with the n registers that follow as arguments
+  //   (operands d, k, n, args...); the result goes to d
+  CALL,
+
+  // Return s; return nothing
+  RET, RETV,
+
+  // Read an integer into d; write s
+  INPUT, OUTPUT
+};
+
+/***********************************************************************/
+
+struct BcFunction
+{
+  std::string name;
+
+  // Offset of the first instruction in BcProgram::code
+  uint32_t entry = 0;
+
+  // Registers of a frame; the parameters are the first ones
+  uint32_t parameters = 0;
+  uint32_t registers = 0;
+
+  // Words of memory the function's arrays take, cleared on each call
+  uint32_t arrayWords = 0;
+};
+
+struct BcProgram
+{
+  std::vector<int32_t>    code;
+  std::vector<BcFunction> functions;
+
+  // Globals take the first words of memory
+  uint32_t globalWords = 0;
+
+  // Index of "main" in functions
+  uint32_t main = 0;
+
+  void
+  clear ()
+  {
+    code.clear ();
+    functions.clear ();
+    globalWords = 0;
+    main = 0;
+  }
+};
+
+/***********************************************************************/
+
+// Replaces program with the bytecode of module, whose functions must be
+//   in SSA form.  Raises a CompileError if module has no "main" or
+//   refers to an imported symbol, since only whole programs can run.
+void
+compileBytecode (const IrModule& module, BcProgram& program);
+
+/***********************************************************************/
+
+#endif
@@ -0,0 +1,704 @@
+/*
+  Filename   : BytecodeCompiler.cc
+  Author     : Philip Androwick
+  Description: Compiles SSA IR to bytecode, one function at a time.
+               Constants used only as the right operand of arithmetic or
+               comparisons become immediates, and a comparison used only
+               by the branch after it becomes a compare-and-branch.  The
+               other constants and the array addresses are loaded once,
+               on entry.  A value computed only for a phi is computed
+               into the phi's register where that is safe.  Blocks keep
+               their layout order, so a jump to the next block is left
+               out, and a jump back to a loop's test is replaced by the
+               test.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <stdexcept>
+
+/***********************************************************************/
+// Local includes
+
+#include "Bytecode.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+namespace
+{
+  const uint32_t NO_REGISTER = UINT32_MAX;
+
+  bool
+  isComparison (IrOpcode op)
+  {
+    return op >= IrOpcode::LT && op <= IrOpcode::NE;
+  }
+
+  // Instructions whose result never changes within a call; they are
+  // compiled into the function's prologue
+  bool
+  isHoisted (IrOpcode op)
+  {
+    return op == IrOpcode::CONST || op == IrOpcode::GLOBAL_ADDR || op == IrOpcode::FRAME_ADDR;
+  }
+
+  // The comparison that holds when op's operands are swapped, and the
+  // one that holds when op does not
+  IrOpcode
+  mirror (IrOpcode op)
+  {
+    switch (op)
+    {
+    case IrOpcode::LT: return IrOpcode::GT;
+    case IrOpcode::LE: return IrOpcode::GE;
+    case IrOpcode::GT: return IrOpcode::LT;
+    case IrOpcode::GE: return IrOpcode::LE;
+    default:           return op;
+    }
+  }
+
+  IrOpcode
+  negate (IrOpcode op)
+  {
+    switch (op)
+    {
+    case IrOpcode::LT: return IrOpcode::GE;
+    case IrOpcode::LE: return IrOpcode::GT;
+    case IrOpcode::GT: return IrOpcode::LE;
+    case IrOpcode::GE: return IrOpcode::LT;
+    case IrOpcode::EQ: return IrOpcode::NE;
+    default:           return IrOpcode::EQ;
+    }
+  }
+
+  // Offsets of the register, immediate and branch forms of each
+  // operation from its first form
+  BcOp
+  offset (BcOp first, IrOpcode op, IrOpcode firstOp)
+  {
+    return (BcOp) ((int32_t) first + ((int32_t) op - (int32_t) firstOp));
+  }
+
+  class FunctionCompiler
+  {
+  public:
+    FunctionCompiler (const IrModule& module, const IrFunction& function, uint32_t index,
+                      const std::vector<uint32_t>& globalAddresses, BcProgram& program)
+      : m_module (module), m_function (function), m_globals (globalAddresses),
+        m_code (program.code), m_info (program.functions[index])
+    { }
+
+    void
+    compile ();
+
+  private:
+    void
+    assignRegisters ();
+
+    void
+    compileInstruction (uint32_t block, const IrInstruction& instruction);
+
+    void
+    compileHoisted (const IrInstruction& instruction);
+
+    void
+    compileBranch (const IrInstruction& instruction);
+
+    // Whether block only tests a condition, so that a jump to it can be
+    // replaced by its branch
+    bool
+    isTest (uint32_t block) const;
+
+    // Values of block's successor's phis when it is entered from block
+    void
+    coalescePhiOperands (uint32_t block);
+
+    // Moves into the phis of block's successor, as if all at once
+    void
+    compilePhiMoves (uint32_t block);
+
+    // Value the register of value holds, following copies
+    uint32_t
+    root (uint32_t value) const
+    {
+      return m_root[value];
+    }
+
+    bool
+    isConstant (uint32_t value) const
+    {
+      return m_constant[root (value)];
+    }
+
+    int32_t
+    constantOf (uint32_t value) const
+    {
+      return (int32_t) m_function.instructions[m_definition[root (value)]].a;
+    }
+
+    // Register holding value; a constant read this way must be loaded
+    int32_t
+    reg (uint32_t value)
+    {
+      return (int32_t) m_register[root (value)];
+    }
+
+    void
+    emit (BcOp op)
+    {
+      m_code.push_back ((int32_t) op);
+    }
+
+    void
+    emit (BcOp op, int32_t x)
+    {
+      m_code.insert (m_code.end (), { (int32_t) op, x });
+    }
+
+    void
+    emit (BcOp op, int32_t x, int32_t y)
+    {
+      m_code.insert (m_code.end (), { (int32_t) op, x, y });
+    }
+
+    void
+    emit (BcOp op, int32_t x, int32_t y, int32_t z)
+    {
+      m_code.insert (m_code.end (), { (int32_t) op, x, y, z });
+    }
+
+    // Emits the word for a jump to block, patched once its offset is
+    // known
+    void
+    emitTarget (uint32_t block)
+    {
+      m_fixups.push_back ({ (uint32_t) m_code.size (), block });
+      m_code.push_back (0);
+    }
+
+    void
+    emitJump (uint32_t block)
+    {
+      emit (BcOp::JMP);
+      emitTarget (block);
+    }
+
+    const IrModule&   m_module;
+    const IrFunction& m_function;
+    const std::vector<uint32_t>& m_globals;
+    std::vector<int32_t>& m_code;
+    BcFunction&       m_info;
+
+    // Per value: its root, whether it is a constant, its defining
+    // instruction, its uses and its register
+    std::vector<uint32_t> m_root;
+    std::vector<bool>     m_constant;
+    std::vector<uint32_t> m_definition;
+    std::vector<uint32_t> m_uses;
+    std::vector<uint32_t> m_register;
+
+    // Values whose register some instruction reads, so that a constant
+    // among them has to be loaded
+    std::vector<bool> m_needsRegister;
+
+    // Comparisons compiled into the branch that uses them
+    std::vector<bool> m_fused;
+
+    // The phi each value computed into a phi's register is for, or
+    // IR_NO_VALUE
+    std::vector<uint32_t> m_coalesced;
+
+    // Register for breaking cycles of phi moves
+    uint32_t m_scratch = NO_REGISTER;
+
+    std::vector<uint32_t> m_blockOffsets;
+    std::vector<std::pair<uint32_t, uint32_t>> m_fixups;
+    uint32_t m_nextBlock = 0;
+  };
+
+  /*********************************************************************/
+
+  void
+  FunctionCompiler::assignRegisters ()
+  {
+    const std::vector<IrInstruction>& instructions = m_function.instructions;
+    size_t valueCount = m_function.types.size ();
+    m_root.resize (valueCount);
+    m_constant.assign (valueCount, false);
+    m_definition.assign (valueCount, 0);
+    m_uses.assign (valueCount, 0);
+    m_register.assign (valueCount, NO_REGISTER);
+    m_needsRegister.assign (valueCount, false);
+    m_fused.assign (valueCount, false);
+    m_coalesced.assign (valueCount, IR_NO_VALUE);
+
+    // A copy's source is defined before it, so one pass in order finds
+    // every root
+    for (uint32_t n = 0; n < instructions.size (); ++n)
+    {
+      const IrInstruction& instruction = instructions[n];
+      if (instruction.dest == IR_NO_VALUE)
+        continue;
+      m_definition[instruction.dest] = n;
+      m_root[instruction.dest] = instruction.op == IrOpcode::COPY ? m_root[instruction.a] : instruction.dest;
+      m_constant[instruction.dest] = instruction.op == IrOpcode::CONST;
+    }
+
+    // Count the uses of each root, then find the comparisons read only
+    // by the branch that ends their block: they are compiled into the
+    // branch
+    for (const IrInstruction& instruction : instructions)
+    {
+      if (instruction.op == IrOpcode::CALL || instruction.op == IrOpcode::PHI)
+        for (uint32_t k = 0; k < instruction.b; ++k)
+          ++m_uses[root (m_function.operands[instruction.a + k])];
+      else if (instruction.op != IrOpcode::COPY)
+        forEachOperand (instruction, [&] (const uint32_t& value) { ++m_uses[root (value)]; });
+    }
+    for (const IrBlock& b : m_function.blocks)
+    {
+      const IrInstruction& last = instructions[b.first + b.count - 1];
+      if (last.op != IrOpcode::BRANCH)
+        continue;
+      uint32_t condition = root (last.a);
+      const IrInstruction& definition = instructions[m_definition[condition]];
+      if (isComparison (definition.op) && m_uses[condition] == 1 && m_definition[condition] >= b.first
+          && m_definition[condition] < b.first + b.count)
+        m_fused[condition] = true;
+    }
+
+    // Then find the constants that must be loaded into a register
+    auto use = [&] (uint32_t value, bool immediate) {
+      if (!immediate)
+        m_needsRegister[root (value)] = true;
+    };
+    for (const IrInstruction& instruction : instructions)
+    {
+      switch (instruction.op)
+      {
+      case IrOpcode::COPY:
+        break;
+      case IrOpcode::PHI:
+        // Constants are loaded straight into the phi's register
+        break;
+      case IrOpcode::CALL:
+        for (uint32_t k = 0; k < instruction.b; ++k)
+          use (m_function.operands[instruction.a + k], false);
+        break;
+      case IrOpcode::LT: case IrOpcode::LE: case IrOpcode::GT:
+      case IrOpcode::GE: case IrOpcode::EQ: case IrOpcode::NE:
+        if (!m_fused[instruction.dest])
+        {
+          use (instruction.a, false);
+          use (instruction.b, false);
+          break;
+        }
+        // A compare-and-branch takes an immediate
+        [[fallthrough]];
+      case IrOpcode::ADD: case IrOpcode::MUL:
+        // Either operand can be the immediate one, but not both
+        use (instruction.a, isConstant (instruction.a) && !isConstant (instruction.b));
+        use (instruction.b, isConstant (instruction.b));
+        break;
+      case IrOpcode::SUB:
+        use (instruction.a, false);
+        use (instruction.b, isConstant (instruction.b));
+        break;
+      case IrOpcode::DIV:
+        use (instruction.a, false);
+        use (instruction.b, isConstant (instruction.b) && constantOf (instruction.b) != 0
+                            && constantOf (instruction.b) != -1);
+        break;
+      default:
+        forEachOperand (instruction, [&] (const uint32_t& value) { use (value, false); });
+        break;
+      }
+    }
+
+    for (uint32_t block = 0; block < m_function.blocks.size (); ++block)
+      coalescePhiOperands (block);
+
+    // Parameters come first; then every other root that is not an
+    // unloaded constant gets a register of its own, or shares its phi's
+    uint32_t next = (uint32_t) m_function.parameters.size ();
+    for (const IrInstruction& instruction : instructions)
+    {
+      uint32_t dest = instruction.dest;
+      if (dest == IR_NO_VALUE || root (dest) != dest || m_coalesced[dest] != IR_NO_VALUE)
+        continue;
+      if (instruction.op == IrOpcode::PARAM)
+        m_register[dest] = instruction.a;
+      else if (!m_fused[dest] && (!m_constant[dest] || m_needsRegister[dest]))
+        m_register[dest] = next++;
+    }
+    for (uint32_t value = 0; value < valueCount; ++value)
+      if (m_coalesced[value] != IR_NO_VALUE)
+        m_register[value] = m_register[m_coalesced[value]];
+    m_scratch = next++;
+    m_info.parameters = (uint32_t) m_function.parameters.size ();
+    m_info.registers = next;
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionCompiler::coalescePhiOperands (uint32_t block)
+  {
+    const IrBlock& b = m_function.blocks[block];
+    const std::vector<IrInstruction>& instructions = m_function.instructions;
+    if (instructions[b.first + b.count - 1].op != IrOpcode::JUMP)
+      return;
+    const IrBlock& s = m_function.blocks[b.successors[0]];
+    size_t slot = 0;
+    while (s.predecessors[slot] != block)
+      ++slot;
+
+    for (uint32_t n = s.first; n < s.first + s.count && instructions[n].op == IrOpcode::PHI; ++n)
+    {
+      uint32_t phi = instructions[n].dest;
+      uint32_t value = root (m_function.operands[instructions[n].a + slot]);
+      uint32_t definition = m_definition[value];
+      IrOpcode op = instructions[definition].op;
+      if (definition < b.first || definition >= b.first + b.count || op == IrOpcode::PHI
+          || op == IrOpcode::PARAM || isHoisted (op) || m_uses[value] != 1 || m_fused[value])
+        continue;
+
+      // The phi's register must not be read after the value is put in
+      // it, whether by the rest of the block or by another phi's move
+      bool safe = true;
+      auto check = [&] (const uint32_t& operand) {
+        if (root (operand) == phi)
+          safe = false;
+      };
+      for (uint32_t k = definition + 1; k < b.first + b.count && safe; ++k)
+      {
+        const IrInstruction& instruction = instructions[k];
+        if (instruction.op == IrOpcode::CALL)
+        {
+          for (uint32_t a = 0; a < instruction.b; ++a)
+            check (m_function.operands[instruction.a + a]);
+        }
+        else
+          forEachOperand (instruction, check);
+      }
+      for (uint32_t k = s.first; k < s.first + s.count && instructions[k].op == IrOpcode::PHI && safe; ++k)
+        if (k != n)
+          check (m_function.operands[instructions[k].a + slot]);
+      if (safe)
+        m_coalesced[value] = phi;
+    }
+  }
+
+  /*********************************************************************/
+
+  bool
+  FunctionCompiler::isTest (uint32_t block) const
+  {
+    const IrBlock& b = m_function.blocks[block];
+    const std::vector<IrInstruction>& instructions = m_function.instructions;
+    if (instructions[b.first + b.count - 1].op != IrOpcode::BRANCH)
+      return false;
+    for (uint32_t n = b.first; n < b.first + b.count - 1; ++n)
+    {
+      const IrInstruction& instruction = instructions[n];
+      bool compiledElsewhere = instruction.op == IrOpcode::PHI || instruction.op == IrOpcode::COPY
+        || isHoisted (instruction.op) || (instruction.dest != IR_NO_VALUE && m_fused[instruction.dest]);
+      if (!compiledElsewhere)
+        return false;
+    }
+    return true;
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionCompiler::compile ()
+  {
+    assignRegisters ();
+    m_info.entry = (uint32_t) m_code.size ();
+    for (uint32_t size : m_function.arrays)
+      m_info.arrayWords += size;
+
+    for (const IrInstruction& instruction : m_function.instructions)
+      if (isHoisted (instruction.op))
+        compileHoisted (instruction);
+
+    m_blockOffsets.assign (m_function.blocks.size (), 0);
+    for (uint32_t block = 0; block < m_function.blocks.size (); ++block)
+    {
+      m_blockOffsets[block] = (uint32_t) m_code.size ();
+      m_nextBlock = block + 1;
+      const IrBlock& b = m_function.blocks[block];
+      for (uint32_t n = b.first; n < b.first + b.count; ++n)
+        compileInstruction (block, m_function.instructions[n]);
+    }
+
+    for (const std::pair<uint32_t, uint32_t>& fixup : m_fixups)
+      m_code[fixup.first] = (int32_t) m_blockOffsets[fixup.second];
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionCompiler::compileInstruction (uint32_t block, const IrInstruction& instruction)
+  {
+    const IrInstruction& i = instruction;
+    switch (i.op)
+    {
+    case IrOpcode::CONST: case IrOpcode::GLOBAL_ADDR: case IrOpcode::FRAME_ADDR:
+    case IrOpcode::PARAM: case IrOpcode::COPY: case IrOpcode::PHI:
+      break;
+
+    case IrOpcode::ADD: case IrOpcode::SUB: case IrOpcode::MUL: case IrOpcode::DIV:
+    {
+      uint32_t left = i.a;
+      uint32_t right = i.b;
+      bool commutes = i.op == IrOpcode::ADD || i.op == IrOpcode::MUL;
+      if (commutes && isConstant (left) && !isConstant (right))
+        std::swap (left, right);
+      if (m_register[root (right)] == NO_REGISTER)
+        emit (offset (BcOp::ADDK, i.op, IrOpcode::ADD), reg (i.dest), reg (left), constantOf (right));
+      else
+        emit (offset (BcOp::ADD, i.op, IrOpcode::ADD), reg (i.dest), reg (left), reg (right));
+      break;
+    }
+
+    case IrOpcode::LT: case IrOpcode::LE: case IrOpcode::GT:
+    case IrOpcode::GE: case IrOpcode::EQ: case IrOpcode::NE:
+      if (!m_fused[i.dest])
+        emit (offset (BcOp::LT, i.op, IrOpcode::LT), reg (i.dest), reg (i.a), reg (i.b));
+      break;
+
+    case IrOpcode::LOAD_GLOBAL:
+      emit (BcOp::LOADG, reg (i.dest), (int32_t) m_globals[i.a]);
+      break;
+
+    case IrOpcode::STORE_GLOBAL:
+      emit (BcOp::STOREG, (int32_t) m_globals[i.a], reg (i.b));
+      break;
+
+    case IrOpcode::LOAD:
+      emit (BcOp::LOAD, reg (i.dest), reg (i.a), reg (i.b));
+      break;
+
+    case IrOpcode::STORE:
+      emit (BcOp::STORE, reg (i.a), reg (i.b), reg (i.c));
+      break;
+
+    case IrOpcode::CALL:
+    {
+      const IrFunction& callee = m_module.functions[i.c];
+      if (callee.external)
+        raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: \"%s\" is imported; only whole programs can be run\n\n",
+                    callee.name.c_str ());
+      // A void call's result register is never written
+      emit (BcOp::CALL, i.dest != IR_NO_VALUE ? reg (i.dest) : 0, (int32_t) i.c, (int32_t) i.b);
+      for (uint32_t k = 0; k < i.b; ++k)
+        m_code.push_back (reg (m_function.operands[i.a + k]));
+      break;
+    }
+
+    case IrOpcode::INPUT:
+      emit (BcOp::INPUT, reg (i.dest));
+      break;
+
+    case IrOpcode::OUTPUT:
+      emit (BcOp::OUTPUT, reg (i.a));
+      break;
+
+    case IrOpcode::JUMP:
+      compilePhiMoves (block);
+      if (i.a == m_nextBlock)
+        break;
+      if (isTest (i.a))
+      {
+        const IrBlock& test = m_function.blocks[i.a];
+        compileBranch (m_function.instructions[test.first + test.count - 1]);
+      }
+      else
+        emitJump (i.a);
+      break;
+
+    case IrOpcode::BRANCH:
+      compileBranch (i);
+      break;
+
+    case IrOpcode::RET:
+      if (i.a == IR_NO_VALUE)
+        emit (BcOp::RETV);
+      else
+        emit (BcOp::RET, reg (i.a));
+      break;
+    }
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionCompiler::compileHoisted (const IrInstruction& instruction)
+  {
+    const IrInstruction& i = instruction;
+    if (m_register[i.dest] == NO_REGISTER)
+      return;
+    if (i.op == IrOpcode::CONST)
+      emit (BcOp::LOADK, reg (i.dest), (int32_t) i.a);
+    else if (i.op == IrOpcode::GLOBAL_ADDR)
+      emit (BcOp::LOADK, reg (i.dest), (int32_t) m_globals[i.a]);
+    else
+    {
+      uint32_t offset = 0;
+      for (uint32_t n = 0; n < i.a; ++n)
+        offset += m_function.arrays[n];
+      emit (BcOp::FRAMEADDR, reg (i.dest), (int32_t) offset);
+    }
+  }
+
+  /*********************************************************************/
+
+  // Branches from the end of the block being compiled, which may be
+  // a jump to the block the branch ends
+  void
+  FunctionCompiler::compileBranch (const IrInstruction& instruction)
+  {
+    uint32_t thenBlock = instruction.b;
+    uint32_t elseBlock = instruction.c;
+    for (uint32_t successor : { thenBlock, elseBlock })
+    {
+      const IrBlock& s = m_function.blocks[successor];
+      if (m_function.instructions[s.first].op == IrOpcode::PHI)
+        throw std::logic_error ("bytecode: a branch in " + m_function.name + " leads to a phi");
+    }
+
+    // Branch to whichever successor does not follow
+    bool thenFollows = thenBlock == m_nextBlock;
+    uint32_t target = thenFollows ? elseBlock : thenBlock;
+    uint32_t condition = root (instruction.a);
+    if (!m_fused[condition])
+      emit (thenFollows ? BcOp::JZ : BcOp::JNZ, reg (condition));
+    else
+    {
+      const IrInstruction& comparison = m_function.instructions[m_definition[condition]];
+      IrOpcode op = thenFollows ? negate (comparison.op) : comparison.op;
+      uint32_t left = comparison.a;
+      uint32_t right = comparison.b;
+      if (m_register[root (left)] == NO_REGISTER)
+      {
+        std::swap (left, right);
+        op = mirror (op);
+      }
+      if (m_register[root (right)] == NO_REGISTER)
+        emit (offset (BcOp::BLTK, op, IrOpcode::LT), reg (left), constantOf (right));
+      else
+        emit (offset (BcOp::BLT, op, IrOpcode::LT), reg (left), reg (right));
+    }
+    emitTarget (target);
+    if (!thenFollows && elseBlock != m_nextBlock)
+      emitJump (elseBlock);
+  }
+
+  /*********************************************************************/
+
+  void
+  FunctionCompiler::compilePhiMoves (uint32_t block)
+  {
+    uint32_t successor = m_function.blocks[block].successors[0];
+    const IrBlock& s = m_function.blocks[successor];
+    const std::vector<uint32_t>& predecessors = s.predecessors;
+    size_t slot = 0;
+    while (predecessors[slot] != block)
+      ++slot;
+
+    // (destination, source register) pairs, and constants to load
+    std::vector<std::pair<uint32_t, uint32_t>> moves;
+    std::vector<std::pair<uint32_t, int32_t>> loads;
+    for (uint32_t n = s.first; n < s.first + s.count; ++n)
+    {
+      const IrInstruction& phi = m_function.instructions[n];
+      if (phi.op != IrOpcode::PHI)
+        break;
+      uint32_t source = m_function.operands[phi.a + slot];
+      uint32_t dest = m_register[phi.dest];
+      if (m_register[root (source)] == NO_REGISTER)
+        loads.push_back ({ dest, constantOf (source) });
+      else if (m_register[root (source)] != dest)
+        moves.push_back ({ dest, m_register[root (source)] });
+    }
+
+    // A move may go ahead once no other move still reads its
+    // destination; when every move is blocked they form cycles, one of
+    // which is broken by saving a source in the scratch register
+    while (!moves.empty ())
+    {
+      bool progressed = false;
+      for (size_t n = 0; n < moves.size (); ++n)
+      {
+        bool blocked = false;
+        for (size_t m = 0; m < moves.size () && !blocked; ++m)
+          blocked = m != n && moves[m].second == moves[n].first;
+        if (blocked)
+          continue;
+        emit (BcOp::MOV, (int32_t) moves[n].first, (int32_t) moves[n].second);
+        moves.erase (moves.begin () + n);
+        progressed = true;
+        break;
+      }
+      if (!progressed)
+      {
+        uint32_t saved = moves[0].second;
+        emit (BcOp::MOV, (int32_t) m_scratch, (int32_t) saved);
+        for (std::pair<uint32_t, uint32_t>& move : moves)
+          if (move.second == saved)
+            move.second = m_scratch;
+      }
+    }
+    for (const std::pair<uint32_t, int32_t>& load : loads)
+      emit (BcOp::LOADK, (int32_t) load.first, load.second);
+  }
+}
+
+/***********************************************************************/
+
+void
+compileBytecode (const IrModule& module, BcProgram& program)
+{
+  program.clear ();
+
+  std::vector<uint32_t> globalAddresses;
+  for (const IrGlobal& global : module.globals)
+  {
+    if (global.external)
+      raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: \"%s\" is imported; only whole programs can be run\n\n",
+                  global.name.c_str ());
+    globalAddresses.push_back (program.globalWords);
+    program.globalWords += global.size;
+  }
+
+  // Every function gets its entry before any is compiled, so calls can
+  // name functions that come later
+  bool foundMain = false;
+  program.functions.resize (module.functions.size ());
+  for (uint32_t n = 0; n < module.functions.size (); ++n)
+  {
+    program.functions[n].name = module.functions[n].name;
+    if (module.functions[n].name == "main" && !module.functions[n].external)
+    {
+      program.main = n;
+      foundMain = true;
+    }
+  }
+  if (!foundMain)
+    raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: \"main\" function was never declared\n\n");
+
+  for (uint32_t n = 0; n < module.functions.size (); ++n)
+  {
+    const IrFunction& function = module.functions[n];
+    if (function.external)
+      continue;
+    if (!function.ssa)
+      throw std::logic_error ("bytecode: " + function.name + " is not in SSA form");
+    FunctionCompiler compiler (module, function, n, globalAddresses, program);
+    compiler.compile ();
+  }
+}
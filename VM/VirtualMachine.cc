@@ -0,0 +1,245 @@
+/*
+  Filename   : VirtualMachine.cc
+  Author     : Philip Androwick
+  Description: The interpreter loop.  The state of the running call (pc,
+               registers, array base and function) lives in locals, and
+               is saved in a Frame only across calls.
+*/
+
+/***********************************************************************/
+// System includes
+
+#include <cstring>
+
+/***********************************************************************/
+// Local includes
+
+#include "VirtualMachine.h"
+#include "../Compiler/Diagnostic.h"
+
+/***********************************************************************/
+
+#if defined (__GNUC__) && !defined (CMINUS_SWITCH_DISPATCH)
+#define VM_COMPUTED_GOTO
+#endif
+
+// The opcode of the instruction at pc, which is about to run
+#ifdef CMINUS_COUNT_INSTRUCTIONS
+#define OPCODE (++m_executed, *pc)
+#else
+#define OPCODE (*pc)
+#endif
+
+/***********************************************************************/
+
+VirtualMachine::VirtualMachine (size_t stackWords)
+  : m_stackWords (stackWords), m_memoryWords (0), m_executed (0)
+{
+}
+
+/***********************************************************************/
+
+void
+VirtualMachine::run (const BcProgram& program, FILE* in, FILE* out)
+{
+  if (m_registers == nullptr)
+    m_registers.reset (new int32_t[m_stackWords]);
+  if (m_memoryWords < program.globalWords + m_stackWords)
+  {
+    m_memoryWords = program.globalWords + m_stackWords;
+    m_memory.reset (new int32_t[m_memoryWords]);
+  }
+  std::memset (m_memory.get (), 0, program.globalWords * sizeof (int32_t));
+  m_frames.clear ();
+  m_executed = 0;
+
+  const BcFunction* functions = program.functions.data ();
+  const int32_t*    code = program.code.data ();
+  int32_t*          memory = m_memory.get ();
+  uint32_t          memoryWords = (uint32_t) m_memoryWords;
+  int32_t*          registersEnd = m_registers.get () + m_stackWords;
+
+  // State of the running call
+  uint32_t       function = program.main;
+  const int32_t* pc = code + functions[function].entry;
+  int32_t*       r = m_registers.get ();
+  uint32_t       arrays = program.globalWords;
+  if (functions[function].registers > m_stackWords)
+    raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: Stack overflow in \"main\"\n\n");
+
+  auto fail = [&] (const char* what) {
+    raiseError (DiagnosticPhase::RUNTIME, 0, 0, "\nERROR: %s in \"%s\"\n\n", what,
+                functions[function].name.c_str ());
+  };
+
+  // Arithmetic is done on unsigned values so that it wraps
+#define ARITHMETIC(op) r[pc[1]] = (int32_t) ((uint32_t) r[pc[2]] op (uint32_t) r[pc[3]])
+#define ARITHMETIC_K(op) r[pc[1]] = (int32_t) ((uint32_t) r[pc[2]] op (uint32_t) pc[3])
+#define COMPARE(op) r[pc[1]] = r[pc[2]] op r[pc[3]]
+#define BRANCH(op) pc = r[pc[1]] op r[pc[2]] ? code + pc[3] : pc + 4
+#define BRANCH_K(op) pc = r[pc[1]] op pc[2] ? code + pc[3] : pc + 4
+
+#ifdef VM_COMPUTED_GOTO
+  // In the order of BcOp
+  static void* const handlers[] = {
+    &&op_LOADK, &&op_MOV,
+    &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV,
+    &&op_ADDK, &&op_SUBK, &&op_MULK, &&op_DIVK,
+    &&op_LT, &&op_LE, &&op_GT, &&op_GE, &&op_EQ, &&op_NE,
+    &&op_JMP, &&op_JZ, &&op_JNZ,
+    &&op_BLT, &&op_BLE, &&op_BGT, &&op_BGE, &&op_BEQ, &&op_BNE,
+    &&op_BLTK, &&op_BLEK, &&op_BGTK, &&op_BGEK, &&op_BEQK, &&op_BNEK,
+    &&op_FRAMEADDR, &&op_LOADG, &&op_STOREG,
+    &&op_LOAD, &&op_STORE,
+    &&op_CALL, &&op_RET, &&op_RETV,
+    &&op_INPUT, &&op_OUTPUT
+  };
+  static_assert (sizeof (handlers) / sizeof (handlers[0]) == (size_t) BcOp::OUTPUT + 1,
+                 "a BcOp has no handler");
+#define CASE(op) op_##op:
+#define NEXT goto *handlers[OPCODE]
+#define DISPATCH NEXT;
+#else
+#define CASE(op) case (int32_t) BcOp::op:
+#define NEXT break
+#define DISPATCH for (;;) switch (OPCODE)
+#endif
+
+  std::memset (memory + arrays, 0, functions[function].arrayWords * sizeof (int32_t));
+  DISPATCH
+  {
+    CASE (LOADK) r[pc[1]] = pc[2]; pc += 3; NEXT;
+    CASE (MOV) r[pc[1]] = r[pc[2]]; pc += 3; NEXT;
+
+    CASE (ADD) ARITHMETIC (+); pc += 4; NEXT;
+    CASE (SUB) ARITHMETIC (-); pc += 4; NEXT;
+    CASE (MUL) ARITHMETIC (*); pc += 4; NEXT;
+    CASE (DIV)
+    {
+      int32_t divisor = r[pc[3]];
+      if (divisor == 0)
+        fail ("Division by zero");
+      // INT_MIN / -1 overflows; it wraps to INT_MIN
+      r[pc[1]] = divisor == -1 ? (int32_t) (0u - (uint32_t) r[pc[2]]) : r[pc[2]] / divisor;
+      pc += 4;
+      NEXT;
+    }
+    CASE (ADDK) ARITHMETIC_K (+); pc += 4; NEXT;
+    CASE (SUBK) ARITHMETIC_K (-); pc += 4; NEXT;
+    CASE (MULK) ARITHMETIC_K (*); pc += 4; NEXT;
+    CASE (DIVK) r[pc[1]] = r[pc[2]] / pc[3]; pc += 4; NEXT;
+
+    CASE (LT) COMPARE (<); pc += 4; NEXT;
+    CASE (LE) COMPARE (<=); pc += 4; NEXT;
+    CASE (GT) COMPARE (>); pc += 4; NEXT;
+    CASE (GE) COMPARE (>=); pc += 4; NEXT;
+    CASE (EQ) COMPARE (==); pc += 4; NEXT;
+    CASE (NE) COMPARE (!=); pc += 4; NEXT;
+
+    CASE (JMP) pc = code + pc[1]; NEXT;
+    CASE (JZ) pc = r[pc[1]] == 0 ? code + pc[2] : pc + 3; NEXT;
+    CASE (JNZ) pc = r[pc[1]] != 0 ? code + pc[2] : pc + 3; NEXT;
+
+    CASE (BLT) BRANCH (<); NEXT;
+    CASE (BLE) BRANCH (<=); NEXT;
+    CASE (BGT) BRANCH (>); NEXT;
+    CASE (BGE) BRANCH (>=); NEXT;
+    CASE (BEQ) BRANCH (==); NEXT;
+    CASE (BNE) BRANCH (!=); NEXT;
+    CASE (BLTK) BRANCH_K (<); NEXT;
+    CASE (BLEK) BRANCH_K (<=); NEXT;
+    CASE (BGTK) BRANCH_K (>); NEXT;
+    CASE (BGEK) BRANCH_K (>=); NEXT;
+    CASE (BEQK) BRANCH_K (==); NEXT;
+    CASE (BNEK) BRANCH_K (!=); NEXT;
+
+    CASE (FRAMEADDR) r[pc[1]] = (int32_t) (arrays + pc[2]); pc += 3; NEXT;
+    CASE (LOADG) r[pc[1]] = memory[pc[2]]; pc += 3; NEXT;
+    CASE (STOREG) memory[pc[1]] = r[pc[2]]; pc += 3; NEXT;
+
+    CASE (LOAD)
+    {
+      uint32_t address = (uint32_t) r[pc[2]] + (uint32_t) r[pc[3]];
+      if (address >= memoryWords)
+        fail ("Array index out of bounds");
+      r[pc[1]] = memory[address];
+      pc += 4;
+      NEXT;
+    }
+    CASE (STORE)
+    {
+      uint32_t address = (uint32_t) r[pc[1]] + (uint32_t) r[pc[2]];
+      if (address >= memoryWords)
+        fail ("Array index out of bounds");
+      memory[address] = r[pc[3]];
+      pc += 4;
+      NEXT;
+    }
+
+    CASE (CALL)
+    {
+      const BcFunction& callee = functions[pc[2]];
+      int32_t* base = r + functions[function].registers;
+      uint32_t calleeArrays = arrays + functions[function].arrayWords;
+      if (callee.registers > (size_t) (registersEnd - base) || callee.arrayWords > memoryWords - calleeArrays)
+        fail ("Stack overflow (recursion too deep)");
+      uint32_t count = (uint32_t) pc[3];
+      for (uint32_t n = 0; n < count; ++n)
+        base[n] = r[pc[4 + n]];
+      std::memset (memory + calleeArrays, 0, callee.arrayWords * sizeof (int32_t));
+
+      m_frames.push_back ({ pc + 4 + count, r, arrays, function, pc[1] });
+      function = (uint32_t) pc[2];
+      r = base;
+      arrays = calleeArrays;
+      pc = code + callee.entry;
+      NEXT;
+    }
+    CASE (RET)
+    {
+      int32_t value = r[pc[1]];
+      if (m_frames.empty ())
+        return;
+      const Frame& caller = m_frames.back ();
+      caller.registers[caller.dest] = value;
+      pc = caller.returnPc;
+      r = caller.registers;
+      arrays = caller.arrays;
+      function = caller.function;
+      m_frames.pop_back ();
+      NEXT;
+    }
+    CASE (RETV)
+    {
+      if (m_frames.empty ())
+        return;
+      const Frame& caller = m_frames.back ();
+      pc = caller.returnPc;
+      r = caller.registers;
+      arrays = caller.arrays;
+      function = caller.function;
+      m_frames.pop_back ();
+      NEXT;
+    }
+
+    CASE (INPUT)
+    {
+      int value;
+      if (fscanf (in, "%d", &value) != 1)
+        fail ("No integer left to read");
+      r[pc[1]] = value;
+      pc += 2;
+      NEXT;
+    }
+    CASE (OUTPUT) fprintf (out, "%d\n", r[pc[1]]); pc += 2; NEXT;
+  }
+
+#undef ARITHMETIC
+#undef ARITHMETIC_K
+#undef COMPARE
+#undef BRANCH
+#undef BRANCH_K
+#undef CASE
+#undef NEXT
+#undef DISPATCH
+}
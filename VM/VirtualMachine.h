@@ -0,0 +1,81 @@
+/*
+  Filename   : VirtualMachine.h
+  Author     : Philip Androwick
+  Description: Virtual machine that runs bytecode (Bytecode.h).  Each
+               call gets a frame of registers on one register stack, and
+               its arrays a block of one linear memory that starts with
+               the globals.  Instructions are dispatched with computed
+               gotos where the compiler has them (GCC and Clang), and
+               with a switch otherwise or when CMINUS_SWITCH_DISPATCH is
+               defined.  Built with CMINUS_COUNT_INSTRUCTIONS defined, it
+               counts the instructions it runs.
+*/
+
+/***********************************************************************/
+
+#ifndef VIRTUAL_MACHINE_H
+#define VIRTUAL_MACHINE_H
+
+/***********************************************************************/
+// System includes
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+/***********************************************************************/
+// Local includes
+
+#include "Bytecode.h"
+
+/***********************************************************************/
+
+class VirtualMachine
+{
+public:
+  // Words of the register stack, and of the memory for the frames'
+  //   arrays; together they bound the depth of recursion
+  static const size_t DEFAULT_STACK_WORDS = 1 << 22;
+
+  explicit VirtualMachine (size_t stackWords = DEFAULT_STACK_WORDS);
+
+  // Runs main of program, reading input from in and writing output to
+  //   out.  Integer arithmetic wraps.  Dividing by zero, reaching
+  //   outside memory, recursing too deeply and running out of input
+  //   are raised as a CompileError with DiagnosticPhase::RUNTIME.
+  void
+  run (const BcProgram& program, FILE* in, FILE* out);
+
+  // Instructions the last run ran; 0 unless CMINUS_COUNT_INSTRUCTIONS
+  //   is defined
+  uint64_t
+  getExecutedCount () const
+  {
+    return m_executed;
+  }
+
+private:
+  // What a call saves of its caller
+  struct Frame
+  {
+    const int32_t* returnPc;
+    int32_t*       registers;
+    uint32_t       arrays;
+    uint32_t       function;
+    int32_t        dest;
+  };
+
+  size_t m_stackWords;
+  // Allocated on the first run and left uninitialized: a frame's
+  //   registers are written before they are read, and the globals and
+  //   each frame's arrays are cleared when they come into being
+  std::unique_ptr<int32_t[]> m_registers;
+  std::unique_ptr<int32_t[]> m_memory;
+  size_t m_memoryWords;
+  std::vector<Frame> m_frames;
+  uint64_t m_executed;
+};
+
+/***********************************************************************/
+
+#endif